@@ -0,0 +1,147 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+/** \file audio_statistics.h
+ *  \brief Defines class CAudioStatistics
+ */
+
+#ifndef INTEGRA_AUDIO_STATISTICS_H
+#define INTEGRA_AUDIO_STATISTICS_H
+
+#include "common_typedefs.h"
+
+#include <stdint.h>
+
+namespace integra_api
+{
+	/** \class CAudioStatistics audio_statistics.h "api/audio_statistics.h"
+	 *  \brief Describes how much of each audio callback's time budget dsp processing uses, and any dropouts
+	 *
+	 *  libIntegra collects a new set of audio statistics once per statistics period (see IServer::get_audio_statistics).
+	 *  Timings describe only the dsp blocks processed during the most recent period, so that a slow block is 
+	 *  reported promptly rather than being averaged away.  Counts are totals since the server started, so that 
+	 *  monitoring tools can't miss a dropout by polling less often than once per period.
+	 *
+	 *  The same figures are published to the read-only statistics endpoints of every AudioSettings module.
+	 */	
+	class INTEGRA_API CAudioStatistics
+	{
+		public:
+
+			CAudioStatistics()
+			{
+				period_seconds = 0;
+				blocks_processed = 0;
+				budget_microseconds = 0;
+				min_microseconds = 0;
+				mean_microseconds = 0;
+				p99_microseconds = 0;
+				p999_microseconds = 0;
+				max_microseconds = 0;
+				mean_budget_percent = 0;
+				max_budget_percent = 0;
+				total_blocks_processed = 0;
+				total_blocks_skipped = 0;
+				input_underflows = 0;
+				input_overflows = 0;
+				output_underflows = 0;
+				output_overflows = 0;
+				ring_buffer_overruns = 0;
+				ring_buffer_underruns = 0;
+				stream_cpu_load = 0;
+			}
+
+			/** \brief Total number of xruns (input and output underflows and overflows) reported by the audio driver */
+			int64_t get_xruns() const { return input_underflows + input_overflows + output_underflows + output_overflows; }
+
+			/** \brief Length of the period which the timings below describe */
+			double period_seconds;
+
+			/** \brief Number of dsp blocks processed during the period */
+			int64_t blocks_processed;
+
+			/** \brief Time available to process one dsp block at the current sample rate */
+			double budget_microseconds;
+
+			/** \brief Fastest dsp block of the period */
+			double min_microseconds;
+
+			/** \brief Mean dsp block time during the period */
+			double mean_microseconds;
+
+			/** \brief 99th percentile dsp block time during the period
+			 *
+			 * \note Percentiles are read from a histogram, so they are rounded up to the histogram's resolution of
+			 * a few microseconds.  min_microseconds, mean_microseconds and max_microseconds are exact.
+			 */
+			double p99_microseconds;
+
+			/** \brief 99.9th percentile dsp block time during the period */
+			double p999_microseconds;
+
+			/** \brief Slowest dsp block of the period */
+			double max_microseconds;
+
+			/** \brief mean_microseconds as a percentage of budget_microseconds */
+			double mean_budget_percent;
+
+			/** \brief max_microseconds as a percentage of budget_microseconds.  Over 100 means at least one block was late */
+			double max_budget_percent;
+
+			/** \brief Number of dsp blocks processed since the server started */
+			int64_t total_blocks_processed;
+
+			/** \brief Number of blocks output as silence because the dsp engine was busy with a synchronous control operation */
+			int64_t total_blocks_skipped;
+
+			/** \brief Input underflows reported by the audio driver since the server started */
+			int64_t input_underflows;
+
+			/** \brief Input overflows reported by the audio driver since the server started */
+			int64_t input_overflows;
+
+			/** \brief Output underflows reported by the audio driver since the server started */
+			int64_t output_underflows;
+
+			/** \brief Output overflows reported by the audio driver since the server started */
+			int64_t output_overflows;
+
+			/** \brief Number of times processed audio was dropped because the ring buffer between separate input 
+			 *  and output devices was full
+			 */
+			int64_t ring_buffer_overruns;
+
+			/** \brief Number of times silence was output because the ring buffer between separate input and 
+			 *  output devices was empty
+			 */
+			int64_t ring_buffer_underruns;
+
+			/** \brief The audio driver's own estimate of the fraction of cpu time used by its callbacks, from 0 to 1
+			 *
+			 * \note stream_cpu_load is 0 when no audio device is open
+			 */
+			double stream_cpu_load;
+	};
+}
+
+
+
+#endif
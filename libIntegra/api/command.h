@@ -48,6 +48,7 @@ namespace integra_internal
 namespace integra_api
 {
 	class CPath;
+	class CEndpointHandle;
 	class CValue;
 	class CCommandResult;
 	class CCommandSource;
@@ -136,7 +137,27 @@ namespace integra_api
 			 */
 			static ISetCommand *create( const CPath &endpoint_path );
 
+			/** \brief Create an instance of ISetCommand from an endpoint handle
+			 * Use this one to set the value of a stateful control endpoint which is addressed repeatedly, 
+			 * to avoid looking up its path each time.  See CEndpointHandle
+			 * \param endpoint_handle the node endpoint to set
+			 * \param value the new value
+			 * \return a pointer to the command, created on the heap.
+			 */
+			static ISetCommand *create( const CEndpointHandle &endpoint_handle, const CValue &value );
+
+			/** \brief Create an instance of ISetCommand from an endpoint handle
+			 * Use this one to send a bang to a stateless control endpoint which is addressed repeatedly.  See CEndpointHandle
+			 * \param endpoint_handle the node endpoint to bang
+			 * \return a pointer to the command, created on the heap.
+			 */
+			static ISetCommand *create( const CEndpointHandle &endpoint_handle );
+
+			/** \return the path the command was created with, or an empty path if it was created from a handle */
 			virtual const CPath &get_endpoint_path() const = 0;
+
+			/** \return the handle the command was created with, or a null handle if it was created from a path */
+			virtual const CEndpointHandle &get_endpoint_handle() const = 0;
 	};
 
 
@@ -218,6 +239,49 @@ namespace integra_api
 			 */
 			static ISaveCommand *create( const string &file_path, const CPath &node_path );
 	};
+
+
+	/** \class ICommandBatch command.h "api/command.h"
+	 *  \brief Command which applies a sequence of other commands as a single transaction
+	 *
+	 * Use ICommandBatch for bulk operations such as scene recalls and preset loads, which would 
+	 * otherwise issue thousands of individual commands.  The batch is processed like any other 
+	 * command, by passing it into IServer::process_command.  
+	 *
+	 * Before anything is applied, every ISetCommand in the batch is checked (endpoint path, value 
+	 * type and constraint).  If any check fails the whole batch is rejected and the session is left 
+	 * unchanged.  Set commands addressing nodes which are created earlier in the same batch can only 
+	 * be checked when they are applied.
+	 *
+	 * While the batch is applied, values sent to the dsp engine are coalesced so that only the last 
+	 * value of each endpoint is sent, and INotificationSink::on_set_command is called once per 
+	 * endpoint after the last command has been applied.
+	 *
+	 * \note If a command fails while the batch is being applied (eg a set command addressing a node 
+	 * which an earlier command failed to create), the remaining commands are discarded.  Commands which 
+	 * have already been applied are not rolled back.
+	 */
+	class INTEGRA_API ICommandBatch : public ICommand
+	{
+		protected:
+			ICommandBatch() {}
+		public:
+			virtual ~ICommandBatch() {}
+
+			/** \brief Create an empty instance of ICommandBatch
+			 * \return a pointer to the command, created on the heap.
+			 */
+			static ICommandBatch *create();
+
+			/** \brief Append a command to the batch
+			 * \param command the command to append, created on the heap.  The batch takes ownership of the command.
+			 */
+			virtual void add_command( ICommand *command ) = 0;
+
+			/** \brief Number of commands in the batch
+			 */
+			virtual int get_number_of_commands() const = 0;
+	};
 }
 
 
@@ -34,6 +34,8 @@
 namespace integra_api
 {
 	class CServerStartupInfo;
+	class COfflineRenderInfo;
+	class COfflineRenderResult;
 	class IServer;
 
 	/** \class CIntegraSession integra_session.h "api/integra_session.h"
@@ -82,6 +84,20 @@ namespace integra_api
 			*/
 			CServerLock get_server();
 
+			/** \brief Render audio offline, as fast as possible
+			*
+			* Optionally loads a collection and starts players, then processes audio in a tight loop for the requested 
+			* duration, at the requested sample rate and channel count, writing the output to a file.  Players are advanced in step 
+			* with the rendered audio, so the result is the same however fast the machine is.
+			* The session must have been started with CServerStartupInfo::offline_rendering set to true.  
+			* This method locks the server as it needs to, so it mustn't be called by a thread which holds a CServerLock.
+			*
+			* \param render_info describes what to render and where to write it
+			* \param result if not NULL, receives statistics about the render, including its realtime factor
+			* \return error if the session isn't an offline session, if the collection couldn't be loaded or if the output file couldn't be written
+			*/
+			CError render_offline( const COfflineRenderInfo &render_info, COfflineRenderResult *result = NULL );
+
 		private:	
 
 			IServer *m_server;
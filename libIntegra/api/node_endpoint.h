@@ -38,6 +38,43 @@ namespace integra_api
 	class CPath;
 
 
+	/** \class CEndpointHandle node_endpoint.h "api/node_endpoint.h"
+	 *  \brief A stable reference to a node endpoint, which can be resolved without a path lookup
+	 *
+	 * Obtain a handle from INodeEndpoint::get_handle, and pass it to ISetCommand::create or IServer::get_value 
+	 * instead of a path when the same endpoint is addressed repeatedly.  A handle remains valid when the 
+	 * endpoint's node (or any of its ancestors) is renamed or moved.  When the node is deleted the handle 
+	 * becomes stale, and is never reused for another endpoint - resolving it simply fails.
+	 */
+	class INTEGRA_API CEndpointHandle
+	{
+		public:
+
+			/** \brief Construct a null handle, which never resolves to an endpoint */
+			CEndpointHandle();
+
+			/** \brief Internal use only */
+			CEndpointHandle( unsigned int slot, unsigned int generation );
+
+			/** \brief Equality operator */
+			bool operator==( const CEndpointHandle &to_compare ) const;
+
+			/** \return true if the handle was default-constructed */
+			bool is_null() const;
+
+			/** \brief Internal use only */
+			unsigned int get_slot() const { return m_slot; }
+
+			/** \brief Internal use only */
+			unsigned int get_generation() const { return m_generation; }
+
+		private:
+
+			unsigned int m_slot;
+			unsigned int m_generation;
+	};
+
+
 	/** \class INodeEndpoint node_endpoint.h "api/node_endpoint.h"
 	 *  \brief Represents a node endpoint
 	 *
@@ -72,6 +109,12 @@ namespace integra_api
 			 * The node endpoint's path consists of the owning node's path, with the node endpoint's name (from the endpoint definition ) appended to it.
 			 */
 			virtual const CPath &get_path() const = 0;
+
+			/** \brief Get node endpoint's handle
+			 *
+			 * The handle identifies this node endpoint for as long as it exists, regardless of renames and moves.  See CEndpointHandle
+			 */
+			virtual const CEndpointHandle &get_handle() const = 0;
 	};
 
 
@@ -0,0 +1,134 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, 
+ * USA.
+ */
+
+/** \file offline_render.h
+ *  \brief Defines classes COfflineRenderInfo and COfflineRenderResult
+ */
+
+#ifndef INTEGRA_OFFLINE_RENDER_H
+#define INTEGRA_OFFLINE_RENDER_H
+
+#include "common_typedefs.h"
+
+#include <stdint.h>
+
+namespace integra_api
+{
+	/** \class COfflineRenderInfo offline_render.h "api/offline_render.h"
+	 *  \brief Describes an offline render
+	 *
+	 *  COfflineRenderInfo is passed into CIntegraSession::render_offline.  The session must have been started 
+	 *  with CServerStartupInfo::offline_rendering set to true.
+	 */	
+	class INTEGRA_API COfflineRenderInfo
+	{
+		public:
+
+			/** \brief Format of the rendered audio file */
+			enum file_format
+			{
+				/** 32-bit float WAV */
+				WAV,
+
+				/** headerless interleaved 32-bit floats, in the machine's byte order */
+				RAW_FLOAT
+			};
+
+			/** \brief Construct default render info - 10 seconds of stereo at 44100 Hz, written as WAV */
+			COfflineRenderInfo()
+			{
+				collection_file = "";
+				output_file = "";
+				format = WAV;
+				sample_rate = 44100;
+				input_channels = 0;
+				output_channels = 2;
+				duration_seconds = 10;
+			}
+
+			/** \brief An .integra file to load into the top level of the session before rendering
+			 *
+			 * \note collection_file is not required.  Leave it empty to render whatever the session already contains.
+			 */
+			string collection_file;
+
+			/** \brief Paths of players to start at the beginning of the render
+			 *
+			 * Each player's play endpoint is set to 1 once the collection has been loaded.  Players which are already 
+			 * playing carry on.  Either way, players are advanced in step with the rendered audio rather than the system clock.
+			 */
+			string_vector players_to_start;
+
+			/** \brief The file to write the rendered audio to
+			 *
+			 * \note output_file is not required.  Leave it empty to render without writing anything, eg to measure how 
+			 * much faster than realtime a collection can be rendered.
+			 */
+			string output_file;
+
+			/** \brief Format of output_file */
+			file_format format;
+
+			/** \brief Sample rate to render at.  Any positive rate is accepted */
+			int sample_rate;
+
+			/** \brief Number of input channels.  Inputs are silent during offline rendering */
+			int input_channels;
+
+			/** \brief Number of output channels to render and write */
+			int output_channels;
+
+			/** \brief Length of the render.  It is rounded up to a whole number of dsp blocks */
+			double duration_seconds;
+	};
+
+
+	/** \class COfflineRenderResult offline_render.h "api/offline_render.h"
+	 *  \brief Statistics about a completed offline render
+	 */	
+	class INTEGRA_API COfflineRenderResult
+	{
+		public:
+
+			COfflineRenderResult()
+			{
+				frames_rendered = 0;
+				rendered_seconds = 0;
+				elapsed_seconds = 0;
+				realtime_factor = 0;
+			}
+
+			/** \brief Number of sample frames rendered per channel */
+			int64_t frames_rendered;
+
+			/** \brief Duration of the rendered audio */
+			double rendered_seconds;
+
+			/** \brief Wall-clock time taken to render it, excluding loading the collection */
+			double elapsed_seconds;
+
+			/** \brief rendered_seconds / elapsed_seconds - how many times faster than realtime the render ran */
+			double realtime_factor;
+	};
+}
+
+
+
+#endif
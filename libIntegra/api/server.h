@@ -40,6 +40,7 @@ namespace integra_api
 	class ICommand;
 	class IModuleManager;
 	class IInterfaceDefinition;
+	class CAudioStatistics;
 
 
 	/** \class IServer server.h "api/server.h"
@@ -101,6 +102,14 @@ namespace integra_api
 			 */
 			virtual const INodeEndpoint *find_node_endpoint( const CPath &path, const INode *relative_to = NULL ) const = 0;
 
+			/** \brief Lookup a node endpoint by its handle
+			 *
+			 * This is cheaper than lookup by path, since no string needs to be hashed.  See CEndpointHandle
+			 * \param handle a handle previously obtained from INodeEndpoint::get_handle
+			 * \return the node endpoint, or NULL if its node has been deleted
+			 */
+			virtual const INodeEndpoint *find_node_endpoint( const CEndpointHandle &handle ) const = 0;
+
 			/** \brief Lookup the value of a stateful control node endpoint
 			 *
 			 * \param path path of the node endpoint
@@ -108,6 +117,13 @@ namespace integra_api
 			 */
 			virtual const CValue *get_value( const CPath &path ) const = 0;
 
+			/** \brief Lookup the value of a stateful control node endpoint by its handle
+			 *
+			 * \param handle a handle previously obtained from INodeEndpoint::get_handle
+			 * \return the node endpoint's value, or NULL if its node has been deleted, or it is not a stateful control
+			 */
+			virtual const CValue *get_value( const CEndpointHandle &handle ) const = 0;
+
 			/** \brief Alter libIntegra's state by passing in a subclass of CCommand 
 			 *
 			 * \param command The command should be created using one of the IXXXCommand::create methods (see ICommand)
@@ -134,6 +150,14 @@ namespace integra_api
 			 */			
 			virtual string get_libintegra_version() const = 0;
 
+			/** \brief Get dsp load and dropout statistics
+			 *
+			 * Statistics are collected once a second, and the same figures are published to the read-only 
+			 * statistics endpoints of AudioSettings modules.  See CAudioStatistics
+			 * \return the most recently collected statistics.  All fields are 0 until the first second has elapsed
+			 */			
+			virtual CAudioStatistics get_audio_statistics() const = 0;
+
 			/** \brief Testing function
 			 *
 			 * Dumps state of all existing nodes and their stateful endpoints to output console
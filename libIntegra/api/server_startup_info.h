@@ -46,6 +46,11 @@ namespace integra_api
 			{
 				system_module_directory = "";
 				third_party_module_directory = "";
+				module_cache_directory = "";
+				extract_module_implementations = false;
+				player_lookahead_milliseconds = 50;
+				render_envelopes_in_dsp = false;
+				offline_rendering = false;
 		
 				notification_sink = NULL;
 			}
@@ -63,6 +68,52 @@ namespace integra_api
 			 * \note This directory is required - libIntegra won't work unless it is provided
 			 */
 			string third_party_module_directory;
+
+			/** \brief Disk location for a persistent cache of loaded modules
+			 *
+			 * When provided, libIntegra keeps parsed interface definitions and extracted module implementations here,
+			 * so that subsequent sessions can skip unpacking module files which haven't changed.
+			 * \note module_cache_directory is not required.  Leave it empty to load all modules from scratch at every startup.
+			 */
+			string module_cache_directory;
+
+			/** \brief Extract module implementations to disk
+			 *
+			 * By default, module implementations which consist only of pd abstractions aren't extracted from their module files.  
+			 * libIntegra decompresses each one in memory when it is first instantiated, and serves its files to libpd from there.  
+			 * When true, every implementation is extracted into the scratch directory at startup instead, as implementations 
+			 * containing other files always are.  This is only needed for implementations which create abstractions dynamically.
+			 * \note extract_module_implementations defaults to false.
+			 */
+			bool extract_module_implementations;
+
+			/** \brief How far ahead of the audio clock players schedule their ticks
+			 *
+			 * Player ticks are timed from the number of audio frames processed, and scheduled this far in advance 
+			 * so that they take effect on the exact frame at which they fall.  Larger values tolerate more scheduling 
+			 * jitter in the player thread, at the cost of endpoint values running further ahead of the audio.
+			 * \note player_lookahead_milliseconds defaults to 50.  0 disables scheduling ahead.
+			 */
+			int player_lookahead_milliseconds;
+
+			/** \brief Render player-driven envelopes in the dsp engine
+			 *
+			 * When true, an Envelope whose currentTick is driven by a Player sends each segment between its control 
+			 * points to the dsp engine once, and the dsp engine interpolates it at block rate, instead of 
+			 * currentValue being set at every tick.  Envelope.currentValue, and the endpoints it is connected to, are then 
+			 * only updated at control points.
+			 * \note Envelopes connected to anything other than module endpoints which are sent to the dsp engine are always 
+			 * rendered at every tick.  render_envelopes_in_dsp defaults to false.
+			 */
+			bool render_envelopes_in_dsp;
+
+			/** \brief Run without an audio device, for rendering with CIntegraSession::render_offline
+			 *
+			 * When true, libIntegra doesn't open an audio device, and audio is only processed during 
+			 * calls to CIntegraSession::render_offline, as fast as the machine allows.  
+			 * \note offline_rendering defaults to false.
+			 */
+			bool offline_rendering;
 			
 			/** \brief Pointer to an INotificationSink subclass, for receiving feedback when control endpoints are set.
 			 *
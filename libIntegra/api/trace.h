@@ -21,7 +21,8 @@
 /** \file trace.h
  *  \brief Defines tracing macros and class CTrace for configuration of tracing
  *
- * libIntegra tracing writes to stdout.
+ * libIntegra tracing writes to stdout, either directly or via a background thread 
+ * (see CTrace::set_deferred_mode).
  *
  * The main entrypoint for libIntegra tracing functionality are the macros
  * INTEGRA_TRACE_ERROR, INTEGRA_TRACE_PROGRESS and INTEGRA_TRACE_VERBOSE.
@@ -37,6 +38,8 @@
 #include "common_typedefs.h"
 #include <ostream>
 #include <fstream>
+#include <ctime>
+#include <atomic>
 
 
 /** Used internally by subsequent macros */
@@ -61,7 +64,7 @@
  * Only traces anything when tracing of errors is enabled
  * Automatically traces time, location and thread ID (subject to configuration). 
  */
-#define INTEGRA_TRACE_ERROR			integra_api::CTrace::error( INTEGRA_LOCATION, INTEGRA_FUNCTION )
+#define INTEGRA_TRACE_ERROR			integra_api::CTraceMessage( integra_api::CTrace::CATEGORY_ERROR, INTEGRA_LOCATION, INTEGRA_FUNCTION )
 
 /** \brief Main progress tracing macro.  
  * Usage example: INTEGRA_TRACE_PROGRESS << "A normal (not unexpected) thing happened.  Details: " << some_details << of_mixed_type;
@@ -69,7 +72,7 @@
  * Only traces anything when tracing of progress is enabled
  * Automatically traces time, location and thread ID (subject to configuration). 
  */
-#define INTEGRA_TRACE_PROGRESS		integra_api::CTrace::progress( INTEGRA_LOCATION, INTEGRA_FUNCTION )
+#define INTEGRA_TRACE_PROGRESS		integra_api::CTraceMessage( integra_api::CTrace::CATEGORY_PROGRESS, INTEGRA_LOCATION, INTEGRA_FUNCTION )
 
 /** \brief Main verbose progress tracing macro.  
  *
@@ -81,10 +84,17 @@
  * Only traces anything when verbose tracing is enabled
  * Automatically traces time, location and thread ID (subject to configuration). 
  */
-#define INTEGRA_TRACE_VERBOSE		integra_api::CTrace::verbose( INTEGRA_LOCATION, INTEGRA_FUNCTION )
+#define INTEGRA_TRACE_VERBOSE		integra_api::CTraceMessage( integra_api::CTrace::CATEGORY_VERBOSE, INTEGRA_LOCATION, INTEGRA_FUNCTION )
 
 
 
+namespace integra_internal
+{
+	class CTraceThreadBuffer;
+	class CDeferredTraceWriter;
+}
+
+
 namespace integra_api
 {
 	/** \class CTrace trace.h "api/trace.h"
@@ -97,7 +107,7 @@ namespace integra_api
 	 * CTrace is exposed in libIntegra's api in order to allow users of the api to customise 
 	 * what is traced.
 	 *
-	 * \note CTrace need never be instantiated - all its methods are static and stateless.
+	 * \note CTrace need never be instantiated - all its methods are static.
 	 */	
 
 	class INTEGRA_API CTrace
@@ -120,19 +130,47 @@ namespace integra_api
 			 */
 			static void set_details_to_trace( bool timestamp, bool location, bool thread );
 
+			/** \brief Defer formatting and output of trace messages to a background thread
+			 *
+			 * By default, messages are written to stdout by the thread which traces them.  This involves 
+			 * locking and system calls, which can cause audible dropouts when done from an audio thread.
+			 *
+			 * In deferred mode, each thread copies its messages into its own preallocated lock-free buffer, 
+			 * and a background thread formats and writes them.  Tracing then never blocks, so it is safe 
+			 * to leave enabled in production.  If a thread traces faster than the background thread can 
+			 * write, excess messages are dropped and the number of dropped messages is traced instead.
+			 *
+			 * Disabling deferred mode waits for messages which other threads are still recording, then 
+			 * writes any outstanding messages before returning.  Applications which enable deferred mode 
+			 * should disable it again before exiting.
+			 *
+			 * \note Thread buffers are preallocated when deferred mode is first enabled.  Messages from threads 
+			 * beyond the first 64 traced concurrently are dropped
+			 */
+			static void set_deferred_mode( bool deferred );
+
 			/** Internal use only */
-			static std::ostream &error( const char *location, const char *function );
+			enum category
+			{
+				CATEGORY_ERROR = 0,
+				CATEGORY_PROGRESS,
+				CATEGORY_VERBOSE
+			};
 
 			/** Internal use only */
-			static std::ostream &progress( const char *location, const char *function );
+			static std::ostream &begin_message( category message_category, const char *location, const char *function, integra_internal::CTraceThreadBuffer *&deferred_buffer );
 
 			/** Internal use only */
-			static std::ostream &verbose( const char *location, const char *function );
+			static void end_message( integra_internal::CTraceThreadBuffer *deferred_buffer );
 
 		private:
 
 			static void do_trace( const char *category, const char *location, const char *function ); 
 
+			static void write_header( std::ostream &stream, const char *category, time_t time, const void *thread_id, unsigned int thread_id_size, const char *location, const char *function );
+
+			static bool should_trace( category message_category );
+
 			static bool s_trace_errors;
 			static bool s_trace_progress;
 			static bool s_trace_verbose;
@@ -141,10 +179,72 @@ namespace integra_api
 			static bool s_trace_location;
 			static bool s_trace_thread;
 
+			/* tracing threads read s_deferred without locking.  s_deferred_writers counts messages being recorded in deferred mode */
+			static std::atomic<bool> s_deferred;
+			static std::atomic<int> s_deferred_writers;
+
 			static std::ostream &s_trace_stream;
 			static std::ofstream s_null_stream;
 
 			static const int max_timestamp_length;
+
+			static const char *s_category_names[];
+
+			friend class integra_internal::CDeferredTraceWriter;
+	};
+
+
+	/** \class CTraceMessage trace.h "api/trace.h"
+	 *  \brief A single trace message, created by the tracing macros
+	 *
+	 * Values streamed into a CTraceMessage are written to the trace output.  In deferred mode 
+	 * the message is handed to the background writer when the CTraceMessage is destroyed, 
+	 * ie at the end of the statement which traced it.
+	 *
+	 * \note CTraceMessage should not be used directly - use the tracing macros instead
+	 */
+	class INTEGRA_API CTraceMessage
+	{
+		public:
+
+			CTraceMessage( CTrace::category message_category, const char *location, const char *function )
+			{
+				m_stream = &CTrace::begin_message( message_category, location, function, m_deferred_buffer );
+			}
+
+			~CTraceMessage()
+			{
+				if( m_deferred_buffer )
+				{
+					CTrace::end_message( m_deferred_buffer );
+				}
+			}
+
+			template <class T> CTraceMessage &operator<<( const T &value )
+			{
+				*m_stream << value;
+				return *this;
+			}
+
+			CTraceMessage &operator<<( std::ostream &( *manipulator )( std::ostream & ) )
+			{
+				*m_stream << manipulator;
+				return *this;
+			}
+
+			CTraceMessage &operator<<( std::ios_base &( *manipulator )( std::ios_base & ) )
+			{
+				*m_stream << manipulator;
+				return *this;
+			}
+
+		private:
+
+			CTraceMessage( const CTraceMessage & );
+			CTraceMessage &operator=( const CTraceMessage & );
+
+			std::ostream *m_stream;
+			integra_internal::CTraceThreadBuffer *m_deferred_buffer;
 	};
 }
 
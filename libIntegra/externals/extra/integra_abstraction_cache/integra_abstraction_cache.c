@@ -0,0 +1,420 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+/*
+ integra_abstraction_cache keeps the parsed contents of the abstractions which make up libIntegra's 
+ module implementations, so that each file is read and parsed once rather than once per instance.
+
+ pd creates an abstraction through its object maker's fallback (new_anything), which probes for a 
+ compiled external of that name, searches for the file, then reads and parses it.  This extension 
+ adds a creator to the object maker for each abstraction name it has seen, which pd tries before that 
+ fallback.  The creator resolves the name against the directory of the canvas being loaded - as pd 
+ would - and evaluates the cached binbuf for that path, reading and caching the file on a miss.  
+ Whenever a file is read, the names of the objects it creates are registered in turn, so that nested 
+ handler abstractions are cached too - but only names which resolve to a .pd file from the file's 
+ directory.  Other names are left to pd, since an external loaded later under a name we had registered 
+ would find our creator first (pd 0.43 doesn't replace object maker methods) and new_anything would 
+ recurse through it.
+
+ Entries are keyed by the abstraction's absolute path.  Module implementation directories are unique 
+ to a module id, and libIntegra invalidates a directory's entries when it unloads the module.
+
+ On a miss, the file is first requested from the reader which libIntegra sets with 
+ integra_abstraction_cache_set_reader, which serves module implementations from memory.  Only files 
+ the reader doesn't have are searched for on disk.
+
+ These functions aren't an external - they are called by libIntegra on whichever thread currently 
+ owns libpd.
+*/
+
+#include "m_pd.h"
+#include "m_imp.h"
+#include "g_canvas.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INTEGRA_ABSTRACTION_CACHE_BUCKETS 1024
+
+/* fills contents and returns 1 if it has the file at path, otherwise returns 0 */
+typedef int (*t_integra_abstraction_reader)(void *context, const char *path, t_binbuf *contents);
+
+typedef struct _integra_abstraction
+{
+    t_symbol *path;
+    t_symbol *file_name;
+    t_symbol *directory;
+    t_binbuf *contents;
+    struct _integra_abstraction *next;
+}
+t_integra_abstraction;
+
+static t_integra_abstraction *integra_abstraction_cache_buckets[INTEGRA_ABSTRACTION_CACHE_BUCKETS];
+
+static int integra_abstraction_cache_hits = 0;
+static int integra_abstraction_cache_misses = 0;
+
+static t_integra_abstraction_reader integra_abstraction_cache_reader = NULL;
+static void *integra_abstraction_cache_reader_context = NULL;
+
+/* pd's own abstraction loading, from m_class.c, m_pd.c and g_canvas.c */
+void new_anything(void *dummy, t_symbol *s, int argc, t_atom *argv);
+int pd_setloadingabstraction(t_symbol *sym);
+void canvas_popabstraction(t_canvas *x);
+
+
+static unsigned int integra_abstraction_cache_bucket(t_symbol *path)
+{
+    /* symbols are unique, so the symbol's address identifies the path */
+    return (unsigned int)(((size_t)path >> 4) % INTEGRA_ABSTRACTION_CACHE_BUCKETS);
+}
+
+
+static t_integra_abstraction *integra_abstraction_cache_find(t_symbol *path)
+{
+    t_integra_abstraction *abstraction = integra_abstraction_cache_buckets[integra_abstraction_cache_bucket(path)];
+
+    for(; abstraction; abstraction = abstraction->next)
+    {
+        if(abstraction->path == path)
+        {
+            return abstraction;
+        }
+    }
+
+    return NULL;
+}
+
+
+static void integra_abstraction_cache_free(t_integra_abstraction *abstraction)
+{
+    binbuf_free(abstraction->contents);
+    freebytes(abstraction, sizeof(t_integra_abstraction));
+}
+
+
+static t_pd *integra_abstraction_cache_new(t_symbol *s, int argc, t_atom *argv);
+static t_integra_abstraction *integra_abstraction_cache_add(t_symbol *path, const char *file_name, const char *directory, t_binbuf *contents);
+static t_binbuf *integra_abstraction_cache_read_from_reader(t_symbol *path, char *directory, char **file_name);
+
+void integra_abstraction_cache_register(const char *name)
+{
+    t_symbol *symbol = gensym(name);
+
+    /* leave classes, creators and names which are already registered alone */
+    if(!zgetfn(&pd_objectmaker, symbol))
+    {
+        class_addmethod(pd_objectmaker, (t_method)integra_abstraction_cache_new, symbol, A_GIMME, 0);
+    }
+}
+
+
+static t_symbol *integra_abstraction_cache_path(t_symbol *name, const char *directory)
+{
+    char path[MAXPDSTRING];
+
+    if(sys_isabsolutepath(name->s_name))
+    {
+        snprintf(path, MAXPDSTRING, "%s.pd", name->s_name);
+    }
+    else
+    {
+        snprintf(path, MAXPDSTRING, "%s/%s.pd", directory, name->s_name);
+    }
+
+    path[MAXPDSTRING - 1] = 0;
+    return gensym(path);
+}
+
+
+static int integra_abstraction_cache_is_abstraction(t_symbol *name, const char *directory)
+{
+    /* whether name, in a file from directory, loads a .pd file */
+    t_symbol *path = integra_abstraction_cache_path(name, directory);
+    char found_directory[MAXPDSTRING], *found_file_name;
+    t_binbuf *contents;
+    int fd;
+
+    if(integra_abstraction_cache_find(path))
+    {
+        return 1;
+    }
+
+    /* files from the reader are cached now, since they would be parsed to check them anyway */
+    contents = integra_abstraction_cache_read_from_reader(path, found_directory, &found_file_name);
+    if(contents)
+    {
+        integra_abstraction_cache_add(path, found_file_name, found_directory, contents);
+        return 1;
+    }
+
+    fd = open_via_path(directory, name->s_name, ".pd", found_directory, &found_file_name, MAXPDSTRING, 0);
+    if(fd < 0)
+    {
+        return 0;
+    }
+
+    sys_close(fd);
+    return 1;
+}
+
+
+static void integra_abstraction_cache_register_objects(t_binbuf *contents, const char *directory)
+{
+    /* object boxes are saved as #X obj <x> <y> <name> ... */
+    t_symbol *obj = gensym("obj");
+    int number_of_atoms = binbuf_getnatom(contents);
+    t_atom *atoms = binbuf_getvec(contents);
+    int i;
+
+    for(i = 0; i + 4 < number_of_atoms; i++)
+    {
+        if(atoms[i].a_type == A_SYMBOL && atoms[i].a_w.w_symbol == &s__X &&
+            atoms[i + 1].a_type == A_SYMBOL && atoms[i + 1].a_w.w_symbol == obj &&
+            atoms[i + 4].a_type == A_SYMBOL)
+        {
+            t_symbol *name = atoms[i + 4].a_w.w_symbol;
+
+            if(!zgetfn(&pd_objectmaker, name) && integra_abstraction_cache_is_abstraction(name, directory))
+            {
+                integra_abstraction_cache_register(name->s_name);
+            }
+        }
+    }
+}
+
+
+static t_binbuf *integra_abstraction_cache_read_from_reader(t_symbol *path, char *directory, char **file_name)
+{
+    t_binbuf *contents;
+    char *separator;
+
+    if(!integra_abstraction_cache_reader)
+    {
+        return NULL;
+    }
+
+    contents = binbuf_new();
+    if(!integra_abstraction_cache_reader(integra_abstraction_cache_reader_context, path->s_name, contents))
+    {
+        binbuf_free(contents);
+        return NULL;
+    }
+
+    /* split the path as canvas_open would, so that nested abstractions resolve against the same directory */
+    strncpy(directory, path->s_name, MAXPDSTRING);
+    directory[MAXPDSTRING - 1] = 0;
+
+    separator = strrchr(directory, '/');
+    if(separator)
+    {
+        *separator = 0;
+        *file_name = separator + 1;
+    }
+    else
+    {
+        *file_name = directory + strlen(directory);
+    }
+
+    return contents;
+}
+
+
+static t_binbuf *integra_abstraction_cache_read_from_disk(t_symbol *name, char *directory, char **file_name)
+{
+    t_binbuf *contents;
+    int fd;
+
+    fd = canvas_open(canvas_getcurrent(), name->s_name, ".pd", directory, file_name, MAXPDSTRING, 0);
+    if(fd < 0)
+    {
+        return NULL;
+    }
+
+    sys_close(fd);
+
+    contents = binbuf_new();
+    if(binbuf_read(contents, *file_name, directory, 0))
+    {
+        binbuf_free(contents);
+        return NULL;
+    }
+
+    return contents;
+}
+
+
+static t_integra_abstraction *integra_abstraction_cache_add(t_symbol *path, const char *file_name, const char *directory, t_binbuf *contents)
+{
+    t_integra_abstraction *abstraction;
+    unsigned int bucket;
+
+    abstraction = (t_integra_abstraction *)getbytes(sizeof(t_integra_abstraction));
+    abstraction->path = path;
+    abstraction->file_name = gensym(file_name);
+    abstraction->directory = gensym(directory);
+    abstraction->contents = contents;
+
+    bucket = integra_abstraction_cache_bucket(path);
+    abstraction->next = integra_abstraction_cache_buckets[bucket];
+    integra_abstraction_cache_buckets[bucket] = abstraction;
+
+    /* after adding, so that abstractions which contain themselves don't recurse */
+    integra_abstraction_cache_register_objects(contents, directory);
+
+    return abstraction;
+}
+
+
+static t_integra_abstraction *integra_abstraction_cache_read(t_symbol *name, t_symbol *path)
+{
+    char directory[MAXPDSTRING], *file_name;
+    t_binbuf *contents;
+
+    contents = integra_abstraction_cache_read_from_reader(path, directory, &file_name);
+    if(!contents)
+    {
+        contents = integra_abstraction_cache_read_from_disk(name, directory, &file_name);
+        if(!contents)
+        {
+            return NULL;
+        }
+    }
+
+    return integra_abstraction_cache_add(path, file_name, directory, contents);
+}
+
+
+static t_pd *integra_abstraction_cache_new(t_symbol *s, int argc, t_atom *argv)
+{
+    t_symbol *path = integra_abstraction_cache_path(s, canvas_getdir(canvas_getcurrent())->s_name);
+    t_integra_abstraction *abstraction = integra_abstraction_cache_find(path);
+    t_pd *current = s__X.s_thing;
+    int dspstate;
+
+    if(abstraction)
+    {
+        integra_abstraction_cache_hits++;
+    }
+    else
+    {
+        integra_abstraction_cache_misses++;
+
+        abstraction = integra_abstraction_cache_read(s, path);
+        if(!abstraction)
+        {
+            /* not an abstraction after all - let pd look for a library, or report the failure */
+            new_anything(0, s, argc, argv);
+            return pd_newest();
+        }
+    }
+
+    /* as new_anything and binbuf_evalfile, but evaluating the cached contents */
+    if(pd_setloadingabstraction(s))
+    {
+        error("%s: can't load abstraction within itself\n", s->s_name);
+        return 0;
+    }
+
+    canvas_setargs(argc, argv);
+
+    dspstate = canvas_suspend_dsp();
+    glob_setfilename(0, abstraction->file_name, abstraction->directory);
+    binbuf_eval(abstraction->contents, 0, 0, 0);
+    glob_setfilename(0, &s_, &s_);
+    canvas_resume_dsp(dspstate);
+
+    if(s__X.s_thing == current)
+    {
+        canvas_setargs(0, 0);
+        return 0;
+    }
+
+    /* leaves the abstraction as pd's newest object */
+    canvas_popabstraction((t_canvas *)(s__X.s_thing));
+    canvas_setargs(0, 0);
+
+    return pd_newest();
+}
+
+
+static int integra_abstraction_cache_is_in_directory(const char *path, const char *directory)
+{
+    /* libIntegra may use either separator on windows, pd always uses '/' */
+    for(; *directory; path++, directory++)
+    {
+        int path_is_separator = (*path == '/' || *path == '\\');
+        int directory_is_separator = (*directory == '/' || *directory == '\\');
+
+        if(path_is_separator != directory_is_separator || (!path_is_separator && *path != *directory))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+void integra_abstraction_cache_invalidate(const char *directory)
+{
+    int i;
+
+    for(i = 0; i < INTEGRA_ABSTRACTION_CACHE_BUCKETS; i++)
+    {
+        t_integra_abstraction **link = &integra_abstraction_cache_buckets[i];
+
+        while(*link)
+        {
+            t_integra_abstraction *abstraction = *link;
+            if(integra_abstraction_cache_is_in_directory(abstraction->path->s_name, directory))
+            {
+                *link = abstraction->next;
+                integra_abstraction_cache_free(abstraction);
+            }
+            else
+            {
+                link = &abstraction->next;
+            }
+        }
+    }
+}
+
+
+void integra_abstraction_cache_set_reader(t_integra_abstraction_reader reader, void *context)
+{
+    integra_abstraction_cache_reader = reader;
+    integra_abstraction_cache_reader_context = context;
+}
+
+
+void integra_abstraction_cache_clear(void)
+{
+    integra_abstraction_cache_invalidate("");
+}
+
+
+void integra_abstraction_cache_get_statistics(int *hits, int *misses)
+{
+    *hits = integra_abstraction_cache_hits;
+    *misses = integra_abstraction_cache_misses;
+}
@@ -0,0 +1,159 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+/*
+ integra_canvas lets libIntegra address the module instances on its host canvas by pointer.
+
+ pd's own canvas messages address objects by their index in the canvas (connect, disconnect) or by 
+ searching their text (find, then cut via the editor's selection).  Both are linear in the number of 
+ objects, and indices shift whenever an object is removed.  Instead, integra_canvas_add_object returns 
+ the new object, which the caller keeps, and the other functions take objects directly.
+
+ integra_canvas_open creates the host patch itself from text, so that it needn't be written to disk first.
+
+ These functions aren't an external - they are called by libIntegra on whichever thread currently 
+ owns libpd.
+*/
+
+#include "m_pd.h"
+#include "m_imp.h"
+#include "g_canvas.h"
+
+#include <string.h>
+
+extern t_class *text_class;
+
+/* from m_pd.c */
+void pd_doloadbang(void);
+
+
+/* as glob_evalfile, but parsing the patch from text rather than reading it from file_name in directory */
+t_canvas *integra_canvas_open(const char *text, const char *file_name, const char *directory)
+{
+    t_binbuf *contents = binbuf_new();
+    t_pd *x = 0;
+    int dspstate;
+
+    binbuf_text(contents, (char *)text, strlen(text));
+
+    dspstate = canvas_suspend_dsp();
+
+    /* set filename so that the new canvas picks it up, and binds itself to pd-<file_name> */
+    glob_setfilename(0, gensym(file_name), gensym(directory));
+    binbuf_eval(contents, 0, 0, 0);
+    glob_setfilename(0, &s_, &s_);
+
+    while((x != s__X.s_thing) && s__X.s_thing)
+    {
+        x = s__X.s_thing;
+        vmess(x, gensym("pop"), "i", 1);
+    }
+
+    pd_doloadbang();
+    canvas_resume_dsp(dspstate);
+
+    binbuf_free(contents);
+
+    return (t_canvas *)x;
+}
+
+
+t_canvas *integra_canvas_find(const char *bind_name)
+{
+    return (t_canvas *)pd_findbyclass(gensym(bind_name), canvas_class);
+}
+
+
+t_object *integra_canvas_add_object(t_canvas *canvas, int argc, t_atom *argv)
+{
+    t_pd *newest;
+    t_gobj *last;
+
+    pd_typedmess(&canvas->gl_pd, gensym("obj"), argc, argv);
+
+    /* 
+     pd appends the new object to the canvas, and normally leaves it as the newest object - 
+     for an abstraction, that's the abstraction's own canvas
+    */
+    newest = pd_newest();
+    if(newest && pd_checkobject(newest) && !pd_checkobject(newest)->te_g.g_next)
+    {
+        return pd_checkobject(newest);
+    }
+
+    /* creation failed, and pd added an empty object box in its place */
+    last = canvas->gl_list;
+    if(!last)
+    {
+        return NULL;
+    }
+
+    while(last->g_next)
+    {
+        last = last->g_next;
+    }
+
+    return pd_checkobject(&last->g_pd);
+}
+
+
+void integra_canvas_remove_object(t_canvas *canvas, t_object *object)
+{
+    /* 
+     as canvas_doclear - an abstraction's contents are deleted one by one, and the dsp chain 
+     mustn't be rebuilt around a partly deleted abstraction
+    */
+    int dspstate = canvas_suspend_dsp();
+
+    glist_delete(canvas, &object->te_g);
+
+    canvas_resume_dsp(dspstate);
+}
+
+
+int integra_canvas_connect(t_object *source, int outlet, t_object *target, int inlet)
+{
+    /* as in canvas_connect, give objects which failed to create enough inlets and outlets to keep their connections */
+    if(pd_class(&source->te_pd) == text_class && source->te_type == T_OBJECT)
+    {
+        while(outlet >= obj_noutlets(source))
+        {
+            outlet_new(source, 0);
+        }
+    }
+
+    if(pd_class(&target->te_pd) == text_class && target->te_type == T_OBJECT)
+    {
+        while(inlet >= obj_ninlets(target))
+        {
+            inlet_new(target, &target->te_pd, 0, 0);
+        }
+    }
+
+    /* obj_connect and obj_disconnect resort the dsp chain themselves when a signal outlet is involved */
+    return (obj_connect(source, outlet, target, inlet) != NULL);
+}
+
+
+void integra_canvas_disconnect(t_object *source, int outlet, t_object *target, int inlet)
+{
+    obj_disconnect(source, outlet, target, inlet);
+}
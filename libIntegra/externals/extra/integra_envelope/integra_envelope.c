@@ -0,0 +1,338 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+/*
+ integra_envelope renders envelope segments on the dsp thread, on behalf of libIntegra's CEnvelopeLogic.
+
+ A single instance, bound to "integra-envelopes", is created when the external is set up.  It accepts:
+
+   segment <envelope id> <from> <to> <exponent> <start fraction> <duration ms>
+   target <envelope id> <node id> <endpoint name>
+   untarget <envelope id>
+   stop <envelope id>
+   remove <envelope id>
+
+ A segment's value at fraction f (0 to 1) is from + f ^ exponent * ( to - from ), where f runs from 
+ start fraction to 1 over duration ms of logical time.  While a segment is running its value is sent 
+ once per dsp block to each of the envelope's targets, via the target module's own receiver.
+*/
+
+#include "m_pd.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define INTEGRA_ENVELOPE_MAX_ENVELOPES 256
+#define INTEGRA_ENVELOPE_MAX_TARGETS 16
+#define INTEGRA_ENVELOPE_BLOCK_SIZE 64
+
+#define INTEGRA_ENVELOPE_RECEIVER "integra-envelopes"
+#define INTEGRA_NODE_RECEIVER_PREFIX "integra-receive-"
+#define INTEGRA_BROADCAST_RECEIVER "integra-broadcast-receive"
+
+typedef struct _integra_envelope_target
+{
+    t_float node_id;
+    t_symbol *receiver;
+    t_symbol *endpoint;
+}
+t_integra_envelope_target;
+
+typedef struct _integra_envelope_state
+{
+    t_float id;
+    int in_use;
+    int is_running;
+
+    double start_time;
+    t_float from;
+    t_float to;
+    t_float exponent;
+    t_float start_fraction;
+    t_float duration;
+
+    t_integra_envelope_target targets[INTEGRA_ENVELOPE_MAX_TARGETS];
+    int number_of_targets;
+}
+t_integra_envelope_state;
+
+typedef struct _integra_envelope
+{
+    t_pd x_pd;
+    t_clock *x_clock;
+    int x_clock_is_set;
+    t_integra_envelope_state *x_envelopes;
+}
+t_integra_envelope;
+
+static t_class *integra_envelope_class;
+static t_integra_envelope *integra_envelope_instance;
+
+
+static t_integra_envelope_state *integra_envelope_find(t_integra_envelope *x, t_float id, int create)
+{
+    t_integra_envelope_state *free_state = NULL;
+    int i;
+
+    for(i = 0; i < INTEGRA_ENVELOPE_MAX_ENVELOPES; i++)
+    {
+        t_integra_envelope_state *state = &x->x_envelopes[i];
+        if(state->in_use && state->id == id)
+        {
+            return state;
+        }
+
+        if(!state->in_use && !free_state)
+        {
+            free_state = state;
+        }
+    }
+
+    if(!create)
+    {
+        return NULL;
+    }
+
+    if(!free_state)
+    {
+        pd_error(x, "[integra_envelope]: too many envelopes");
+        return NULL;
+    }
+
+    memset(free_state, 0, sizeof(t_integra_envelope_state));
+    free_state->id = id;
+    free_state->in_use = 1;
+    return free_state;
+}
+
+static t_float integra_envelope_value(const t_integra_envelope_state *state, int *finished)
+{
+    double fraction = 1;
+    *finished = 1;
+
+    if(state->duration > 0)
+    {
+        double progress = clock_gettimesince(state->start_time) / state->duration;
+        if(progress < 1)
+        {
+            fraction = state->start_fraction + (1 - state->start_fraction) * progress;
+            *finished = 0;
+        }
+    }
+
+    if(state->exponent != 1)
+    {
+        fraction = pow(fraction, state->exponent);
+    }
+
+    return state->from + fraction * (state->to - state->from);
+}
+
+static void integra_envelope_output(const t_integra_envelope_state *state, t_float value)
+{
+    t_atom atoms[3];
+    int i;
+
+    for(i = 0; i < state->number_of_targets; i++)
+    {
+        const t_integra_envelope_target *target = &state->targets[i];
+
+        if(target->receiver->s_thing)
+        {
+            SETSYMBOL(&atoms[0], target->endpoint);
+            SETFLOAT(&atoms[1], value);
+            pd_list(target->receiver->s_thing, &s_list, 2, atoms);
+        }
+        else
+        {
+            /* module has no receiver of its own - go via the broadcast receiver, as libIntegra does */
+            t_symbol *broadcast = gensym(INTEGRA_BROADCAST_RECEIVER);
+            if(broadcast->s_thing)
+            {
+                SETFLOAT(&atoms[0], target->node_id);
+                SETSYMBOL(&atoms[1], target->endpoint);
+                SETFLOAT(&atoms[2], value);
+                pd_list(broadcast->s_thing, &s_list, 3, atoms);
+            }
+        }
+    }
+}
+
+static void integra_envelope_schedule(t_integra_envelope *x)
+{
+    /* once per dsp block */
+    t_float sample_rate = sys_getsr();
+    clock_delay(x->x_clock, 1000. * INTEGRA_ENVELOPE_BLOCK_SIZE / (sample_rate > 0 ? sample_rate : 44100));
+    x->x_clock_is_set = 1;
+}
+
+static void integra_envelope_tick(t_integra_envelope *x)
+{
+    int any_running = 0;
+    int i;
+
+    x->x_clock_is_set = 0;
+
+    for(i = 0; i < INTEGRA_ENVELOPE_MAX_ENVELOPES; i++)
+    {
+        t_integra_envelope_state *state = &x->x_envelopes[i];
+        int finished;
+        t_float value;
+
+        if(!state->in_use || !state->is_running)
+        {
+            continue;
+        }
+
+        value = integra_envelope_value(state, &finished);
+        integra_envelope_output(state, value);
+
+        if(finished)
+        {
+            state->is_running = 0;
+        }
+        else
+        {
+            any_running = 1;
+        }
+    }
+
+    if(any_running)
+    {
+        integra_envelope_schedule(x);
+    }
+}
+
+static void integra_envelope_segment(t_integra_envelope *x, t_symbol *s, int argc, t_atom *argv)
+{
+    t_integra_envelope_state *state;
+    int finished;
+
+    if(argc != 6)
+    {
+        pd_error(x, "[integra_envelope]: expected segment <envelope id> <from> <to> <exponent> <start fraction> <duration ms>");
+        return;
+    }
+
+    state = integra_envelope_find(x, atom_getfloat(&argv[0]), 1);
+    if(!state)
+    {
+        return;
+    }
+
+    state->start_time = clock_getlogicaltime();
+    state->from = atom_getfloat(&argv[1]);
+    state->to = atom_getfloat(&argv[2]);
+    state->exponent = atom_getfloat(&argv[3]);
+    state->start_fraction = atom_getfloat(&argv[4]);
+    state->duration = atom_getfloat(&argv[5]);
+
+    integra_envelope_output(state, integra_envelope_value(state, &finished));
+
+    state->is_running = !finished;
+
+    if(state->is_running && !x->x_clock_is_set)
+    {
+        integra_envelope_schedule(x);
+    }
+}
+
+static void integra_envelope_target(t_integra_envelope *x, t_floatarg id, t_floatarg node_id, t_symbol *endpoint)
+{
+    char receiver_name[MAXPDSTRING];
+    t_integra_envelope_state *state = integra_envelope_find(x, id, 1);
+    t_integra_envelope_target *target;
+
+    if(!state)
+    {
+        return;
+    }
+
+    if(state->number_of_targets >= INTEGRA_ENVELOPE_MAX_TARGETS)
+    {
+        pd_error(x, "[integra_envelope]: too many targets for one envelope");
+        return;
+    }
+
+    /* same formatting as libIntegra's CDspEngine::bind_node_receiver */
+    snprintf(receiver_name, MAXPDSTRING, "%s%g", INTEGRA_NODE_RECEIVER_PREFIX, node_id);
+
+    target = &state->targets[state->number_of_targets++];
+    target->node_id = node_id;
+    target->receiver = gensym(receiver_name);
+    target->endpoint = endpoint;
+}
+
+static void integra_envelope_untarget(t_integra_envelope *x, t_floatarg id)
+{
+    t_integra_envelope_state *state = integra_envelope_find(x, id, 0);
+    if(state)
+    {
+        state->number_of_targets = 0;
+    }
+}
+
+static void integra_envelope_stop(t_integra_envelope *x, t_floatarg id)
+{
+    t_integra_envelope_state *state = integra_envelope_find(x, id, 0);
+    if(state)
+    {
+        state->is_running = 0;
+    }
+}
+
+static void integra_envelope_remove(t_integra_envelope *x, t_floatarg id)
+{
+    t_integra_envelope_state *state = integra_envelope_find(x, id, 0);
+    if(state)
+    {
+        state->in_use = 0;
+        state->is_running = 0;
+    }
+}
+
+void integra_envelope_setup(void)
+{
+    if(integra_envelope_instance)
+    {
+        /* pd is being reused by a new session - forget the previous session's envelopes */
+        memset(integra_envelope_instance->x_envelopes, 0, INTEGRA_ENVELOPE_MAX_ENVELOPES * sizeof(t_integra_envelope_state));
+        clock_unset(integra_envelope_instance->x_clock);
+        integra_envelope_instance->x_clock_is_set = 0;
+        return;
+    }
+
+    integra_envelope_class = class_new(gensym("integra_envelope"), 0, 0, sizeof(t_integra_envelope), CLASS_PD, 0);
+
+    class_addmethod(integra_envelope_class, (t_method)integra_envelope_segment, gensym("segment"), A_GIMME, 0);
+    class_addmethod(integra_envelope_class, (t_method)integra_envelope_target, gensym("target"), A_FLOAT, A_FLOAT, A_SYMBOL, 0);
+    class_addmethod(integra_envelope_class, (t_method)integra_envelope_untarget, gensym("untarget"), A_FLOAT, 0);
+    class_addmethod(integra_envelope_class, (t_method)integra_envelope_stop, gensym("stop"), A_FLOAT, 0);
+    class_addmethod(integra_envelope_class, (t_method)integra_envelope_remove, gensym("remove"), A_FLOAT, 0);
+
+    integra_envelope_instance = (t_integra_envelope *)pd_new(integra_envelope_class);
+    integra_envelope_instance->x_envelopes = (t_integra_envelope_state *)getbytes(INTEGRA_ENVELOPE_MAX_ENVELOPES * sizeof(t_integra_envelope_state));
+    integra_envelope_instance->x_clock = clock_new(integra_envelope_instance, (t_method)integra_envelope_tick);
+    integra_envelope_instance->x_clock_is_set = 0;
+
+    pd_bind(&integra_envelope_instance->x_pd, gensym(INTEGRA_ENVELOPE_RECEIVER));
+}
@@ -24,22 +24,32 @@
 
 #include "audio_engine.h"
 #include "portaudio_engine.h"
+#include "offline_audio_engine.h"
 
 
 namespace integra_internal
 {
-	IAudioEngine *IAudioEngine::create_audio_engine( CDspEngine &dsp_engine )
+	IAudioEngine *IAudioEngine::create_audio_engine( CDspEngine &dsp_engine, bool offline_rendering )
 	{
 		/*
 		 at such a time as we implement other audio engines (eg for iOS), we'd use 
 		 preprocessor switches to instantiate the required engine implementation here
 		*/
 
+		IAudioEngine *engine = NULL;
+
+		if( offline_rendering )
+		{
+			engine = new COfflineAudioEngine;
+		}
+		else
+		{
 		#if 1
-			IAudioEngine *engine = new CPortAudioEngine;
+			engine = new CPortAudioEngine;
 		#else
-			IAudioEngine *engine = new CSomeOtherAudioEngine;
+			engine = new CSomeOtherAudioEngine;
 		#endif
+		}
 
 		
 		engine->m_dsp_engine = &dsp_engine;
@@ -26,6 +26,11 @@
 #include "api/error.h"
 
 
+namespace integra_api
+{
+	class CAudioStatistics;
+}
+
 using namespace integra_api;
 
 namespace integra_internal
@@ -40,7 +45,8 @@ namespace integra_internal
 
 		public:
 
-			static IAudioEngine *create_audio_engine( CDspEngine &dsp_engine );
+			/* an offline engine has no devices, and only processes audio when asked to render */
+			static IAudioEngine *create_audio_engine( CDspEngine &dsp_engine, bool offline_rendering );
 			virtual ~IAudioEngine() {}
 
 			virtual CError set_driver( const string &driver ) = 0;
@@ -66,6 +72,9 @@ namespace integra_internal
 			virtual int get_number_of_input_channels() const = 0;
 			virtual int get_number_of_output_channels() const = 0;
 
+			/* fills in xrun, ring buffer and driver cpu load figures.  Dsp timings are left untouched */
+			virtual void get_driver_statistics( CAudioStatistics &statistics ) const = 0;
+
 		protected:
 
 			CDspEngine &get_dsp_engine() { return *m_dsp_engine; }
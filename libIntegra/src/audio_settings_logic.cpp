@@ -30,6 +30,8 @@
 
 #include "api/string_helper.h"
 #include "api/command.h"
+#include "api/audio_statistics.h"
+#include "api/trace.h"
 
 #include "assert.h"
 
@@ -48,6 +50,19 @@ namespace integra_internal
 	const string CAudioSettingsLogic::endpoint_output_channels = "outputChannels";
 	const string CAudioSettingsLogic::endpoint_restore_defaults = "restoreDefaults";
 
+	const string CAudioSettingsLogic::endpoint_dsp_min_microseconds = "dspMinMicroseconds";
+	const string CAudioSettingsLogic::endpoint_dsp_mean_microseconds = "dspMeanMicroseconds";
+	const string CAudioSettingsLogic::endpoint_dsp_p99_microseconds = "dspP99Microseconds";
+	const string CAudioSettingsLogic::endpoint_dsp_p999_microseconds = "dspP999Microseconds";
+	const string CAudioSettingsLogic::endpoint_dsp_max_microseconds = "dspMaxMicroseconds";
+	const string CAudioSettingsLogic::endpoint_dsp_mean_budget_percent = "dspMeanBudgetPercent";
+	const string CAudioSettingsLogic::endpoint_dsp_max_budget_percent = "dspMaxBudgetPercent";
+	const string CAudioSettingsLogic::endpoint_skipped_blocks = "skippedBlocks";
+	const string CAudioSettingsLogic::endpoint_xruns = "xruns";
+	const string CAudioSettingsLogic::endpoint_ring_buffer_overruns = "ringBufferOverruns";
+	const string CAudioSettingsLogic::endpoint_ring_buffer_underruns = "ringBufferUnderruns";
+	const string CAudioSettingsLogic::endpoint_stream_cpu_load = "streamCpuLoad";
+
 	CAudioSettingsLogic::audio_settings_logic_set CAudioSettingsLogic::s_all_audio_settings_logics;
 
 
@@ -70,6 +85,8 @@ namespace integra_internal
 
 		update_all_fields( server );
 
+		publish_statistics( server, server.get_audio_statistics() );
+
 		if( source == CCommandSource::PUBLIC_API )
 		{
 			if( s_all_audio_settings_logics.size() == 1 )
@@ -106,6 +123,13 @@ namespace integra_internal
 				return;
 		}
 
+		if( is_statistic_endpoint( endpoint_name ) )
+		{
+			/* the next statistics period overwrites the value */
+			INTEGRA_TRACE_ERROR << "audio statistics are read-only: " << node_endpoint.get_path().get_string();
+			return;
+		}
+
 		if( endpoint_name == endpoint_selected_driver )
 		{
 			audio_engine.set_driver( *node_endpoint.get_value() );
@@ -207,6 +231,57 @@ namespace integra_internal
 	}
 
 
+	void CAudioSettingsLogic::publish_statistics( CServer &server, const CAudioStatistics &statistics )
+	{
+		update_statistic_field( server, endpoint_dsp_min_microseconds, CFloatValue( statistics.min_microseconds ) );
+		update_statistic_field( server, endpoint_dsp_mean_microseconds, CFloatValue( statistics.mean_microseconds ) );
+		update_statistic_field( server, endpoint_dsp_p99_microseconds, CFloatValue( statistics.p99_microseconds ) );
+		update_statistic_field( server, endpoint_dsp_p999_microseconds, CFloatValue( statistics.p999_microseconds ) );
+		update_statistic_field( server, endpoint_dsp_max_microseconds, CFloatValue( statistics.max_microseconds ) );
+		update_statistic_field( server, endpoint_dsp_mean_budget_percent, CFloatValue( statistics.mean_budget_percent ) );
+		update_statistic_field( server, endpoint_dsp_max_budget_percent, CFloatValue( statistics.max_budget_percent ) );
+
+		update_statistic_field( server, endpoint_skipped_blocks, CIntegerValue( ( int ) statistics.total_blocks_skipped ) );
+		update_statistic_field( server, endpoint_xruns, CIntegerValue( ( int ) statistics.get_xruns() ) );
+		update_statistic_field( server, endpoint_ring_buffer_overruns, CIntegerValue( ( int ) statistics.ring_buffer_overruns ) );
+		update_statistic_field( server, endpoint_ring_buffer_underruns, CIntegerValue( ( int ) statistics.ring_buffer_underruns ) );
+
+		update_statistic_field( server, endpoint_stream_cpu_load, CFloatValue( statistics.stream_cpu_load ) );
+	}
+
+
+	void CAudioSettingsLogic::update_statistic_field( CServer &server, const string &endpoint_name, const CValue &new_value )
+	{
+		const INodeEndpoint *endpoint = get_node().get_node_endpoint( endpoint_name );
+		if( !endpoint || !endpoint->get_value() )
+		{
+			return;
+		}
+
+		if( !endpoint->get_value()->is_equal( new_value ) )
+		{
+			server.process_command( ISetCommand::create( endpoint->get_path(), new_value ), CCommandSource::SYSTEM );
+		}
+	}
+
+
+	bool CAudioSettingsLogic::is_statistic_endpoint( const string &endpoint_name )
+	{
+		return ( endpoint_name == endpoint_dsp_min_microseconds ||
+			endpoint_name == endpoint_dsp_mean_microseconds ||
+			endpoint_name == endpoint_dsp_p99_microseconds ||
+			endpoint_name == endpoint_dsp_p999_microseconds ||
+			endpoint_name == endpoint_dsp_max_microseconds ||
+			endpoint_name == endpoint_dsp_mean_budget_percent ||
+			endpoint_name == endpoint_dsp_max_budget_percent ||
+			endpoint_name == endpoint_skipped_blocks ||
+			endpoint_name == endpoint_xruns ||
+			endpoint_name == endpoint_ring_buffer_overruns ||
+			endpoint_name == endpoint_ring_buffer_underruns ||
+			endpoint_name == endpoint_stream_cpu_load );
+	}
+
+
 	string_vector CAudioSettingsLogic::int_vector_to_string_vector( const int_vector &input )
 	{
 		string_vector result;
@@ -222,6 +297,15 @@ namespace integra_internal
 	}
 
 
+	void CAudioSettingsLogic::publish_statistics_to_all_audio_settings_nodes( CServer &server, const CAudioStatistics &statistics )
+	{
+		for( audio_settings_logic_set::iterator i = s_all_audio_settings_logics.begin(); i != s_all_audio_settings_logics.end(); i++ )
+		{
+			( *i )->publish_statistics( server, statistics );
+		}
+	}
+
+
 	void CAudioSettingsLogic::update_all_fields_for_all_audio_settings_nodes( CServer &server )
 	{
 		for( audio_settings_logic_set::iterator i = s_all_audio_settings_logics.begin(); i != s_all_audio_settings_logics.end(); i++ )
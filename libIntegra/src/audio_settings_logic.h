@@ -26,6 +26,12 @@
 #include "logic.h"
 
 
+namespace integra_api
+{
+	class CAudioStatistics;
+}
+
+
 namespace integra_internal
 {
 	class CAudioSettingsLogic : public CLogic
@@ -37,6 +43,8 @@ namespace integra_internal
 			void handle_new( CServer &server, CCommandSource source );
 			void handle_set( CServer &server, const CNodeEndpoint &node_endpoint, const CValue *previous_value, CCommandSource source );
 
+			static void publish_statistics_to_all_audio_settings_nodes( CServer &server, const CAudioStatistics &statistics );
+
 		private:
 
 			void update_all_fields( CServer &server );
@@ -44,6 +52,13 @@ namespace integra_internal
 			void update_string_field( CServer &server, const string &endpoint_name, const string &new_value );
 			void update_integer_field( CServer &server, const string &endpoint_name, int new_value );
 
+			void publish_statistics( CServer &server, const CAudioStatistics &statistics );
+
+			/* statistics endpoints are skipped if the module's interface doesn't declare them */
+			void update_statistic_field( CServer &server, const string &endpoint_name, const CValue &new_value );
+
+			static bool is_statistic_endpoint( const string &endpoint_name );
+
 			static void update_all_fields_for_all_audio_settings_nodes( CServer &server );
 
 			static string_vector int_vector_to_string_vector( const int_vector &input );
@@ -63,6 +78,19 @@ namespace integra_internal
 			static const string endpoint_input_channels;
 			static const string endpoint_output_channels;
 			static const string endpoint_restore_defaults;
+
+			static const string endpoint_dsp_min_microseconds;
+			static const string endpoint_dsp_mean_microseconds;
+			static const string endpoint_dsp_p99_microseconds;
+			static const string endpoint_dsp_p999_microseconds;
+			static const string endpoint_dsp_max_microseconds;
+			static const string endpoint_dsp_mean_budget_percent;
+			static const string endpoint_dsp_max_budget_percent;
+			static const string endpoint_skipped_blocks;
+			static const string endpoint_xruns;
+			static const string endpoint_ring_buffer_overruns;
+			static const string endpoint_ring_buffer_underruns;
+			static const string endpoint_stream_cpu_load;
 	};
 }
 
@@ -0,0 +1,164 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+
+#include "platform_specifics.h"
+
+#include "audio_statistics_publisher.h"
+#include "audio_settings_logic.h"
+#include "audio_engine.h"
+#include "dsp_engine.h"
+#include "dsp_load_monitor.h"
+#include "server.h"
+#include "api/trace.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <utility>
+#include <assert.h>
+
+
+namespace integra_internal
+{
+	const int CAudioStatisticsPublisher::publish_period_milliseconds = 1000;
+
+	/* how often the thread checks for shutdown */
+	const int CAudioStatisticsPublisher::poll_microseconds = 100000;
+
+
+	CAudioStatisticsPublisher::CAudioStatisticsPublisher( CServer &server )
+		:	m_server( server )
+	{
+		m_previous_snapshot = new CDspLoadSnapshot;
+		m_current_snapshot = new CDspLoadSnapshot;
+
+		#ifdef __APPLE__
+			m_thread_shutdown_semaphore = sem_open( "sem_audio_statistics_thread_shutdown", O_CREAT, 0777, 0 );
+		#else
+			m_thread_shutdown_semaphore = new sem_t;
+			sem_init( m_thread_shutdown_semaphore, 0, 0 );
+		#endif
+
+		pthread_create( &m_thread, NULL, audio_statistics_thread_function, this );
+	}
+
+
+	CAudioStatisticsPublisher::~CAudioStatisticsPublisher()
+	{
+		INTEGRA_TRACE_PROGRESS << "stopping audio statistics thread";
+
+		sem_post( m_thread_shutdown_semaphore );
+		pthread_join( m_thread, NULL );
+
+		#ifdef __APPLE__
+			sem_close( m_thread_shutdown_semaphore );
+		#else
+			sem_destroy( m_thread_shutdown_semaphore );
+			delete m_thread_shutdown_semaphore;
+		#endif
+
+		delete m_previous_snapshot;
+		delete m_current_snapshot;
+	}
+
+
+	void CAudioStatisticsPublisher::thread_function()
+	{
+		/* the first snapshot only marks the start of the first period */
+		m_server.get_dsp_engine().get_load_monitor().take_snapshot( *m_previous_snapshot );
+
+		int elapsed_microseconds = 0;
+
+		while( sem_trywait( m_thread_shutdown_semaphore ) < 0 ) 
+		{
+			usleep( poll_microseconds );
+
+			elapsed_microseconds += poll_microseconds;
+			if( elapsed_microseconds >= publish_period_milliseconds * 1000 )
+			{
+				publish();
+				elapsed_microseconds = 0;
+			}
+		}
+	}
+
+
+	void CAudioStatisticsPublisher::publish()
+	{
+		/* the load monitor is safe to read without the server lock */
+		m_server.get_dsp_engine().get_load_monitor().take_snapshot( *m_current_snapshot );
+
+		CAudioStatistics statistics;
+		m_current_snapshot->get_statistics( *m_previous_snapshot, statistics );
+
+		std::swap( m_previous_snapshot, m_current_snapshot );
+
+		if( !m_server.lock() )
+		{
+			return;
+		}
+
+		m_server.get_audio_engine().get_driver_statistics( statistics );
+
+		trace_new_problems( statistics );
+
+		m_latest_statistics = statistics;
+
+		CAudioSettingsLogic::publish_statistics_to_all_audio_settings_nodes( m_server, statistics );
+
+		m_server.unlock();
+	}
+
+
+	void CAudioStatisticsPublisher::trace_new_problems( const CAudioStatistics &statistics ) const
+	{
+		const CAudioStatistics &previous = m_latest_statistics;
+
+		if( statistics.get_xruns() > previous.get_xruns() )
+		{
+			INTEGRA_TRACE_ERROR << "xruns - input underflows: " << statistics.input_underflows << ", input overflows: " << statistics.input_overflows << ", output underflows: " << statistics.output_underflows << ", output overflows: " << statistics.output_overflows;
+		}
+
+		if( statistics.ring_buffer_overruns > previous.ring_buffer_overruns || statistics.ring_buffer_underruns > previous.ring_buffer_underruns )
+		{
+			INTEGRA_TRACE_ERROR << "ring buffer overruns: " << statistics.ring_buffer_overruns << ", underruns: " << statistics.ring_buffer_underruns;
+		}
+
+		if( statistics.total_blocks_skipped > previous.total_blocks_skipped )
+		{
+			INTEGRA_TRACE_ERROR << "dsp blocks skipped because libpd was busy: " << statistics.total_blocks_skipped;
+		}
+
+		if( statistics.max_budget_percent > 100 )
+		{
+			INTEGRA_TRACE_ERROR << "slowest dsp block took " << statistics.max_microseconds << " microseconds - " << statistics.max_budget_percent << "% of its budget";
+		}
+	}
+
+
+	void *audio_statistics_thread_function( void *context )
+	{
+		CAudioStatisticsPublisher *publisher = static_cast< CAudioStatisticsPublisher * > ( context );
+		publisher->thread_function();
+
+		return NULL;
+	}
+}
@@ -0,0 +1,86 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+#ifndef INTEGRA_AUDIO_STATISTICS_PUBLISHER_H
+#define INTEGRA_AUDIO_STATISTICS_PUBLISHER_H
+
+#include "api/common_typedefs.h"
+#include "api/audio_statistics.h"
+
+#include <pthread.h>
+#include <semaphore.h>
+
+using namespace integra_api;
+
+
+namespace integra_internal
+{
+	class CServer;
+	class CDspLoadSnapshot;
+
+	/*
+	 CAudioStatisticsPublisher periodically collects dsp load and xrun statistics, publishes them to 
+	 AudioSettings nodes, and keeps the latest set for IServer::get_audio_statistics
+	*/
+
+	class CAudioStatisticsPublisher
+	{
+		public:
+
+			CAudioStatisticsPublisher( CServer &server );
+			~CAudioStatisticsPublisher();
+
+			/* the statistics most recently published.  Only meaningful whilst the server is locked */
+			const CAudioStatistics &get_latest_statistics() const { return m_latest_statistics; }
+
+			static const int publish_period_milliseconds;
+
+		private:
+
+			friend void *audio_statistics_thread_function( void *context );
+
+			void thread_function();
+
+			void publish();
+
+			void trace_new_problems( const CAudioStatistics &statistics ) const;
+
+			CServer &m_server;
+
+			/* publisher thread only */
+			CDspLoadSnapshot *m_previous_snapshot;
+			CDspLoadSnapshot *m_current_snapshot;
+
+			/* protected by the server lock */
+			CAudioStatistics m_latest_statistics;
+
+			pthread_t m_thread;
+			sem_t *m_thread_shutdown_semaphore;
+
+			static const int poll_microseconds;
+	};
+
+	void *audio_statistics_thread_function( void *context );
+}
+
+
+
+#endif /* INTEGRA_AUDIO_STATISTICS_PUBLISHER_H */
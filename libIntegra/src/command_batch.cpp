@@ -0,0 +1,299 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+
+
+#include "platform_specifics.h"
+
+#include "command_batch.h"
+#include "set_command.h"
+#include "server.h"
+#include "node_endpoint.h"
+#include "dsp_engine.h"
+#include "interface_definition.h"
+#include "api/value.h"
+#include "api/trace.h"
+#include "api/notification_sink.h"
+
+#include <assert.h>
+
+
+namespace integra_api
+{
+	ICommandBatch *ICommandBatch::create()
+	{
+		return new integra_internal::CCommandBatch;
+	}
+}
+
+
+namespace integra_internal
+{
+	CCommandBatch::CCommandBatch()
+	{
+	}
+
+
+	CCommandBatch::~CCommandBatch()
+	{
+		for( command_list::iterator i = m_commands.begin(); i != m_commands.end(); i++ )
+		{
+			delete *i;
+		}
+
+		clear_deferred();
+	}
+
+
+	void CCommandBatch::add_command( ICommand *command )
+	{
+		assert( command );
+
+		m_commands.push_back( command );
+	}
+
+
+	int CCommandBatch::get_number_of_commands() const
+	{
+		return m_commands.size();
+	}
+
+
+	CError CCommandBatch::execute( CServer &server, CCommandSource source, CCommandResult * )
+	{
+		CCommandBatch *open_batch = server.get_open_command_batch();
+		if( open_batch )
+		{
+			/* nested batch - its commands become part of the enclosing batch */
+			return execute_commands( server, source );
+		}
+
+		bool changes_structure = false;
+		CError error = validate( server, changes_structure );
+		if( error != CError::SUCCESS )
+		{
+			return error;
+		}
+
+		/* any modules and connections the batch creates or removes are applied to the dsp graph together */
+		CDspEngine &dsp_engine = server.get_dsp_engine();
+		if( changes_structure )
+		{
+			dsp_engine.begin_graph_edit();
+		}
+
+		server.set_open_command_batch( this );
+
+		error = execute_commands( server, source );
+
+		server.set_open_command_batch( NULL );
+
+		/* flush whatever was applied, even if the batch stopped early, so that the host and notification sink stay in sync */
+		flush( server );
+
+		if( changes_structure )
+		{
+			dsp_engine.end_graph_edit();
+		}
+
+		return error;
+	}
+
+
+	CError CCommandBatch::validate( const CServer &server, bool &changes_structure ) const
+	{
+		changes_structure = false;
+		for( command_list::const_iterator i = m_commands.begin(); i != m_commands.end(); i++ )
+		{
+			if( !dynamic_cast<const CSetCommand *>( *i ) )
+			{
+				changes_structure = true;
+				break;
+			}
+		}
+
+		for( command_list::const_iterator i = m_commands.begin(); i != m_commands.end(); i++ )
+		{
+			const CSetCommand *set_command = dynamic_cast<const CSetCommand *>( *i );
+			if( !set_command )
+			{
+				continue;
+			}
+
+			if( changes_structure )
+			{
+				if( !set_command->find_endpoint( server ) )
+				{
+					/* the endpoint may belong to a node created earlier in the batch - checked when applied */
+					continue;
+				}
+			}
+
+			CError error = set_command->validate( server );
+			if( error != CError::SUCCESS )
+			{
+				INTEGRA_TRACE_ERROR << "command batch failed validation - nothing applied";
+				return error;
+			}
+		}
+
+		return CError::SUCCESS;
+	}
+
+
+	CError CCommandBatch::execute_commands( CServer &server, CCommandSource source )
+	{
+		while( !m_commands.empty() )
+		{
+			ICommand *command = m_commands.front();
+			m_commands.pop_front();
+
+			/* process_command takes ownership of the command */
+			CError error = server.process_command( command, source );
+			if( error != CError::SUCCESS )
+			{
+				INTEGRA_TRACE_ERROR << "command in batch failed - discarding remaining " << m_commands.size() << " commands";
+				return error;
+			}
+		}
+
+		return CError::SUCCESS;
+	}
+
+
+	void CCommandBatch::defer_send_value( const CNodeEndpoint &endpoint )
+	{
+		const CNode &node = CNode::downcast( endpoint.get_node() );
+		internal_id node_id = node.get_id();
+		const CValue *value = endpoint.get_value();
+
+		if( value )
+		{
+			map_endpoint_to_index::const_iterator lookup = m_deferred_value_indices.find( &endpoint );
+			if( lookup != m_deferred_value_indices.end() )
+			{
+				CDeferredValue &deferred_value = m_deferred_values[ lookup->second ];
+
+				/* 
+				 the endpoint object may have been deleted and its address reused by a node created 
+				 later in the batch, so check the pending value really belongs to this endpoint
+				*/
+				bool is_same_endpoint = ( deferred_value.node_id == node_id && deferred_value.endpoint_name == endpoint.get_endpoint_definition().get_name() );
+
+				map_id_to_index::const_iterator last_bang = m_last_bang_indices.find( node_id );
+				bool is_after_bang = ( last_bang != m_last_bang_indices.end() && last_bang->second > lookup->second );
+
+				if( is_same_endpoint && !is_after_bang )
+				{
+					assert( deferred_value.value );
+					delete deferred_value.value;
+					deferred_value.value = value->clone();
+					return;
+				}
+			}
+		}
+
+		int index = m_deferred_values.size();
+
+		CDeferredValue deferred_value;
+		deferred_value.node_id = node_id;
+		deferred_value.endpoint_name = endpoint.get_endpoint_definition().get_name();
+		deferred_value.value = value ? value->clone() : NULL;
+		m_deferred_values.push_back( deferred_value );
+
+		if( value )
+		{
+			m_deferred_value_indices[ &endpoint ] = index;
+		}
+		else
+		{
+			m_last_bang_indices[ node_id ] = index;
+		}
+	}
+
+
+	void CCommandBatch::defer_notification( const CPath &endpoint_path, CCommandSource source )
+	{
+		const string &path_string = endpoint_path.get_string();
+
+		map_string_to_index::const_iterator lookup = m_deferred_notification_indices.find( path_string );
+		if( lookup != m_deferred_notification_indices.end() )
+		{
+			m_deferred_notifications[ lookup->second ].source = source;
+			return;
+		}
+
+		m_deferred_notification_indices[ path_string ] = m_deferred_notifications.size();
+		m_deferred_notifications.push_back( CDeferredNotification( endpoint_path, source ) );
+	}
+
+
+	void CCommandBatch::flush( CServer &server )
+	{
+		if( !m_deferred_values.empty() )
+		{
+			CDspEngine &dsp_engine = server.get_dsp_engine();
+
+			dsp_engine.begin_flush();
+
+			for( deferred_value_list::const_iterator i = m_deferred_values.begin(); i != m_deferred_values.end(); i++ )
+			{
+				dsp_engine.send_value( i->node_id, i->endpoint_name, i->value );
+			}
+
+			dsp_engine.end_flush();
+		}
+
+		/* swap out the notifications first, in case the sink processes further commands */
+		deferred_notification_list notifications;
+		notifications.swap( m_deferred_notifications );
+
+		clear_deferred();
+
+		INotificationSink *notification_sink = server.get_notification_sink();
+		if( notification_sink )
+		{
+			for( deferred_notification_list::const_iterator i = notifications.begin(); i != notifications.end(); i++ )
+			{
+				notification_sink->on_set_command( server, i->path, i->source );
+			}
+		}
+	}
+
+
+	void CCommandBatch::clear_deferred()
+	{
+		for( deferred_value_list::iterator i = m_deferred_values.begin(); i != m_deferred_values.end(); i++ )
+		{
+			if( i->value )
+			{
+				delete i->value;
+			}
+		}
+
+		m_deferred_values.clear();
+		m_deferred_value_indices.clear();
+		m_last_bang_indices.clear();
+
+		m_deferred_notifications.clear();
+		m_deferred_notification_indices.clear();
+	}
+}
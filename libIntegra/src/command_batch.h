@@ -0,0 +1,107 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+
+
+#ifndef INTEGRA_COMMAND_BATCH_PRIVATE
+#define INTEGRA_COMMAND_BATCH_PRIVATE
+
+#include "api/command.h"
+#include "api/path.h"
+#include "api/command_source.h"
+#include "node.h"
+
+#include <list>
+#include <vector>
+#include <unordered_map>
+
+using namespace integra_api;
+
+
+namespace integra_internal
+{
+	class CNodeEndpoint;
+
+
+	class CCommandBatch : public ICommandBatch
+	{
+		public:
+			CCommandBatch();
+			~CCommandBatch();
+
+			void add_command( ICommand *command );
+			int get_number_of_commands() const;
+
+			/* 
+			 called by set commands while the batch is open.  Values are coalesced per endpoint, but never 
+			 across a bang to the same node, so that a module sees the same values when it is banged
+			*/
+			void defer_send_value( const CNodeEndpoint &endpoint );
+			void defer_notification( const CPath &endpoint_path, CCommandSource source );
+
+		private:
+
+			CError execute( CServer &server, CCommandSource source, CCommandResult *result );
+
+			/* changes_structure is set when the batch holds anything besides set commands */
+			CError validate( const CServer &server, bool &changes_structure ) const;
+			CError execute_commands( CServer &server, CCommandSource source );
+			void flush( CServer &server );
+			void clear_deferred();
+
+			class CDeferredValue
+			{
+				public:
+					internal_id node_id;
+					string endpoint_name;
+					CValue *value;		/* NULL for bangs */
+			};
+
+			class CDeferredNotification
+			{
+				public:
+					CDeferredNotification( const CPath &path, CCommandSource source ) : path( path ), source( source ) {}
+
+					CPath path;
+					CCommandSource source;
+			};
+
+			typedef std::list<ICommand *> command_list;
+			typedef std::vector<CDeferredValue> deferred_value_list;
+			typedef std::vector<CDeferredNotification> deferred_notification_list;
+			typedef std::unordered_map<const CNodeEndpoint *, int> map_endpoint_to_index;
+			typedef std::unordered_map<internal_id, int> map_id_to_index;
+			typedef std::unordered_map<string, int> map_string_to_index;
+
+			command_list m_commands;
+
+			deferred_value_list m_deferred_values;
+			map_endpoint_to_index m_deferred_value_indices;
+			map_id_to_index m_last_bang_indices;
+
+			deferred_notification_list m_deferred_notifications;
+			map_string_to_index m_deferred_notification_indices;
+	};
+}
+
+
+
+#endif /*INTEGRA_COMMAND_BATCH_PRIVATE*/
@@ -51,6 +51,8 @@ namespace integra_internal
 
 		if( endpoint_name == endpoint_source_path )
 		{
+			server.get_connection_routing_table().update( get_node(), *node_endpoint.get_value() );
+
 			source_path_handler( server, node_endpoint, previous_value, source );
 			return;
 		}
@@ -67,8 +69,11 @@ namespace integra_internal
 	{
 		CLogic::handle_delete( server, source );
 
-		/* remove in host if needed */ 
 		const CNode &node = get_node();
+
+		server.get_connection_routing_table().remove( node );
+
+		/* remove in host if needed */ 
 		const CNode *connection_owner = CNode::downcast( node.get_parent() );
 
 		const INodeEndpoint *source_path = node.get_node_endpoint( endpoint_source_path );
@@ -89,6 +94,18 @@ namespace integra_internal
 	}
 
 
+	void CConnectionLogic::update_on_path_change( CServer &server )
+	{
+		CLogic::update_on_path_change( server );
+
+		/* the connection's source is relative to its parent, so its absolute source path has changed too */
+		const INodeEndpoint *source_path = get_node().get_node_endpoint( endpoint_source_path );
+		assert( source_path );
+
+		server.get_connection_routing_table().update( get_node(), *source_path->get_value() );
+	}
+
+
 	void CConnectionLogic::source_path_handler( CServer &server, const CNodeEndpoint &endpoint, const CValue *previous_value, CCommandSource source )
 	{
 		/* remove and/or add in host if needed */ 
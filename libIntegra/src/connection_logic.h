@@ -37,6 +37,8 @@ namespace integra_internal
 			void handle_set( CServer &server, const CNodeEndpoint &node_endpoint, const CValue *previous_value, CCommandSource source );
 			void handle_delete( CServer &server, CCommandSource source );
 
+			void update_on_path_change( CServer &server );
+
 		private:
 
 			void source_path_handler( CServer &server, const CNodeEndpoint &endpoint, const CValue *previous_value, CCommandSource source );
@@ -0,0 +1,133 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, 
+ * USA.
+ */
+
+
+
+
+#include "platform_specifics.h"
+
+#include "connection_routing_table.h"
+#include "api/trace.h"
+
+#include <algorithm>
+
+
+namespace integra_internal
+{
+	CConnectionRoutingTable::CConnectionRoutingTable()
+	{
+	}
+
+
+	CConnectionRoutingTable::~CConnectionRoutingTable()
+	{
+	}
+
+
+	void CConnectionRoutingTable::update( const CNode &connection, const string &source_path )
+	{
+		remove( connection );
+
+		if( source_path.empty() )
+		{
+			/* unconnected */
+			return;
+		}
+
+		string source_endpoint_path;
+		const INode *owner = connection.get_parent();
+		if( owner )
+		{
+			source_endpoint_path = owner->get_path().get_string() + "." + source_path;
+		}
+		else
+		{
+			source_endpoint_path = source_path;
+		}
+
+		connection_list &connections = m_connections_by_source[ source_endpoint_path ];
+
+		/* insert after any connections at the same or higher level */
+		int depth = get_depth( connection );
+		connection_list::iterator position = connections.begin();
+		while( position != connections.end() && get_depth( **position ) <= depth )
+		{
+			position++;
+		}
+
+		connections.insert( position, &connection );
+
+		m_sources_by_connection[ connection.get_id() ] = source_endpoint_path;
+	}
+
+
+	void CConnectionRoutingTable::remove( const CNode &connection )
+	{
+		map_id_to_source::iterator source_lookup = m_sources_by_connection.find( connection.get_id() );
+		if( source_lookup == m_sources_by_connection.end() )
+		{
+			/* not in table */
+			return;
+		}
+
+		map_source_to_connections::iterator connections_lookup = m_connections_by_source.find( source_lookup->second );
+		if( connections_lookup == m_connections_by_source.end() )
+		{
+			INTEGRA_TRACE_ERROR << "missing key in connection routing table: " << source_lookup->second;
+		}
+		else
+		{
+			connection_list &connections = connections_lookup->second;
+			connections.erase( std::remove( connections.begin(), connections.end(), &connection ), connections.end() );
+
+			if( connections.empty() )
+			{
+				m_connections_by_source.erase( connections_lookup );
+			}
+		}
+
+		m_sources_by_connection.erase( source_lookup );
+	}
+
+
+	const connection_list *CConnectionRoutingTable::lookup( const string &source_endpoint_path ) const
+	{
+		map_source_to_connections::const_iterator lookup = m_connections_by_source.find( source_endpoint_path );
+		if( lookup == m_connections_by_source.end() )
+		{
+			/* not found */
+			return NULL;
+		}
+
+		return &lookup->second;
+	}
+
+
+	int CConnectionRoutingTable::get_depth( const CNode &node )
+	{
+		int depth = 0;
+		for( const INode *ancestor = node.get_parent(); ancestor; ancestor = ancestor->get_parent() )
+		{
+			depth++;
+		}
+
+		return depth;
+	}
+}
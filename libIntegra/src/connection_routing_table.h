@@ -0,0 +1,73 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, 
+ * USA.
+ */
+
+
+
+#ifndef INTEGRA_CONNECTION_ROUTING_TABLE_H
+#define INTEGRA_CONNECTION_ROUTING_TABLE_H
+
+#include "api/common_typedefs.h"
+#include "node.h"
+
+#include <vector>
+
+
+namespace integra_internal
+{
+	typedef std::vector<const CNode *> connection_list;
+
+	/*
+	 CConnectionRoutingTable indexes Connection nodes by the absolute path of their source endpoint, 
+	 so that a set command can find its outgoing connections without searching the node tree.
+
+	 A connection is keyed by its parent's path plus its sourcePath, so it must be updated whenever 
+	 its sourcePath is set, or its own path changes due to it or an ancestor being renamed or moved.
+
+	 Connections sharing a source are listed in order of depth, so that connections in higher-level 
+	 containers are handled first.
+	*/
+
+	class CConnectionRoutingTable
+	{
+		public:
+
+			CConnectionRoutingTable();
+			~CConnectionRoutingTable();
+
+			void update( const CNode &connection, const string &source_path );
+			void remove( const CNode &connection );
+
+			/* returns NULL if there are no connections from source_endpoint_path */
+			const connection_list *lookup( const string &source_endpoint_path ) const;
+
+		private:
+
+			static int get_depth( const CNode &node );
+
+			typedef std::unordered_map<string, connection_list> map_source_to_connections;
+			typedef std::unordered_map<internal_id, string> map_id_to_source;
+
+			map_source_to_connections m_connections_by_source;
+			map_id_to_source m_sources_by_connection;
+	};
+}
+
+
+#endif
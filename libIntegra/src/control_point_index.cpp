@@ -0,0 +1,240 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+
+#include "platform_specifics.h"
+
+#include "control_point_index.h"
+
+#include <assert.h>
+#include <math.h>
+#include <algorithm>
+
+
+namespace integra_internal
+{
+	/* beyond this, a binary search is cheaper than walking the cursor forwards */
+	const int CControlPointIndex::max_cursor_steps = 8;
+
+
+	CControlPointIndex::CControlPointIndex()
+	{
+		m_cursor = 0;
+	}
+
+
+	void CControlPointIndex::set( internal_id id, int tick, float value, float curvature )
+	{
+		control_point_tick_map::iterator lookup = m_ticks.find( id );
+		if( lookup != m_ticks.end() )
+		{
+			control_point_array::iterator existing = find( id, lookup->second );
+			assert( existing != m_control_points.end() );
+
+			if( lookup->second == tick )
+			{
+				/* same position - update in place */
+				existing->m_value = value;
+				existing->m_curvature = curvature;
+				existing->m_exponent = pow( 2, -curvature );
+				return;
+			}
+
+			m_control_points.erase( existing );
+		}
+
+		CControlPoint control_point;
+		control_point.m_id = id;
+		control_point.m_tick = tick;
+		control_point.m_value = value;
+		control_point.m_curvature = curvature;
+		control_point.m_exponent = pow( 2, -curvature );
+
+		/* after any control points at the same tick */
+		control_point_array::iterator position = std::upper_bound( m_control_points.begin(), m_control_points.end(), tick, tick_before_control_point );
+		m_control_points.insert( position, control_point );
+
+		m_ticks[ id ] = tick;
+	}
+
+
+	void CControlPointIndex::remove( internal_id id )
+	{
+		control_point_tick_map::iterator lookup = m_ticks.find( id );
+		if( lookup == m_ticks.end() )
+		{
+			return;
+		}
+
+		control_point_array::iterator existing = find( id, lookup->second );
+		assert( existing != m_control_points.end() );
+
+		m_control_points.erase( existing );
+		m_ticks.erase( lookup );
+	}
+
+
+	void CControlPointIndex::clear()
+	{
+		m_control_points.clear();
+		m_ticks.clear();
+		m_cursor = 0;
+	}
+
+
+	bool CControlPointIndex::get_value( int tick, float &value )
+	{
+		if( m_control_points.empty() )
+		{
+			return false;
+		}
+
+		unsigned int next = seek( tick );
+
+		if( next == 0 )
+		{
+			/* before first control point - use next value */
+			value = m_control_points.front().m_value;
+			return true;
+		}
+
+		if( next == m_control_points.size() )
+		{
+			/* after last control point - use previous value */
+			value = m_control_points.back().m_value;
+			return true;
+		}
+
+		/* between control points - perform interpolation */
+		const CControlPoint &previous_point = m_control_points[ next - 1 ];
+		const CControlPoint &next_point = m_control_points[ next ];
+
+		int tick_range = next_point.m_tick - previous_point.m_tick;
+		assert( tick_range > 0 );
+
+		float interpolation = (float) ( tick - previous_point.m_tick ) / tick_range;
+
+		/* apply curvature */
+		if( previous_point.m_curvature != 0 )
+		{
+			interpolation = pow( interpolation, previous_point.m_exponent );
+		}
+
+		value = previous_point.m_value + interpolation * ( next_point.m_value - previous_point.m_value );
+		return true;
+	}
+
+
+	bool CControlPointIndex::get_segment( int tick, CSegment &segment )
+	{
+		if( m_control_points.empty() )
+		{
+			return false;
+		}
+
+		unsigned int next = seek( tick );
+
+		if( next == 0 )
+		{
+			const CControlPoint &first_point = m_control_points.front();
+			segment.m_start_tick = tick;
+			segment.m_end_tick = first_point.m_tick;
+			segment.m_has_end = true;
+			segment.m_start_value = segment.m_end_value = first_point.m_value;
+			segment.m_exponent = 1;
+			return true;
+		}
+
+		const CControlPoint &previous_point = m_control_points[ next - 1 ];
+		segment.m_start_tick = previous_point.m_tick;
+
+		if( next == m_control_points.size() )
+		{
+			segment.m_end_tick = previous_point.m_tick;
+			segment.m_has_end = false;
+			segment.m_start_value = segment.m_end_value = previous_point.m_value;
+			segment.m_exponent = 1;
+			return true;
+		}
+
+		const CControlPoint &next_point = m_control_points[ next ];
+		segment.m_end_tick = next_point.m_tick;
+		segment.m_has_end = true;
+		segment.m_start_value = previous_point.m_value;
+		segment.m_end_value = next_point.m_value;
+		segment.m_exponent = ( previous_point.m_curvature != 0 ) ? previous_point.m_exponent : 1;
+		return true;
+	}
+
+
+	CControlPointIndex::control_point_array::iterator CControlPointIndex::find( internal_id id, int tick )
+	{
+		control_point_array::iterator i = std::lower_bound( m_control_points.begin(), m_control_points.end(), tick, control_point_before_tick );
+		for( ; i != m_control_points.end() && i->m_tick == tick; i++ )
+		{
+			if( i->m_id == id )
+			{
+				return i;
+			}
+		}
+
+		return m_control_points.end();
+	}
+
+
+	bool CControlPointIndex::tick_before_control_point( int tick, const CControlPoint &control_point )
+	{
+		return tick < control_point.m_tick;
+	}
+
+
+	bool CControlPointIndex::control_point_before_tick( const CControlPoint &control_point, int tick )
+	{
+		return control_point.m_tick < tick;
+	}
+
+
+	unsigned int CControlPointIndex::seek( int tick )
+	{
+		unsigned int number_of_control_points = m_control_points.size();
+		if( m_cursor > number_of_control_points )
+		{
+			m_cursor = number_of_control_points;
+		}
+
+		if( m_cursor == 0 || m_control_points[ m_cursor - 1 ].m_tick <= tick )
+		{
+			/* tick is at or after the cursor's segment - try walking forwards */
+			for( int step = 0; step <= max_cursor_steps; step++ )
+			{
+				if( m_cursor == number_of_control_points || m_control_points[ m_cursor ].m_tick > tick )
+				{
+					return m_cursor;
+				}
+
+				m_cursor++;
+			}
+		}
+
+		m_cursor = std::upper_bound( m_control_points.begin(), m_control_points.end(), tick, tick_before_control_point ) - m_control_points.begin();
+		return m_cursor;
+	}
+}
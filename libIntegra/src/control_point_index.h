@@ -0,0 +1,114 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+
+#ifndef INTEGRA_CONTROL_POINT_INDEX_H
+#define INTEGRA_CONTROL_POINT_INDEX_H
+
+#include "api/common_typedefs.h"
+#include "node.h"
+
+#include <vector>
+#include <unordered_map>
+
+
+namespace integra_internal
+{
+	/*
+	 CControlPointIndex keeps an envelope's control points sorted by tick, so that the envelope's 
+	 value can be found without visiting every control point.
+
+	 It remembers where the previous lookup landed.  During forward playback the next lookup is 
+	 normally in the same segment or a step or two further on, so costs O(1) amortized; any other 
+	 lookup is a binary search.
+	*/
+
+	class CControlPointIndex
+	{
+		public:
+
+			CControlPointIndex();
+
+			/* adds the control point, or updates it if it is already in the index */
+			void set( internal_id id, int tick, float value, float curvature );
+			void remove( internal_id id );
+			void clear();
+
+			int get_number_of_control_points() const { return m_control_points.size(); }
+
+			/* returns false when there are no control points */
+			bool get_value( int tick, float &value );
+
+			/* 
+			 the stretch of the envelope which contains tick.  Before the first control point and after 
+			 the last one the envelope is flat, and after the last one it has no end
+			*/
+			class CSegment
+			{
+				public:
+					int m_start_tick;
+					int m_end_tick;
+					bool m_has_end;
+					float m_start_value;
+					float m_end_value;
+					double m_exponent;
+			};
+
+			/* returns false when there are no control points */
+			bool get_segment( int tick, CSegment &segment );
+
+		private:
+
+			class CControlPoint
+			{
+				public:
+					internal_id m_id;
+					int m_tick;
+					float m_value;
+					float m_curvature;
+
+					/* pow( 2, -curvature ), cached since it is needed at every tick */
+					double m_exponent;
+			};
+
+			typedef std::vector<CControlPoint> control_point_array;
+			typedef std::unordered_map<internal_id, int> control_point_tick_map;
+
+			control_point_array::iterator find( internal_id id, int tick );
+
+			/* index of the first control point after tick */
+			unsigned int seek( int tick );
+
+			static bool tick_before_control_point( int tick, const CControlPoint &control_point );
+			static bool control_point_before_tick( const CControlPoint &control_point, int tick );
+
+			control_point_array m_control_points;
+			control_point_tick_map m_ticks;
+
+			unsigned int m_cursor;
+
+			static const int max_cursor_steps;
+	};
+}
+
+
+
+#endif /* INTEGRA_CONTROL_POINT_INDEX_H */
@@ -62,7 +62,7 @@ namespace integra_internal
 
 		const string &endpoint_name = node_endpoint.get_endpoint_definition().get_name();
 	
-		if( endpoint_name == endpoint_value || endpoint_name == endpoint_tick )
+		if( endpoint_name == endpoint_value || endpoint_name == endpoint_tick || endpoint_name == endpoint_curvature )
 		{
 			update_envelope( server, CNode::downcast( get_node().get_parent() ) );
 			return;
@@ -76,10 +76,10 @@ namespace integra_internal
 
 		/* let's handle the obscure case of moving a control point from one envelope to another! */
 
-		/* update the previous envelope */
+		/* remove from the previous envelope */
 		CPath old_parent_path( previous_path );
 		old_parent_path.pop_element();
-		update_envelope( server, CNode::downcast( server.find_node( old_parent_path ) ) );
+		update_envelope( server, CNode::downcast( server.find_node( old_parent_path ) ), true );
 
 		/* update the new envelope */
 		update_envelope( server, CNode::downcast( get_node().get_parent() ) );
@@ -94,7 +94,7 @@ namespace integra_internal
 	}
 
 
-	void CControlPointLogic::update_envelope( CServer &server, const CNode *envelope_node, bool is_deleting )
+	void CControlPointLogic::update_envelope( CServer &server, const CNode *envelope_node, bool is_removing )
 	{
 		if( !envelope_node )
 		{
@@ -109,7 +109,14 @@ namespace integra_internal
 			return;
 		}
 
-		envelope_logic->update_value( server, is_deleting ? &get_node() : NULL );
+		if( is_removing )
+		{
+			envelope_logic->remove_control_point( server, get_node() );
+		}
+		else
+		{
+			envelope_logic->update_control_point( server, get_node() );
+		}
 	}
 
 
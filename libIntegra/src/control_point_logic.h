@@ -45,7 +45,7 @@ namespace integra_internal
 
 		private:
 
-			void update_envelope( CServer &server, const CNode *envelope_node, bool is_deleting = false );
+			void update_envelope( CServer &server, const CNode *envelope_node, bool is_removing = false );
 
 			static const string endpoint_tick;
 			static const string endpoint_value;
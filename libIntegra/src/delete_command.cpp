@@ -56,6 +56,10 @@ namespace integra_internal
 			return CError::PATH_ERROR;
 		}
 
+		/* removing a subtree only rebuilds the dsp graph once.  Child deletes nest inside this scope */
+		CDspEngine &dsp_engine = server.get_dsp_engine();
+		dsp_engine.begin_graph_edit();
+
 		/* delete children */
 		node_map copy_of_children( node->get_children() );
 		for( node_map::iterator i = copy_of_children.begin(); i != copy_of_children.end(); i++ )
@@ -69,15 +73,18 @@ namespace integra_internal
 
 		/* state tables */
 		server.get_state_table().remove( *node );
+		server.get_state_table().release_handles( *node );
 
 		/* remove in host */
 		const CInterfaceDefinition &interface_definition = CInterfaceDefinition::downcast( node->get_interface_definition() );
 
 		if( interface_definition.has_implementation() )
 		{
-			server.get_dsp_engine().remove_module( node->get_id() );
+			dsp_engine.remove_module( node->get_id() );
 		}
 
+		dsp_engine.end_graph_edit();
+
 		/* remove from owning container */
 		server.get_sibling_set_writable( *node ).erase( node->get_name() );
 
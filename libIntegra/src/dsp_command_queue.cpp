@@ -0,0 +1,361 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+
+#include "platform_specifics.h"
+
+#include "dsp_command_queue.h"
+#include "api/trace.h"
+
+#include <string.h>
+#include <assert.h>
+
+
+namespace integra_internal
+{
+	void CDspCommand::clear()
+	{
+		m_target_type = LIST_TARGET;
+		m_number_of_atoms = 0;
+
+		/* offset 0 is always an empty string */
+		m_strings[ 0 ] = 0;
+		m_string_bytes_used = 1;
+
+		m_receiver_offset = 0;
+		m_selector_offset = 0;
+		m_node_id = 0;
+		m_target_node_id = 0;
+		m_frame = 0;
+	}
+
+
+	bool CDspCommand::set_list_target( const char *receiver )
+	{
+		m_target_type = LIST_TARGET;
+		m_receiver_offset = store_string( receiver );
+
+		return ( m_receiver_offset >= 0 );
+	}
+
+
+	bool CDspCommand::set_message_target( const char *receiver, const char *selector )
+	{
+		m_target_type = MESSAGE_TARGET;
+		m_receiver_offset = store_string( receiver );
+		m_selector_offset = store_string( selector );
+
+		return ( m_receiver_offset >= 0 && m_selector_offset >= 0 );
+	}
+
+
+	void CDspCommand::set_node_target( unsigned long node_id )
+	{
+		m_target_type = NODE_TARGET;
+		m_node_id = node_id;
+	}
+
+
+	void CDspCommand::set_node_binding( unsigned long node_id, bool bind )
+	{
+		m_target_type = bind ? BIND_NODE : UNBIND_NODE;
+		m_node_id = node_id;
+	}
+
+
+	void CDspCommand::set_node_object( unsigned long node_id, bool create )
+	{
+		m_target_type = create ? CREATE_OBJECT : DELETE_OBJECT;
+		m_node_id = node_id;
+	}
+
+
+	void CDspCommand::set_node_connection( unsigned long source_node_id, unsigned long target_node_id, bool connect )
+	{
+		m_target_type = connect ? CONNECT_OBJECTS : DISCONNECT_OBJECTS;
+		m_node_id = source_node_id;
+		m_target_node_id = target_node_id;
+	}
+
+
+	void CDspCommand::set_dsp_suspension( bool suspend )
+	{
+		m_target_type = suspend ? SUSPEND_DSP : RESUME_DSP;
+	}
+
+
+	void CDspCommand::set_abstraction_invalidation()
+	{
+		m_target_type = INVALIDATE_ABSTRACTIONS;
+	}
+
+
+	bool CDspCommand::add_float( float value )
+	{
+		if( m_number_of_atoms >= max_atoms )
+		{
+			INTEGRA_TRACE_ERROR << "too many atoms in dsp command";
+			return false;
+		}
+
+		CAtom &atom = m_atoms[ m_number_of_atoms ];
+		atom.is_symbol = false;
+		atom.value = value;
+		atom.symbol_offset = 0;
+
+		m_number_of_atoms++;
+		return true;
+	}
+
+
+	bool CDspCommand::add_symbol( const char *symbol )
+	{
+		if( m_number_of_atoms >= max_atoms )
+		{
+			INTEGRA_TRACE_ERROR << "too many atoms in dsp command";
+			return false;
+		}
+
+		int offset = store_string( symbol );
+		if( offset < 0 )
+		{
+			return false;
+		}
+
+		CAtom &atom = m_atoms[ m_number_of_atoms ];
+		atom.is_symbol = true;
+		atom.value = 0;
+		atom.symbol_offset = offset;
+
+		m_number_of_atoms++;
+		return true;
+	}
+
+
+	int CDspCommand::store_string( const char *string )
+	{
+		int length = strlen( string ) + 1;
+		if( m_string_bytes_used + length > string_storage_size )
+		{
+			INTEGRA_TRACE_ERROR << "dsp command string storage exhausted - can't store " << string;
+			return -1;
+		}
+
+		int offset = m_string_bytes_used;
+		memcpy( m_strings + offset, string, length );
+		m_string_bytes_used += length;
+
+		return offset;
+	}
+
+
+	CDspCommandQueue::CDspCommandQueue( unsigned int number_of_slots )
+	{
+		/* round up to a power of two so that indices can be masked rather than wrapped */
+		m_number_of_slots = 1;
+		while( m_number_of_slots < number_of_slots )
+		{
+			m_number_of_slots <<= 1;
+		}
+
+		m_index_mask = m_number_of_slots - 1;
+
+		m_slots = new CDspCommand[ m_number_of_slots ];
+
+		m_write_index.store( 0 );
+		m_read_index.store( 0 );
+
+		m_next_write_index = 0;
+		m_is_holding_commands = false;
+	}
+
+
+	CDspCommandQueue::~CDspCommandQueue()
+	{
+		delete [] m_slots;
+	}
+
+
+	CDspCommand *CDspCommandQueue::begin_write()
+	{
+		unsigned int read_index = m_read_index.load( std::memory_order_acquire );
+
+		if( m_next_write_index - read_index >= m_number_of_slots )
+		{
+			/* full */
+			return NULL;
+		}
+
+		CDspCommand *command = &m_slots[ m_next_write_index & m_index_mask ];
+		command->clear();
+		return command;
+	}
+
+
+	void CDspCommandQueue::end_write()
+	{
+		m_next_write_index++;
+
+		if( !m_is_holding_commands )
+		{
+			m_write_index.store( m_next_write_index, std::memory_order_release );
+		}
+	}
+
+
+	void CDspCommandQueue::hold_commands()
+	{
+		m_is_holding_commands = true;
+	}
+
+
+	void CDspCommandQueue::release_held_commands()
+	{
+		m_is_holding_commands = false;
+
+		m_write_index.store( m_next_write_index, std::memory_order_release );
+	}
+
+
+	const CDspCommand *CDspCommandQueue::begin_read()
+	{
+		unsigned int read_index = m_read_index.load( std::memory_order_relaxed );
+		unsigned int write_index = m_write_index.load( std::memory_order_acquire );
+
+		if( read_index == write_index )
+		{
+			/* empty */
+			return NULL;
+		}
+
+		return &m_slots[ read_index & m_index_mask ];
+	}
+
+
+	void CDspCommandQueue::end_read()
+	{
+		unsigned int read_index = m_read_index.load( std::memory_order_relaxed );
+		assert( read_index != m_write_index.load( std::memory_order_relaxed ) );
+
+		m_read_index.store( read_index + 1, std::memory_order_release );
+	}
+
+
+	unsigned int CDspCommandQueue::get_number_of_free_slots() const
+	{
+		/* held commands occupy their slots too */
+		return m_number_of_slots - ( m_next_write_index - m_read_index.load( std::memory_order_acquire ) );
+	}
+
+
+	bool CDspCommandQueue::is_empty() const
+	{
+		return ( m_read_index.load( std::memory_order_acquire ) == m_write_index.load( std::memory_order_acquire ) );
+	}
+
+
+	CDspCommandScheduler::CDspCommandScheduler( unsigned int capacity )
+	{
+		assert( capacity > 0 );
+
+		m_commands = new CDspCommand[ capacity ];
+		m_capacity = capacity;
+		m_first = 0;
+		m_number_of_commands = 0;
+	}
+
+
+	CDspCommandScheduler::~CDspCommandScheduler()
+	{
+		delete [] m_commands;
+	}
+
+
+	bool CDspCommandScheduler::schedule( const CDspCommand &command )
+	{
+		if( m_number_of_commands >= m_capacity )
+		{
+			return false;
+		}
+
+		/* 
+		 commands almost always arrive in frame order, so this insertion normally stops immediately.  
+		 Commands for the same frame keep the order in which they were scheduled
+		*/
+		unsigned int index = m_number_of_commands;
+		while( index > 0 && get_command( index - 1 ).get_frame() > command.get_frame() )
+		{
+			get_command( index ) = get_command( index - 1 );
+			index--;
+		}
+
+		get_command( index ) = command;
+		m_number_of_commands++;
+
+		return true;
+	}
+
+
+	const CDspCommand *CDspCommandScheduler::begin_due( int64_t end_frame ) const
+	{
+		if( m_number_of_commands == 0 )
+		{
+			return NULL;
+		}
+
+		const CDspCommand &command = m_commands[ m_first ];
+		if( command.get_frame() >= end_frame )
+		{
+			return NULL;
+		}
+
+		return &command;
+	}
+
+
+	void CDspCommandScheduler::end_due()
+	{
+		assert( m_number_of_commands > 0 );
+
+		m_first = ( m_first + 1 ) % m_capacity;
+		m_number_of_commands--;
+	}
+
+
+	void CDspCommandScheduler::dispatch_commands( CDspCommandQueue &queue, int64_t end_frame, IDspCommandDispatcher &dispatcher )
+	{
+		while( const CDspCommand *command = queue.begin_read() )
+		{
+			if( command->get_frame() < end_frame || !schedule( *command ) )
+			{
+				dispatcher.dispatch_command( *command );
+			}
+
+			queue.end_read();
+		}
+
+		while( const CDspCommand *command = begin_due( end_frame ) )
+		{
+			dispatcher.dispatch_command( *command );
+			end_due();
+		}
+	}
+}
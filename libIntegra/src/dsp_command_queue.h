@@ -0,0 +1,221 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+#ifndef INTEGRA_DSP_COMMAND_QUEUE_H
+#define INTEGRA_DSP_COMMAND_QUEUE_H
+
+#include <atomic>
+#include <stdint.h>
+
+
+namespace integra_internal
+{
+	/*
+	 CDspCommand is a single pd message, stored inline in a preallocated slot so that
+	 it can be built on the control thread and dispatched on the dsp thread without
+	 any allocation.  Symbols (including the receiver and selector names) are copied
+	 into the slot's own string storage.
+	*/
+
+	class CDspCommand
+	{
+		public:
+
+			static const int max_atoms = 8;
+			static const int string_storage_size = 1024;
+
+			enum target_type
+			{
+				LIST_TARGET,		/* list to a named receiver */
+				MESSAGE_TARGET,		/* message with a selector to a named receiver */
+				NODE_TARGET,		/* list to a module instance's own receiver */
+				BIND_NODE,			/* resolve and cache a module instance's receiver */
+				UNBIND_NODE,		/* forget a module instance's receiver */
+				CREATE_OBJECT,		/* create a module instance on the host canvas and remember it */
+				DELETE_OBJECT,		/* delete a module instance from the host canvas */
+				CONNECT_OBJECTS,	/* connect an outlet of one module instance to an inlet of another */
+				DISCONNECT_OBJECTS,	/* remove a connection made by CONNECT_OBJECTS */
+				SUSPEND_DSP,		/* stop pd resorting its dsp chain after each canvas edit */
+				RESUME_DSP,			/* rebuild the dsp chain once, and restore the state from before SUSPEND_DSP */
+				INVALIDATE_ABSTRACTIONS	/* forget cached abstractions from the directory given as a symbol */
+			};
+
+			void clear();
+
+			/* a list goes to a receiver, a message goes to a receiver with a selector */
+			bool set_list_target( const char *receiver );
+			bool set_message_target( const char *receiver, const char *selector );
+
+			/* node ids are integra_internal::internal_id */
+			void set_node_target( unsigned long node_id );
+			void set_node_binding( unsigned long node_id, bool bind );
+
+			/* object creation takes the host canvas's "obj" arguments as atoms, connections take outlet and inlet indices */
+			void set_node_object( unsigned long node_id, bool create );
+			void set_node_connection( unsigned long source_node_id, unsigned long target_node_id, bool connect );
+
+			void set_dsp_suspension( bool suspend );
+			void set_abstraction_invalidation();
+
+			bool add_float( float value );
+			bool add_symbol( const char *symbol );
+
+			/* the audio frame at which the command is due.  0 means as soon as possible */
+			void set_frame( int64_t frame ) { m_frame = frame; }
+			int64_t get_frame() const { return m_frame; }
+
+			target_type get_target_type() const { return m_target_type; }
+			const char *get_receiver() const { return m_strings + m_receiver_offset; }
+			const char *get_selector() const { return m_strings + m_selector_offset; }
+			unsigned long get_node_id() const { return m_node_id; }
+			unsigned long get_target_node_id() const { return m_target_node_id; }
+
+			int get_number_of_atoms() const { return m_number_of_atoms; }
+			bool is_symbol( int index ) const { return m_atoms[ index ].is_symbol; }
+			float get_float( int index ) const { return m_atoms[ index ].value; }
+			const char *get_symbol( int index ) const { return m_strings + m_atoms[ index ].symbol_offset; }
+
+		private:
+
+			int store_string( const char *string );
+
+			struct CAtom
+			{
+				bool is_symbol;
+				float value;
+				int symbol_offset;
+			};
+
+			target_type m_target_type;
+			int m_receiver_offset;
+			int m_selector_offset;
+			unsigned long m_node_id;
+			unsigned long m_target_node_id;
+			int64_t m_frame;
+
+			CAtom m_atoms[ max_atoms ];
+			int m_number_of_atoms;
+
+			char m_strings[ string_storage_size ];
+			int m_string_bytes_used;
+	};
+
+
+	/*
+	 CDspCommandQueue is a lock-free single-producer/single-consumer ring of CDspCommands.
+
+	 The producer (the control thread, serialized by the server lock) calls
+	 begin_write / end_write.  A slot from begin_write which isn't passed to end_write is 
+	 abandoned - the next begin_write returns it again, cleared.  The consumer (whichever thread currently owns libpd -
+	 normally the audio callback) calls begin_read / end_read.  Neither side ever blocks.
+
+	 Whilst the producer holds commands, end_write doesn't publish them, so that the consumer 
+	 receives everything written between hold_commands and release_held_commands at once.
+	*/
+
+	class CDspCommandQueue
+	{
+		public:
+
+			CDspCommandQueue( unsigned int number_of_slots );
+			~CDspCommandQueue();
+
+			/* producer side.  begin_write returns NULL when the queue is full */
+			CDspCommand *begin_write();
+			void end_write();
+			unsigned int get_number_of_free_slots() const;
+
+			/* producer side */
+			void hold_commands();
+			void release_held_commands();
+			bool is_holding_commands() const { return m_is_holding_commands; }
+
+			/* consumer side.  begin_read returns NULL when the queue is empty */
+			const CDspCommand *begin_read();
+			void end_read();
+
+			bool is_empty() const;
+
+		private:
+
+			CDspCommand *m_slots;
+			unsigned int m_number_of_slots;
+			unsigned int m_index_mask;
+
+			std::atomic<unsigned int> m_write_index;
+			std::atomic<unsigned int> m_read_index;
+
+			/* producer only.  Runs ahead of m_write_index whilst commands are held */
+			unsigned int m_next_write_index;
+			bool m_is_holding_commands;
+	};
+
+
+	/* Interface for the consumer of a CDspCommandScheduler's due commands */
+	class IDspCommandDispatcher
+	{
+		public:
+			virtual void dispatch_command( const CDspCommand &command ) = 0;
+	};
+
+
+	/*
+	 CDspCommandScheduler holds commands which were stamped for a future frame until the block 
+	 which contains that frame is processed.  It belongs to the consumer thread, keeps its 
+	 commands in frame order, and never allocates after construction.
+	*/
+
+	class CDspCommandScheduler
+	{
+		public:
+
+			CDspCommandScheduler( unsigned int capacity );
+			~CDspCommandScheduler();
+
+			/* returns false when full, in which case the caller should dispatch the command straight away */
+			bool schedule( const CDspCommand &command );
+
+			/* begin_due returns the earliest command due before end_frame, or NULL if there are none */
+			const CDspCommand *begin_due( int64_t end_frame ) const;
+			void end_due();
+
+			/* 
+			 empties queue, dispatching commands due before end_frame and scheduling later ones, then 
+			 dispatches the scheduled commands which have become due - once per processed block
+			*/
+			void dispatch_commands( CDspCommandQueue &queue, int64_t end_frame, IDspCommandDispatcher &dispatcher );
+
+			bool is_empty() const { return ( m_number_of_commands == 0 ); }
+
+		private:
+
+			CDspCommand &get_command( unsigned int index ) { return m_commands[ ( m_first + index ) % m_capacity ]; }
+
+			CDspCommand *m_commands;
+			unsigned int m_capacity;
+			unsigned int m_first;
+			unsigned int m_number_of_commands;
+	};
+}
+
+
+
+#endif /* INTEGRA_DSP_COMMAND_QUEUE_H */
@@ -24,17 +24,21 @@
 #include "dsp_engine.h"
 #include "interface_definition.h"
 #include "file_helper.h"
-#include "midi_input_filterer.h"
-#include "midi_input_dispatcher.h"
 #include "server.h"
+#include "module_manager.h"
 #include "midi_engine.h"
+#include "dsp_command_queue.h"
+#include "dsp_load_monitor.h"
 #include "api/command.h"
 #include "api/trace.h"
 
 #include "PdBase.hpp"
+#include "z_libpd.h"
 
-#include <fstream>
+#include <sstream>
+#include <chrono>
 #include <iostream>
+#include <unistd.h>
 
 
 using namespace integra_api;
@@ -45,12 +49,24 @@ namespace integra_internal
 	const int CDspEngine::samples_per_buffer = 64;
 	const int CDspEngine::max_audio_channels = 64;
 
+	const int CDspEngine::command_queue_slots = 1024;
+	const int CDspEngine::command_scheduler_slots = 256;
+	const int CDspEngine::command_queue_wait_microseconds = 500;
+	const int CDspEngine::command_queue_max_waits = 20;
+	const int CDspEngine::feedback_queue_slots = 4096;
+
+	/* should cover the audio driver's buffer, so that midi which arrives between callbacks keeps its timing */
+	const int CDspEngine::midi_latency_milliseconds = 10;
+	const int CDspEngine::midi_clock_tolerance_milliseconds = 100;
+
 	const string CDspEngine::patch_file_name = "host_patch_file.pd";
 	const string CDspEngine::host_patch_name = "integra-canvas";
 	const string CDspEngine::patch_message_target = "pd-" + host_patch_name;
 
 	const string CDspEngine::feedback_source = "integra";
 	const string CDspEngine::broadcast_symbol = "integra-broadcast-receive";
+	const string CDspEngine::node_receiver_prefix = "integra-receive-";
+	const string CDspEngine::envelope_receiver = "integra-envelopes";
 	const string CDspEngine::bang = "bang";
 
 	const int CDspEngine::module_x_margin = 10;
@@ -64,6 +80,14 @@ namespace integra_internal
 	const string CDspEngine::ping_message = "ping";
 
 
+	/* 
+	 libpd's hooks are process-wide and carry no context.  There is only ever one libpd instance, so the 
+	 engine which owns it is remembered here, along with PdBase's own list hook for everything which isn't feedback
+	*/
+	static CDspEngine *feedback_hook_engine = NULL;
+	static t_libpd_listhook pd_base_list_hook = NULL;
+
+
 	CDspEngine::CDspEngine( CServer &server )
 		:	m_server( server )
 	{
@@ -72,16 +96,34 @@ namespace integra_internal
 		m_input_channels = 2;
 		m_output_channels = 2;
 		m_sample_rate = 44100;
+		m_frames_processed = 0;
 
 		m_unanswered_pings = 0;
 
 		m_next_module_y_slot = 1;
+		m_host_canvas = NULL;
 
-		create_host_patch();
+		m_command_queue = new CDspCommandQueue( command_queue_slots );
+		m_command_scheduler = new CDspCommandScheduler( command_scheduler_slots );
+		m_schedule_frame = 0;
+		m_is_flushing = false;
+		m_flush_holds_mutex = false;
+		m_graph_edit_depth = 0;
+		m_dsp_state_before_graph_edit = 0;
 
-		m_midi_input_filterer = new CMidiInputFilterer();
+		m_midi_clock_is_anchored = false;
+		m_midi_clock_anchor_time = 0;
+		m_midi_clock_anchor_frame = 0;
+		m_midi_clock_sample_rate = 0;
+		m_block_start = 0;
+		m_has_pending_midi_input = false;
 
-		m_feedback_queue = new CThreadedQueue<pd::Message>( *this );
+		m_message_queue = new CThreadedQueue<pd::Message>( *this );
+
+		m_feedback_queue = new CDspFeedbackQueue( *this, feedback_queue_slots );
+		m_reported_dropped_feedback = 0;
+
+		m_load_monitor = new CDspLoadMonitor( samples_per_buffer );
 
 		m_pd = new pd::PdBase;
 
@@ -89,11 +131,9 @@ namespace integra_internal
 
 		setup_libpd();
 
-		pd::Patch patch = m_pd->openPatch( patch_file_name, m_server.get_scratch_directory() );
-		if( !patch.isValid() )
-		{
-			INTEGRA_TRACE_ERROR << "failed to load patch: " << get_patch_file_path();
-		}
+		integra_abstraction_cache_set_reader( read_implementation_file, &CModuleManager::downcast( m_server.get_module_manager() ).get_implementation_files() );
+
+		open_host_patch();
 
 		register_externals();
 
@@ -108,16 +148,19 @@ namespace integra_internal
 		m_pd->clear();
 		delete m_pd;
 
-		delete m_feedback_queue;
+		integra_abstraction_cache_clear();
+		integra_abstraction_cache_set_reader( NULL, NULL );
 
-		delete m_midi_input_filterer;
+		feedback_hook_engine = NULL;
+		pd_base_list_hook = NULL;
 
-		for( set_command_list::iterator i = m_set_commands.begin(); i != m_set_commands.end(); i++ )
-		{
-			delete *i;
-		}
+		delete m_feedback_queue;
+		delete m_message_queue;
 
-		delete_host_patch();
+		delete m_load_monitor;
+
+		delete m_command_queue;
+		delete m_command_scheduler;
 
 		pthread_mutex_unlock( &m_mutex );
 
@@ -136,36 +179,41 @@ namespace integra_internal
 		soundfile_info_setup();
 		fsplay_tilde_setup();
                 copy_setup();
+		integra_envelope_setup();
 	}
 
 
-	string CDspEngine::get_patch_file_path() const
+	void CDspEngine::open_host_patch()
 	{
-		return m_server.get_scratch_directory() + patch_file_name;
-	}
-
+		/* the host patch is evaluated from text, rather than written to the scratch directory for libpd to open */
+		std::ostringstream host_patch;
+		host_patch << "#N canvas 250 50 800 600 10;" << std::endl;
+		host_patch << "#N canvas 10 30 400 400 integra-canvas 0;" << std::endl;
+		host_patch << "#X restore 30 20 pd integra-canvas;" << std::endl;
 
-	void CDspEngine::create_host_patch()
-	{
-		std::ofstream host_patch_file;
-		host_patch_file.open( get_patch_file_path(), std::ios_base::out | std::ios_base::trunc );
-		if( host_patch_file.fail() )
+		if( !integra_canvas_open( host_patch.str().c_str(), patch_file_name.c_str(), m_server.get_scratch_directory().c_str() ) )
 		{
-			INTEGRA_TRACE_ERROR << "Failed to open host patch " << get_patch_file_path();
-			return;
+			INTEGRA_TRACE_ERROR << "failed to load host patch";
 		}
 
-		host_patch_file << "#N canvas 250 50 800 600 10;" << std::endl;
-		host_patch_file << "#N canvas 10 30 400 400 integra-canvas 0;" << std::endl;
-		host_patch_file << "#X restore 30 20 pd integra-canvas;" << std::endl;
-
-		host_patch_file.close();
+		m_host_canvas = integra_canvas_find( patch_message_target.c_str() );
+		if( !m_host_canvas )
+		{
+			INTEGRA_TRACE_ERROR << "failed to find host canvas " << patch_message_target;
+		}
 	}
 
 
-	void CDspEngine::delete_host_patch()
+	int CDspEngine::read_implementation_file( void *context, const char *path, t_binbuf *contents )
 	{
-		CFileHelper::delete_file( get_patch_file_path() );
+		string file_contents;
+		if( !static_cast<CImplementationFileSystem *>( context )->read_file( path, file_contents ) )
+		{
+			return 0;
+		}
+
+		binbuf_text( contents, ( char * ) file_contents.c_str(), file_contents.length() );
+		return 1;
 	}
 
 
@@ -223,6 +271,82 @@ namespace integra_internal
 	{
 		m_pd->computeAudio( true );
 		m_pd->subscribe( feedback_source );
+
+		install_feedback_hook();
+	}
+
+
+	void CDspEngine::install_feedback_hook()
+	{
+		/* PdBase::init resets libpd's hooks, so this is repeated after each init */
+		if( libpd_listhook != ( t_libpd_listhook ) feedback_list_hook )
+		{
+			pd_base_list_hook = libpd_listhook;
+			libpd_listhook = ( t_libpd_listhook ) feedback_list_hook;
+		}
+
+		feedback_hook_engine = this;
+	}
+
+
+	void CDspEngine::feedback_list_hook( const char *receiver, int argc, t_atom *argv )
+	{
+		/* 
+		 called by libpd on the thread which holds m_mutex.  Must not allocate - anything which 
+		 isn't well-formed feedback is left to PdBase, and reaches poll_for_messages as before
+		*/
+		if( feedback_hook_engine && strcmp( receiver, feedback_source.c_str() ) == 0 )
+		{
+			if( feedback_hook_engine->record_feedback( argc, argv ) )
+			{
+				return;
+			}
+		}
+
+		if( pd_base_list_hook )
+		{
+			pd_base_list_hook( receiver, argc, argv );
+		}
+	}
+
+
+	bool CDspEngine::record_feedback( int argc, const t_atom *argv )
+	{
+		/* feedback is [ node id, endpoint name, scalar, value ] */
+		if( argc != 4 || !libpd_is_float( argv[ 0 ] ) || !libpd_is_symbol( argv[ 1 ] ) || !libpd_is_symbol( argv[ 2 ] ) )
+		{
+			return false;
+		}
+
+		if( strcmp( libpd_get_symbol( argv[ 2 ] ), "scalar" ) != 0 )
+		{
+			return false;
+		}
+
+		CDspFeedback feedback;
+		feedback.node_id = libpd_get_float( argv[ 0 ] );
+		feedback.endpoint_name = libpd_get_symbol( argv[ 1 ] );
+
+		if( libpd_is_symbol( argv[ 3 ] ) )
+		{
+			feedback.is_symbol = true;
+			feedback.float_value = 0;
+			feedback.symbol_value = libpd_get_symbol( argv[ 3 ] );
+		}
+		else if( libpd_is_float( argv[ 3 ] ) )
+		{
+			feedback.is_symbol = false;
+			feedback.float_value = libpd_get_float( argv[ 3 ] );
+			feedback.symbol_value = NULL;
+		}
+		else
+		{
+			return false;
+		}
+
+		/* a full queue counts the item as dropped */
+		m_feedback_queue->push( feedback );
+		return true;
 	}
 
 
@@ -236,14 +360,17 @@ namespace integra_internal
 		string filename = CFileHelper::extract_filename_from_path( path );
 		string directory = CFileHelper::extract_directory_from_path( path );
 
-		pthread_mutex_lock( &m_mutex );
+		string patch_receiver = "pd-" + patch_file_name;
 
-        m_pd->startMessage();
-        m_pd->addSymbol( filename );
-        m_pd->addSymbol( directory );
-        m_pd->finishMessage( "pd-" + patch_file_name, "savetofile" );
+		CDspCommand *command = begin_command();
+		command->set_message_target( patch_receiver.c_str(), "savetofile" );
+		if( !command->add_symbol( filename.c_str() ) || !command->add_symbol( directory.c_str() ) )
+		{
+			/* path too long for a command - abandon it */
+			return;
+		}
 
-		pthread_mutex_unlock( &m_mutex );
+		end_command();
 	}
 
 
@@ -251,6 +378,9 @@ namespace integra_internal
 	{
 		pthread_mutex_lock( &m_mutex );
 
+		/* pings are answered synchronously, so make sure all modules have been created first */
+		dispatch_commands();
+
 		m_unanswered_pings = 0;
 
 		INTEGRA_TRACE_PROGRESS << "Pinging all dsp modules...";
@@ -296,11 +426,13 @@ namespace integra_internal
 	{
 		INTEGRA_TRACE_PROGRESS << "Pinging " << node.get_interface_definition().get_interface_info().get_name() << " (" << node.get_path().get_string() << ")";
  
-		m_pd->startMessage();
-		m_pd->addFloat( node.get_id() );
-		m_pd->addSymbol( ping_message );
-		m_pd->addSymbol( bang );
-		m_pd->finishList( broadcast_symbol );
+		/* the caller holds m_mutex, so the ping can be dispatched directly */
+		CDspCommand command;
+		command.clear();
+		command.set_node_target( node.get_id() );
+		command.add_symbol( ping_message.c_str() );
+		command.add_symbol( bang.c_str() );
+		dispatch_command( command );
 
 		int previous_unanswered_pings( m_unanswered_pings );
 
@@ -325,262 +457,832 @@ namespace integra_internal
 	{
 		INTEGRA_TRACE_VERBOSE << "add module id " << id << " as " << patch_path;
 
+		/* unzip the implementation here, if it's served from memory, rather than when the dsp thread creates the object */
+		CModuleManager::downcast( m_server.get_module_manager() ).get_implementation_files().load_implementation( patch_path );
+
+		begin_canvas_edit();
+
+		CDspCommand *command = begin_command();
+		command->set_node_object( id, true );
+		command->add_float( module_x_margin );
+		command->add_float( m_next_module_y_slot * module_y_spacing );
+		if( !command->add_symbol( patch_path.c_str() ) )
+		{
+			/* patch path too long for a command - abandon it, and don't bind or init a module which doesn't exist */
+			return CError::FAILED;
+		}
+
+		command->add_float( id );
+		end_command();
+
+		m_next_module_y_slot ++;
+
+		//resolve the new module's own receiver, so that messages to it don't go through the broadcast receiver
+		command = begin_command();
+		command->set_node_binding( id, true );
+		end_command();
+
+		//send 'init' message
+		command = begin_command();
+		command->set_node_target( id );
+		command->add_symbol( init_message.c_str() );
+		command->add_symbol( bang.c_str() );
+		end_command();
+
+		return CError::SUCCESS;
+	}
+
+
+	CError CDspEngine::remove_module( internal_id id )
+	{
+		INTEGRA_TRACE_VERBOSE << "remove module id " << id;
+
+		//send 'fini' message
+		CDspCommand *command = begin_command();
+		command->set_node_target( id );
+		command->add_symbol( fini_message.c_str() );
+		command->add_symbol( bang.c_str() );
+		end_command();
+
+		command = begin_command();
+		command->set_node_binding( id, false );
+		end_command();
+
+		begin_canvas_edit();
+
+		command = begin_command();
+		command->set_node_object( id, false );
+		end_command();
+
+		return CError::SUCCESS;
+	}
+
+
+	CError CDspEngine::connect_modules( const CNodeEndpoint &source, const CNodeEndpoint &target )
+	{
+		INTEGRA_TRACE_VERBOSE << "connect " << source.get_path().get_string() << " to " << target.get_path().get_string();
+
+		return connect_or_disconnect( source, target, true );
+	}
+
+
+	CError CDspEngine::disconnect_modules( const CNodeEndpoint &source, const CNodeEndpoint &target )
+	{
+		INTEGRA_TRACE_VERBOSE << "disconnect " << source.get_path().get_string() << " from " << target.get_path().get_string();
+
+		return connect_or_disconnect( source, target, false );
+	}
+
+
+	CError CDspEngine::connect_or_disconnect( const CNodeEndpoint &source, const CNodeEndpoint &target, bool connect )
+	{
+		int source_connection_index = get_stream_connection_index( source );
+		int target_connection_index = get_stream_connection_index( target );
+
+		if( source_connection_index < 0 || target_connection_index < 0 )
+		{
+			INTEGRA_TRACE_ERROR << "failed to get a connection index - can't " << ( connect ? "connect" : "disconnect" );
+			return CError::FAILED;
+		}
+
+		begin_canvas_edit();
+
+		CDspCommand *dsp_command = begin_command();
+		dsp_command->set_node_connection( CNode::downcast( source.get_node() ).get_id(), CNode::downcast( target.get_node() ).get_id(), connect );
+		dsp_command->add_float( source_connection_index );
+		dsp_command->add_float( target_connection_index );
+		end_command();
+
+		return CError::SUCCESS;
+	}
+
+
+	CError CDspEngine::send_value( const CNodeEndpoint &target )
+	{
+		const CNode &node = CNode::downcast( target.get_node() );
+
+		return send_value( node.get_id(), target.get_endpoint_definition().get_name(), target.get_value() );
+	}
+
+
+	CError CDspEngine::send_value( internal_id node_id, const string &endpoint_name, const CValue *value )
+	{
+		INTEGRA_TRACE_VERBOSE << "send value to " << node_id << "." << endpoint_name;
+
+		CDspCommand *command = begin_command();
+		command->set_node_target( node_id );
+		bool is_complete = command->add_symbol( endpoint_name.c_str() );
+
+		if( value )
+		{
+			switch( value->get_type() )
+			{
+				case CValue::STRING:
+					is_complete = is_complete && command->add_symbol( ( ( const string & ) *value ).c_str() );
+					break;
+
+				case CValue::INTEGER:
+					command->add_float( ( int ) *value );
+					break;
+
+				case CValue::FLOAT:
+					command->add_float( ( float ) *value );
+					break;
+
+				default:
+					INTEGRA_TRACE_ERROR << "unhandled value type";
+					break;
+			}
+		}
+		else
+		{
+			is_complete = is_complete && command->add_symbol( bang.c_str() );
+		}
+
+		if( !is_complete )
+		{
+			/* 
+			 the value doesn't fit in a command slot.  Sending the endpoint name without it would mean 
+			 something else to the module, so abandon the command instead
+			*/
+			INTEGRA_TRACE_ERROR << "value for " << node_id << "." << endpoint_name << " is too long to send to the dsp engine";
+			return CError::FAILED;
+		}
+
+		end_command();
+
+		return CError::SUCCESS;
+	}
+
+
+	void CDspEngine::send_envelope_segment( internal_id envelope_id, float from_value, float to_value, float exponent, float start_fraction, float duration_ms )
+	{
+		CDspCommand *command = begin_command();
+		command->set_message_target( envelope_receiver.c_str(), "segment" );
+		command->add_float( envelope_id );
+		command->add_float( from_value );
+		command->add_float( to_value );
+		command->add_float( exponent );
+		command->add_float( start_fraction );
+		command->add_float( duration_ms );
+		end_command();
+	}
+
+
+	void CDspEngine::add_envelope_target( internal_id envelope_id, internal_id target_node_id, const string &endpoint_name )
+	{
+		CDspCommand *command = begin_command();
+		command->set_message_target( envelope_receiver.c_str(), "target" );
+		command->add_float( envelope_id );
+		command->add_float( target_node_id );
+		if( !command->add_symbol( endpoint_name.c_str() ) )
+		{
+			return;
+		}
+
+		end_command();
+	}
+
+
+	void CDspEngine::clear_envelope_targets( internal_id envelope_id )
+	{
+		CDspCommand *command = begin_command();
+		command->set_message_target( envelope_receiver.c_str(), "untarget" );
+		command->add_float( envelope_id );
+		end_command();
+	}
+
+
+	void CDspEngine::stop_envelope( internal_id envelope_id )
+	{
+		CDspCommand *command = begin_command();
+		command->set_message_target( envelope_receiver.c_str(), "stop" );
+		command->add_float( envelope_id );
+		end_command();
+	}
+
+
+	void CDspEngine::remove_envelope( internal_id envelope_id )
+	{
+		CDspCommand *command = begin_command();
+		command->set_message_target( envelope_receiver.c_str(), "remove" );
+		command->add_float( envelope_id );
+		end_command();
+	}
+
+
+	void CDspEngine::begin_flush()
+	{
+		assert( !m_is_flushing );
+
+		m_is_flushing = true;
+	}
+
+
+	void CDspEngine::end_flush()
+	{
+		assert( m_is_flushing );
+
+		if( m_flush_holds_mutex )
+		{
+			/* the flush overflowed the queue - deliver the remainder now, since we already own libpd */
+			dispatch_commands();
+			pthread_mutex_unlock( &m_mutex );
+			m_flush_holds_mutex = false;
+		}
+
+		m_is_flushing = false;
+	}
+
+
+	void CDspEngine::begin_graph_edit()
+	{
+		/* nothing is suspended until the scope makes its first canvas edit - see begin_canvas_edit */
+		m_graph_edit_depth++;
+	}
+
+
+	void CDspEngine::end_graph_edit()
+	{
+		assert( m_graph_edit_depth > 0 );
+
+		m_graph_edit_depth--;
+		if( m_graph_edit_depth > 0 )
+		{
+			return;
+		}
+
+		if( m_command_queue->is_holding_commands() )
+		{
+			resume_dsp_after_graph_edit();
+		}
+	}
+
+
+	void CDspEngine::begin_canvas_edit()
+	{
+		/* control thread only.  Called before each command which adds, removes or connects objects on the host canvas */
+
+		if( m_graph_edit_depth == 0 )
+		{
+			return;
+		}
+
+		if( m_command_queue->is_holding_commands() )
+		{
+			if( m_command_queue->get_number_of_free_slots() > 1 )
+			{
+				return;
+			}
+
+			/* the current batch is full - end it here rather than let this edit reach pd unsuspended */
+			resume_dsp_after_graph_edit();
+		}
+
+		/* room for the suspension, at least one edit and the resumption, so that a held batch is never empty */
+		wait_for_free_slots( 3 );
+
+		/* hold the edits back until the batch ends, so that the dsp thread keeps rendering the existing graph meanwhile */
+		CDspCommand *command = begin_command();
+		command->set_dsp_suspension( true );
+		m_command_queue->hold_commands();
+		end_command();
+	}
+
+
+	void CDspEngine::resume_dsp_after_graph_edit()
+	{
+		assert( m_command_queue->is_holding_commands() );
+
+		/* get_free_command always leaves a slot for this whilst commands are held */
+		CDspCommand *command = m_command_queue->begin_write();
+		assert( command );
+		command->set_frame( m_schedule_frame );
+		command->set_dsp_suspension( false );
+		end_command();
+
+		m_command_queue->release_held_commands();
+	}
+
+
+	void CDspEngine::wait_for_free_slots( unsigned int number_of_slots )
+	{
+		/* control thread only.  Held commands can't be drained, so this is only called between held batches */
+		assert( !m_command_queue->is_holding_commands() );
+
+		if( !m_is_flushing )
+		{
+			for( int i = 0; i < command_queue_max_waits; i++ )
+			{
+				if( m_command_queue->get_number_of_free_slots() >= number_of_slots )
+				{
+					return;
+				}
+
+				usleep( command_queue_wait_microseconds );
+			}
+		}
+
+		if( m_command_queue->get_number_of_free_slots() >= number_of_slots )
+		{
+			return;
+		}
+
+		/* drain the queue ourselves, in the same way as get_free_command */
+		if( m_is_flushing )
+		{
+			if( !m_flush_holds_mutex )
+			{
+				pthread_mutex_lock( &m_mutex );
+				m_flush_holds_mutex = true;
+			}
+
+			dispatch_commands();
+		}
+		else
+		{
+			pthread_mutex_lock( &m_mutex );
+			dispatch_commands();
+			pthread_mutex_unlock( &m_mutex );
+		}
+
+		assert( m_command_queue->get_number_of_free_slots() >= number_of_slots );
+	}
+
+
+	void CDspEngine::invalidate_abstractions( const string &directory )
+	{
+		INTEGRA_TRACE_VERBOSE << "invalidate abstractions in " << directory;
+
+		CDspCommand *command = begin_command();
+		command->set_abstraction_invalidation();
+		if( !command->add_symbol( directory.c_str() ) )
+		{
+			return;
+		}
+
+		end_command();
+	}
+
+
+	void CDspEngine::set_schedule_frame( int64_t frame )
+	{
+		m_schedule_frame = frame;
+	}
+
+
+	int64_t CDspEngine::get_frames_processed() const
+	{
+		return m_frames_processed.load( std::memory_order_acquire );
+	}
+
+
+	int CDspEngine::get_sample_rate() const
+	{
+		return m_sample_rate.load( std::memory_order_relaxed );
+	}
+
+
+	unsigned long CDspEngine::get_dropped_feedback_count() const
+	{
+		return m_feedback_queue->get_dropped_count();
+	}
+
+
+	unsigned long CDspEngine::get_coalesced_feedback_count() const
+	{
+		return m_feedback_queue->get_coalesced_count();
+	}
+
+
+	void CDspEngine::process_buffer( const float *input, float *output, int input_channels, int output_channels, int sample_rate, bool wait_for_libpd )
+	{
+		std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+		/* the clock advances even when this block is skipped, so that scheduled commands are never held back */
+		int64_t block_start = m_frames_processed.fetch_add( samples_per_buffer, std::memory_order_acq_rel );
+
+		memset( output, 0, samples_per_buffer * output_channels * sizeof( float ) );
+
+		//NOISE GENERATOR
+		
+		/*
+		for( int i = 0; i < output_channels * samples_per_buffer; i++ )
+		{
+			output[ i ] = float( ( rand() % 200 ) - 100 ) * 0.001f;
+		}
+		*/
+
+		//THRU
+		/*for( int i = 0; i < samples_per_buffer; i++ )
+		{
+			float input_mix( 0 );
+			if( input_channels > 0 )
+			{
+				for( int j = 0; j < input_channels; j++ )
+				{
+					input_mix += input[ i * input_channels + j ];
+				}
+				input_mix /= input_channels;
+			}
+
+			for( int j = 0; j < output_channels; j++ )
+			{
+				output[ i * output_channels + j ] = input_mix;
+			}
+		}*/
+
+		if( wait_for_libpd )
+		{
+			pthread_mutex_lock( &m_mutex );
+		}
+		else if( pthread_mutex_trylock( &m_mutex ) != 0 )
+		{
+			/* 
+			 libpd is in use by a rare synchronous control-thread operation (eg pinging modules).
+			 Never block the audio thread - output this block as silence instead
+			*/
+			m_load_monitor->record_skipped_block();
+			return;
+		}
+
+		dispatch_commands( block_start + samples_per_buffer );
+
+		if( has_configuration_changed( input_channels, output_channels, sample_rate ) )
+		{
+			initialize_audio_configuration( input_channels, output_channels, sample_rate );
+		}
+
+		if( m_initialised )
+		{
+			m_block_start = block_start;
+			update_midi_clock( block_start );
+			handle_midi_input( block_start + samples_per_buffer );
+
+			/* pd needs a writable input pointer, although presumably does not write to it */
+			float *input_writable = ( float * ) input;
+
+			m_pd->processFloat( 1, input_writable, output );
+		}
+		else
+		{
+			memset( output, 0, output_channels * samples_per_buffer * sizeof( float ) );
+		}
+
+		poll_for_messages();
+
+		pthread_mutex_unlock( &m_mutex );
+
+		std::chrono::nanoseconds duration = std::chrono::steady_clock::now() - start_time;
+		m_load_monitor->record_block( duration.count(), sample_rate );
+	}
+
+
+	CDspCommand *CDspEngine::begin_command()
+	{
+		/* control thread only */
+
+		CDspCommand *command = get_free_command();
+		command->set_frame( m_schedule_frame );
+		return command;
+	}
+
+
+	CDspCommand *CDspEngine::get_free_command()
+	{
+		if( m_command_queue->is_holding_commands() )
+		{
+			if( m_command_queue->get_number_of_free_slots() > 1 )
+			{
+				CDspCommand *command = m_command_queue->begin_write();
+				assert( command );
+				return command;
+			}
+
+			/* 
+			 too many edits to hold back.  Close this batch with the slot kept for its resumption, so that pd 
+			 rebuilds the chain and carries on rendering whilst we wait for room.  The next canvas edit in the 
+			 scope starts a new suspended batch
+			*/
+			INTEGRA_TRACE_VERBOSE << "graph edit filled the dsp command queue - delivering it in more than one batch";
+
+			resume_dsp_after_graph_edit();
+		}
+
+		if( m_is_flushing )
+		{
+			CDspCommand *command = m_command_queue->begin_write();
+			if( command )
+			{
+				return command;
+			}
+
+			/* 
+			 a flush which overflows the queue takes the dsp lock once and keeps it until end_flush, 
+			 dispatching directly instead of waiting for the dsp thread to drain each time the queue fills
+			*/
+			if( !m_flush_holds_mutex )
+			{
+				pthread_mutex_lock( &m_mutex );
+				m_flush_holds_mutex = true;
+			}
+
+			dispatch_commands();
+
+			command = m_command_queue->begin_write();
+			assert( command );
+			return command;
+		}
+
+		for( int i = 0; i < command_queue_max_waits; i++ )
+		{
+			CDspCommand *command = m_command_queue->begin_write();
+			if( command )
+			{
+				return command;
+			}
+
+			/* queue is full - give the dsp thread a chance to drain it */
+			usleep( command_queue_wait_microseconds );
+		}
+
+		/* the dsp thread isn't draining the queue (eg no audio is running) - drain it ourselves */
+		INTEGRA_TRACE_VERBOSE << "dsp command queue is full - dispatching from control thread";
+
 		pthread_mutex_lock( &m_mutex );
+		dispatch_commands();
+		pthread_mutex_unlock( &m_mutex );
 
-        m_pd->startMessage();
-		m_pd->addFloat( module_x_margin );
-        m_pd->addFloat( m_next_module_y_slot * module_y_spacing );
-        m_pd->addSymbol( patch_path );
-		m_pd->addFloat( id );
-        m_pd->finishMessage( patch_message_target, "obj" );
+		CDspCommand *command = m_command_queue->begin_write();
+		assert( command );
+		return command;
+	}
 
-		m_next_module_y_slot ++;
 
-		m_map_id_to_patch_id[ id ] = m_map_id_to_patch_id.size();
+	void CDspEngine::end_command()
+	{
+		m_command_queue->end_write();
+	}
 
-		test_map_sanity();
 
-		//send 'init' message
-		m_pd->startMessage();
-        m_pd->addFloat( id );
-        m_pd->addSymbol( init_message );
-		m_pd->addSymbol( bang );
-        m_pd->finishList( broadcast_symbol );
+	void CDspEngine::dispatch_commands()
+	{
+		/* delivers everything due in the block currently being rendered */
+		dispatch_commands( get_frames_processed() + samples_per_buffer );
+	}
 
-		pthread_mutex_unlock( &m_mutex );
 
-		return CError::SUCCESS;
+	void CDspEngine::dispatch_commands( int64_t end_frame )
+	{
+		/* must only be called by the thread which holds m_mutex */
+
+		m_command_scheduler->dispatch_commands( *m_command_queue, end_frame, *this );
 	}
 
 
-	CError CDspEngine::remove_module( internal_id id )
+	void CDspEngine::dispatch_command( const CDspCommand &command )
 	{
-		INTEGRA_TRACE_VERBOSE << "remove module id " << id;
-
-		pthread_mutex_lock( &m_mutex );
+		/* 
+		 use libpd's c api directly rather than PdBase, to avoid constructing std::strings on the audio thread
+		*/
 
-		//send 'fini' message
-		m_pd->startMessage();
-        m_pd->addFloat( id );
-        m_pd->addSymbol( fini_message );
-		m_pd->addSymbol( bang );
-        m_pd->finishList( broadcast_symbol );
+		switch( command.get_target_type() )
+		{
+			case CDspCommand::NODE_TARGET:
+				dispatch_node_command( command );
+				return;
 
-		//do the magic to select and delete the module
-		ostringstream find;
-		find << "+" << id;
+			case CDspCommand::BIND_NODE:
+				bind_node_receiver( command.get_node_id() );
+				return;
 
-		m_pd->startMessage();
-        m_pd->addSymbol( find.str() );
-		m_pd->addFloat( 1 );
-		m_pd->finishMessage( patch_message_target, "find" );
+			case CDspCommand::UNBIND_NODE:
+				m_node_receivers.erase( command.get_node_id() );
+				return;
 
-		m_pd->sendMessage( patch_message_target, "cut" );
+			case CDspCommand::CREATE_OBJECT:
+				create_node_object( command );
+				return;
 
-		int patch_id = get_patch_id( id );
-		m_map_id_to_patch_id.erase( id );
+			case CDspCommand::DELETE_OBJECT:
+				delete_node_object( command.get_node_id() );
+				return;
 
-		for( int_map::iterator i = m_map_id_to_patch_id.begin(); i != m_map_id_to_patch_id.end(); i++ )
-		{
-			if( i->second > patch_id )
-			{
-				i->second --;
-			}
-		}
+			case CDspCommand::CONNECT_OBJECTS:
+			case CDspCommand::DISCONNECT_OBJECTS:
+				connect_node_objects( command );
+				return;
 
-		test_map_sanity();
+			case CDspCommand::SUSPEND_DSP:
+				m_dsp_state_before_graph_edit = canvas_suspend_dsp();
+				return;
 
-		pthread_mutex_unlock( &m_mutex );
+			case CDspCommand::RESUME_DSP:
+				canvas_resume_dsp( m_dsp_state_before_graph_edit );
+				return;
 
-		return CError::SUCCESS;
-	}
+			case CDspCommand::INVALIDATE_ABSTRACTIONS:
+				integra_abstraction_cache_invalidate( command.get_symbol( 0 ) );
+				return;
 
+			default:
+				break;
+		}
 
-	void CDspEngine::test_map_sanity()
-	{
-		//m_map_id_to_patch_id should contain all values from 0 .. m_map_id_to_patch_id.size()-1, with no duplicates
+		int number_of_atoms = command.get_number_of_atoms();
 
-		int_set values;
+		libpd_start_message( number_of_atoms );
 
-		for( int_map::const_iterator i = m_map_id_to_patch_id.begin(); i != m_map_id_to_patch_id.end(); i++ )
+		for( int i = 0; i < number_of_atoms; i++ )
 		{
-			int value = i->second;
-			if( value < 0 || value >= m_map_id_to_patch_id.size() )
+			if( command.is_symbol( i ) )
 			{
-				INTEGRA_TRACE_ERROR << "map sanity check failed - value " << value << "is out of range";
+				libpd_add_symbol( command.get_symbol( i ) );
 			}
-
-			if( values.count( value ) != 0 )
+			else
 			{
-				INTEGRA_TRACE_ERROR << "map sanity check failed - duplicate value " << value;
+				libpd_add_float( command.get_float( i ) );
 			}
+		}
 
-			values.insert( value );
+		if( command.get_target_type() == CDspCommand::LIST_TARGET )
+		{
+			libpd_finish_list( command.get_receiver() );
+		}
+		else
+		{
+			libpd_finish_message( command.get_receiver(), command.get_selector() );
 		}
 	}
 
 
-	CError CDspEngine::connect_modules( const CNodeEndpoint &source, const CNodeEndpoint &target )
+	void CDspEngine::dispatch_node_command( const CDspCommand &command )
 	{
-		INTEGRA_TRACE_VERBOSE << "connect " << source.get_path().get_string() << " to " << target.get_path().get_string();
-
-		return connect_or_disconnect( source, target, "connect" );
-	}
-
+		/* must only be called by the thread which holds m_mutex */
 
-	CError CDspEngine::disconnect_modules( const CNodeEndpoint &source, const CNodeEndpoint &target )
-	{
-		INTEGRA_TRACE_VERBOSE << "disconnect " << source.get_path().get_string() << " from " << target.get_path().get_string();
+		internal_id node_id = command.get_node_id();
+		int number_of_atoms = command.get_number_of_atoms();
 
-		return connect_or_disconnect( source, target, "disconnect" );
-	}
+		t_symbol *receiver( NULL );
+		node_receiver_map::const_iterator lookup = m_node_receivers.find( node_id );
+		if( lookup != m_node_receivers.end() )
+		{
+			receiver = lookup->second;
+		}
 
+		if( !receiver || !receiver->s_thing )
+		{
+			/* 
+			 the module has no receiver of its own (eg an embedded module saved with older handlers).
+			 Fall back to the broadcast receiver, where each module filters by id
+			*/
+			libpd_start_message( number_of_atoms + 1 );
+			libpd_add_float( node_id );
 
-	CError CDspEngine::connect_or_disconnect( const CNodeEndpoint &source, const CNodeEndpoint &target, const string &command )
-	{
-		CError result;
+			for( int i = 0; i < number_of_atoms; i++ )
+			{
+				if( command.is_symbol( i ) )
+				{
+					libpd_add_symbol( command.get_symbol( i ) );
+				}
+				else
+				{
+					libpd_add_float( command.get_float( i ) );
+				}
+			}
 
-		pthread_mutex_lock( &m_mutex );
+			libpd_finish_list( broadcast_symbol.c_str() );
+			return;
+		}
 
-		int source_patch_id = get_patch_id( CNode::downcast( source.get_node() ).get_id() );
-		int target_patch_id = get_patch_id( CNode::downcast( target.get_node() ).get_id() );
+		t_atom atoms[ CDspCommand::max_atoms ];
 
-		if( source_patch_id < 0 || target_patch_id < 0 )
-		{
-			INTEGRA_TRACE_ERROR << "failed to get a patch id - can't " << command;
-		}
-		else
+		for( int i = 0; i < number_of_atoms; i++ )
 		{
-			int source_connection_index = get_stream_connection_index( source );
-			int target_connection_index = get_stream_connection_index( target );
-
-			if( source_connection_index < 0 || target_connection_index < 0 )
+			if( command.is_symbol( i ) )
 			{
-				INTEGRA_TRACE_ERROR << "failed to get a connection index - can't " << command;
-				result = CError::FAILED;
+				libpd_set_symbol( &atoms[ i ], command.get_symbol( i ) );
 			}
 			else
 			{
-				m_pd->startMessage();
-				m_pd->addFloat( source_patch_id );
-				m_pd->addFloat( source_connection_index );
-				m_pd->addFloat( target_patch_id );
-				m_pd->addFloat( target_connection_index );
-				m_pd->finishMessage( patch_message_target, command ); 
-
-				result = CError::SUCCESS;
+				libpd_set_float( &atoms[ i ], command.get_float( i ) );
 			}
 		}
 
-		pthread_mutex_unlock( &m_mutex );
-
-		return result;
+		pd_list( receiver->s_thing, &s_list, number_of_atoms, atoms );
 	}
 
 
-	CError CDspEngine::send_value( const CNodeEndpoint &target )
+	void CDspEngine::bind_node_receiver( internal_id node_id )
 	{
-		INTEGRA_TRACE_VERBOSE << "send value to " << target.get_path().get_string();
+		/* 
+		 must only be called by the thread which holds m_mutex.  The module's handlers bind
+		 [r integra-receive-$1], and pd expands $1 as a float, so format the id the same way
+		*/
 
-		pthread_mutex_lock( &m_mutex );
+		char receiver_name[ 64 ];
+		snprintf( receiver_name, sizeof( receiver_name ), "%s%g", node_receiver_prefix.c_str(), ( float ) node_id );
 
-		const CNode &node = CNode::downcast( target.get_node() );
-		const CValue *value = target.get_value();
+		m_node_receivers[ node_id ] = gensym( receiver_name );
+	}
 
-		m_pd->startMessage();
-		m_pd->addFloat( node.get_id() );
-		m_pd->addSymbol( target.get_endpoint_definition().get_name() );
 
-		if( value )
-		{
-			switch( value->get_type() )
-			{
-				case CValue::STRING:
-					m_pd->addSymbol( ( const string & ) *value );
-					break;
+	void CDspEngine::create_node_object( const CDspCommand &command )
+	{
+		/* must only be called by the thread which holds m_mutex */
 
-				case CValue::INTEGER:
-					m_pd->addFloat( ( int ) *value );
-					break;
+		if( !m_host_canvas )
+		{
+			return;
+		}
 
-				case CValue::FLOAT:
-					m_pd->addFloat( ( float ) *value );
-					break;
+		int number_of_atoms = command.get_number_of_atoms();
+		t_atom atoms[ CDspCommand::max_atoms ];
 
-				default:
-					INTEGRA_TRACE_ERROR << "unhandled value type";
-					break;
+		for( int i = 0; i < number_of_atoms; i++ )
+		{
+			if( command.is_symbol( i ) )
+			{
+				libpd_set_symbol( &atoms[ i ], command.get_symbol( i ) );
+			}
+			else
+			{
+				libpd_set_float( &atoms[ i ], command.get_float( i ) );
 			}
 		}
-		else
+
+		/* the arguments are the object's position, then the module's patch path.  Instances after the first use the parsed abstraction cache */
+		if( number_of_atoms > 2 && command.is_symbol( 2 ) )
 		{
-			m_pd->addSymbol( bang );
+			integra_abstraction_cache_register( command.get_symbol( 2 ) );
 		}
 
-		m_pd->finishList( broadcast_symbol );
-
-		pthread_mutex_unlock( &m_mutex );
+		t_object *object = integra_canvas_add_object( m_host_canvas, number_of_atoms, atoms );
+		if( !object )
+		{
+			INTEGRA_TRACE_ERROR << "failed to create module instance for node " << command.get_node_id();
+			return;
+		}
 
-		return CError::SUCCESS;
+		m_node_objects[ command.get_node_id() ] = object;
 	}
 
 
-	void CDspEngine::process_buffer( const float *input, float *output, int input_channels, int output_channels, int sample_rate )
+	void CDspEngine::delete_node_object( internal_id node_id )
 	{
-		memset( output, 0, samples_per_buffer * output_channels * sizeof( float ) );
+		/* must only be called by the thread which holds m_mutex */
 
-		//NOISE GENERATOR
-		
-		/*
-		for( int i = 0; i < output_channels * samples_per_buffer; i++ )
+		node_object_map::iterator lookup = m_node_objects.find( node_id );
+		if( lookup == m_node_objects.end() )
 		{
-			output[ i ] = float( ( rand() % 200 ) - 100 ) * 0.001f;
+			INTEGRA_TRACE_ERROR << "no module instance for node " << node_id;
+			return;
 		}
-		*/
 
-		//THRU
-		/*for( int i = 0; i < samples_per_buffer; i++ )
-		{
-			float input_mix( 0 );
-			if( input_channels > 0 )
-			{
-				for( int j = 0; j < input_channels; j++ )
-				{
-					input_mix += input[ i * input_channels + j ];
-				}
-				input_mix /= input_channels;
-			}
+		integra_canvas_remove_object( m_host_canvas, lookup->second );
 
-			for( int j = 0; j < output_channels; j++ )
-			{
-				output[ i * output_channels + j ] = input_mix;
-			}
-		}*/
+		m_node_objects.erase( lookup );
+	}
 
-		pthread_mutex_lock( &m_mutex );
 
-		if( has_configuration_changed( input_channels, output_channels, sample_rate ) )
-		{
-			initialize_audio_configuration( input_channels, output_channels, sample_rate );
-		}
+	void CDspEngine::connect_node_objects( const CDspCommand &command )
+	{
+		/* must only be called by the thread which holds m_mutex */
 
-		if( m_initialised )
+		t_object *source = get_node_object( command.get_node_id() );
+		t_object *target = get_node_object( command.get_target_node_id() );
+		if( !source || !target )
 		{
-			handle_midi_input();
+			INTEGRA_TRACE_ERROR << "no module instance for node " << ( source ? command.get_target_node_id() : command.get_node_id() );
+			return;
+		}
 
-			/* pd needs a writable input pointer, although presumably does not write to it */
-			float *input_writable = ( float * ) input;
+		int outlet = command.get_float( 0 );
+		int inlet = command.get_float( 1 );
 
-			m_pd->processFloat( 1, input_writable, output );
+		if( command.get_target_type() == CDspCommand::CONNECT_OBJECTS )
+		{
+			if( !integra_canvas_connect( source, outlet, target, inlet ) )
+			{
+				INTEGRA_TRACE_ERROR << "failed to connect node " << command.get_node_id() << " to node " << command.get_target_node_id();
+			}
 		}
 		else
 		{
-			memset( output, 0, output_channels * samples_per_buffer * sizeof( float ) );
+			integra_canvas_disconnect( source, outlet, target, inlet );
 		}
+	}
 
-		poll_for_messages();
 
-		pthread_mutex_unlock( &m_mutex );
+	t_object *CDspEngine::get_node_object( internal_id node_id ) const
+	{
+		node_object_map::const_iterator lookup = m_node_objects.find( node_id );
+		if( lookup == m_node_objects.end() )
+		{
+			return NULL;
+		}
+
+		return lookup->second;
 	}
 
 
@@ -604,7 +1306,7 @@ namespace integra_internal
 
 		if( !queue_messages.empty() )
 		{
-			m_feedback_queue->push( queue_messages );
+			m_message_queue->push( queue_messages );
 		}
 	}
 
@@ -717,11 +1419,15 @@ namespace integra_internal
 		int channel = message.channel % 16;
 		int device_index = message.channel / 16;
 
-		unsigned int midi_message = message.channel | ( status << 4 ) | ( value1 << 8 ) | ( value2 << 16 );
-
-		IMidiEngine &midi_engine = m_server.get_midi_engine();
+		CMidiEvent event;
+		event.timestamp = frame_to_midi_time( m_block_start );
+		event.device_index = device_index;
+		event.message = channel | ( status << 4 ) | ( value1 << 8 ) | ( value2 << 16 );
 
-		midi_engine.send_midi_message( device_index, midi_message );
+		if( !m_server.get_midi_engine().write_output_event( event ) )
+		{
+			INTEGRA_TRACE_ERROR << "midi output queue is full - dropping outgoing midi";
+		}
 
 		return true;
 	}
@@ -729,23 +1435,13 @@ namespace integra_internal
 
 	void CDspEngine::handle_queue_items( const pd_message_list &messages )
 	{
-		if( !m_server.lock() )
-		{
-			return;
-		}
-
 		for( pd_message_list::const_iterator i = messages.begin(); i != messages.end(); i++ )
 		{
 			const pd::Message &message = *i;
 			if( message.dest == feedback_source )
 			{
-				assert( message.type == pd::LIST );
-
-				ISetCommand *command = build_set_command( message.list );
-				if( command )
-				{
-					merge_set_command( command );
-				}
+				/* well-formed feedback never gets this far - see feedback_list_hook */
+				INTEGRA_TRACE_ERROR << "unexpected message list structure " << message.list.toString();
 			}
 			else
 			{
@@ -755,31 +1451,45 @@ namespace integra_internal
 				}
 			}
 		}
+	}
+
+
+	void CDspEngine::handle_feedback( const CDspFeedback *feedback, unsigned int number_of_items )
+	{
+		unsigned long dropped_feedback = m_feedback_queue->get_dropped_count();
+		if( dropped_feedback != m_reported_dropped_feedback )
+		{
+			INTEGRA_TRACE_ERROR << "feedback queue full - dropped " << dropped_feedback - m_reported_dropped_feedback << " messages from module implementations";
+			m_reported_dropped_feedback = dropped_feedback;
+		}
+
+		if( !m_server.lock() )
+		{
+			return;
+		}
 
-		for( set_command_list::iterator i = m_set_commands.begin(); i != m_set_commands.end(); i++ )
+		for( unsigned int i = 0; i < number_of_items; i++ )
 		{
-			CError result = m_server.process_command( *i, CCommandSource::MODULE_IMPLEMENTATION );
+			ISetCommand *command = build_set_command( feedback[ i ] );
+			if( !command )
+			{
+				continue;
+			}
+
+			CError result = m_server.process_command( command, CCommandSource::MODULE_IMPLEMENTATION );
 			if( result != CError::SUCCESS )
 			{
 				INTEGRA_TRACE_ERROR << "Error processing command: " << result.get_text();
 			}
 		}
 
-		m_set_commands.clear();
-
 		m_server.unlock();
 	}
 
 
-	ISetCommand *CDspEngine::build_set_command( const pd::List &feedback_arguments ) const
+	ISetCommand *CDspEngine::build_set_command( const CDspFeedback &feedback ) const
 	{
-		if( feedback_arguments.len() != 4 || !feedback_arguments.isFloat( 0 ) || !feedback_arguments.isSymbol( 1 ) || !feedback_arguments.isSymbol( 2 ) || feedback_arguments.getSymbol( 2 ) != "scalar" )
-		{
-			INTEGRA_TRACE_ERROR << "unexpected message list structure " << feedback_arguments.toString();
-			return NULL;
-		}
-
-		internal_id id = feedback_arguments.getFloat( 0 );
+		internal_id id = feedback.node_id;
 		const CNode *node = m_server.find_node( id );
 		if( !node )
 		{
@@ -787,7 +1497,7 @@ namespace integra_internal
 			return NULL;
 		}
 
-		string endpoint_name = feedback_arguments.getSymbol( 1 );
+		string endpoint_name = feedback.endpoint_name;
 		const INodeEndpoint *node_endpoint = node->get_node_endpoint( endpoint_name );
 		if( !node_endpoint )
 		{
@@ -807,36 +1517,36 @@ namespace integra_internal
 		switch( control_info.get_type() )
 		{
 			case IControlInfo::BANG:
-				return ISetCommand::create( node_endpoint->get_path() );
+				return ISetCommand::create( node_endpoint->get_handle() );
 
 			case IControlInfo::STATEFUL:
 				switch( control_info.get_state_info()->get_type() )
 				{
 					case CValue::INTEGER:
-						if( feedback_arguments.isFloat( 3 ) )
+						if( !feedback.is_symbol )
 						{
-							CIntegerValue value( feedback_arguments.getFloat( 3 ) );
-							return ISetCommand::create( node_endpoint->get_path(), value );
+							CIntegerValue value( feedback.float_value );
+							return ISetCommand::create( node_endpoint->get_handle(), value );
 						}
 
 						INTEGRA_TRACE_ERROR << "Unexpected message value type";
 						return NULL;
 
 					case CValue::FLOAT:
-						if( feedback_arguments.isFloat( 3 ) )
+						if( !feedback.is_symbol )
 						{
-							CFloatValue value( feedback_arguments.getFloat( 3 ) );
-							return ISetCommand::create( node_endpoint->get_path(), value );
+							CFloatValue value( feedback.float_value );
+							return ISetCommand::create( node_endpoint->get_handle(), value );
 						}
 
 						INTEGRA_TRACE_ERROR << "Unexpected message value type";
 						return NULL;
 
 					case CValue::STRING:
-						if( feedback_arguments.isSymbol( 3 ) )
+						if( feedback.is_symbol )
 						{
-							CStringValue value( feedback_arguments.getSymbol( 3 ) );
-							return ISetCommand::create( node_endpoint->get_path(), value );
+							CStringValue value( feedback.symbol_value );
+							return ISetCommand::create( node_endpoint->get_handle(), value );
 						}
 
 						INTEGRA_TRACE_ERROR << "Unexpected message value type";
@@ -856,36 +1566,6 @@ namespace integra_internal
 	}
 
 
-	void CDspEngine::merge_set_command( ISetCommand *command )
-	{
-		for( set_command_list::iterator i = m_set_commands.begin(); i != m_set_commands.end(); i++ )
-		{
-			ISetCommand *previous_command = *i;
-			if( previous_command ->get_endpoint_path() == command->get_endpoint_path() )
-			{
-				delete previous_command;
-				m_set_commands.erase( i );
-				break;
-			}
-
-		}
-		m_set_commands.push_back( command );
-	}
-
-
-	int CDspEngine::get_patch_id( internal_id id ) const
-	{
-		int_map::const_iterator lookup = m_map_id_to_patch_id.find( id );
-		if( lookup == m_map_id_to_patch_id.end() )
-		{
-			INTEGRA_TRACE_ERROR << "Can't find patch id from internal id " << id;
-			return -1;
-		}
-
-		return lookup->second;
-	}
-
-
 	int CDspEngine::get_stream_connection_index( const CNodeEndpoint &node_endpoint ) const
 	{
 		const IEndpointDefinition &endpoint_definition = node_endpoint.get_endpoint_definition();
@@ -936,108 +1616,130 @@ namespace integra_internal
 	}
 
 
-	void CDspEngine::handle_midi_input()
+	void CDspEngine::handle_midi_input( int64_t block_end )
 	{
 		IMidiEngine &midi_engine = m_server.get_midi_engine();
 
-		CError midi_result = midi_engine.poll_input( m_midi_input );
-		if( midi_result != CError::SUCCESS )
-		{
-			INTEGRA_TRACE_ERROR << "Error getting incoming midi messages: " << midi_result;
-			return;
-		}
-
-		m_midi_input_filterer->filter_input( m_midi_input );
+		/* never hold input back for longer than this, even if the midi clock has jumped */
+		int64_t latest_frame = block_end + int64_t( midi_latency_milliseconds ) * m_midi_clock_sample_rate / 1000;
 
-		midi_message_list message_list;
-		CMidiMessage midi_message;
-
-		for( int device_index = 0; device_index < m_midi_input.size(); device_index++ )
+		while( true )
 		{
-			const CMidiInputBuffer &input_buffer = m_midi_input[ device_index ];
+			if( !m_has_pending_midi_input )
+			{
+				if( !midi_engine.read_input_event( m_pending_midi_input ) )
+				{
+					break;
+				}
+
+				m_has_pending_midi_input = true;
+			}
 
-			if( input_buffer.number_of_messages == 0 )
+			int64_t frame = midi_time_to_frame( m_pending_midi_input.timestamp );
+			if( frame >= block_end && frame < latest_frame )
 			{
-				continue;
+				/* not due until a later block */
+				break;
 			}
 
-			midi_message.device = input_buffer.device_name;
+			send_midi_to_pd( m_pending_midi_input );
+			m_has_pending_midi_input = false;
+		}
+	}
 
-			/* 
-			 multiple devices are handled in pd by using channel numbers that are greater than 15.
-			 channels 0..15 represent first device, channels 16..31 represent second device and so on
-			*/
-			int device_component = device_index * 16;
 
-			/* 
-			 iterate through midi messages, sending them into pd and adding to the list for midi_input_dispatcher
-			*/
+	void CDspEngine::send_midi_to_pd( const CMidiEvent &event )
+	{
+		unsigned int message = event.message;
 
-			for( int message_iterator = 0; message_iterator < input_buffer.number_of_messages; message_iterator++ )
-			{
-				unsigned int message = input_buffer.messages[ message_iterator ];
+		unsigned int status_nibble = ( message & 0xF0 ) >> 4;
+		unsigned int channel_nibble = message & 0xF;
+		unsigned int value1 = ( message & 0xFF00 ) >> 8;
+		unsigned int value2 = ( message & 0xFF0000 ) >> 16;
 
-				if( message == 0 )
-				{
-					//message was filtered by CMidiInputFilterer
-					continue;
-				}
+		/* 
+		 multiple devices are handled in pd by using channel numbers that are greater than 15.
+		 channels 0..15 represent first device, channels 16..31 represent second device and so on
+		*/
+		int device_and_channel = event.device_index * 16 | channel_nibble;
 
-				midi_message.message = message;
-				message_list.push_back( midi_message );
+		assert( status_nibble >= 0x8 && status_nibble << 0xF );
+		assert( value1 < 0x80 );
+		assert( value2 < 0x80 );
 
-				unsigned int status_nibble = ( message & 0xF0 ) >> 4;
-				unsigned int channel_nibble = message & 0xF;
-				unsigned int value1 = ( message & 0xFF00 ) >> 8;
-				unsigned int value2 = ( message & 0xFF0000 ) >> 16;
+		switch( status_nibble )
+		{
+			case 0x8:	/* note off */
+				m_pd->sendNoteOn( device_and_channel, value1, 0 );
+				break;							
 
-				int device_and_channel = device_component | channel_nibble;
+			case 0x9:	/* note on */
+				m_pd->sendNoteOn( device_and_channel, value1, value2 );
+				break;
 
-				assert( status_nibble >= 0x8 && status_nibble << 0xF );
-				assert( value1 < 0x80 );
-				assert( value2 < 0x80 );
+			case 0xA:	/* polyphonic key pressure */
+				m_pd->sendPolyAftertouch( device_and_channel, value1, value2 );
+				break;
 
-				switch( status_nibble )
-				{
-					case 0x8:	/* note off */
-						m_pd->sendNoteOn( device_and_channel, value1, 0 );
-						break;							
+			case 0xB:	/* control change */
+				m_pd->sendControlChange( device_and_channel, value1, value2 );
+				break;
 
-					case 0x9:	/* note on */
-						m_pd->sendNoteOn( device_and_channel, value1, value2 );
-						break;
+			case 0xC:	/* program change */
+				m_pd->sendProgramChange( device_and_channel, value1 );
+				break;
 
-					case 0xA:	/* polyphonic key pressure */
-						m_pd->sendPolyAftertouch( device_and_channel, value1, value2 );
-						break;
+			case 0xD:	/* channel pressure */
+				m_pd->sendAftertouch( device_and_channel, value1 );
+				break;
 
-					case 0xB:	/* control change */
-						m_pd->sendControlChange( device_and_channel, value1, value2 );
-						break;
+			case 0xE:	/* pitchbend */
+				m_pd->sendPitchBend( device_and_channel, ( value1 | ( value2 << 7 ) ) - 0x2000 );
+				break;
 
-					case 0xC:	/* program change */
-						m_pd->sendProgramChange( device_and_channel, value1 );
-						break;
+			case 0xF:
+				INTEGRA_TRACE_ERROR << "Unexpected system common / realtime message: " << std::hex << message;
+				break;
+		}
+	}
 
-					case 0xD:	/* channel pressure */
-						m_pd->sendAftertouch( device_and_channel, value1 );
-						break;
 
-					case 0xE:	/* pitchbend */
-						m_pd->sendPitchBend( device_and_channel, ( value1 | ( value2 << 7 ) ) - 0x2000 );
-						break;
+	void CDspEngine::update_midi_clock( int64_t block_start )
+	{
+		int now = m_server.get_midi_engine().get_time();
+		int sample_rate = m_sample_rate.load( std::memory_order_relaxed );
 
-					case 0xF:
-						INTEGRA_TRACE_ERROR << "Unexpected system common / realtime message: " << std::hex << message;
-						break;
-				}
+		if( m_midi_clock_is_anchored && sample_rate == m_midi_clock_sample_rate )
+		{
+			int predicted_time = frame_to_midi_time( block_start );
+			if( abs( predicted_time - now ) <= midi_clock_tolerance_milliseconds )
+			{
+				return;
 			}
 		}
 
-		if( !message_list.empty() )
+		m_midi_clock_anchor_time = now;
+		m_midi_clock_anchor_frame = block_start;
+		m_midi_clock_sample_rate = sample_rate;
+		m_midi_clock_is_anchored = true;
+	}
+
+
+	int64_t CDspEngine::midi_time_to_frame( int timestamp ) const
+	{
+		assert( m_midi_clock_is_anchored );
+
+		return m_midi_clock_anchor_frame + int64_t( timestamp - m_midi_clock_anchor_time + midi_latency_milliseconds ) * m_midi_clock_sample_rate / 1000;
+	}
+
+
+	int CDspEngine::frame_to_midi_time( int64_t frame ) const
+	{
+		if( !m_midi_clock_is_anchored )
 		{
-			m_server.get_midi_input_dispatcher().dispatch_midi( message_list );
+			return m_server.get_midi_engine().get_time();
 		}
+
+		return m_midi_clock_anchor_time + int( ( frame - m_midi_clock_anchor_frame ) * 1000 / m_midi_clock_sample_rate );
 	}
 }
-
@@ -27,8 +27,11 @@
 #include "node.h"
 #include "midi_engine.h"
 #include "threaded_queue.h"
+#include "dsp_feedback_queue.h"
+#include "dsp_command_queue.h"
 
 #include <pthread.h>
+#include <atomic>
 
 
 extern "C"	//setup functions for externals
@@ -42,9 +45,35 @@ extern "C"	//setup functions for externals
 	void soundfile_info_setup();
 	void fsplay_tilde_setup();
         void copy_setup();
+	void integra_envelope_setup();
 }
 
 
+extern "C"	//direct access to module instances on the host canvas - see externals/extra/integra_canvas
+{
+	struct _glist *integra_canvas_find( const char *bind_name );
+	struct _glist *integra_canvas_open( const char *text, const char *file_name, const char *directory );
+	struct _text *integra_canvas_add_object( struct _glist *canvas, int argc, struct _atom *argv );
+	void integra_canvas_remove_object( struct _glist *canvas, struct _text *object );
+	int integra_canvas_connect( struct _text *source, int outlet, struct _text *target, int inlet );
+	void integra_canvas_disconnect( struct _text *source, int outlet, struct _text *target, int inlet );
+}
+
+
+extern "C"	//parsed abstraction cache - see externals/extra/integra_abstraction_cache
+{
+	void integra_abstraction_cache_register( const char *name );
+	void integra_abstraction_cache_set_reader( int ( *reader )( void *context, const char *path, struct _binbuf *contents ), void *context );
+	void integra_abstraction_cache_invalidate( const char *directory );
+	void integra_abstraction_cache_clear();
+	void integra_abstraction_cache_get_statistics( int *hits, int *misses );
+}
+
+
+struct _symbol;		/* pd's t_symbol */
+struct _atom;		/* pd's t_atom */
+
+
 namespace pd
 {
 	class PdBase;
@@ -62,9 +91,9 @@ namespace integra_internal
 {
 	class CServer;
 	class IMidiEngine;
-	class CMidiInputFilterer;
+	class CDspLoadMonitor;
 
-	class CDspEngine : public IThreadedQueueOutputSink<pd::Message>
+	class CDspEngine : public IThreadedQueueOutputSink<pd::Message>, public IDspFeedbackSink, public IDspCommandDispatcher
 	{
 		public:
 
@@ -76,8 +105,68 @@ namespace integra_internal
 			CError connect_modules( const CNodeEndpoint &source, const CNodeEndpoint &target );
 			CError disconnect_modules( const CNodeEndpoint &source, const CNodeEndpoint &target );
 			CError send_value( const CNodeEndpoint &target );
-
-			void process_buffer( const float *input, float *output, int input_channels, int output_channels, int sample_rate );
+			CError send_value( internal_id node_id, const string &endpoint_name, const CValue *value );
+
+			/* 
+			 values sent between begin_flush and end_flush are delivered as one flush: if they overflow 
+			 the command queue, m_mutex is taken once for the remainder rather than waiting for the dsp thread
+			*/
+			void begin_flush();
+			void end_flush();
+
+			/* 
+			 canvas edits (module adds and removes, connections) made between begin_graph_edit and end_graph_edit 
+			 reach libpd together, with the dsp chain suspended, so that pd rebuilds it once rather than after every 
+			 edit.  A scope which makes no canvas edits doesn't touch the dsp chain at all, and one which outgrows 
+			 the command queue is delivered as several suspended batches, each followed by a rebuild.  Scopes can 
+			 be nested - only the outermost one has any effect
+			*/
+			void begin_graph_edit();
+			void end_graph_edit();
+
+			/* 
+			 module abstractions are parsed once and cached by path.  The module manager invalidates an 
+			 implementation directory when the module is unloaded
+			*/
+			void invalidate_abstractions( const string &directory );
+
+			/* 
+			 envelope segments, rendered once per block by the integra_envelope external.  The envelope's 
+			 value runs from the fraction start_fraction to 1 over duration_ms, as from + fraction ^ exponent * ( to - from ),
+			 and is sent to each of the envelope's targets
+			*/
+			void send_envelope_segment( internal_id envelope_id, float from_value, float to_value, float exponent, float start_fraction, float duration_ms );
+			void add_envelope_target( internal_id envelope_id, internal_id target_node_id, const string &endpoint_name );
+			void clear_envelope_targets( internal_id envelope_id );
+			void stop_envelope( internal_id envelope_id );
+			void remove_envelope( internal_id envelope_id );
+
+			/* 
+			 dsp commands built after set_schedule_frame are delivered in the block which contains frame, 
+			 rather than as soon as possible.  Pass 0 to go back to immediate delivery
+			*/
+			void set_schedule_frame( int64_t frame );
+
+			/* 
+			 a block is normally output as silence if libpd is busy on another thread.  Offline rendering 
+			 passes wait_for_libpd, since it has no deadline and mustn't lose blocks.
+
+			 Every module instance is rendered here, on one thread.  The bundled libpd (pd 0.43) has a single 
+			 global instance, so audio subgraphs can't be processed concurrently even when nothing connects them - 
+			 that needs a libpd built with PDINSTANCE, one instance per subgraph
+			*/
+			void process_buffer( const float *input, float *output, int input_channels, int output_channels, int sample_rate, bool wait_for_libpd = false );
+
+			/* the audio clock: frames rendered so far, including the block currently being rendered.  Safe from any thread */
+			int64_t get_frames_processed() const;
+			int get_sample_rate() const;
+
+			/* feedback from module implementations which was lost because the queue was full, or superseded before it was read */
+			unsigned long get_dropped_feedback_count() const;
+			unsigned long get_coalesced_feedback_count() const;
+
+			/* times every call to process_buffer */
+			CDspLoadMonitor &get_load_monitor() { return *m_load_monitor; }
 
 			void dump_patch_to_file( const string &path );
 			void ping_all_modules();
@@ -90,8 +179,6 @@ namespace integra_internal
 
 			void setup_libpd();
 
-			string get_patch_file_path() const;
-
 
 			bool has_configuration_changed( int input_channels, int output_channels, int sample_rate ) const;
 
@@ -100,17 +187,54 @@ namespace integra_internal
 
 			void poll_for_messages();
 
-			void create_host_patch();
-			void delete_host_patch();
+			/* 
+			 feedback lists are recorded straight from libpd's list hook into m_feedback_queue, 
+			 before PdBase copies them into a pd::Message
+			*/
+			void install_feedback_hook();
+			static void feedback_list_hook( const char *receiver, int argc, struct _atom *argv );
+			bool record_feedback( int argc, const struct _atom *argv );
+
+			CDspCommand *begin_command();
+			CDspCommand *get_free_command();
+			void end_command();
+			void wait_for_free_slots( unsigned int number_of_slots );
+
+			/* a graph edit holds commands, behind SUSPEND_DSP, from its first canvas edit until RESUME_DSP */
+			void begin_canvas_edit();
+			void resume_dsp_after_graph_edit();
+			void dispatch_commands();
+			void dispatch_commands( int64_t end_frame );
+			void dispatch_command( const CDspCommand &command );
+			void dispatch_node_command( const CDspCommand &command );
+			void bind_node_receiver( internal_id node_id );
+			void create_node_object( const CDspCommand &command );
+			void delete_node_object( internal_id node_id );
+			void connect_node_objects( const CDspCommand &command );
+			struct _text *get_node_object( internal_id node_id ) const;
+
+			void open_host_patch();
+
+			/* serves module implementations which weren't extracted to the abstraction cache, from CImplementationFileSystem */
+			static int read_implementation_file( void *context, const char *path, struct _binbuf *contents );
 
 			void register_externals();
 
-			CError connect_or_disconnect( const CNodeEndpoint &source, const CNodeEndpoint &target, const string &command );
+			CError connect_or_disconnect( const CNodeEndpoint &source, const CNodeEndpoint &target, bool connect );
 
-			int get_patch_id( internal_id id ) const;
 			int get_stream_connection_index( const CNodeEndpoint &node_endpoint ) const;
 
-			void handle_midi_input();
+			/* incoming midi is sent to pd in the block which contains its timestamp, a fixed latency later */
+			void handle_midi_input( int64_t block_end );
+			void send_midi_to_pd( const CMidiEvent &event );
+
+			/* 
+			 the midi clock relates the midi engine's millisecond timestamps to audio frames.  It is re-anchored 
+			 only when the two drift apart, so that blocks processed together in one driver callback keep their spacing
+			*/
+			void update_midi_clock( int64_t block_start );
+			int64_t midi_time_to_frame( int timestamp ) const;
+			int frame_to_midi_time( int64_t frame ) const;
 
 			bool should_queue_message( const pd::Message &message ) const;
 
@@ -120,8 +244,9 @@ namespace integra_internal
 
 			void handle_queue_items( const pd_message_list &messages );
 
-			ISetCommand *build_set_command( const pd::List &feedback_arguments ) const;
-			void merge_set_command( ISetCommand *command );
+			void handle_feedback( const CDspFeedback *feedback, unsigned int number_of_items );
+
+			ISetCommand *build_set_command( const CDspFeedback &feedback ) const;
 
 			int ping_modules( const node_map &nodes );
 			void send_ping( const CNode &node );
@@ -129,8 +254,6 @@ namespace integra_internal
 
 			void trace_to_pd_log( const string &message ) const;
 
-			void test_map_sanity();
-
 			pd::PdBase *m_pd;
 
 			CServer &m_server;
@@ -138,32 +261,89 @@ namespace integra_internal
 			bool m_initialised;
 			int m_input_channels;
 			int m_output_channels;
-			int m_sample_rate;
+			std::atomic<int> m_sample_rate;
+
+			std::atomic<int64_t> m_frames_processed;
 
+			/* 
+			 m_mutex is owned by whichever thread is currently driving libpd.  The audio thread only 
+			 ever try-locks it, so the control thread never holds it on the hot path - control thread 
+			 messages go through m_command_queue instead
+			*/
 			pthread_mutex_t m_mutex;
 
+			CDspCommandQueue *m_command_queue;
+
+			/* commands which were stamped for a future block.  Only touched by the thread which holds m_mutex */
+			CDspCommandScheduler *m_command_scheduler;
+
+			/* control thread only */
+			int64_t m_schedule_frame;
+
+			/* 
+			 each module instance's own receive symbol, resolved once when the module is added.
+			 Only touched by the thread which holds m_mutex
+			*/
+			typedef std::unordered_map<internal_id, struct _symbol *> node_receiver_map;
+			node_receiver_map m_node_receivers;
+
+			/* 
+			 the host canvas, and each module instance on it, so that modules can be removed and connected 
+			 without searching the canvas or renumbering anything.  Only touched by the thread which holds m_mutex
+			*/
+			struct _glist *m_host_canvas;
+			typedef std::unordered_map<internal_id, struct _text *> node_object_map;
+			node_object_map m_node_objects;
+
+			bool m_is_flushing;
+			bool m_flush_holds_mutex;
+
+			/* control thread only */
+			int m_graph_edit_depth;
+
+			/* pd's dsp state from before the current graph edit.  Only touched by the thread which holds m_mutex */
+			int m_dsp_state_before_graph_edit;
+
 			int m_next_module_y_slot;
 
-			int_map m_map_id_to_patch_id;
+			/* print messages, and feedback which couldn't be recorded, go through m_message_queue */
+			CThreadedQueue<pd::Message> *m_message_queue;
+
+			CDspFeedbackQueue *m_feedback_queue;
 
-			CThreadedQueue<pd::Message> *m_feedback_queue;
+			CDspLoadMonitor *m_load_monitor;
 
-			typedef std::list<ISetCommand *> set_command_list;
-			set_command_list m_set_commands;
+			/* feedback output thread only */
+			unsigned long m_reported_dropped_feedback;
 
-			CMidiInputFilterer *m_midi_input_filterer;
+			/* midi clock and pending input.  Only touched by the thread which holds m_mutex */
+			bool m_midi_clock_is_anchored;
+			int m_midi_clock_anchor_time;
+			int64_t m_midi_clock_anchor_frame;
+			int m_midi_clock_sample_rate;
+			int64_t m_block_start;
 
-			midi_input_buffer_array m_midi_input;
+			CMidiEvent m_pending_midi_input;
+			bool m_has_pending_midi_input;
 
 			int m_unanswered_pings;
 
 			static const int max_audio_channels;
+			static const int command_queue_slots;
+			static const int command_scheduler_slots;
+			static const int command_queue_wait_microseconds;
+			static const int command_queue_max_waits;
+			static const int feedback_queue_slots;
+			static const int midi_latency_milliseconds;
+			static const int midi_clock_tolerance_milliseconds;
 			static const string patch_file_name;
 			static const string host_patch_name;
 			static const string patch_message_target;
 
 			static const string feedback_source;
 			static const string broadcast_symbol;
+			static const string node_receiver_prefix;
+			static const string envelope_receiver;
 			static const string bang;
 
 
@@ -0,0 +1,253 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+
+#include "platform_specifics.h"
+
+#include "dsp_feedback_queue.h"
+#include "api/trace.h"
+
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <assert.h>
+
+
+namespace integra_internal
+{
+	CDspFeedbackQueue::CDspFeedbackQueue( IDspFeedbackSink &output_sink, unsigned int capacity )
+		:	m_output_sink( output_sink ),
+			m_ring( capacity )
+	{
+		/* each delivery holds at most one ring's worth of distinct endpoints */
+		m_pending_capacity = capacity;
+		m_pending = new CDspFeedback[ m_pending_capacity ];
+		m_pending_table_slots = new unsigned int[ m_pending_capacity ];
+		m_number_of_pending = 0;
+
+		/* keep the table at most half full, so that probes stay short */
+		unsigned int table_size = 1;
+		while( table_size < m_pending_capacity * 2 )
+		{
+			table_size <<= 1;
+		}
+
+		m_table_mask = table_size - 1;
+		m_table = new int[ table_size ];
+		for( unsigned int i = 0; i < table_size; i++ )
+		{
+			m_table[ i ] = -1;
+		}
+
+		m_signal_is_pending.store( false );
+		m_dropped_count.store( 0 );
+		m_coalesced_count.store( 0 );
+		m_finished.store( false );
+
+#ifdef __APPLE__
+		m_semaphore = dispatch_semaphore_create( 0 );
+		if( m_semaphore == NULL )
+		{
+			INTEGRA_TRACE_ERROR << "Semaphore open error: " << strerror( errno );
+			return;
+		}
+#else
+		m_semaphore = new sem_t;
+		if( sem_init( m_semaphore, 0, 0 ) == -1 )
+		{
+			INTEGRA_TRACE_ERROR << "Semaphore open error: " << strerror( errno );
+			return;
+		}
+#endif
+
+		pthread_create( &m_output_thread, NULL, dsp_feedback_thread_function, this );
+	}
+
+
+	CDspFeedbackQueue::~CDspFeedbackQueue()
+	{
+		m_finished.store( true );
+
+		send_signal_to_output_thread();
+
+		pthread_join( m_output_thread, NULL );
+
+#ifdef __APPLE__
+		dispatch_release( m_semaphore );
+#else
+		if( sem_destroy( m_semaphore ) == -1 )
+		{
+			INTEGRA_TRACE_ERROR << "Semaphore close error: " << strerror( errno );
+		}
+
+		delete m_semaphore;
+#endif
+
+		delete [] m_pending;
+		delete [] m_pending_table_slots;
+		delete [] m_table;
+	}
+
+
+	bool CDspFeedbackQueue::push( const CDspFeedback &feedback )
+	{
+		if( !m_ring.push( feedback ) )
+		{
+			m_dropped_count.fetch_add( 1, std::memory_order_relaxed );
+			return false;
+		}
+
+		/* 
+		 the output thread clears the flag before it drains the ring, so an item pushed while 
+		 the flag is still set is sure to be seen by the drain which follows
+		*/
+		if( !m_signal_is_pending.exchange( true ) )
+		{
+			send_signal_to_output_thread();
+		}
+
+		return true;
+	}
+
+
+	void CDspFeedbackQueue::send_signal_to_output_thread()
+	{
+#ifdef __APPLE__
+		dispatch_semaphore_signal( m_semaphore );
+#else
+		sem_post( m_semaphore );
+#endif
+	}
+
+
+	void CDspFeedbackQueue::wait_for_signal()
+	{
+#ifdef __APPLE__
+		dispatch_semaphore_wait( m_semaphore, DISPATCH_TIME_FOREVER );
+#else
+		while( sem_wait( m_semaphore ) == -1 && errno == EINTR )
+		{
+		}
+#endif
+	}
+
+
+	void CDspFeedbackQueue::output_thread()
+	{
+		while( true )
+		{
+			wait_for_signal();
+
+			if( m_finished.load() )
+			{
+				break;
+			}
+
+			m_signal_is_pending.store( false );
+
+			bool pending_is_full( true );
+			while( pending_is_full )
+			{
+				pending_is_full = coalesce();
+
+				if( m_number_of_pending > 0 )
+				{
+					m_output_sink.handle_feedback( m_pending, m_number_of_pending );
+				}
+
+				clear_pending();
+			}
+		}
+	}
+
+
+	bool CDspFeedbackQueue::coalesce()
+	{
+		CDspFeedback feedback;
+
+		while( m_number_of_pending < m_pending_capacity && m_ring.pop( feedback ) )
+		{
+			unsigned int table_slot = get_table_slot( feedback.node_id, feedback.endpoint_name );
+			int pending_index = m_table[ table_slot ];
+
+			if( pending_index >= 0 )
+			{
+				m_pending[ pending_index ] = feedback;
+				m_coalesced_count.fetch_add( 1, std::memory_order_relaxed );
+			}
+			else
+			{
+				m_table[ table_slot ] = m_number_of_pending;
+				m_pending_table_slots[ m_number_of_pending ] = table_slot;
+				m_pending[ m_number_of_pending ] = feedback;
+				m_number_of_pending++;
+			}
+		}
+
+		return ( m_number_of_pending >= m_pending_capacity );
+	}
+
+
+	unsigned int CDspFeedbackQueue::get_table_slot( unsigned long node_id, const char *endpoint_name ) const
+	{
+		/* linear probing - returns the endpoint's slot, or the empty slot where it belongs */
+		uintptr_t hash = ( node_id * 2654435761u ) ^ ( reinterpret_cast<uintptr_t>( endpoint_name ) >> 3 );
+		unsigned int table_slot = hash & m_table_mask;
+
+		while( true )
+		{
+			int pending_index = m_table[ table_slot ];
+			if( pending_index < 0 )
+			{
+				return table_slot;
+			}
+
+			const CDspFeedback &pending = m_pending[ pending_index ];
+			if( pending.node_id == node_id && pending.endpoint_name == endpoint_name )
+			{
+				return table_slot;
+			}
+
+			table_slot = ( table_slot + 1 ) & m_table_mask;
+		}
+	}
+
+
+	void CDspFeedbackQueue::clear_pending()
+	{
+		for( unsigned int i = 0; i < m_number_of_pending; i++ )
+		{
+			m_table[ m_pending_table_slots[ i ] ] = -1;
+		}
+
+		m_number_of_pending = 0;
+	}
+
+
+	void *dsp_feedback_thread_function( void *context )
+	{
+		CDspFeedbackQueue *feedback_queue = static_cast<CDspFeedbackQueue *>( context );
+		feedback_queue->output_thread();
+
+		return NULL;
+	}
+}
+
@@ -0,0 +1,143 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+#ifndef INTEGRA_DSP_FEEDBACK_QUEUE_H
+#define INTEGRA_DSP_FEEDBACK_QUEUE_H
+
+#include "spsc_queue.h"
+
+#include <pthread.h>
+#include <atomic>
+
+#ifdef __APPLE__
+#include <dispatch/dispatch.h>
+#else
+#include <semaphore.h>
+#endif
+
+
+namespace integra_internal
+{
+	/*
+	 CDspFeedback is a single endpoint value reported by a module implementation.  
+
+	 It is plain data so that it can be recorded on the audio thread without allocation.  The endpoint 
+	 name and any symbol value point at pd's interned symbol names, which pd never frees, so they 
+	 stay valid on other threads and the endpoint name's address identifies the endpoint.
+	*/
+
+	class CDspFeedback
+	{
+		public:
+
+			unsigned long node_id;
+			const char *endpoint_name;
+
+			bool is_symbol;
+			float float_value;
+			const char *symbol_value;
+	};
+
+
+	class IDspFeedbackSink
+	{
+		public:
+
+			virtual void handle_feedback( const CDspFeedback *feedback, unsigned int number_of_items ) = 0;
+	};
+
+
+	void *dsp_feedback_thread_function( void *context );
+
+
+	/*
+	 CDspFeedbackQueue passes feedback from whichever thread currently drives libpd to its own output 
+	 thread, through a preallocated lock-free ring.  
+
+	 The output thread coalesces the ring by endpoint, so that the sink only sees the latest value of 
+	 each endpoint since the previous delivery - meters and analysis modules report far more often 
+	 than anyone needs to read them.  The producer only signals the output thread when it isn't 
+	 already due to run, so a busy block costs one wakeup rather than one per item.
+	*/
+
+	class CDspFeedbackQueue
+	{
+		public:
+
+			CDspFeedbackQueue( IDspFeedbackSink &output_sink, unsigned int capacity );
+			~CDspFeedbackQueue();
+
+			/* 
+			 producer side - only the thread which drives libpd may push.  Never blocks or allocates.  
+			 Returns false, and counts the item as dropped, when the ring is full
+			*/
+			bool push( const CDspFeedback &feedback );
+
+			/* items lost because the ring was full, and items superseded by a later value for the same endpoint */
+			unsigned long get_dropped_count() const { return m_dropped_count.load( std::memory_order_relaxed ); }
+			unsigned long get_coalesced_count() const { return m_coalesced_count.load( std::memory_order_relaxed ); }
+
+			friend void *dsp_feedback_thread_function( void *context );
+
+		private:
+
+			void send_signal_to_output_thread();
+			void wait_for_signal();
+
+			void output_thread();
+
+			/* moves items from the ring into m_pending, returns true if it stopped because m_pending is full */
+			bool coalesce();
+			unsigned int get_table_slot( unsigned long node_id, const char *endpoint_name ) const;
+			void clear_pending();
+
+			IDspFeedbackSink &m_output_sink;
+
+			CSpscQueue<CDspFeedback> m_ring;
+
+			/* output thread only.  m_table maps endpoints to indices in m_pending, or -1 */
+			CDspFeedback *m_pending;
+			unsigned int *m_pending_table_slots;
+			unsigned int m_number_of_pending;
+			unsigned int m_pending_capacity;
+
+			int *m_table;
+			unsigned int m_table_mask;
+
+			std::atomic<bool> m_signal_is_pending;
+			std::atomic<unsigned long> m_dropped_count;
+			std::atomic<unsigned long> m_coalesced_count;
+
+#ifdef __APPLE__
+			dispatch_semaphore_t m_semaphore;
+#else
+			sem_t *m_semaphore;
+#endif
+
+			pthread_t m_output_thread;
+
+			std::atomic<bool> m_finished;
+	};
+}
+
+
+
+#endif /* INTEGRA_DSP_FEEDBACK_QUEUE_H */
@@ -0,0 +1,210 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+
+#include "platform_specifics.h"
+
+#include "dsp_load_monitor.h"
+#include "api/audio_statistics.h"
+
+#include <chrono>
+#include <string.h>
+#include <assert.h>
+
+
+namespace integra_internal
+{
+	CDspLoadMonitor::CDspLoadMonitor( unsigned int samples_per_buffer )
+	{
+		m_samples_per_buffer = samples_per_buffer;
+
+		m_buckets = new std::atomic<uint32_t>[ number_of_buckets ];
+		for( unsigned int i = 0; i < number_of_buckets; i++ )
+		{
+			m_buckets[ i ].store( 0 );
+		}
+
+		m_blocks.store( 0 );
+		m_skipped_blocks.store( 0 );
+		m_total_nanoseconds.store( 0 );
+		m_period_min_nanoseconds.store( UINT64_MAX );
+		m_period_max_nanoseconds.store( 0 );
+		m_sample_rate.store( 0 );
+	}
+
+
+	CDspLoadMonitor::~CDspLoadMonitor()
+	{
+		delete [] m_buckets;
+	}
+
+
+	void CDspLoadMonitor::record_block( uint64_t nanoseconds, int sample_rate )
+	{
+		uint64_t bucket = nanoseconds / ( bucket_microseconds * 1000 );
+		if( bucket >= number_of_buckets )
+		{
+			bucket = number_of_buckets - 1;
+		}
+
+		m_buckets[ bucket ].fetch_add( 1, std::memory_order_relaxed );
+		m_total_nanoseconds.fetch_add( nanoseconds, std::memory_order_relaxed );
+
+		uint64_t min = m_period_min_nanoseconds.load( std::memory_order_relaxed );
+		while( nanoseconds < min && !m_period_min_nanoseconds.compare_exchange_weak( min, nanoseconds, std::memory_order_relaxed ) )
+		{
+		}
+
+		uint64_t max = m_period_max_nanoseconds.load( std::memory_order_relaxed );
+		while( nanoseconds > max && !m_period_max_nanoseconds.compare_exchange_weak( max, nanoseconds, std::memory_order_relaxed ) )
+		{
+		}
+
+		m_sample_rate.store( sample_rate, std::memory_order_relaxed );
+
+		/* released last, so that a snapshot which sees this block also sees its timing */
+		m_blocks.fetch_add( 1, std::memory_order_release );
+	}
+
+
+	void CDspLoadMonitor::record_skipped_block()
+	{
+		m_skipped_blocks.fetch_add( 1, std::memory_order_relaxed );
+	}
+
+
+	void CDspLoadMonitor::take_snapshot( CDspLoadSnapshot &snapshot )
+	{
+		snapshot.m_time_seconds = std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+
+		snapshot.m_blocks = m_blocks.load( std::memory_order_acquire );
+		snapshot.m_skipped_blocks = m_skipped_blocks.load( std::memory_order_relaxed );
+		snapshot.m_total_nanoseconds = m_total_nanoseconds.load( std::memory_order_relaxed );
+
+		for( unsigned int i = 0; i < number_of_buckets; i++ )
+		{
+			snapshot.m_buckets[ i ] = m_buckets[ i ].load( std::memory_order_relaxed );
+		}
+
+		snapshot.m_min_nanoseconds = m_period_min_nanoseconds.exchange( UINT64_MAX, std::memory_order_relaxed );
+		snapshot.m_max_nanoseconds = m_period_max_nanoseconds.exchange( 0, std::memory_order_relaxed );
+
+		int sample_rate = m_sample_rate.load( std::memory_order_relaxed );
+		snapshot.m_budget_microseconds = ( sample_rate > 0 ) ? m_samples_per_buffer * 1000000.0 / sample_rate : 0;
+	}
+
+
+	CDspLoadSnapshot::CDspLoadSnapshot()
+	{
+		m_buckets = new uint32_t[ CDspLoadMonitor::number_of_buckets ];
+		memset( m_buckets, 0, CDspLoadMonitor::number_of_buckets * sizeof( uint32_t ) );
+
+		m_blocks = 0;
+		m_skipped_blocks = 0;
+		m_total_nanoseconds = 0;
+		m_min_nanoseconds = UINT64_MAX;
+		m_max_nanoseconds = 0;
+		m_budget_microseconds = 0;
+		m_time_seconds = 0;
+	}
+
+
+	CDspLoadSnapshot::~CDspLoadSnapshot()
+	{
+		delete [] m_buckets;
+	}
+
+
+	void CDspLoadSnapshot::get_statistics( const CDspLoadSnapshot &previous, CAudioStatistics &statistics ) const
+	{
+		/* 
+		 the counters are read one by one whilst blocks are being recorded, so a block can be counted in one 
+		 counter but not yet in another.  Differences are clamped rather than trusted to be consistent
+		*/
+		uint64_t blocks = m_blocks - previous.m_blocks;
+
+		statistics.period_seconds = ( previous.m_time_seconds > 0 ) ? m_time_seconds - previous.m_time_seconds : 0;
+		statistics.blocks_processed = blocks;
+		statistics.budget_microseconds = m_budget_microseconds;
+		statistics.total_blocks_processed = m_blocks;
+		statistics.total_blocks_skipped = m_skipped_blocks;
+
+		if( blocks == 0 || m_max_nanoseconds == 0 )
+		{
+			statistics.min_microseconds = 0;
+			statistics.mean_microseconds = 0;
+			statistics.p99_microseconds = 0;
+			statistics.p999_microseconds = 0;
+			statistics.max_microseconds = 0;
+			statistics.mean_budget_percent = 0;
+			statistics.max_budget_percent = 0;
+			return;
+		}
+
+		statistics.min_microseconds = m_min_nanoseconds / 1000.0;
+		statistics.max_microseconds = m_max_nanoseconds / 1000.0;
+		statistics.mean_microseconds = ( m_total_nanoseconds - previous.m_total_nanoseconds ) / 1000.0 / blocks;
+		statistics.p99_microseconds = get_percentile( previous, 0.99, blocks );
+		statistics.p999_microseconds = get_percentile( previous, 0.999, blocks );
+
+		if( statistics.mean_microseconds < statistics.min_microseconds ) statistics.mean_microseconds = statistics.min_microseconds;
+		if( statistics.mean_microseconds > statistics.max_microseconds ) statistics.mean_microseconds = statistics.max_microseconds;
+
+		if( m_budget_microseconds > 0 )
+		{
+			statistics.mean_budget_percent = statistics.mean_microseconds * 100 / m_budget_microseconds;
+			statistics.max_budget_percent = statistics.max_microseconds * 100 / m_budget_microseconds;
+		}
+		else
+		{
+			statistics.mean_budget_percent = 0;
+			statistics.max_budget_percent = 0;
+		}
+	}
+
+
+	double CDspLoadSnapshot::get_percentile( const CDspLoadSnapshot &previous, double fraction, uint64_t blocks_in_period ) const
+	{
+		/* the smallest bucket upper edge at or below which at least fraction of the period's blocks fall */
+		uint64_t target = uint64_t( fraction * blocks_in_period );
+		if( target < fraction * blocks_in_period ) target++;
+		if( target == 0 ) target = 1;
+
+		double min_microseconds = m_min_nanoseconds / 1000.0;
+		double max_microseconds = m_max_nanoseconds / 1000.0;
+
+		uint64_t cumulative = 0;
+		for( unsigned int i = 0; i < CDspLoadMonitor::number_of_buckets - 1; i++ )
+		{
+			cumulative += uint32_t( m_buckets[ i ] - previous.m_buckets[ i ] );
+			if( cumulative >= target )
+			{
+				double upper_edge = double( ( i + 1 ) * CDspLoadMonitor::bucket_microseconds );
+				if( upper_edge < min_microseconds ) return min_microseconds;
+				if( upper_edge > max_microseconds ) return max_microseconds;
+				return upper_edge;
+			}
+		}
+
+		/* the percentile falls in the overflow bucket */
+		return max_microseconds;
+	}
+}
@@ -0,0 +1,124 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+#ifndef INTEGRA_DSP_LOAD_MONITOR_H
+#define INTEGRA_DSP_LOAD_MONITOR_H
+
+#include <atomic>
+#include <stdint.h>
+
+
+namespace integra_api
+{
+	class CAudioStatistics;
+}
+
+using namespace integra_api;
+
+
+namespace integra_internal
+{
+	class CDspLoadSnapshot;
+
+
+	/*
+	 CDspLoadMonitor times dsp blocks into a histogram.
+
+	 record_block and record_skipped_block are wait-free and never allocate, so they are safe to call from 
+	 audio callbacks.  take_snapshot can be called from any thread, but it also starts a new period for the 
+	 exact min and max timings, so only one thread should take snapshots.
+	*/
+
+	class CDspLoadMonitor
+	{
+		public:
+
+			static const unsigned int bucket_microseconds = 5;
+
+			/* the last bucket also collects every block slower than the histogram's range */
+			static const unsigned int number_of_buckets = 2048;
+
+			CDspLoadMonitor( unsigned int samples_per_buffer );
+			~CDspLoadMonitor();
+
+			void record_block( uint64_t nanoseconds, int sample_rate );
+			void record_skipped_block();
+
+			void take_snapshot( CDspLoadSnapshot &snapshot );
+
+		private:
+
+			unsigned int m_samples_per_buffer;
+
+			std::atomic<uint32_t> *m_buckets;
+
+			std::atomic<uint64_t> m_blocks;
+			std::atomic<uint64_t> m_skipped_blocks;
+			std::atomic<uint64_t> m_total_nanoseconds;
+
+			/* reset by take_snapshot */
+			std::atomic<uint64_t> m_period_min_nanoseconds;
+			std::atomic<uint64_t> m_period_max_nanoseconds;
+
+			std::atomic<int> m_sample_rate;
+	};
+
+
+	/*
+	 CDspLoadSnapshot is a copy of a CDspLoadMonitor's counters.  Statistics for a period are derived from 
+	 the difference between the snapshots taken at its start and end
+	*/
+
+	class CDspLoadSnapshot
+	{
+		friend class CDspLoadMonitor;
+
+		public:
+
+			CDspLoadSnapshot();
+			~CDspLoadSnapshot();
+
+			/* fills in the timings and block counts of statistics.  Driver counts are left untouched */
+			void get_statistics( const CDspLoadSnapshot &previous, CAudioStatistics &statistics ) const;
+
+		private:
+
+			double get_percentile( const CDspLoadSnapshot &previous, double fraction, uint64_t blocks_in_period ) const;
+
+			uint32_t *m_buckets;
+			uint64_t m_blocks;
+			uint64_t m_skipped_blocks;
+			uint64_t m_total_nanoseconds;
+			uint64_t m_min_nanoseconds;
+			uint64_t m_max_nanoseconds;
+			double m_budget_microseconds;
+
+			/* steady clock, when the snapshot was taken */
+			double m_time_seconds;
+
+			CDspLoadSnapshot( const CDspLoadSnapshot & );
+			CDspLoadSnapshot &operator=( const CDspLoadSnapshot & );
+	};
+}
+
+
+
+#endif /* INTEGRA_DSP_LOAD_MONITOR_H */
@@ -26,6 +26,8 @@
 #include "node_endpoint.h"
 #include "interface_definition.h"
 #include "server.h"
+#include "dsp_engine.h"
+#include "player_handler.h"
 #include "api/command.h"
 
 #include <assert.h>
@@ -41,6 +43,9 @@ namespace integra_internal
 	CEnvelopeLogic::CEnvelopeLogic( const CNode &node )
 		:	CLogic( node )
 	{
+		m_dsp_segment_is_active = false;
+		m_dsp_rate = 0;
+		m_dsp_previous_tick = 0;
 	}
 
 
@@ -60,6 +65,35 @@ namespace integra_internal
 			update_value( server );
 			return;
 		}	
+
+		if( endpoint_name == endpoint_active && !node_is_active() )
+		{
+			stop_rendering_in_dsp( server );
+			return;
+		}
+	}
+
+
+	void CEnvelopeLogic::handle_delete( CServer &server, CCommandSource source )
+	{
+		CLogic::handle_delete( server, source );
+
+		if( !m_dsp_targets.empty() || m_dsp_segment_is_active )
+		{
+			server.get_dsp_engine().remove_envelope( get_node().get_id() );
+		}
+	}
+
+
+	void CEnvelopeLogic::stop_rendering_in_dsp( CServer &server )
+	{
+		if( !m_dsp_segment_is_active )
+		{
+			return;
+		}
+
+		server.get_dsp_engine().stop_envelope( get_node().get_id() );
+		m_dsp_segment_is_active = false;
 	}
 
 
@@ -69,10 +103,11 @@ namespace integra_internal
 	}
 
 
-	void CEnvelopeLogic::update_value( CServer &server, const CNode *control_point_to_ignore )
+	void CEnvelopeLogic::update_value( CServer &server )
 	{
 		if( !node_is_active() )
 		{
+			stop_rendering_in_dsp( server );
 			return;
 		}
 
@@ -100,121 +135,201 @@ namespace integra_internal
 
 		envelope_current_tick -= envelope_start_tick;
 
+		if( update_dsp_segment( server, envelope_current_tick ) )
+		{
+			/* the dsp engine is already producing this value */
+			return;
+		}
+
 		/*
-		iterate over control points to find ticks and values of latest previous control point and earliest next control point
+		find output value
 		*/
 
-		bool found_previous_tick = false;
-		bool found_next_tick = false;
-		float previous_value = 0;
-		float next_value = 0;
-		int latest_previous_tick = 0;
-		int earliest_next_tick = 0;
-		float previous_control_point_curvature = 0;
+		float output = 0;
+		if( !m_control_points.get_value( envelope_current_tick, output ) )
+		{
+			/*
+			no control points - can't find output value
+			*/
+
+			return;
+		}
+	
+		/*
+		store output value if changed
+		*/
+		CFloatValue output_value( output );
 
-		const node_map &control_points = envelope_node.get_children();
-		for( node_map::const_iterator i = control_points.begin(); i != control_points.end(); i++ )
+		if( !current_value_endpoint->get_value()->is_equal( output_value ) )
 		{
-			const INode *control_point = i->second;
-			if( control_point == control_point_to_ignore )
-			{
-				continue;
-			}
+			server.process_command( ISetCommand::create( current_value_endpoint->get_handle(), output_value ), CCommandSource::SYSTEM );
+		}
+	}
 
-			const INodeEndpoint *control_point_tick_endpoint = control_point->get_node_endpoint( CControlPointLogic::endpoint_tick );
-			const INodeEndpoint *control_point_value_endpoint = control_point->get_node_endpoint( CControlPointLogic::endpoint_value );
 
-			assert( control_point_tick_endpoint && control_point_value_endpoint );
+	void CEnvelopeLogic::update_control_point( CServer &server, const CNode &control_point )
+	{
+		const INodeEndpoint *tick_endpoint = control_point.get_node_endpoint( CControlPointLogic::endpoint_tick );
+		const INodeEndpoint *value_endpoint = control_point.get_node_endpoint( CControlPointLogic::endpoint_value );
+		const INodeEndpoint *curvature_endpoint = control_point.get_node_endpoint( CControlPointLogic::endpoint_curvature );
 
-			int control_point_tick = *control_point_tick_endpoint->get_value();
-			float control_point_value = *control_point_value_endpoint->get_value();
+		assert( tick_endpoint && value_endpoint && curvature_endpoint );
 
-			if( control_point_tick <= envelope_current_tick && ( !found_previous_tick || control_point_tick > latest_previous_tick ) )
-			{
-				latest_previous_tick = control_point_tick;
-				previous_value = control_point_value;
+		m_control_points.set( control_point.get_id(), *tick_endpoint->get_value(), *value_endpoint->get_value(), *curvature_endpoint->get_value() );
 
-				const INodeEndpoint *control_point_curvature_endpoint = control_point->get_node_endpoint( CControlPointLogic::endpoint_curvature );
-				assert( control_point_curvature_endpoint );
+		stop_rendering_in_dsp( server );
+		update_value( server );
+	}
 
-				previous_control_point_curvature = *control_point_curvature_endpoint->get_value();
 
-				found_previous_tick = true;
-			}
+	void CEnvelopeLogic::remove_control_point( CServer &server, const CNode &control_point )
+	{
+		m_control_points.remove( control_point.get_id() );
+
+		stop_rendering_in_dsp( server );
+		update_value( server );
+	}
+
+
+	bool CEnvelopeLogic::update_dsp_segment( CServer &server, int tick )
+	{
+		int rate = server.should_render_envelopes_in_dsp() ? server.get_player_handler().get_current_rate() : 0;
+		if( rate <= 0 )
+		{
+			/* ticks aren't coming from a playing player */
+			stop_rendering_in_dsp( server );
+			return false;
+		}
 
-			if( control_point_tick > envelope_current_tick && ( !found_next_tick || control_point_tick < earliest_next_tick ) )
+		if( m_dsp_segment_is_active && rate == m_dsp_rate && tick > m_dsp_previous_tick && tick < m_dsp_segment.m_end_tick )
+		{
+			/* still playing forwards through the same segment - check nothing has been reconnected */
+			if( find_dsp_targets( server, m_dsp_segment, m_candidate_dsp_targets ) && m_candidate_dsp_targets == m_dsp_targets )
 			{
-				earliest_next_tick = control_point_tick;
-				next_value = control_point_value;
-				found_next_tick = true;
+				m_dsp_previous_tick = tick;
+				return true;
 			}
 		}
 
-		/*
-		find output value
-		*/
+		stop_rendering_in_dsp( server );
 
-		float output = 0;
+		CControlPointIndex::CSegment segment;
+		if( !m_control_points.get_segment( tick, segment ) || !segment.m_has_end || segment.m_start_value == segment.m_end_value )
+		{
+			/* flat - nothing to interpolate */
+			return false;
+		}
 
-		if( found_previous_tick )
+		if( !find_dsp_targets( server, segment, m_candidate_dsp_targets ) || m_candidate_dsp_targets.empty() )
 		{
-			if( found_next_tick )
+			return false;
+		}
+
+		CDspEngine &dsp_engine = server.get_dsp_engine();
+		internal_id envelope_id = get_node().get_id();
+
+		if( !( m_candidate_dsp_targets == m_dsp_targets ) )
+		{
+			dsp_engine.clear_envelope_targets( envelope_id );
+			for( dsp_target_list::const_iterator i = m_candidate_dsp_targets.begin(); i != m_candidate_dsp_targets.end(); i++ )
 			{
-				/*
-				between control points - perform interpolation
-				*/
-				int tick_range = earliest_next_tick - latest_previous_tick;
-				assert( tick_range > 0 );
+				dsp_engine.add_envelope_target( envelope_id, i->m_node_id, *i->m_endpoint_name );
+			}
+
+			m_dsp_targets.swap( m_candidate_dsp_targets );
+		}
+
+		int segment_length = segment.m_end_tick - segment.m_start_tick;
+		assert( segment_length > 0 );
+
+		float start_fraction = (float) ( tick - segment.m_start_tick ) / segment_length;
+		float duration_ms = ( segment.m_end_tick - tick ) * 1000.f / rate;
+
+		dsp_engine.send_envelope_segment( envelope_id, segment.m_start_value, segment.m_end_value, segment.m_exponent, start_fraction, duration_ms );
+
+		m_dsp_segment = segment;
+		m_dsp_segment_is_active = true;
+		m_dsp_rate = rate;
+		m_dsp_previous_tick = tick;
+
+		/* currentValue is still set at the start of each segment */
+		return false;
+	}
+
+
+	bool CEnvelopeLogic::find_dsp_targets( CServer &server, const CControlPointIndex::CSegment &segment, dsp_target_list &targets ) const
+	{
+		targets.clear();
+
+		const INodeEndpoint *current_value_endpoint = get_node().get_node_endpoint( endpoint_current_value );
+		assert( current_value_endpoint );
+
+		const connection_list *connections = server.get_connection_routing_table().lookup( current_value_endpoint->get_path() );
+		if( !connections )
+		{
+			return true;
+		}
 
-				float interpolation = (float) ( envelope_current_tick - latest_previous_tick ) / tick_range;
+		CFloatValue start_value( segment.m_start_value );
+		CFloatValue end_value( segment.m_end_value );
 
-				/*
-				apply curvature
-				*/
+		for( connection_list::const_iterator i = connections->begin(); i != connections->end(); i++ )
+		{
+			const CNode *connection = *i;
+			if( !connection->get_logic().node_is_active() )
+			{
+				continue;
+			}
 
-				if( previous_control_point_curvature != 0 )
-				{
-					interpolation = pow( interpolation, pow( 2, -previous_control_point_curvature ) );
-				}
+			const INodeEndpoint *target_path_endpoint = connection->get_node_endpoint( endpoint_target_path );
+			assert( target_path_endpoint );
 
-				output = previous_value + interpolation * ( next_value - previous_value );
+			const CNodeEndpoint *destination = CNodeEndpoint::downcast( server.find_node_endpoint( CPath( *target_path_endpoint->get_value() ), CNode::downcast( connection->get_parent() ) ) );
+			if( !destination )
+			{
+				continue;
 			}
-			else
+
+			/* 
+			 the destination must be a plain float which the module implementation receives, and which 
+			 nothing else depends upon, since the control thread won't see the values in between
+			*/
+			const CEndpointDefinition &definition = CEndpointDefinition::downcast( destination->get_endpoint_definition() );
+			const IControlInfo *control_info = definition.get_control_info();
+			if( !control_info || control_info->get_type() != CControlInfo::STATEFUL || !definition.should_send_to_host() || definition.is_input_file() )
 			{
-				/*
-				after last control point - use previous value
-				*/
-				output = previous_value;
+				return false;
 			}
-		}
-		else
-		{
-			if( found_next_tick )
+
+			const CStateInfo &state_info = CStateInfo::downcast( *control_info->get_state_info() );
+			if( state_info.get_type() != CValue::FLOAT || state_info.get_constraint().get_allowed_states() )
 			{
-				/*
-				before first control point - use next value
-				*/
-				output = next_value;
+				return false;
 			}
-			else
+
+			/* values between two control points lie between their values, so checking the ends suffices */
+			if( !state_info.test_constraint( start_value ) || !state_info.test_constraint( end_value ) )
 			{
-				/*
-				no control points - can't find output value
-				*/
+				return false;
+			}
 
-				return;
+			const CNode &destination_node = CNode::downcast( destination->get_node() );
+			if( !CInterfaceDefinition::downcast( destination_node.get_interface_definition() ).has_implementation() )
+			{
+				return false;
 			}
-		}
-	
-		/*
-		store output value if changed
-		*/
-		CFloatValue output_value( output );
 
-		if( !current_value_endpoint->get_value()->is_equal( output_value ) )
-		{
-			server.process_command( ISetCommand::create( current_value_endpoint->get_path(), output_value ), CCommandSource::SYSTEM );
+			if( server.get_connection_routing_table().lookup( destination->get_path() ) )
+			{
+				return false;
+			}
+
+			CDspTarget target;
+			target.m_node_id = destination_node.get_id();
+			target.m_endpoint_name = &definition.get_name();
+			targets.push_back( target );
 		}
-	}
 
+		return true;
+	}
 }
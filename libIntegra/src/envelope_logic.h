@@ -24,6 +24,7 @@
 #define INTEGRA_ENVELOPE_LOGIC_PRIVATE
 
 #include "logic.h"
+#include "control_point_index.h"
 
 
 namespace integra_internal
@@ -37,12 +38,53 @@ namespace integra_internal
 			~CEnvelopeLogic();
 
 			void handle_set( CServer &server, const CNodeEndpoint &node_endpoint, const CValue *previous_value, CCommandSource source );
+			void handle_delete( CServer &server, CCommandSource source );
+
+			/* 
+			 called when the player driving the envelope stops or jumps, so that the dsp engine 
+			 doesn't carry on ramping towards the next control point
+			*/
+			void stop_rendering_in_dsp( CServer &server );
 
 		private:
 
 			void update_on_activation( CServer &server );
 
-			void update_value( CServer &server, const CNode *control_point_to_ignore = NULL );
+			void update_value( CServer &server );
+
+			/* called by CControlPointLogic when a control point is added, changed, moved or deleted */
+			void update_control_point( CServer &server, const CNode &control_point );
+			void remove_control_point( CServer &server, const CNode &control_point );
+
+			/* 
+			 when ticks come from a playing player and every target lives in the dsp graph, the envelope 
+			 sends each segment to the dsp engine once, and the integra_envelope external interpolates it 
+			 per block.  Returns true when tick lies within the segment already being rendered
+			*/
+			bool update_dsp_segment( CServer &server, int tick );
+
+			class CDspTarget
+			{
+				public:
+					internal_id m_node_id;
+					const string *m_endpoint_name;
+
+					bool operator==( const CDspTarget &other ) const { return m_node_id == other.m_node_id && m_endpoint_name == other.m_endpoint_name; }
+			};
+
+			typedef std::vector<CDspTarget> dsp_target_list;
+
+			/* returns false if any of the envelope's connections leads somewhere the dsp engine can't reach */
+			bool find_dsp_targets( CServer &server, const CControlPointIndex::CSegment &segment, dsp_target_list &targets ) const;
+
+			CControlPointIndex m_control_points;
+
+			bool m_dsp_segment_is_active;
+			CControlPointIndex::CSegment m_dsp_segment;
+			int m_dsp_rate;
+			int m_dsp_previous_tick;
+			dsp_target_list m_dsp_targets;
+			dsp_target_list m_candidate_dsp_targets;
 
 			const static string endpoint_start_tick;
 			const static string endpoint_current_tick;
@@ -26,6 +26,7 @@
 #include <direct.h>
 #else
 #include <sys/stat.h>
+#include <unistd.h>
 #define _S_IFMT S_IFMT
 #define mkdir(x) mkdir(x, 0777)
 #endif
@@ -180,6 +181,73 @@ namespace integra_internal
 	}
 
 
+	CError CFileHelper::copy_directory( const string &source_directory, const string &target_directory, bool link_files )
+	{
+		DIR *directory_stream = opendir( source_directory.c_str() );
+		if( !directory_stream )
+		{
+			INTEGRA_TRACE_ERROR << "unable to open directory " << source_directory;
+			return CError::FAILED;
+		}
+
+		if( !is_directory( target_directory ) )
+		{
+			mkdir( target_directory.c_str() );
+		}
+
+		CError error = CError::SUCCESS;
+
+		while( error == CError::SUCCESS )
+		{
+			struct dirent *directory_entry = readdir( directory_stream );
+			if( !directory_entry )
+			{
+				break;
+			}
+
+			const char *name = directory_entry->d_name;
+
+			if( strcmp( name, ".." ) == 0 || strcmp( name, "." ) == 0 )
+			{
+				continue;
+			}
+
+			string source_path = source_directory + CFileIO::path_separator + name;
+			string target_path = target_directory + CFileIO::path_separator + name;
+
+			struct stat entry_data;
+			if( stat( source_path.c_str(), &entry_data ) != 0 )
+			{
+				INTEGRA_TRACE_ERROR << "couldn't read directory entry data: " << strerror( errno );
+				error = CError::FAILED;
+				break;
+			}
+
+			switch( entry_data.st_mode & _S_IFMT )
+			{
+				case S_IFDIR:	/* directory */
+					error = copy_directory( source_path, target_path, link_files );
+					break;
+
+				default:
+					#ifndef _WINDOWS
+						if( link_files && link( source_path.c_str(), target_path.c_str() ) == 0 )
+						{
+							break;
+						}
+					#endif
+
+					error = copy_file( source_path, target_path );
+					break;
+			}
+		}
+
+		closedir( directory_stream );
+
+		return error;
+	}
+
+
 	bool CFileHelper::file_exists( const string &file_name )
 	{
 		FILE *file = fopen( file_name.c_str(), "rb" );
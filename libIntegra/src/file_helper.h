@@ -46,6 +46,12 @@ namespace integra_internal
 			static bool is_directory( const string &directory_name );
 			static void delete_directory( const string &directory_name );
 
+			/* 
+			 copies a directory tree into target_directory, which is created if necessary.
+			 when link_files is true, files are hard linked where the filesystem allows it, and copied otherwise
+			*/
+			static CError copy_directory( const string &source_directory, const string &target_directory, bool link_files );
+
 			static bool file_exists( const string &file_name );
 			static CError copy_file( const string &source_path, const string &target_path );
 			static CError delete_file( const string &file_name );
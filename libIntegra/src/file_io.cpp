@@ -89,13 +89,16 @@ namespace integra_internal
 		xmlTextReaderPtr reader = NULL;
 		node_list new_nodes;
 		node_list::const_iterator new_node_iterator;
-		CValidator validator;
 		CError error = CError::SUCCESS;
 
 		LIBXML_TEST_VERSION;
 
 		CModuleManager &module_manager = CModuleManager::downcast( server.get_module_manager() );
 
+		/* every module and connection in the file is added to the dsp graph with a single rebuild */
+		CDspEngine &dsp_engine = server.get_dsp_engine();
+		dsp_engine.begin_graph_edit();
+
 		string suffix = CFileHelper::extract_suffix_from_path( filename );
 		std::transform( suffix.begin(), suffix.end(), suffix.begin(), ::tolower );	//make lowercase
 
@@ -126,14 +129,6 @@ namespace integra_internal
 
 		xmlInitParser();
 
-		/* validate candidate IXD file against schema */
-		error = validator.validate_ixd( (char *)ixd_buffer, ixd_buffer_length );
-		if( error != CError::SUCCESS ) 
-		{
-			INTEGRA_TRACE_ERROR << "ixd validation failed: " << filename;
-			goto CLEANUP;
-		}
-
 		/* create ixd reader */
 		reader = xmlReaderForMemory( (char *)ixd_buffer, ixd_buffer_length, NULL, NULL, 0 );
 		if( reader == NULL )
@@ -143,11 +138,27 @@ namespace integra_internal
 			goto CLEANUP;
 		}
 
+		/* validate against schema during the same pass which loads the nodes */
+		error = CValidator::get_shared_validator().validate_while_reading( reader );
+		if( error != CError::SUCCESS )
+		{
+			INTEGRA_TRACE_ERROR << "unable to validate ixd: " << filename;
+			goto CLEANUP;
+		}
+
 		/* actually load the data */
 		error = load_nodes( server, parent, reader, new_nodes );
 		if( error != CError::SUCCESS )
 		{
 			INTEGRA_TRACE_ERROR << "failed to load nodes: " << filename;
+
+			if( error == CError::FILE_VALIDATION_ERROR )
+			{
+				/* nodes read before the invalid content have already been created */
+				delete_loaded_nodes( server, parent, new_nodes );
+				new_nodes.clear();
+			}
+
 			goto CLEANUP;
 		}
         
@@ -164,7 +175,7 @@ namespace integra_internal
 		/* send the loaded attributes to the host */
 		for( new_node_iterator = new_nodes.begin(); new_node_iterator != new_nodes.end(); new_node_iterator++ )
 		{
-			if( send_loaded_values_to_module( **new_node_iterator, server.get_dsp_engine() ) != CError::SUCCESS)
+			if( send_loaded_values_to_module( **new_node_iterator, dsp_engine ) != CError::SUCCESS)
 			{
 				INTEGRA_TRACE_ERROR << "failed to send loaded attributes to host: " << filename;
 				continue;
@@ -203,6 +214,8 @@ namespace integra_internal
 			new_embedded_module_ids.clear();
 		}
 
+		dsp_engine.end_graph_edit();
+
 		return error;
 	}
 
@@ -404,6 +417,13 @@ namespace integra_internal
 		INTEGRA_TRACE_VERBOSE << "loading... ";
 		while( rv == 1 ) 
 		{
+			if( !CValidator::is_valid( reader ) )
+			{
+				INTEGRA_TRACE_ERROR << "ixd doesn't conform to collection schema";
+				free_loaded_values( loaded_values );
+				return CError::FILE_VALIDATION_ERROR;
+			}
+
 			string element( ( const char * ) xmlTextReaderConstName( reader ) );
 			depth = xmlTextReaderDepth(reader);
 			type = xmlTextReaderNodeType(reader);
@@ -538,6 +558,13 @@ namespace integra_internal
 			rv = xmlTextReaderRead(reader);
 		}
 
+		if( rv < 0 || !CValidator::is_valid( reader ) )
+		{
+			INTEGRA_TRACE_ERROR << "ixd is malformed or doesn't conform to collection schema";
+			free_loaded_values( loaded_values );
+			return CError::FILE_VALIDATION_ERROR;
+		}
+
 		INTEGRA_TRACE_VERBOSE << "done!";
 
 		INTEGRA_TRACE_VERBOSE << "Setting values...";
@@ -579,6 +606,43 @@ namespace integra_internal
 	}
 
 
+	void CFileIO::delete_loaded_nodes( CServer &server, const CNode *parent, const node_list &loaded_nodes )
+	{
+		/* deleting the topmost loaded nodes also deletes their descendants */
+		path_list paths_to_delete;
+		for( node_list::const_iterator i = loaded_nodes.begin(); i != loaded_nodes.end(); i++ )
+		{
+			const CNode *loaded_node = *i;
+			if( CNode::downcast( loaded_node->get_parent() ) == parent )
+			{
+				paths_to_delete.push_back( loaded_node->get_path() );
+			}
+		}
+
+		for( path_list::const_iterator i = paths_to_delete.begin(); i != paths_to_delete.end(); i++ )
+		{
+			server.process_command( IDeleteCommand::create( *i ), CCommandSource::SYSTEM );
+		}
+	}
+
+
+	void CFileIO::free_loaded_values( map_id_to_value_map &loaded_values )
+	{
+		for( map_id_to_value_map::iterator i = loaded_values.begin(); i != loaded_values.end(); i++ )
+		{
+			value_map *values_for_node = i->second;
+			for( value_map::iterator j = values_for_node->begin(); j != values_for_node->end(); j++ )
+			{
+				delete j->second;
+			}
+
+			delete values_for_node;
+		}
+
+		loaded_values.clear();
+	}
+
+
 	CError CFileIO::send_loaded_values_to_module( const CNode &node, CDspEngine &dsp_engine )
 	{
 		const CInterfaceDefinition &interface_definition = CInterfaceDefinition::downcast( node.get_interface_definition() );
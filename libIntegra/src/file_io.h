@@ -66,6 +66,7 @@ namespace integra_internal
 			static CError load_ixd_buffer_directly( const string &file_path, unsigned char **ixd_buffer, unsigned int *ixd_buffer_length );
 
 			static CError load_nodes( CServer &server, const CNode *node, xmlTextReaderPtr reader, node_list &loaded_nodes );
+			static void delete_loaded_nodes( CServer &server, const CNode *parent, const node_list &loaded_nodes );
 			static CError send_loaded_values_to_module( const CNode &node, CDspEngine &dsp_engine );
 			static string get_top_level_node_name( const string &filename );
 
@@ -83,6 +84,8 @@ namespace integra_internal
 
 			typedef std::unordered_map<internal_id, value_map *> map_id_to_value_map;
 
+			static void free_loaded_values( map_id_to_value_map &loaded_values );
+
 
 			static const string internal_file_suffix;
 			static const string xml_encoding;
@@ -0,0 +1,269 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+
+
+#include "platform_specifics.h"
+
+#include "implementation_file_system.h"
+#include "file_io.h"
+#include "api/string_helper.h"
+#include "api/trace.h"
+
+#include "../externals/minizip/unzip.h"
+
+#include <algorithm>
+
+
+namespace integra_internal
+{
+	CImplementationFileSystem::CImplementationFileSystem( const string &internal_implementation_directory )
+		:	m_internal_implementation_directory( internal_implementation_directory )
+	{
+		pthread_mutex_init( &m_mutex, NULL );
+	}
+
+
+	CImplementationFileSystem::~CImplementationFileSystem()
+	{
+		pthread_mutex_destroy( &m_mutex );
+	}
+
+
+	void CImplementationFileSystem::add_implementation( const string &implementation_directory, const string &module_file )
+	{
+		pthread_mutex_lock( &m_mutex );
+
+		CImplementation &implementation = m_implementations[ normalize_path( implementation_directory ) ];
+		implementation.module_file = module_file;
+		implementation.is_decompressed = false;
+		implementation.files.clear();
+
+		pthread_mutex_unlock( &m_mutex );
+	}
+
+
+	void CImplementationFileSystem::remove_implementation( const string &implementation_directory )
+	{
+		pthread_mutex_lock( &m_mutex );
+
+		m_implementations.erase( normalize_path( implementation_directory ) );
+
+		pthread_mutex_unlock( &m_mutex );
+	}
+
+
+	void CImplementationFileSystem::set_module_file( const string &implementation_directory, const string &module_file )
+	{
+		pthread_mutex_lock( &m_mutex );
+
+		implementation_map::iterator lookup = m_implementations.find( normalize_path( implementation_directory ) );
+		if( lookup != m_implementations.end() )
+		{
+			lookup->second.module_file = module_file;
+		}
+
+		pthread_mutex_unlock( &m_mutex );
+	}
+
+
+	bool CImplementationFileSystem::has_implementation( const string &implementation_directory ) const
+	{
+		pthread_mutex_lock( &m_mutex );
+
+		bool result = ( m_implementations.count( normalize_path( implementation_directory ) ) > 0 );
+
+		pthread_mutex_unlock( &m_mutex );
+
+		return result;
+	}
+
+
+	void CImplementationFileSystem::load_implementation( const string &path )
+	{
+		string normalized_path = normalize_path( path );
+		string relative_path;
+
+		pthread_mutex_lock( &m_mutex );
+
+		CImplementation *implementation = find_implementation( normalized_path, relative_path );
+		if( !implementation || implementation->is_decompressed )
+		{
+			pthread_mutex_unlock( &m_mutex );
+			return;
+		}
+
+		string module_file = implementation->module_file;
+
+		pthread_mutex_unlock( &m_mutex );
+
+		string_map files;
+		decompress( module_file, files );
+
+		pthread_mutex_lock( &m_mutex );
+
+		/* the implementation may have been removed or replaced whilst we weren't holding the lock */
+		implementation = find_implementation( normalized_path, relative_path );
+		if( implementation && !implementation->is_decompressed && implementation->module_file == module_file )
+		{
+			implementation->files.swap( files );
+			implementation->is_decompressed = true;
+		}
+
+		pthread_mutex_unlock( &m_mutex );
+	}
+
+
+	bool CImplementationFileSystem::read_file( const string &path, string &contents )
+	{
+		bool result = false;
+
+		pthread_mutex_lock( &m_mutex );
+
+		string relative_path;
+		CImplementation *implementation = find_implementation( normalize_path( path ), relative_path );
+		if( implementation )
+		{
+			if( !implementation->is_decompressed )
+			{
+				/* only when the implementation wasn't loaded first - see load_implementation */
+				INTEGRA_TRACE_VERBOSE << "implementation read before it was loaded: " << path;
+
+				decompress( implementation->module_file, implementation->files );
+
+				/* don't retry unreadable module files at every read */
+				implementation->is_decompressed = true;
+			}
+
+			string_map::const_iterator lookup = implementation->files.find( relative_path );
+			if( lookup != implementation->files.end() )
+			{
+				contents = lookup->second;
+				result = true;
+			}
+		}
+
+		pthread_mutex_unlock( &m_mutex );
+
+		return result;
+	}
+
+
+	CImplementationFileSystem::CImplementation *CImplementationFileSystem::find_implementation( const string &path, string &relative_path )
+	{
+		/* 
+		 implementation directories all end in a separator and none contains another, so the only 
+		 directory which can contain path is the last one which sorts before it
+		*/
+		implementation_map::iterator lookup = m_implementations.upper_bound( path );
+		if( lookup == m_implementations.begin() )
+		{
+			return NULL;
+		}
+
+		lookup--;
+
+		const string &implementation_directory = lookup->first;
+		if( path.compare( 0, implementation_directory.length(), implementation_directory ) != 0 )
+		{
+			return NULL;
+		}
+
+		relative_path = path.substr( implementation_directory.length() );
+		return &lookup->second;
+	}
+
+
+	void CImplementationFileSystem::decompress( const string &module_file, string_map &files ) const
+	{
+		/* only reads m_internal_implementation_directory, so needn't be called with the lock held */
+
+		unzFile unzip_file = unzOpen( module_file.c_str() );
+		if( !unzip_file )
+		{
+			INTEGRA_TRACE_ERROR << "Unable to open zip: " << module_file;
+			return;
+		}
+
+		if( unzGoToFirstFile( unzip_file ) != UNZ_OK )
+		{
+			INTEGRA_TRACE_ERROR << "Couldn't iterate contents: " << module_file;
+			unzClose( unzip_file );
+			return;
+		}
+
+		do
+		{
+			unz_file_info file_info;
+			char file_name_buffer[ CStringHelper::string_buffer_length ];
+			if( unzGetCurrentFileInfo( unzip_file, &file_info, file_name_buffer, CStringHelper::string_buffer_length, NULL, 0, NULL, 0 ) != UNZ_OK )
+			{
+				INTEGRA_TRACE_ERROR << "Couldn't extract file info";
+				continue;
+			}
+
+			string file_name( file_name_buffer );
+
+			if( file_name.substr( 0, m_internal_implementation_directory.length() ) != m_internal_implementation_directory )
+			{
+				/* skip files outside the implementation */
+				continue;
+			}
+
+			if( file_name.back() == CFileIO::path_separator )
+			{
+				/* skip directories */
+				continue;
+			}
+
+			if( unzOpenCurrentFile( unzip_file ) != UNZ_OK )
+			{
+				INTEGRA_TRACE_ERROR << "couldn't open zip contents: " << file_name;
+				continue;
+			}
+
+			string contents( file_info.uncompressed_size, '\0' );
+			if( file_info.uncompressed_size > 0 && unzReadCurrentFile( unzip_file, &contents[ 0 ], file_info.uncompressed_size ) != ( int ) file_info.uncompressed_size )
+			{
+				INTEGRA_TRACE_ERROR << "Error decompressing file: " << file_name;
+			}
+			else
+			{
+				files[ file_name.substr( m_internal_implementation_directory.length() ) ] = contents;
+			}
+
+			unzCloseCurrentFile( unzip_file );
+		}
+		while( unzGoToNextFile( unzip_file ) != UNZ_END_OF_LIST_OF_FILE );
+
+		unzClose( unzip_file );
+
+		INTEGRA_TRACE_VERBOSE << "Decompressed " << files.size() << " implementation files from " << module_file;
+	}
+
+
+	string CImplementationFileSystem::normalize_path( const string &path )
+	{
+		string normalized_path( path );
+		std::replace( normalized_path.begin(), normalized_path.end(), '\\', '/' );
+		return normalized_path;
+	}
+}
@@ -0,0 +1,101 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+
+#ifndef INTEGRA_IMPLEMENTATION_FILE_SYSTEM_H
+#define INTEGRA_IMPLEMENTATION_FILE_SYSTEM_H
+
+#include <pthread.h>
+#include <map>
+
+#include "api/common_typedefs.h"
+
+
+using namespace integra_api;
+
+
+namespace integra_internal
+{
+	/*
+	 CImplementationFileSystem serves the files of module implementations from memory, so that they 
+	 needn't be extracted to the scratch directory.
+
+	 Each implementation is registered with its implementation directory - the path at which libpd looks 
+	 for its files, which doesn't exist on disk - and the module file which contains it.  Nothing is 
+	 decompressed at registration.  load_implementation decompresses all of an implementation's files 
+	 from the module file, and keeps them until the implementation is removed.  It should be called on 
+	 the control thread before libpd is asked for the implementation, so that reads from the dsp thread 
+	 are only lookups.
+
+	 Implementations are registered from the module loading threads and the control thread, and read 
+	 from whichever thread owns libpd, so every method locks.
+	*/
+
+	class CImplementationFileSystem
+	{
+		public:
+
+			/* internal_implementation_directory is the implementation's location within module files */
+			CImplementationFileSystem( const string &internal_implementation_directory );
+			~CImplementationFileSystem();
+
+			void add_implementation( const string &implementation_directory, const string &module_file );
+			void remove_implementation( const string &implementation_directory );
+
+			/* for when a module file is moved.  Does nothing for implementations which aren't registered */
+			void set_module_file( const string &implementation_directory, const string &module_file );
+
+			bool has_implementation( const string &implementation_directory ) const;
+
+			/* decompresses the implementation which contains path, unless it already is.  The lock isn't held whilst unzipping */
+			void load_implementation( const string &path );
+
+			/* returns false if path isn't a file in a registered implementation */
+			bool read_file( const string &path, string &contents );
+
+		private:
+
+			class CImplementation
+			{
+				public:
+					string module_file;
+					bool is_decompressed;
+					string_map files;
+			};
+
+			typedef std::map<string, CImplementation> implementation_map;
+
+			CImplementation *find_implementation( const string &path, string &relative_path );
+
+			void decompress( const string &module_file, string_map &files ) const;
+
+			/* libpd always separates paths with '/' */
+			static string normalize_path( const string &path );
+
+			implementation_map m_implementations;
+			string m_internal_implementation_directory;
+
+			mutable pthread_mutex_t m_mutex;
+	};
+}
+
+
+#endif
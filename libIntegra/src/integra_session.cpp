@@ -24,7 +24,9 @@
 #include "api/integra_session.h"
 #include "api/trace.h"
 #include "api/server_startup_info.h"
+#include "api/offline_render.h"
 #include "server.h"
+#include "offline_audio_engine.h"
 
 #include <assert.h>
 
@@ -95,6 +97,36 @@ namespace integra_api
 
 		return CServerLock( m_server );
 	}
+
+
+	CError CIntegraSession::render_offline( const COfflineRenderInfo &render_info, COfflineRenderResult *result )
+	{
+		if( !m_server )
+		{
+			INTEGRA_TRACE_ERROR << "Can't render - session wasn't started";
+			return CError::FAILED;
+		}
+
+		CServer *server = dynamic_cast<CServer *>( m_server );
+		assert( server );
+
+		COfflineAudioEngine *offline_audio_engine = dynamic_cast<COfflineAudioEngine *>( &server->get_audio_engine() );
+		if( !offline_audio_engine )
+		{
+			INTEGRA_TRACE_ERROR << "Can't render - session wasn't started for offline rendering";
+			return CError::FAILED;
+		}
+
+		COfflineRenderResult render_result;
+		CError error = offline_audio_engine->render( *server, render_info, render_result );
+
+		if( result )
+		{
+			*result = render_result;
+		}
+
+		return error;
+	}
 }
 
 
@@ -53,6 +53,7 @@ namespace integra_internal
 	class CInterfaceDefinition : public IInterfaceDefinition
 	{
 		friend class CInterfaceDefinitionLoader;
+		friend class CInterfaceDefinitionSerializer;
 
 		public:
 
@@ -104,6 +105,7 @@ namespace integra_internal
 	class CInterfaceInfo : public IInterfaceInfo
 	{
 		friend class CInterfaceDefinitionLoader;
+		friend class CInterfaceDefinitionSerializer;
 
 		public:
 			CInterfaceInfo();
@@ -138,6 +140,7 @@ namespace integra_internal
 	class CEndpointDefinition : public IEndpointDefinition
 	{
 		friend class CInterfaceDefinitionLoader;
+		friend class CInterfaceDefinitionSerializer;
 
 		public:
 
@@ -177,6 +180,7 @@ namespace integra_internal
 	class CControlInfo : public IControlInfo
 	{
 		friend class CInterfaceDefinitionLoader;
+		friend class CInterfaceDefinitionSerializer;
 
 		public:
 			CControlInfo();
@@ -201,6 +205,7 @@ namespace integra_internal
 	class CStateInfo : public IStateInfo
 	{
 		friend class CInterfaceDefinitionLoader;
+		friend class CInterfaceDefinitionSerializer;
 
 		public:
 			CStateInfo();
@@ -232,6 +237,7 @@ namespace integra_internal
 	class CConstraint : public IConstraint
 	{
 		friend class CInterfaceDefinitionLoader;
+		friend class CInterfaceDefinitionSerializer;
 
 		public:
 			CConstraint();
@@ -249,6 +255,7 @@ namespace integra_internal
 	class CValueRange : public IValueRange
 	{
 		friend class CInterfaceDefinitionLoader;
+		friend class CInterfaceDefinitionSerializer;
 
 		public:
 			CValueRange();
@@ -267,6 +274,7 @@ namespace integra_internal
 	class CValueScale : public IValueScale
 	{
 		friend class CInterfaceDefinitionLoader;
+		friend class CInterfaceDefinitionSerializer;
 
 		public:
 			CValueScale();
@@ -282,6 +290,7 @@ namespace integra_internal
 	class CStreamInfo : public IStreamInfo
 	{
 		friend class CInterfaceDefinitionLoader;
+		friend class CInterfaceDefinitionSerializer;
 
 		public:
 			CStreamInfo();
@@ -299,6 +308,7 @@ namespace integra_internal
 	class CWidgetDefinition : public IWidgetDefinition
 	{
 		friend class CInterfaceDefinitionLoader;
+		friend class CInterfaceDefinitionSerializer;
 
 		public:
 			CWidgetDefinition();
@@ -322,6 +332,7 @@ namespace integra_internal
 	class CWidgetPosition : public IWidgetPosition
 	{
 		friend class CInterfaceDefinitionLoader;
+		friend class CInterfaceDefinitionSerializer;
 
 		public:	
 			CWidgetPosition();
@@ -343,6 +354,7 @@ namespace integra_internal
 	class CImplementationInfo : public IImplementationInfo
 	{
 		friend class CInterfaceDefinitionLoader;
+		friend class CInterfaceDefinitionSerializer;
 
 		public:
 			CImplementationInfo();
@@ -0,0 +1,690 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+
+
+#include "platform_specifics.h"
+
+#include <assert.h>
+
+#include "interface_definition_serializer.h"
+#include "api/trace.h"
+
+
+namespace integra_internal
+{
+	const unsigned int CInterfaceDefinitionSerializer::format_version = 1;
+
+	/* written in place of a value when a value pointer is null */
+	static const int null_value_code = -1;
+
+
+	CInterfaceDefinitionSerializer::CInterfaceDefinitionSerializer( string *output, const unsigned char *buffer, unsigned int buffer_size )
+	{
+		m_output = output;
+		m_read_position = buffer;
+		m_read_end = buffer + buffer_size;
+	}
+
+
+	void CInterfaceDefinitionSerializer::serialize( const CInterfaceDefinition &interface_definition, string &output )
+	{
+		output.clear();
+
+		CInterfaceDefinitionSerializer serializer( &output, NULL, 0 );
+		serializer.write_int( format_version );
+		serializer.write_interface_definition( interface_definition );
+	}
+
+
+	CInterfaceDefinition *CInterfaceDefinitionSerializer::deserialize( const unsigned char *buffer, unsigned int buffer_size )
+	{
+		CInterfaceDefinitionSerializer serializer( NULL, buffer, buffer_size );
+
+		int version = 0;
+		if( !serializer.read_int( version ) || version != format_version )
+		{
+			INTEGRA_TRACE_VERBOSE << "serialized interface definition has unexpected format version " << version;
+			return NULL;
+		}
+
+		CInterfaceDefinition *interface_definition = new CInterfaceDefinition;
+
+		if( !serializer.read_interface_definition( *interface_definition ) || serializer.m_read_position != serializer.m_read_end )
+		{
+			INTEGRA_TRACE_ERROR << "malformed serialized interface definition";
+			delete interface_definition;
+			return NULL;
+		}
+
+		return interface_definition;
+	}
+
+
+	void CInterfaceDefinitionSerializer::write_interface_definition( const CInterfaceDefinition &interface_definition )
+	{
+		write_guid( interface_definition.m_module_guid );
+		write_guid( interface_definition.m_origin_guid );
+
+		assert( interface_definition.m_interface_info );
+		write_interface_info( *interface_definition.m_interface_info );
+
+		write_int( interface_definition.m_endpoint_definitions.size() );
+		for( endpoint_definition_list::const_iterator i = interface_definition.m_endpoint_definitions.begin(); i != interface_definition.m_endpoint_definitions.end(); i++ )
+		{
+			write_endpoint_definition( CEndpointDefinition::downcast( **i ) );
+		}
+
+		write_int( interface_definition.m_widget_definitions.size() );
+		for( widget_definition_list::const_iterator i = interface_definition.m_widget_definitions.begin(); i != interface_definition.m_widget_definitions.end(); i++ )
+		{
+			write_widget_definition( CWidgetDefinition::downcast_writable( **i ) );
+		}
+
+		const CImplementationInfo *implementation_info = interface_definition.m_implementation_info;
+		write_bool( implementation_info != NULL );
+		if( implementation_info )
+		{
+			write_string( implementation_info->m_patch_name );
+			write_int( implementation_info->m_checksum );
+		}
+	}
+
+
+	void CInterfaceDefinitionSerializer::write_interface_info( const CInterfaceInfo &interface_info )
+	{
+		write_string( interface_info.m_name );
+		write_string( interface_info.m_label );
+		write_string( interface_info.m_description );
+
+		write_int( interface_info.m_tags.size() );
+		for( string_set::const_iterator i = interface_info.m_tags.begin(); i != interface_info.m_tags.end(); i++ )
+		{
+			write_string( *i );
+		}
+
+		write_bool( interface_info.m_implemented_in_libintegra );
+		write_string( interface_info.m_author );
+		write_time( interface_info.m_created_date );
+		write_time( interface_info.m_modified_date );
+	}
+
+
+	void CInterfaceDefinitionSerializer::write_endpoint_definition( const CEndpointDefinition &endpoint_definition )
+	{
+		write_string( endpoint_definition.m_name );
+		write_string( endpoint_definition.m_label );
+		write_string( endpoint_definition.m_description );
+		write_int( endpoint_definition.m_type );
+
+		write_bool( endpoint_definition.m_control_info != NULL );
+		if( endpoint_definition.m_control_info )
+		{
+			write_control_info( *endpoint_definition.m_control_info );
+		}
+
+		write_bool( endpoint_definition.m_stream_info != NULL );
+		if( endpoint_definition.m_stream_info )
+		{
+			write_int( endpoint_definition.m_stream_info->m_type );
+			write_int( endpoint_definition.m_stream_info->m_direction );
+		}
+	}
+
+
+	void CInterfaceDefinitionSerializer::write_control_info( const CControlInfo &control_info )
+	{
+		write_int( control_info.m_type );
+		write_bool( control_info.m_can_be_source );
+		write_bool( control_info.m_can_be_target );
+		write_bool( control_info.m_is_sent_to_host );
+
+		write_bool( control_info.m_state_info != NULL );
+		if( control_info.m_state_info )
+		{
+			write_state_info( *control_info.m_state_info );
+		}
+	}
+
+
+	void CInterfaceDefinitionSerializer::write_state_info( const CStateInfo &state_info )
+	{
+		write_int( state_info.m_type );
+
+		assert( state_info.m_constraint );
+		const CConstraint &constraint = *state_info.m_constraint;
+
+		write_bool( constraint.m_value_range != NULL );
+		if( constraint.m_value_range )
+		{
+			write_value( constraint.m_value_range->m_minimum );
+			write_value( constraint.m_value_range->m_maximum );
+		}
+
+		write_bool( constraint.m_allowed_states != NULL );
+		if( constraint.m_allowed_states )
+		{
+			write_int( constraint.m_allowed_states->size() );
+			for( value_set::const_iterator i = constraint.m_allowed_states->begin(); i != constraint.m_allowed_states->end(); i++ )
+			{
+				write_value( *i );
+			}
+		}
+
+		write_value( state_info.m_default_value );
+
+		write_bool( state_info.m_value_scale != NULL );
+		if( state_info.m_value_scale )
+		{
+			write_int( state_info.m_value_scale->m_type );
+		}
+
+		write_int( state_info.m_state_labels.size() );
+		for( value_map::const_iterator i = state_info.m_state_labels.begin(); i != state_info.m_state_labels.end(); i++ )
+		{
+			write_string( i->first );
+			write_value( i->second );
+		}
+
+		write_bool( state_info.m_is_saved_to_file );
+		write_bool( state_info.m_is_input_file );
+	}
+
+
+	void CInterfaceDefinitionSerializer::write_widget_definition( const CWidgetDefinition &widget_definition )
+	{
+		write_string( widget_definition.m_type );
+		write_string( widget_definition.m_label );
+
+		assert( widget_definition.m_position );
+		write_float( widget_definition.m_position->m_x );
+		write_float( widget_definition.m_position->m_y );
+		write_float( widget_definition.m_position->m_width );
+		write_float( widget_definition.m_position->m_height );
+
+		write_int( widget_definition.m_attribute_mappings.size() );
+		for( string_map::const_iterator i = widget_definition.m_attribute_mappings.begin(); i != widget_definition.m_attribute_mappings.end(); i++ )
+		{
+			write_string( i->first );
+			write_string( i->second );
+		}
+	}
+
+
+	void CInterfaceDefinitionSerializer::write_bytes( const void *data, unsigned int size )
+	{
+		assert( m_output );
+		m_output->append( ( const char * ) data, size );
+	}
+
+
+	void CInterfaceDefinitionSerializer::write_int( int value )
+	{
+		write_bytes( &value, sizeof( int ) );
+	}
+
+
+	void CInterfaceDefinitionSerializer::write_bool( bool value )
+	{
+		unsigned char byte = value ? 1 : 0;
+		write_bytes( &byte, 1 );
+	}
+
+
+	void CInterfaceDefinitionSerializer::write_float( float value )
+	{
+		write_bytes( &value, sizeof( float ) );
+	}
+
+
+	void CInterfaceDefinitionSerializer::write_string( const string &value )
+	{
+		write_int( value.length() );
+		write_bytes( value.c_str(), value.length() );
+	}
+
+
+	void CInterfaceDefinitionSerializer::write_time( const struct tm &value )
+	{
+		write_int( value.tm_sec );
+		write_int( value.tm_min );
+		write_int( value.tm_hour );
+		write_int( value.tm_mday );
+		write_int( value.tm_mon );
+		write_int( value.tm_year );
+		write_int( value.tm_wday );
+		write_int( value.tm_yday );
+		write_int( value.tm_isdst );
+	}
+
+
+	void CInterfaceDefinitionSerializer::write_guid( const GUID &value )
+	{
+		write_bytes( &value, sizeof( GUID ) );
+	}
+
+
+	void CInterfaceDefinitionSerializer::write_value( const CValue *value )
+	{
+		if( !value )
+		{
+			write_int( null_value_code );
+			return;
+		}
+
+		write_int( value->get_type() );
+
+		switch( value->get_type() )
+		{
+			case CValue::INTEGER:
+				write_int( *value );
+				break;
+
+			case CValue::FLOAT:
+				write_float( *value );
+				break;
+
+			case CValue::STRING:
+				write_string( *value );
+				break;
+
+			default:
+				assert( false );
+				break;
+		}
+	}
+
+
+	bool CInterfaceDefinitionSerializer::read_interface_definition( CInterfaceDefinition &interface_definition )
+	{
+		if( !read_guid( interface_definition.m_module_guid ) ) return false;
+		if( !read_guid( interface_definition.m_origin_guid ) ) return false;
+
+		assert( interface_definition.m_interface_info );
+		if( !read_interface_info( *interface_definition.m_interface_info ) ) return false;
+
+		int number_of_endpoints = 0;
+		if( !read_int( number_of_endpoints ) ) return false;
+		for( int i = 0; i < number_of_endpoints; i++ )
+		{
+			CEndpointDefinition *endpoint_definition = read_endpoint_definition();
+			if( !endpoint_definition ) return false;
+
+			interface_definition.m_endpoint_definitions.push_back( endpoint_definition );
+		}
+
+		int number_of_widgets = 0;
+		if( !read_int( number_of_widgets ) ) return false;
+		for( int i = 0; i < number_of_widgets; i++ )
+		{
+			CWidgetDefinition *widget_definition = read_widget_definition();
+			if( !widget_definition ) return false;
+
+			interface_definition.m_widget_definitions.push_back( widget_definition );
+		}
+
+		bool has_implementation_info = false;
+		if( !read_bool( has_implementation_info ) ) return false;
+		if( has_implementation_info )
+		{
+			interface_definition.m_implementation_info = new CImplementationInfo;
+
+			int checksum = 0;
+			if( !read_string( interface_definition.m_implementation_info->m_patch_name ) ) return false;
+			if( !read_int( checksum ) ) return false;
+			interface_definition.m_implementation_info->m_checksum = checksum;
+		}
+
+		return true;
+	}
+
+
+	bool CInterfaceDefinitionSerializer::read_interface_info( CInterfaceInfo &interface_info )
+	{
+		if( !read_string( interface_info.m_name ) ) return false;
+		if( !read_string( interface_info.m_label ) ) return false;
+		if( !read_string( interface_info.m_description ) ) return false;
+
+		int number_of_tags = 0;
+		if( !read_int( number_of_tags ) ) return false;
+		for( int i = 0; i < number_of_tags; i++ )
+		{
+			string tag;
+			if( !read_string( tag ) ) return false;
+			interface_info.m_tags.insert( tag );
+		}
+
+		if( !read_bool( interface_info.m_implemented_in_libintegra ) ) return false;
+		if( !read_string( interface_info.m_author ) ) return false;
+		if( !read_time( interface_info.m_created_date ) ) return false;
+		if( !read_time( interface_info.m_modified_date ) ) return false;
+
+		return true;
+	}
+
+
+	CEndpointDefinition *CInterfaceDefinitionSerializer::read_endpoint_definition()
+	{
+		CEndpointDefinition *endpoint_definition = new CEndpointDefinition;
+
+		int type = 0;
+		bool has_control_info = false;
+		bool has_stream_info = false;
+
+		if( !read_string( endpoint_definition->m_name ) ) goto FAILED;
+		if( !read_string( endpoint_definition->m_label ) ) goto FAILED;
+		if( !read_string( endpoint_definition->m_description ) ) goto FAILED;
+		if( !read_int( type ) ) goto FAILED;
+		endpoint_definition->m_type = ( CEndpointDefinition::endpoint_type ) type;
+
+		if( !read_bool( has_control_info ) ) goto FAILED;
+		if( has_control_info )
+		{
+			endpoint_definition->m_control_info = read_control_info();
+			if( !endpoint_definition->m_control_info ) goto FAILED;
+		}
+
+		if( !read_bool( has_stream_info ) ) goto FAILED;
+		if( has_stream_info )
+		{
+			int stream_type = 0;
+			int stream_direction = 0;
+			if( !read_int( stream_type ) ) goto FAILED;
+			if( !read_int( stream_direction ) ) goto FAILED;
+
+			endpoint_definition->m_stream_info = new CStreamInfo;
+			endpoint_definition->m_stream_info->m_type = ( CStreamInfo::stream_type ) stream_type;
+			endpoint_definition->m_stream_info->m_direction = ( CStreamInfo::stream_direction ) stream_direction;
+		}
+
+		return endpoint_definition;
+
+	FAILED:
+
+		delete endpoint_definition;
+		return NULL;
+	}
+
+
+	CControlInfo *CInterfaceDefinitionSerializer::read_control_info()
+	{
+		CControlInfo *control_info = new CControlInfo;
+
+		int type = 0;
+		bool has_state_info = false;
+
+		if( !read_int( type ) ) goto FAILED;
+		control_info->m_type = ( CControlInfo::control_type ) type;
+
+		if( !read_bool( control_info->m_can_be_source ) ) goto FAILED;
+		if( !read_bool( control_info->m_can_be_target ) ) goto FAILED;
+		if( !read_bool( control_info->m_is_sent_to_host ) ) goto FAILED;
+
+		if( !read_bool( has_state_info ) ) goto FAILED;
+		if( has_state_info )
+		{
+			control_info->m_state_info = read_state_info();
+			if( !control_info->m_state_info ) goto FAILED;
+		}
+
+		return control_info;
+
+	FAILED:
+
+		delete control_info;
+		return NULL;
+	}
+
+
+	CStateInfo *CInterfaceDefinitionSerializer::read_state_info()
+	{
+		CStateInfo *state_info = new CStateInfo;
+		CConstraint &constraint = *state_info->m_constraint;
+
+		int type = 0;
+		bool has_value_range = false;
+		bool has_allowed_states = false;
+		bool has_value_scale = false;
+		bool ok = true;
+		int number_of_state_labels = 0;
+
+		if( !read_int( type ) ) goto FAILED;
+		state_info->m_type = ( CValue::type ) type;
+
+		if( !read_bool( has_value_range ) ) goto FAILED;
+		if( has_value_range )
+		{
+			constraint.m_value_range = new CValueRange;
+			constraint.m_value_range->m_minimum = read_value( ok );
+			if( !ok ) goto FAILED;
+			constraint.m_value_range->m_maximum = read_value( ok );
+			if( !ok ) goto FAILED;
+		}
+
+		if( !read_bool( has_allowed_states ) ) goto FAILED;
+		if( has_allowed_states )
+		{
+			constraint.m_allowed_states = new value_set;
+
+			int number_of_allowed_states = 0;
+			if( !read_int( number_of_allowed_states ) ) goto FAILED;
+			for( int i = 0; i < number_of_allowed_states; i++ )
+			{
+				CValue *allowed_state = read_value( ok );
+				if( !ok || !allowed_state ) goto FAILED;
+				constraint.m_allowed_states->insert( allowed_state );
+			}
+		}
+
+		state_info->m_default_value = read_value( ok );
+		if( !ok ) goto FAILED;
+
+		if( !read_bool( has_value_scale ) ) goto FAILED;
+		if( has_value_scale )
+		{
+			int scale_type = 0;
+			if( !read_int( scale_type ) ) goto FAILED;
+
+			state_info->m_value_scale = new CValueScale;
+			state_info->m_value_scale->m_type = ( CValueScale::scale_type ) scale_type;
+		}
+
+		if( !read_int( number_of_state_labels ) ) goto FAILED;
+		for( int i = 0; i < number_of_state_labels; i++ )
+		{
+			string label;
+			if( !read_string( label ) ) goto FAILED;
+
+			CValue *value = read_value( ok );
+			if( !ok || !value ) goto FAILED;
+
+			if( state_info->m_state_labels.count( label ) > 0 )
+			{
+				delete value;
+				goto FAILED;
+			}
+
+			state_info->m_state_labels[ label ] = value;
+		}
+
+		if( !read_bool( state_info->m_is_saved_to_file ) ) goto FAILED;
+		if( !read_bool( state_info->m_is_input_file ) ) goto FAILED;
+
+		return state_info;
+
+	FAILED:
+
+		delete state_info;
+		return NULL;
+	}
+
+
+	CWidgetDefinition *CInterfaceDefinitionSerializer::read_widget_definition()
+	{
+		CWidgetDefinition *widget_definition = new CWidgetDefinition;
+		CWidgetPosition &position = *widget_definition->m_position;
+
+		int number_of_attribute_mappings = 0;
+
+		if( !read_string( widget_definition->m_type ) ) goto FAILED;
+		if( !read_string( widget_definition->m_label ) ) goto FAILED;
+
+		if( !read_float( position.m_x ) ) goto FAILED;
+		if( !read_float( position.m_y ) ) goto FAILED;
+		if( !read_float( position.m_width ) ) goto FAILED;
+		if( !read_float( position.m_height ) ) goto FAILED;
+
+		if( !read_int( number_of_attribute_mappings ) ) goto FAILED;
+		for( int i = 0; i < number_of_attribute_mappings; i++ )
+		{
+			string key, value;
+			if( !read_string( key ) ) goto FAILED;
+			if( !read_string( value ) ) goto FAILED;
+
+			widget_definition->m_attribute_mappings[ key ] = value;
+		}
+
+		return widget_definition;
+
+	FAILED:
+
+		delete widget_definition;
+		return NULL;
+	}
+
+
+	bool CInterfaceDefinitionSerializer::read_bytes( void *data, unsigned int size )
+	{
+		if( size > ( unsigned int ) ( m_read_end - m_read_position ) )
+		{
+			return false;
+		}
+
+		memcpy( data, m_read_position, size );
+		m_read_position += size;
+		return true;
+	}
+
+
+	bool CInterfaceDefinitionSerializer::read_int( int &value )
+	{
+		return read_bytes( &value, sizeof( int ) );
+	}
+
+
+	bool CInterfaceDefinitionSerializer::read_bool( bool &value )
+	{
+		unsigned char byte = 0;
+		if( !read_bytes( &byte, 1 ) ) return false;
+
+		value = ( byte != 0 );
+		return true;
+	}
+
+
+	bool CInterfaceDefinitionSerializer::read_float( float &value )
+	{
+		return read_bytes( &value, sizeof( float ) );
+	}
+
+
+	bool CInterfaceDefinitionSerializer::read_string( string &value )
+	{
+		int length = 0;
+		if( !read_int( length ) ) return false;
+
+		if( length < 0 || length > m_read_end - m_read_position )
+		{
+			return false;
+		}
+
+		value.assign( ( const char * ) m_read_position, length );
+		m_read_position += length;
+		return true;
+	}
+
+
+	bool CInterfaceDefinitionSerializer::read_time( struct tm &value )
+	{
+		memset( &value, 0, sizeof( struct tm ) );
+
+		if( !read_int( value.tm_sec ) ) return false;
+		if( !read_int( value.tm_min ) ) return false;
+		if( !read_int( value.tm_hour ) ) return false;
+		if( !read_int( value.tm_mday ) ) return false;
+		if( !read_int( value.tm_mon ) ) return false;
+		if( !read_int( value.tm_year ) ) return false;
+		if( !read_int( value.tm_wday ) ) return false;
+		if( !read_int( value.tm_yday ) ) return false;
+		if( !read_int( value.tm_isdst ) ) return false;
+
+		return true;
+	}
+
+
+	bool CInterfaceDefinitionSerializer::read_guid( GUID &value )
+	{
+		return read_bytes( &value, sizeof( GUID ) );
+	}
+
+
+	CValue *CInterfaceDefinitionSerializer::read_value( bool &ok )
+	{
+		ok = false;
+
+		int type = 0;
+		if( !read_int( type ) ) return NULL;
+
+		switch( type )
+		{
+			case null_value_code:
+				ok = true;
+				return NULL;
+
+			case CValue::INTEGER:
+				{
+					int value = 0;
+					if( !read_int( value ) ) return NULL;
+					ok = true;
+					return new CIntegerValue( value );
+				}
+
+			case CValue::FLOAT:
+				{
+					float value = 0;
+					if( !read_float( value ) ) return NULL;
+					ok = true;
+					return new CFloatValue( value );
+				}
+
+			case CValue::STRING:
+				{
+					string value;
+					if( !read_string( value ) ) return NULL;
+					ok = true;
+					return new CStringValue( value );
+				}
+
+			default:
+				return NULL;
+		}
+	}
+}
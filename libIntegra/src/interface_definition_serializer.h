@@ -0,0 +1,101 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+
+#ifndef INTEGRA_INTERFACE_DEFINITION_SERIALIZER_PRIVATE_H
+#define INTEGRA_INTERFACE_DEFINITION_SERIALIZER_PRIVATE_H
+
+
+#include "api/common_typedefs.h"
+#include "api/value.h"
+#include "interface_definition.h"
+
+
+namespace integra_internal
+{
+	/*
+	 CInterfaceDefinitionSerializer converts a loaded CInterfaceDefinition to and from a compact
+	 binary form, so that the module cache can restore interface definitions without unzipping
+	 and parsing their xml.
+
+	 The binary form is only meaningful to the build which wrote it - it stores values in native 
+	 byte order, and is tagged with format_version so that stale data is rejected.
+	 Module source and file path aren't stored, as they depend on where the module was loaded from.
+	*/
+
+	class CInterfaceDefinitionSerializer
+	{
+		public:
+
+			static void serialize( const CInterfaceDefinition &interface_definition, string &output );
+
+			/* returns NULL if the buffer is malformed or was written by a different format version */
+			static CInterfaceDefinition *deserialize( const unsigned char *buffer, unsigned int buffer_size );
+
+			static const unsigned int format_version;
+
+		private:
+
+			CInterfaceDefinitionSerializer( string *output, const unsigned char *buffer, unsigned int buffer_size );
+
+			void write_interface_definition( const CInterfaceDefinition &interface_definition );
+			void write_interface_info( const CInterfaceInfo &interface_info );
+			void write_endpoint_definition( const CEndpointDefinition &endpoint_definition );
+			void write_control_info( const CControlInfo &control_info );
+			void write_state_info( const CStateInfo &state_info );
+			void write_widget_definition( const CWidgetDefinition &widget_definition );
+
+			void write_bytes( const void *data, unsigned int size );
+			void write_int( int value );
+			void write_bool( bool value );
+			void write_float( float value );
+			void write_string( const string &value );
+			void write_time( const struct tm &value );
+			void write_guid( const GUID &value );
+			void write_value( const CValue *value );
+
+			bool read_interface_definition( CInterfaceDefinition &interface_definition );
+			bool read_interface_info( CInterfaceInfo &interface_info );
+			CEndpointDefinition *read_endpoint_definition();
+			CControlInfo *read_control_info();
+			CStateInfo *read_state_info();
+			CWidgetDefinition *read_widget_definition();
+
+			bool read_bytes( void *data, unsigned int size );
+			bool read_int( int &value );
+			bool read_bool( bool &value );
+			bool read_float( float &value );
+			bool read_string( string &value );
+			bool read_time( struct tm &value );
+			bool read_guid( GUID &value );
+
+			/* read_value returns NULL if the stored value was null, and sets ok to false on error */
+			CValue *read_value( bool &ok );
+
+			string *m_output;
+
+			const unsigned char *m_read_position;
+			const unsigned char *m_read_end;
+	};
+}
+
+
+#endif
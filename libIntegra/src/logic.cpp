@@ -236,7 +236,7 @@ namespace integra_internal
 				break;
 
 			default:
-				handle_connections( server, m_node, node_endpoint );
+				handle_connections( server, node_endpoint );
 		}
 	}
 
@@ -457,108 +457,102 @@ namespace integra_internal
 	}
 
 
-	void CLogic::handle_connections( CServer &server, const CNode &search_node, const CNodeEndpoint &changed_endpoint )
+	void CLogic::handle_connections( CServer &server, const CNodeEndpoint &changed_endpoint )
 	{
-		const CNode *parent = CNode::downcast( search_node.get_parent() );
+		const connection_list *connections_from_endpoint = server.get_connection_routing_table().lookup( changed_endpoint.get_path() );
+		if( !connections_from_endpoint )
+		{
+			return;
+		}
 
-		/* recurse up the tree first, so that higher-level connections are evaluated first */
-		if( parent ) 
+		if( changed_endpoint.get_endpoint_definition().get_type() != CEndpointDefinition::CONTROL || !changed_endpoint.get_endpoint_definition().get_control_info()->get_can_be_source() )
 		{
-			handle_connections( server, *parent, changed_endpoint );
+			INTEGRA_TRACE_ERROR << "aborting handling of connection from endpoint which cannot be a connection source";
+			return;
 		}
 
-		/* build endpoint path relative to search_node */
-		string relative_endpoint_path = changed_endpoint.get_path().get_string();
-		if( parent )
+		/* 
+		 copy the connection ids, since handling a connection can modify the routing table, 
+		 or even delete subsequent connections 
+		*/
+		std::vector<internal_id> connection_ids;
+		for( connection_list::const_iterator i = connections_from_endpoint->begin(); i != connections_from_endpoint->end(); i++ )
 		{
-			relative_endpoint_path = relative_endpoint_path.substr( parent->get_path().get_string().length() + 1 );
+			connection_ids.push_back( ( *i )->get_id() );
 		}
 
-		/* search amongst sibling nodes */
-		const node_map &siblings = server.get_siblings( search_node );
-		for( node_map::const_iterator i = siblings.begin(); i != siblings.end(); i++ )
+		for( std::vector<internal_id>::const_iterator i = connection_ids.begin(); i != connection_ids.end(); i++ )
 		{
-			const CNode *sibling = CNode::downcast( i->second );
-			if( !CGuidHelper::guids_are_equal(sibling->get_interface_definition().get_module_guid(), get_connection_interface_guid( server ) ) )
+			const CNode *connection = server.find_node( *i );
+			if( !connection )
 			{
-				/* not a connection */
+				/* connection was deleted whilst handling a previous connection */
 				continue;
 			}
 
-			if( !sibling->get_logic().node_is_active() )
+			if( !connection->get_logic().node_is_active() )
 			{
 				/* connection is not active */
 				continue;
 			}
 
-			const INodeEndpoint *source_endpoint = sibling->get_node_endpoint( endpoint_source_path );
-			assert( source_endpoint );
+			const CNode *parent = CNode::downcast( connection->get_parent() );
+
+			/* found a connection! */
+			const INodeEndpoint *target_endpoint = connection->get_node_endpoint( endpoint_target_path );
+			assert( target_endpoint );
+
+			const INodeEndpoint *destination_endpoint = server.find_node_endpoint( CPath( *target_endpoint->get_value() ), parent );
 
-			const string &source_endpoint_value = *source_endpoint->get_value();
-			if( source_endpoint_value == relative_endpoint_path )
+			if( destination_endpoint )
 			{
-				if( changed_endpoint.get_endpoint_definition().get_type() != CEndpointDefinition::CONTROL || !changed_endpoint.get_endpoint_definition().get_control_info()->get_can_be_source() )
+				/* found a destination! */
+
+				if( destination_endpoint->get_endpoint_definition().get_type() != CEndpointDefinition::CONTROL || !destination_endpoint->get_endpoint_definition().get_control_info()->get_can_be_target() )
 				{
-					INTEGRA_TRACE_ERROR << "aborting handling of connection from endpoint which cannot be a connection source";
+					INTEGRA_TRACE_ERROR << "aborting handling of connection to endpoint which cannot be a connection target";
 					continue;
 				}
 
-				/* found a connection! */
-				const INodeEndpoint *target_endpoint = sibling->get_node_endpoint( endpoint_target_path );
-				assert( target_endpoint );
-
-				const INodeEndpoint *destination_endpoint = server.find_node_endpoint( CPath( *target_endpoint->get_value() ), parent );
-
-				if( destination_endpoint )
+				CValue *converted_value;
+				if( destination_endpoint->get_endpoint_definition().get_control_info()->get_type() == CControlInfo::STATEFUL )
 				{
-					/* found a destination! */
-
-					if( destination_endpoint->get_endpoint_definition().get_type() != CEndpointDefinition::CONTROL || !destination_endpoint->get_endpoint_definition().get_control_info()->get_can_be_target() )
+					if( changed_endpoint.get_value() )
 					{
-						INTEGRA_TRACE_ERROR << "aborting handling of connection to endpoint which cannot be a connection target";
-						continue;
-					}
+						converted_value = changed_endpoint.get_value()->transmogrify( destination_endpoint->get_value()->get_type() );
 
-					CValue *converted_value;
-					if( destination_endpoint->get_endpoint_definition().get_control_info()->get_type() == CControlInfo::STATEFUL )
-					{
-						if( changed_endpoint.get_value() )
-						{
-							converted_value = changed_endpoint.get_value()->transmogrify( destination_endpoint->get_value()->get_type() );
-
-							const value_set *allowed_states = destination_endpoint->get_endpoint_definition().get_control_info()->get_state_info()->get_constraint().get_allowed_states();
-							if( allowed_states )
-							{
-								/* if destination has set of allowed states, quantize to nearest allowed state */
-								quantize_to_allowed_states( *converted_value, *allowed_states );
-							}
-						}
-						else
+						const value_set *allowed_states = destination_endpoint->get_endpoint_definition().get_control_info()->get_state_info()->get_constraint().get_allowed_states();
+						if( allowed_states )
 						{
-							/* if source is a bang, reset target to it's current value */
-							converted_value = destination_endpoint->get_value()->clone();
+							/* if destination has set of allowed states, quantize to nearest allowed state */
+							quantize_to_allowed_states( *converted_value, *allowed_states );
 						}
 					}
 					else
 					{
-						assert( destination_endpoint->get_endpoint_definition().get_control_info()->get_type() == CControlInfo::BANG );
-						converted_value = NULL;
+						/* if source is a bang, reset target to it's current value */
+						converted_value = destination_endpoint->get_value()->clone();
 					}
+				}
+				else
+				{
+					assert( destination_endpoint->get_endpoint_definition().get_control_info()->get_type() == CControlInfo::BANG );
+					converted_value = NULL;
+				}
 
-					ISetCommand *command;
+				ISetCommand *command;
 
-					if( converted_value )
-					{
-						command = ISetCommand::create( destination_endpoint->get_path(), *converted_value );
-						delete converted_value;
-					}
-					else
-					{
-						command = ISetCommand::create( destination_endpoint->get_path() );
-					}
-
-					server.process_command( command, CCommandSource::CONNECTION );
+				if( converted_value )
+				{
+					command = ISetCommand::create( destination_endpoint->get_handle(), *converted_value );
+					delete converted_value;
+				}
+				else
+				{
+					command = ISetCommand::create( destination_endpoint->get_handle() );
 				}
+
+				server.process_command( command, CCommandSource::CONNECTION );
 			}
 		}
 	}
@@ -92,7 +92,7 @@ namespace integra_internal
 			void non_container_active_initializer( CServer &server );
 			void data_directory_handler( CServer &server, const CNodeEndpoint &node_endpoint, const CValue *previous_value, CCommandSource source );
 			void handle_input_file( CServer &server, const CNodeEndpoint &input_file );
-			void handle_connections( CServer &server, const CNode &search_node, const CNodeEndpoint &changed_endpoint );
+			void handle_connections( CServer &server, const CNodeEndpoint &changed_endpoint );
 
 			void quantize_to_allowed_states( CValue &value, const value_set &allowed_states ) const;
 
@@ -49,6 +49,105 @@ namespace integra_internal
 	const unsigned int CLuaEngine::get_color = 0xc08000;
 	const unsigned int CLuaEngine::print_color = 0x6060ff;
 	const string CLuaEngine::self_key = "integra_internal::CLuaEngine";
+
+	const char *CLuaEngine::init_script = 
+
+		/*
+		Minimal MIDI to frequency conversion with argument checking
+		usage: mtof(midi-value)
+		*/
+		"function mtof(value)\n"
+		"	local input = value>0 and value or 0\n"
+		"	input = input<128 and input or 128\n"
+		"	local freq = 440 * (2^((input - 69) / 12 ))\n"
+		"	return freq\n"
+		"end\n"
+
+		/*
+		Minimal frequency to MIDI conversion with argument checking 
+		usage: lua_ftom(frequency-in-hertz)
+		*/
+		"function ftom(freq)\n"
+		"	local input = freq>0 and freq or 0\n"
+		"	return 69 + math.log(freq/440) * 17.31234\n"
+		"end\n"
+
+		/*
+		Node bindings.  Each node is represented by a proxy table holding its path elements 
+		relative to the script's parent.  Proxies are created the first time a node is referred 
+		to in each run, and their endpoints are read and written via integra.get / integra.set
+		*/
+		"local get, set, is_node = integra.get, integra.set, integra.is_node\n"
+		"local unpack = table.unpack\n"
+		"local elements_key = {}\n"
+		"local node_metatable = {}\n"
+		"local top_level_nodes = {}\n"
+
+		"local function node_proxy( elements )\n"
+		"	return setmetatable( { [ elements_key ] = elements }, node_metatable )\n"
+		"end\n"
+
+		"local function child_elements( proxy, name )\n"
+		"	local elements = { unpack( rawget( proxy, elements_key ) ) }\n"
+		"	elements[ #elements + 1 ] = name\n"
+		"	return elements\n"
+		"end\n"
+
+		"node_metatable.__index = function( proxy, name )\n"
+		"	local elements = child_elements( proxy, name )\n"
+		"	if is_node( unpack( elements ) ) then\n"
+		"		local child = node_proxy( elements )\n"
+		"		rawset( proxy, name, child )\n"
+		"		return child\n"
+		"	end\n"
+		"	return get( unpack( elements ) )\n"
+		"end\n"
+
+		"node_metatable.__newindex = function( proxy, name, value )\n"
+		"	local elements = child_elements( proxy, name )\n"
+		"	local number_of_elements = #elements\n"
+		"	elements[ number_of_elements + 1 ] = value\n"
+		"	set( unpack( elements, 1, number_of_elements + 1 ) )\n"
+		"end\n"
+
+		"setmetatable( _G, {\n"
+		"	__index = function( _, name )\n"
+		"		local node = top_level_nodes[ name ]\n"
+		"		if node then return node end\n"
+		"		if is_node( name ) then\n"
+		"			node = node_proxy( { name } )\n"
+		"			top_level_nodes[ name ] = node\n"
+		"			return node\n"
+		"		end\n"
+		"		return get( name )\n"
+		"	end,\n"
+		"	__newindex = function( _, name, value )\n"
+		"		set( name, value )\n"
+		"	end\n"
+		"} )\n"
+
+		/* returns a function to forget the previous run's proxies, as the node tree may have changed */
+		"return function()\n"
+		"	top_level_nodes = {}\n"
+		"end\n";
+
+
+	CLuaScriptState::CLuaScriptState()
+	{
+		m_state = NULL;
+		m_chunk_reference = LUA_NOREF;
+		m_begin_run_reference = LUA_NOREF;
+	}
+
+
+	CLuaScriptState::~CLuaScriptState()
+	{
+		if( m_state )
+		{
+			lua_close( m_state );
+		}
+	}
+
     
 	CLuaEngine::CLuaEngine()
 	{
@@ -60,13 +159,36 @@ namespace integra_internal
 	}
 
 
-	string CLuaEngine::run_script( CServer &server, const CPath &parent_path, const string &script_string )
+	CLuaScriptState *CLuaEngine::create_script_state( const string &script_string )
 	{
-		m_server = &server;
+		CLuaScriptState *script_state = new CLuaScriptState;
+		script_state->m_script = script_string;
+
+		if( !create_state( *script_state ) )
+		{
+			script_state->m_compile_error = "Error creating Lua State";
+			return script_state;
+		}
+
+		lua_State *state = script_state->m_state;
+
+		if( luaL_loadstring( state, script_string.c_str() ) == LUA_OK )
+		{
+			script_state->m_chunk_reference = luaL_ref( state, LUA_REGISTRYINDEX );
+		}
+		else
+		{
+			script_state->m_compile_error = lua_tostring( state, -1 );
+			lua_pop( state, 1 );
+		}
+
+		return script_state;
+	}
+
 
-		/* initialize the state */
-		lua_State *state = create_state( server, parent_path );
-		if( !state ) return "Error creating Lua State";
+	string CLuaEngine::run_script( CServer &server, const CPath &parent_path, CLuaScriptState &script_state )
+	{
+		m_server = &server;
 
 		/* set the context */
 		time_t raw_time_stamp;
@@ -87,9 +209,30 @@ namespace integra_internal
 		m_context_stack.push_back( context );
 
 		/* execute the script */
-		if( luaL_dostring( state, script_string.c_str() ) )
+		if( script_state.m_chunk_reference == LUA_NOREF )
 		{
-			error_handler( lua_tostring( state, -1 ) );
+			error_handler( "%s", script_state.m_compile_error.c_str() );
+		}
+		else
+		{
+			lua_State *state = script_state.m_state;
+
+			/* forget node bindings from previous runs */
+			lua_rawgeti( state, LUA_REGISTRYINDEX, script_state.m_begin_run_reference );
+			if( lua_pcall( state, 0, 0, 0 ) != LUA_OK )
+			{
+				error_handler( "%s", lua_tostring( state, -1 ) );
+			}
+			else
+			{
+				lua_rawgeti( state, LUA_REGISTRYINDEX, script_state.m_chunk_reference );
+				if( lua_pcall( state, 0, 0, 0 ) != LUA_OK )
+				{
+					error_handler( "%s", lua_tostring( state, -1 ) );
+				}
+			}
+
+			lua_settop( state, 0 );
 		}
 
 		context->m_output += "\n\n_done_";
@@ -103,9 +246,6 @@ namespace integra_internal
 		delete context;
 		m_context_stack.pop_back();
 
-		/* free the state */
-		lua_close( state );
-
 		return output;
 	}
 
@@ -287,6 +427,31 @@ namespace integra_internal
 
 
 
+	int CLuaEngine::handle_is_node( lua_State *state )
+	{
+		assert( !m_context_stack.empty() );
+		const CLuaContext *context = m_context_stack.back();
+
+		int num_arguments = lua_gettop( state ) - 1;
+
+		CPath path( *context->m_parent_path );
+		for( int i = 1; i <= num_arguments; i++ ) 
+		{
+			if( !lua_isstring( state, i ) )
+			{
+				/* can't be a node name */
+				lua_pushboolean( state, 0 );
+				return 1;
+			}
+
+			path.append_element( lua_tostring( state, i ) );
+		}
+
+		lua_pushboolean( state, m_server->find_node( path ) ? 1 : 0 );
+		return 1;
+	}
+
+
 	int CLuaEngine::handle_print( lua_State *state )
 	{
 		int num_arguments = 0;
@@ -345,38 +510,40 @@ namespace integra_internal
 	}
 
 
-	lua_State *CLuaEngine::create_state( const CServer &server, const CPath &parent_path )
+	bool CLuaEngine::create_state( CLuaScriptState &script_state )
 	{
 		const luaL_Reg function_registration[] = 
 		{
 			{ "set", set_callback },
 			{ "get", get_callback },
 			{ "print", print_callback },
+			{ "is_node", is_node_callback },
 			{ NULL, NULL }
 		};
 
 		lua_State *state = luaL_newstate();
+		if( !state ) return false;
 
-		/* store pointer to self */
+		script_state.m_state = state;
 
-		/* store a number */
+		/* store pointer to self */
 		lua_pushstring( state, self_key.c_str() );  
 		lua_pushlightuserdata( state, ( void * ) this );
 	    lua_settable( state, LUA_REGISTRYINDEX );
 
-	
-		string init_script = build_init_script( server, parent_path );
-		if( init_script.empty() ) return NULL;
-
 		luaL_openlibs( state );
 		luaL_register( state, "integra", function_registration );
+		lua_pop( state, 1 );
 
-		if( luaL_dostring( state, init_script.c_str() ) )
+		if( luaL_loadstring( state, init_script ) != LUA_OK || lua_pcall( state, 0, 1, 0 ) != LUA_OK )
 		{
 			INTEGRA_TRACE_ERROR << "Failed to initialize lua state: " << lua_tostring( state, -1 );
+			return false;
 		}
 
-		return state;
+		script_state.m_begin_run_reference = luaL_ref( state, LUA_REGISTRYINDEX );
+
+		return true;
 	}
 
 
@@ -439,172 +606,6 @@ namespace integra_internal
 	}
 
 
-	string CLuaEngine::build_init_script( const CServer &server, const CPath &parent_path )
-	{
-		const char *helper_functions[] = 
-		{
-			/*
-			Minimal MIDI to frequency conversion with argument checking
-			usage: mtof(midi-value)
-			*/
-			"function mtof(value)"
-			"   local input = value>0 and value or 0"
-			"   input = input<128 and input or 128"
-			"   local freq = 440 * (2^((input - 69) / 12 ))"
-			"   return freq"
-			"	end",
-
-			/*
-			Minimal frequency to MIDI conversion with argument checking 
-			usage: lua_ftom(frequency-in-hertz)
-			*/
-			"function ftom(freq)"
-			"  local  input = freq>0 and freq or 0"
-			"   return 69 + math.log(freq/440) * 17.31234"
-			"	end",
-
-			/* end of helper functions */
-			"\0"
-		};
-
-		const char *global_metatable = 
-			"setmetatable(_G,\n"
-			"{\n"
-			"	__index = function( _, attribute )\n"
-			"		return integra.get( attribute )\n"
-			"	end,\n"
-			"	__newindex = function( _, attribute, value )\n"
-			"		integra.set( attribute, value )\n"
-			"	end\n"
-			"})\n";
-
-		string init_script;
-	
-		for( int i = 0; *helper_functions[ i ] != 0; i++ )
-		{
-			init_script += helper_functions[ i ];
-			init_script += "\n";
-		}
-
-		const INode *parent_node = server.find_node( parent_path );
-		const node_map &child_nodes = parent_node ? parent_node->get_children() : m_server->get_nodes();
-	
-		declare_child_objects( init_script, child_nodes, parent_path );
-		declare_child_metatables( init_script, child_nodes, parent_path );
-		init_script += global_metatable;
-
-		return init_script;
-	}
-
-
-	void CLuaEngine::declare_child_objects( string &init_script, const node_map &children, const CPath &parent_path ) const
-	{
-		const string &child_initializer = "={}\n";
-
-		for( node_map::const_iterator i = children.begin(); i != children.end(); i++ )
-		{
-			//declare child object
-			const INode *child = i->second;
-			string child_declaration = get_lua_object_name( child->get_path(), parent_path );
-
-			child_declaration += child_initializer;
-
-			init_script += child_declaration;
-
-			declare_child_objects( init_script, child->get_children(), parent_path );
-		}
-	}
-
-
-	string CLuaEngine::get_child_metatable( const INode &node, const CPath &parent_path ) const
-	{
-		const char *metatable_template = 
-			"setmetatable(%s,\n"
-			"{\n"
-			"	__index=function(_,attribute)\n"
-			"		return integra.get(%sattribute )\n"
-			"	end,\n"
-			"	__newindex = function( _, attribute, value )\n"
-			"		integra.set( %sattribute, value )\n"
-			"	end\n"
-			"})\n";
-
-		const CPath &node_path = node.get_path();
-		assert( parent_path.get_number_of_elements() < node_path.get_number_of_elements() );
-
-		string object_name = get_lua_object_name( node_path, parent_path );
-		string parameter_string = get_lua_parameter_string( node_path, parent_path );
-
-		char *metatable = new char[ strlen( metatable_template ) + object_name.length() + parameter_string.length() * 2 + 1 ];
-		sprintf( metatable, metatable_template, object_name.c_str(), parameter_string.c_str(), parameter_string.c_str() );
-
-		string result( metatable );
-		delete metatable;
-		return result;
-	}
-
-
-	void CLuaEngine::declare_child_metatables( string &init_script, const node_map &children, const CPath &parent_path ) const
-	{
-		for( node_map::const_iterator i = children.begin(); i != children.end(); i++ )
-		{
-			const INode *child = i->second;
-
-			string child_metatable = get_child_metatable( *child, parent_path );
-
-			init_script += child_metatable;
-
-			declare_child_metatables( init_script, child->get_children(), parent_path );
-		}
-	}
-
-
-	string CLuaEngine::get_lua_object_name( const CPath &child_path, const CPath &parent_path ) const
-	{
-		int child_elements = child_path.get_number_of_elements();
-		int parent_elements = parent_path.get_number_of_elements();
-
-		assert( child_elements > parent_elements );
-
-		string object_name;
-
-		for( int i = parent_elements; i < child_elements; i++ )
-		{
-			const string &path_element = child_path[ i ];
-			if( object_name.empty() )
-			{
-				object_name = path_element;
-			}
-			else
-			{
-				object_name += ( "[\"" + path_element + "\"]" );
-			}
-		}
-	
-		return object_name;
-	}
-
-
-	string CLuaEngine::get_lua_parameter_string( const CPath &child_path, const CPath &parent_path ) const
-	{
-		int child_elements = child_path.get_number_of_elements();
-		int parent_elements = parent_path.get_number_of_elements();
-
-		assert( child_elements > parent_elements );
-
-		string parameter_string;
-
-		for( int i = parent_elements; i < child_elements; i++ )
-		{
-			const string &path_element = child_path[ i ];
-
-			parameter_string += ( "\"" + path_element + "\", " );
-		}
-	
-		return parameter_string;
-	}
-
-
 	CLuaEngine *CLuaEngine::from_lua_state( lua_State *state )
 	{
 		lua_pushstring( state, self_key.c_str() );  
@@ -633,4 +634,10 @@ namespace integra_internal
 	}
 
 
+	static int is_node_callback( lua_State *state )
+	{
+		return CLuaEngine::from_lua_state( state )->handle_is_node( state );
+	}
+
+
 }
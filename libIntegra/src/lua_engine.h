@@ -45,42 +45,76 @@ namespace integra_internal
 	static int set_callback( lua_State *state );
     static int get_callback( lua_State *state );
     static int print_callback( lua_State *state );
-    
+    static int is_node_callback( lua_State *state );
+
+
+	/*
+	 CLuaScriptState is a lua state holding a precompiled script, so that a script can be run 
+	 repeatedly without recreating the state or recompiling the script.
+
+	 Nodes are bound to lua objects lazily, relative to the path passed to each run_script call, 
+	 so the state remains valid when nodes are added, removed, renamed or moved.  It only needs 
+	 to be recreated when the script text changes.
+	*/
+
+	class CLuaScriptState
+	{
+		public:
+
+			~CLuaScriptState();
+
+			const string &get_script() const { return m_script; }
+
+		private:
+
+			friend class CLuaEngine;
+
+			CLuaScriptState();
+
+			lua_State *m_state;
+			string m_script;
+
+			/* LUA_NOREF if the script failed to compile */
+			int m_chunk_reference;
+			string m_compile_error;
+
+			/* registry reference to the function which resets bindings between runs */
+			int m_begin_run_reference;
+	};
+
+
 	class CLuaEngine
 	{
 		public:
 			CLuaEngine();
 			~CLuaEngine();
 
-			string run_script( CServer &server, const CPath &parent_path, const string &script_string );
+			CLuaScriptState *create_script_state( const string &script_string );
+
+			string run_script( CServer &server, const CPath &parent_path, CLuaScriptState &script_state );
 
 		private:
 
             friend int set_callback( lua_State *state );
             friend int get_callback( lua_State *state );
             friend int print_callback( lua_State *state );
+            friend int is_node_callback( lua_State *state );
 
 			int handle_set( lua_State *state );
 			int handle_get( lua_State *state );
 			int handle_print( lua_State *state );
+			int handle_is_node( lua_State *state );
 
 			const char *get_string( lua_State *state, int argnum );
 			float get_float( lua_State *state, int argnum );
 
 			static CLuaEngine *from_lua_state( lua_State *state );
 
-			lua_State *create_state( const CServer &server, const CPath &parent_path );
-			string build_init_script( const CServer &server, const CPath &parent_path );
+			bool create_state( CLuaScriptState &script_state );
 
 			void error_handler( const char *fmt, ... );
 			void output_handler( unsigned int color, const char *fmt, ... );
 
-			void declare_child_objects( string &init_script, const node_map &children, const CPath &parent_path ) const;
-			string get_child_metatable( const INode &node, const CPath &parent_path ) const;
-			void declare_child_metatables( string &init_script, const node_map &children, const CPath &parent_path ) const;
-			string get_lua_object_name( const CPath &child_path, const CPath &parent_path ) const;
-			string get_lua_parameter_string( const CPath &child_path, const CPath &parent_path ) const;
-
 			class CLuaContext
 			{
 				public:
@@ -100,6 +134,8 @@ namespace integra_internal
 			static const unsigned int print_color;
 
 			static const string self_key;
+
+			static const char *init_script;
 	};
 }
 
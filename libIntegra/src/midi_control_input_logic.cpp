@@ -22,6 +22,8 @@
 #include "platform_specifics.h"
 
 #include "midi_control_input_logic.h"
+#include "node_endpoint.h"
+#include "interface_definition.h"
 #include "api/command.h"
 #include "server.h"
 
@@ -46,6 +48,8 @@ namespace integra_internal
 	CMidiControlInputLogic::CMidiControlInputLogic( const CNode &node )
 		:	CLogic( node )
 	{
+		m_is_auto_learning = false;
+		m_has_route = false;
 	}
 
 
@@ -58,7 +62,30 @@ namespace integra_internal
 	{
 		CLogic::handle_new( server, source );
 
-		server.get_midi_input_dispatcher().register_input_receiver( this );
+		update_input_route( server );
+	}
+
+
+	void CMidiControlInputLogic::handle_set( CServer &server, const CNodeEndpoint &node_endpoint, const CValue *previous_value, CCommandSource source )
+	{
+		CLogic::handle_set( server, node_endpoint, previous_value, source );
+
+		if( source == CCommandSource::INITIALIZATION )
+		{
+			/* handle_new registers the initial mapping */
+			return;
+		}
+
+		const string &endpoint_name = node_endpoint.get_endpoint_definition().get_name();
+
+		if( endpoint_name == endpoint_device || 
+			endpoint_name == endpoint_channel || 
+			endpoint_name == endpoint_message_type || 
+			endpoint_name == endpoint_note_or_controller ||
+			endpoint_name == endpoint_auto_learn )
+		{
+			update_input_route( server );
+		}
 	}
 
 
@@ -66,7 +93,94 @@ namespace integra_internal
 	{
 		CLogic::handle_delete( server, source );
 
-		server.get_midi_input_dispatcher().unregister_input_receiver( this );
+		CMidiInputDispatcher &dispatcher = server.get_midi_input_dispatcher();
+
+		if( m_is_auto_learning )
+		{
+			dispatcher.unregister_input_receiver( this );
+			m_is_auto_learning = false;
+		}
+
+		if( m_has_route )
+		{
+			dispatcher.remove_input_route( this );
+			m_has_route = false;
+		}
+	}
+
+
+	void CMidiControlInputLogic::update_input_route( CServer &server )
+	{
+		const CNode &node = get_node();
+		CMidiInputDispatcher &dispatcher = server.get_midi_input_dispatcher();
+
+		const INodeEndpoint *auto_learn_endpoint = node.get_node_endpoint( endpoint_auto_learn );
+		assert( auto_learn_endpoint );
+
+		bool should_auto_learn = ( ( int ) *auto_learn_endpoint->get_value() == 1 );
+		if( should_auto_learn != m_is_auto_learning )
+		{
+			if( should_auto_learn )
+			{
+				dispatcher.register_input_receiver( this );
+			}
+			else
+			{
+				dispatcher.unregister_input_receiver( this );
+			}
+
+			m_is_auto_learning = should_auto_learn;
+		}
+
+		const INodeEndpoint *device_endpoint = node.get_node_endpoint( endpoint_device );
+		const INodeEndpoint *channel_endpoint = node.get_node_endpoint( endpoint_channel );
+		const INodeEndpoint *message_type_endpoint = node.get_node_endpoint( endpoint_message_type );
+		const INodeEndpoint *note_or_controller_endpoint = node.get_node_endpoint( endpoint_note_or_controller );
+
+		assert( device_endpoint && channel_endpoint && message_type_endpoint && note_or_controller_endpoint );
+
+		CMidiInputRoute route;
+
+		const string &message_type = *message_type_endpoint->get_value();
+		if( message_type == note_on )
+		{
+			route.status = CMidiInputRoute::note_on;
+		}
+		else
+		{
+			if( message_type == control_change )
+			{
+				route.status = CMidiInputRoute::control_change;
+			}
+			else
+			{
+				/* not a message type we can receive */
+				if( m_has_route )
+				{
+					dispatcher.remove_input_route( this );
+					m_has_route = false;
+				}
+				return;
+			}
+		}
+
+		const string &device = *device_endpoint->get_value();
+		if( device == any_device )
+		{
+			route.any_device = true;
+		}
+		else
+		{
+			route.device = device;
+		}
+
+		int channel = *channel_endpoint->get_value();
+		route.channel = ( channel == any_channel ) ? 0 : channel;
+
+		route.number = ( int ) *note_or_controller_endpoint->get_value();
+
+		dispatcher.set_input_route( this, route );
+		m_has_route = true;
 	}
 
 
@@ -90,6 +204,12 @@ namespace integra_internal
 
 		assert( device_endpoint && channel_endpoint && message_type_endpoint && note_or_controller_endpoint && value_endpoint && auto_learn_endpoint );
 
+		if( ( int ) *auto_learn_endpoint->get_value() != 1 )
+		{
+			/* not auto-learning - matching input arrives via receive_routed_midi_input */
+			return;
+		}
+
 		for( midi_message_list::const_iterator message_iterator = midi_messages.begin(); message_iterator != midi_messages.end(); message_iterator++ )
 		{
 			const string &device_name = message_iterator->device;
@@ -127,47 +247,32 @@ namespace integra_internal
 
 			assert( message_type );
 
-			if( ( int ) *auto_learn_endpoint->get_value() == 1 )
-			{
-				//do autolearn
-				server.process_command( ISetCommand::create( device_endpoint->get_path(), CStringValue( device_name ) ), CCommandSource::SYSTEM );
-				server.process_command( ISetCommand::create( channel_endpoint->get_path(), CIntegerValue( channel ) ), CCommandSource::SYSTEM );
-				server.process_command( ISetCommand::create( message_type_endpoint->get_path(), CStringValue( *message_type ) ), CCommandSource::SYSTEM );
-				server.process_command( ISetCommand::create( note_or_controller_endpoint->get_path(), CIntegerValue( value1 ) ), CCommandSource::SYSTEM );
-
-				//send value
-				server.process_command( ISetCommand::create( value_endpoint->get_path(), CIntegerValue( value2 ) ), CCommandSource::SYSTEM );
+			//do autolearn
+			server.process_command( ISetCommand::create( device_endpoint->get_path(), CStringValue( device_name ) ), CCommandSource::SYSTEM );
+			server.process_command( ISetCommand::create( channel_endpoint->get_path(), CIntegerValue( channel ) ), CCommandSource::SYSTEM );
+			server.process_command( ISetCommand::create( message_type_endpoint->get_path(), CStringValue( *message_type ) ), CCommandSource::SYSTEM );
+			server.process_command( ISetCommand::create( note_or_controller_endpoint->get_path(), CIntegerValue( value1 ) ), CCommandSource::SYSTEM );
 
-				//end autolearn mode
-				server.process_command( ISetCommand::create( auto_learn_endpoint->get_path(), CIntegerValue( 0 ) ), CCommandSource::SYSTEM );
-				return;
-			}
+			//send value
+			server.process_command( ISetCommand::create( value_endpoint->get_path(), CIntegerValue( value2 ) ), CCommandSource::SYSTEM );
 
-			/* now skip message if it's not the type we're interested in */
-			const string &listen_device = *device_endpoint->get_value();
-			if( device_name != listen_device && listen_device != any_device )
-			{
-				continue;
-			}
+			//end autolearn mode
+			server.process_command( ISetCommand::create( auto_learn_endpoint->get_path(), CIntegerValue( 0 ) ), CCommandSource::SYSTEM );
+			return;
+		}
+	}
 
-			int listen_channel = *channel_endpoint->get_value();
-			if( channel != listen_channel && listen_channel != any_channel )
-			{
-				continue;
-			}
 
-			if( (const string &) *message_type_endpoint->get_value() != *message_type )
-			{
-				continue;
-			}
+	void CMidiControlInputLogic::receive_routed_midi_input( CServer &server, unsigned int value )
+	{
+		if( m_is_auto_learning || !node_is_active() )
+		{
+			return;
+		}
 
-			if( ( int ) *note_or_controller_endpoint->get_value() != value1 )
-			{
-				continue;
-			}
+		const INodeEndpoint *value_endpoint = get_node().get_node_endpoint( endpoint_value );
+		assert( value_endpoint );
 
-			/* if we get here, it _is_ the type of message we're interested in */
-			server.process_command( ISetCommand::create( value_endpoint->get_path(), CIntegerValue( value2 ) ), CCommandSource::SYSTEM );
-		}
+		server.process_command( ISetCommand::create( value_endpoint->get_handle(), CIntegerValue( value ) ), CCommandSource::SYSTEM );
 	}
 }
@@ -29,19 +29,28 @@
 
 namespace integra_internal
 {
-	class CMidiControlInputLogic : public CLogic, IMidiInputReceiver
+	class CMidiControlInputLogic : public CLogic, IMidiInputReceiver, IMidiRoutedInputReceiver
 	{
 		public:
 			CMidiControlInputLogic( const CNode &node );
 			~CMidiControlInputLogic();
 
 			void handle_new( CServer &server, CCommandSource source );
+			void handle_set( CServer &server, const CNodeEndpoint &node_endpoint, const CValue *previous_value, CCommandSource source );
 			void handle_delete( CServer &server, CCommandSource source );
 
+			/* all input is received whilst auto-learning, otherwise only input which matches the mapping */
 			void receive_midi_input( CServer &server, const midi_message_list &midi_messages );
+			void receive_routed_midi_input( CServer &server, unsigned int value );
 
 	private:
 
+			/* re-registers with the midi input dispatcher according to the mapping endpoints */
+			void update_input_route( CServer &server );
+
+			bool m_is_auto_learning;
+			bool m_has_route;
+
 			const static string endpoint_device;
 			const static string endpoint_channel;
 			const static string endpoint_message_type;
@@ -28,7 +28,7 @@
 
 namespace integra_internal
 {
-	IMidiEngine *IMidiEngine::create_midi_engine()
+	IMidiEngine *IMidiEngine::create_midi_engine( CMidiInputDispatcher &input_dispatcher )
 	{
 		/*
 		 at such a time as we implement other midi engines (eg for iOS), we'd use 
@@ -36,7 +36,7 @@ namespace integra_internal
 		*/
 
 		#if 1
-			IMidiEngine *engine = new CPortMidiEngine;
+			IMidiEngine *engine = new CPortMidiEngine( input_dispatcher );
 		#else
 			IMidiEngine *engine = new CSomeOtherAudioEngine;
 		#endif
@@ -34,10 +34,26 @@ namespace integra_internal
 {
 	class CDspEngine;
 	class CMidiInputBuffer;
+	class CMidiInputDispatcher;
 
 	typedef std::vector<CMidiInputBuffer> midi_input_buffer_array;
 
 
+	/* a short midi message, stamped with the midi engine's millisecond clock */
+	class CMidiEvent
+	{
+		public:
+			CMidiEvent() { timestamp = 0; device_index = 0; message = 0; }
+
+			int timestamp;
+
+			/* index into the active input or output devices */
+			int device_index;
+
+			unsigned int message;
+	};
+
+
 
 	class IMidiEngine
 	{
@@ -47,7 +63,8 @@ namespace integra_internal
 
 		public:
 
-			static IMidiEngine *create_midi_engine();
+			/* incoming messages are passed to input_dispatcher from the midi engine's own thread */
+			static IMidiEngine *create_midi_engine( CMidiInputDispatcher &input_dispatcher );
 			virtual ~IMidiEngine() {}
 
 			/* the following methods must not be called simultaneously */
@@ -63,17 +80,23 @@ namespace integra_internal
 			virtual string_vector get_active_input_devices() const = 0;
 			virtual string_vector get_active_output_devices() const = 0;
 
-			/* the following methods can be called simultaneously to the methods above */
+			/* 
+			 the following methods can be called simultaneously to the methods above, from the audio thread.  
+			 They never block - devices are read and written by the midi engine's own thread, which exchanges 
+			 events with them through lock-free queues
+			*/
 
 			/*
-			 poll_input should only return the following message types:
+			 read_input_event returns false when there is no more input.  It should only return the following message types:
 			 Note On, Note Off, Channel Aftertouch, Poly Aftertouch, Program Change, Control Change, Pitchbend.
 			*/
+			virtual bool read_input_event( CMidiEvent &event ) = 0;
 
-			virtual CError poll_input( midi_input_buffer_array &input_buffers ) = 0;
+			/* the event is sent at its timestamp.  Returns false if the output queue is full */
+			virtual bool write_output_event( const CMidiEvent &event ) = 0;
 
-			virtual CError send_midi_message( const string &device_name, unsigned int message ) = 0;
-			virtual CError send_midi_message( int device_index, unsigned int message ) = 0;
+			/* the clock used for event timestamps, in milliseconds */
+			virtual int get_time() const = 0;
 	};
 
 
@@ -25,6 +25,8 @@
 #include "midi_input_dispatcher.h"
 #include "server.h"
 
+#include <algorithm>
+
 
 namespace integra_internal
 {
@@ -81,6 +83,52 @@ namespace integra_internal
 	}
 
 
+	void CMidiInputDispatcher::set_input_route( IMidiRoutedInputReceiver *receiver, const CMidiInputRoute &route )
+	{
+		remove_input_route( receiver );
+
+		routed_receiver_map &routes = route.any_device ? m_any_device_routes : m_device_routes[ route.device ];
+		routes[ get_route_key( route.channel, route.status, route.number ) ].push_back( receiver );
+
+		m_receiver_routes[ receiver ] = route;
+	}
+
+
+	void CMidiInputDispatcher::remove_input_route( IMidiRoutedInputReceiver *receiver )
+	{
+		receiver_route_map::iterator lookup = m_receiver_routes.find( receiver );
+		if( lookup == m_receiver_routes.end() )
+		{
+			return;
+		}
+
+		const CMidiInputRoute &route = lookup->second;
+
+		device_route_map::iterator device_routes = m_device_routes.end();
+		if( !route.any_device )
+		{
+			device_routes = m_device_routes.find( route.device );
+			assert( device_routes != m_device_routes.end() );
+		}
+
+		routed_receiver_map &routes = route.any_device ? m_any_device_routes : device_routes->second;
+		routed_receiver_map::iterator receivers = routes.find( get_route_key( route.channel, route.status, route.number ) );
+		assert( receivers != routes.end() );
+
+		receivers->second.erase( std::find( receivers->second.begin(), receivers->second.end(), receiver ) );
+		if( receivers->second.empty() )
+		{
+			routes.erase( receivers );
+			if( routes.empty() && !route.any_device )
+			{
+				m_device_routes.erase( device_routes );
+			}
+		}
+
+		m_receiver_routes.erase( lookup );
+	}
+
+
 	void CMidiInputDispatcher::dispatch_midi( const midi_message_list &items )
 	{
 		m_message_queue->push( items );
@@ -102,11 +150,7 @@ namespace integra_internal
 			return;
 		}
 
-		for( midi_input_receiver_set::iterator i = m_midi_receivers.begin(); i != m_midi_receivers.end(); i++ )
-		{
-			IMidiInputReceiver *receiver = *i;
-			receiver->receive_midi_input( m_server, filtered_items );
-		}
+		route_midi_input( filtered_items );
 
 		// if the set of active input devices has changed, we prune our filter map when we've got a server lock
 		if( m_new_active_midi_input_devices )
@@ -134,6 +178,99 @@ namespace integra_internal
 	}
 
 
+	void CMidiInputDispatcher::route_midi_input( const midi_message_list &filtered_items )
+	{
+		m_receivers_to_call.assign( m_midi_receivers.begin(), m_midi_receivers.end() );
+		for( std::vector<IMidiInputReceiver *>::iterator i = m_receivers_to_call.begin(); i != m_receivers_to_call.end(); i++ )
+		{
+			IMidiInputReceiver *receiver = *i;
+			if( m_midi_receivers.count( receiver ) > 0 )
+			{
+				receiver->receive_midi_input( m_server, filtered_items );
+			}
+		}
+
+		if( m_receiver_routes.empty() )
+		{
+			return;
+		}
+
+		for( midi_message_list::const_iterator i = filtered_items.begin(); i != filtered_items.end(); i++ )
+		{
+			unsigned int message = i->message;
+
+			unsigned int status = ( message & 0xF0 ) >> 4;
+			unsigned int channel = ( message & 0xF ) + 1;
+			unsigned int value1 = ( message & 0xFF00 ) >> 8;
+			unsigned int value2 = ( message & 0xFF0000 ) >> 16;
+
+			switch( status )
+			{
+				case CMidiInputRoute::note_on:
+					if( value2 == 0 )
+					{
+						/* note-off due to zero velocity - not routed */
+						continue;
+					}
+					break;
+
+				case CMidiInputRoute::control_change:
+					break;
+
+				default:
+					continue;
+			}
+
+			m_routed_receivers_to_call.clear();
+
+			device_route_map::const_iterator device_routes = m_device_routes.find( i->device );
+			if( device_routes != m_device_routes.end() )
+			{
+				add_routed_receivers( device_routes->second, channel, status, value1 );
+			}
+
+			add_routed_receivers( m_any_device_routes, channel, status, value1 );
+
+			for( routed_receiver_list::iterator j = m_routed_receivers_to_call.begin(); j != m_routed_receivers_to_call.end(); j++ )
+			{
+				IMidiRoutedInputReceiver *receiver = *j;
+				if( m_receiver_routes.count( receiver ) > 0 )
+				{
+					receiver->receive_routed_midi_input( m_server, value2 );
+				}
+			}
+		}
+	}
+
+
+	unsigned int CMidiInputDispatcher::get_route_key( unsigned int channel, unsigned int status, unsigned int number )
+	{
+		return ( channel << 16 ) | ( status << 8 ) | number;
+	}
+
+
+	void CMidiInputDispatcher::add_routed_receivers( const routed_receiver_map &routes, unsigned int channel, unsigned int status, unsigned int number )
+	{
+		if( routes.empty() )
+		{
+			return;
+		}
+
+		routed_receiver_map::const_iterator lookup = routes.find( get_route_key( channel, status, number ) );
+		if( lookup != routes.end() )
+		{
+			m_routed_receivers_to_call.insert( m_routed_receivers_to_call.end(), lookup->second.begin(), lookup->second.end() );
+		}
+
+		/* receivers listening on any channel */
+		lookup = routes.find( get_route_key( 0, status, number ) );
+		if( lookup != routes.end() )
+		{
+			m_routed_receivers_to_call.insert( m_routed_receivers_to_call.end(), lookup->second.begin(), lookup->second.end() );
+		}
+	}
+
+
 	void CMidiInputDispatcher::make_filtered_items( const midi_message_list &items, midi_message_list &filtered_items )
 	{
 		for( midi_input_filter_map::iterator i = m_midi_input_filters.begin(); i != m_midi_input_filters.end(); i++ )
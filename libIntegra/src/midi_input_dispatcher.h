@@ -55,9 +55,37 @@ namespace integra_internal
 	};
 
 
+	/* 
+	 A note on or control change, with a given note or controller number, from a given device and channel.
+	 Channels are 1 - 16, or 0 for any channel
+	*/
+	class CMidiInputRoute
+	{
+		public:
+			CMidiInputRoute() { any_device = false; channel = 0; status = 0; number = 0; }
+
+			static const unsigned int note_on = 0x9;
+			static const unsigned int control_change = 0xB;
+
+			string device;
+			bool any_device;
+			unsigned int channel;
+			unsigned int status;
+			unsigned int number;
+	};
+
+
+	/* Interface for receivers which are only given the values of messages matching their route */
+	class IMidiRoutedInputReceiver
+	{
+		public:
+			virtual void receive_routed_midi_input( CServer &server, unsigned int value ) = 0;
+	};
+
+
 
 	/* 
-	 The Input Dispatcher.  Can receive midi in a low-latency dsp thread, dispatches to subclasses of
+	 The Input Dispatcher.  Receives midi from the midi engine's i/o thread, dispatches to subclasses of
 	 IMidiInputReceiver in a less time-critical thread with a locked server.
 	*/
 
@@ -68,15 +96,27 @@ namespace integra_internal
 			CMidiInputDispatcher( CServer &server );
 			~CMidiInputDispatcher();
 
+			/* registered input receivers are given every message */
 			CError register_input_receiver( IMidiInputReceiver *receiver );
 			CError unregister_input_receiver( IMidiInputReceiver *receiver );
 
+			/* 
+			 routed input receivers are only given messages which match their route, found via an 
+			 index rather than by offering every message to every receiver.  Setting a receiver's 
+			 route replaces any previous route
+			*/
+			void set_input_route( IMidiRoutedInputReceiver *receiver, const CMidiInputRoute &route );
+			void remove_input_route( IMidiRoutedInputReceiver *receiver );
+
 			/* called by midi settings, with locked server */
 			void set_active_midi_input_devices( const string_vector &active_midi_input_devices );
 
-			/* called by CDspEngine */
+			/* called by the midi engine's i/o thread */
 			void dispatch_midi( const midi_message_list &items );
 
+			/* hands already-filtered messages to receivers.  Called with locked server */
+			void route_midi_input( const midi_message_list &filtered_items );
+
 
 		private:
 
@@ -93,6 +133,28 @@ namespace integra_internal
 			typedef std::unordered_set<IMidiInputReceiver *> midi_input_receiver_set;
 			midi_input_receiver_set m_midi_receivers;
 
+			typedef std::vector<IMidiRoutedInputReceiver *> routed_receiver_list;
+			typedef std::unordered_map<unsigned int, routed_receiver_list> routed_receiver_map;
+			typedef std::unordered_map<string, routed_receiver_map> device_route_map;
+			typedef std::unordered_map<IMidiRoutedInputReceiver *, CMidiInputRoute> receiver_route_map;
+
+			/* route keys pack channel, status and number */
+			static unsigned int get_route_key( unsigned int channel, unsigned int status, unsigned int number );
+
+			void add_routed_receivers( const routed_receiver_map &routes, unsigned int channel, unsigned int status, unsigned int number );
+
+			/* routes for specific devices, and for any device */
+			device_route_map m_device_routes;
+			routed_receiver_map m_any_device_routes;
+			receiver_route_map m_receiver_routes;
+
+			/* 
+			 receivers are copied here before being called, since handling input can change routes 
+			 or delete receivers
+			*/
+			std::vector<IMidiInputReceiver *> m_receivers_to_call;
+			routed_receiver_list m_routed_receivers_to_call;
+
 			string_vector *m_new_active_midi_input_devices;
 
 	};
@@ -74,7 +74,7 @@ namespace integra_internal
 
 		for( midi_message_list::const_iterator i = midi_messages.begin(); i != midi_messages.end(); i++ )
 		{
-			server.process_command( ISetCommand::create( midi_message_endpoint->get_path(), CIntegerValue( i->message ) ), CCommandSource::SYSTEM );
+			server.process_command( ISetCommand::create( midi_message_endpoint->get_handle(), CIntegerValue( i->message ) ), CCommandSource::SYSTEM );
 		}
 	}
 }
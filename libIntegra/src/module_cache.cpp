@@ -0,0 +1,352 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+
+
+#include "platform_specifics.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#ifdef _WINDOWS
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#define mkdir(x) mkdir(x, 0777)
+#endif
+
+#include "module_cache.h"
+#include "interface_definition_serializer.h"
+#include "file_helper.h"
+#include "file_io.h"
+#include "MurmurHash2.h"
+#include "api/trace.h"
+
+#include <sstream>
+#include <iomanip>
+
+
+namespace integra_internal
+{
+	const string CModuleCache::entry_file_name = "entry.bin";
+	const string CModuleCache::implementation_directory_name = "implementation";
+	const unsigned int CModuleCache::entry_magic = 0x494d4345;	/* 'IMCE' */
+	const unsigned int CModuleCache::entry_format_version = 1;
+	const int CModuleCache::hash_seed = 53;
+
+
+	static bool read_whole_file( const string &file_name, string &contents )
+	{
+		FILE *file = fopen( file_name.c_str(), "rb" );
+		if( !file )
+		{
+			return false;
+		}
+
+		fseek( file, 0, SEEK_END );
+		long file_size = ftell( file );
+		fseek( file, 0, SEEK_SET );
+
+		bool success = false;
+		if( file_size >= 0 )
+		{
+			contents.resize( file_size );
+			success = ( file_size == 0 || fread( &contents[ 0 ], 1, file_size, file ) == ( size_t ) file_size );
+		}
+
+		fclose( file );
+		return success;
+	}
+
+
+	template<typename T> static void append_to_buffer( string &buffer, const T &value )
+	{
+		buffer.append( ( const char * ) &value, sizeof( T ) );
+	}
+
+
+	template<typename T> static bool read_from_buffer( const string &buffer, size_t &position, T &value )
+	{
+		if( position + sizeof( T ) > buffer.length() )
+		{
+			return false;
+		}
+
+		memcpy( &value, buffer.data() + position, sizeof( T ) );
+		position += sizeof( T );
+		return true;
+	}
+
+
+	CModuleCache::CModuleCache( const string &cache_directory )
+	{
+		if( cache_directory.empty() )
+		{
+			return;
+		}
+
+		m_cache_directory = cache_directory;
+		if( m_cache_directory[ m_cache_directory.length() - 1 ] != CFileIO::path_separator )
+		{
+			m_cache_directory += CFileIO::path_separator;
+		}
+
+		if( !CFileHelper::is_directory( m_cache_directory ) )
+		{
+			mkdir( m_cache_directory.c_str() );
+
+			if( !CFileHelper::is_directory( m_cache_directory ) )
+			{
+				INTEGRA_TRACE_ERROR << "Can't create module cache directory " << m_cache_directory << " - module cache disabled";
+				m_cache_directory.clear();
+			}
+		}
+	}
+
+
+	CModuleCache::~CModuleCache()
+	{
+	}
+
+
+	CInterfaceDefinition *CModuleCache::lookup( const string &module_file, unsigned int &checksum ) const
+	{
+		checksum = 0;
+
+		if( !is_enabled() )
+		{
+			return NULL;
+		}
+
+		string entry;
+		if( !read_whole_file( get_entry_file( module_file ), entry ) )
+		{
+			return NULL;
+		}
+
+		size_t position = 0;
+		unsigned int magic = 0;
+		unsigned int entry_version = 0;
+		unsigned int serializer_version = 0;
+		unsigned int path_length = 0;
+		CEntryHeader header;
+
+		if( !read_from_buffer( entry, position, magic ) || magic != entry_magic ||
+			!read_from_buffer( entry, position, entry_version ) || entry_version != entry_format_version ||
+			!read_from_buffer( entry, position, serializer_version ) || serializer_version != CInterfaceDefinitionSerializer::format_version ||
+			!read_from_buffer( entry, position, path_length ) || position + path_length > entry.length() )
+		{
+			INTEGRA_TRACE_VERBOSE << "Ignoring stale or malformed module cache entry for " << module_file;
+			return NULL;
+		}
+
+		header.module_file = entry.substr( position, path_length );
+		position += path_length;
+
+		if( header.module_file != module_file )
+		{
+			/* different module file with the same path hash */
+			return NULL;
+		}
+
+		if( !read_from_buffer( entry, position, header.modification_time ) ||
+			!read_from_buffer( entry, position, header.size ) ||
+			!read_from_buffer( entry, position, header.content_hash ) ||
+			!read_from_buffer( entry, position, header.checksum ) )
+		{
+			INTEGRA_TRACE_VERBOSE << "Ignoring malformed module cache entry for " << module_file;
+			return NULL;
+		}
+
+		long long modification_time = 0;
+		long long size = 0;
+		if( !get_file_stats( module_file, modification_time, size ) || size != header.size )
+		{
+			return NULL;
+		}
+
+		string serialized_definition = entry.substr( position );
+
+		if( modification_time != header.modification_time )
+		{
+			/* the file has been touched - it's still valid if its content is unchanged */
+			unsigned int content_hash = 0;
+			if( !get_content_hash( module_file, content_hash ) || content_hash != header.content_hash )
+			{
+				return NULL;
+			}
+
+			header.modification_time = modification_time;
+			write_entry( module_file, header, serialized_definition );
+		}
+
+		CInterfaceDefinition *interface_definition = CInterfaceDefinitionSerializer::deserialize( ( const unsigned char * ) serialized_definition.data(), serialized_definition.length() );
+		if( !interface_definition )
+		{
+			return NULL;
+		}
+
+		checksum = header.checksum;
+		return interface_definition;
+	}
+
+
+	CError CModuleCache::restore_implementation( const string &module_file, const string &implementation_directory ) const
+	{
+		assert( is_enabled() );
+
+		return CFileHelper::copy_directory( get_implementation_directory( module_file ), implementation_directory, true );
+	}
+
+
+	CError CModuleCache::store( const string &module_file, const CInterfaceDefinition &interface_definition, unsigned int checksum, const string &implementation_directory ) const
+	{
+		assert( is_enabled() );
+
+		CEntryHeader header;
+		header.module_file = module_file;
+		header.checksum = checksum;
+
+		if( !get_file_stats( module_file, header.modification_time, header.size ) || !get_content_hash( module_file, header.content_hash ) )
+		{
+			INTEGRA_TRACE_ERROR << "Can't read module file " << module_file;
+			return CError::FAILED;
+		}
+
+		string entry_directory = get_entry_directory( module_file );
+		if( CFileHelper::is_directory( entry_directory ) )
+		{
+			CFileHelper::delete_directory( entry_directory );
+		}
+
+		mkdir( entry_directory.c_str() );
+
+		if( interface_definition.has_implementation() && !implementation_directory.empty() )
+		{
+			if( CFileHelper::copy_directory( implementation_directory, get_implementation_directory( module_file ), true ) != CError::SUCCESS )
+			{
+				INTEGRA_TRACE_ERROR << "Failed to cache implementation of " << module_file;
+				CFileHelper::delete_directory( entry_directory );
+				return CError::FAILED;
+			}
+		}
+
+		string serialized_definition;
+		CInterfaceDefinitionSerializer::serialize( interface_definition, serialized_definition );
+
+		return write_entry( module_file, header, serialized_definition );
+	}
+
+
+	string CModuleCache::get_entry_directory( const string &module_file ) const
+	{
+		unsigned int hash1 = MurmurHash2( module_file.c_str(), module_file.length(), hash_seed );
+		unsigned int hash2 = MurmurHash2( module_file.c_str(), module_file.length(), ~hash_seed );
+
+		std::ostringstream entry_directory;
+		entry_directory << m_cache_directory << std::hex << std::setfill( '0' ) << std::setw( 8 ) << hash1 << std::setw( 8 ) << hash2 << CFileIO::path_separator;
+
+		return entry_directory.str();
+	}
+
+
+	string CModuleCache::get_entry_file( const string &module_file ) const
+	{
+		return get_entry_directory( module_file ) + entry_file_name;
+	}
+
+
+	string CModuleCache::get_implementation_directory( const string &module_file ) const
+	{
+		return get_entry_directory( module_file ) + implementation_directory_name;
+	}
+
+
+	bool CModuleCache::get_file_stats( const string &file_name, long long &modification_time, long long &size )
+	{
+		struct stat file_info;
+		if( stat( file_name.c_str(), &file_info ) != 0 )
+		{
+			return false;
+		}
+
+		modification_time = file_info.st_mtime;
+		size = file_info.st_size;
+		return true;
+	}
+
+
+	bool CModuleCache::get_content_hash( const string &file_name, unsigned int &content_hash )
+	{
+		string contents;
+		if( !read_whole_file( file_name, contents ) )
+		{
+			return false;
+		}
+
+		content_hash = MurmurHash2( contents.data(), contents.length(), hash_seed );
+		return true;
+	}
+
+
+	CError CModuleCache::write_entry( const string &module_file, const CEntryHeader &header, const string &serialized_definition ) const
+	{
+		string entry;
+		append_to_buffer( entry, entry_magic );
+		append_to_buffer( entry, entry_format_version );
+		append_to_buffer( entry, CInterfaceDefinitionSerializer::format_version );
+		append_to_buffer( entry, ( unsigned int ) header.module_file.length() );
+		entry.append( header.module_file );
+		append_to_buffer( entry, header.modification_time );
+		append_to_buffer( entry, header.size );
+		append_to_buffer( entry, header.content_hash );
+		append_to_buffer( entry, header.checksum );
+		entry.append( serialized_definition );
+
+		/* write to a temporary file first, so that a partly written entry is never read */
+		string entry_file = get_entry_file( module_file );
+		string temporary_file = entry_file + ".tmp";
+
+		FILE *file = fopen( temporary_file.c_str(), "wb" );
+		if( !file )
+		{
+			INTEGRA_TRACE_ERROR << "Can't write module cache entry " << temporary_file;
+			return CError::FAILED;
+		}
+
+		bool written = ( fwrite( entry.data(), 1, entry.length(), file ) == entry.length() );
+		fclose( file );
+
+		#ifdef _WINDOWS
+			/* windows can't rename over an existing file */
+			remove( entry_file.c_str() );
+		#endif
+
+		if( !written || rename( temporary_file.c_str(), entry_file.c_str() ) != 0 )
+		{
+			INTEGRA_TRACE_ERROR << "Failed to write module cache entry " << entry_file;
+			remove( temporary_file.c_str() );
+			return CError::FAILED;
+		}
+
+		return CError::SUCCESS;
+	}
+}
@@ -0,0 +1,106 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+
+#ifndef INTEGRA_MODULE_CACHE_PRIVATE_H
+#define INTEGRA_MODULE_CACHE_PRIVATE_H
+
+
+#include "api/common_typedefs.h"
+#include "api/error.h"
+#include "interface_definition.h"
+
+
+namespace integra_internal
+{
+	/*
+	 CModuleCache is a persistent directory of previously loaded modules, which lets startup skip 
+	 unzipping, xml parsing and implementation extraction for module files which haven't changed.
+
+	 Each module file has an entry directory, named from a hash of the module file's path.  The entry
+	 holds the module's path, modification time, size and content hash, its implementation checksum, 
+	 its serialized interface definition, and a copy of its extracted implementation tree.
+
+	 An entry is valid when the module file's size matches, and either its modification time or its 
+	 content hash matches.  Cached implementations are hard linked into place where possible.
+
+	 Methods are const and each only touches the entry for the given module file, so different
+	 module files can be looked up and stored concurrently.
+	*/
+
+	class CModuleCache
+	{
+		public:
+
+			/* an empty cache_directory disables the cache */
+			CModuleCache( const string &cache_directory );
+			~CModuleCache();
+
+			bool is_enabled() const { return !m_cache_directory.empty(); }
+
+			/* 
+			 returns a new interface definition if module_file has a valid entry, otherwise NULL.
+			 stores the cached implementation checksum in checksum
+			*/
+			CInterfaceDefinition *lookup( const string &module_file, unsigned int &checksum ) const;
+
+			/* links or copies the cached implementation of module_file into implementation_directory */
+			CError restore_implementation( const string &module_file, const string &implementation_directory ) const;
+
+			/* 
+			 replaces the entry for module_file.  implementation_directory is ignored for modules without implementations, 
+			 and is empty for implementations which weren't extracted, in which case restore_implementation fails
+			*/
+			CError store( const string &module_file, const CInterfaceDefinition &interface_definition, unsigned int checksum, const string &implementation_directory ) const;
+
+		private:
+
+			class CEntryHeader
+			{
+				public:
+					string module_file;
+					long long modification_time;
+					long long size;
+					unsigned int content_hash;
+					unsigned int checksum;
+			};
+
+			string get_entry_directory( const string &module_file ) const;
+			string get_entry_file( const string &module_file ) const;
+			string get_implementation_directory( const string &module_file ) const;
+
+			static bool get_file_stats( const string &file_name, long long &modification_time, long long &size );
+			static bool get_content_hash( const string &file_name, unsigned int &content_hash );
+
+			CError write_entry( const string &module_file, const CEntryHeader &header, const string &serialized_definition ) const;
+
+			string m_cache_directory;
+
+			static const string entry_file_name;
+			static const string implementation_directory_name;
+			static const unsigned int entry_magic;
+			static const unsigned int entry_format_version;
+			static const int hash_seed;
+	};
+}
+
+
+#endif
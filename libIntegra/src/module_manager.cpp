@@ -24,6 +24,12 @@
 
 #include <assert.h>
 #include <dirent.h>
+#include <pthread.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 #ifdef _WINDOWS
 #include <direct.h>
@@ -43,11 +49,14 @@
 #include "file_helper.h"
 #include "api/guid_helper.h"
 #include "server.h"
+#include "dsp_engine.h"
 #include "interface_definition_loader.h"
 #include "file_io.h"
 #include "MurmurHash2.h"
 #include "api/string_helper.h"
 
+#include <libxml/parser.h>
+
 using namespace integra_api;
 
 
@@ -74,9 +83,147 @@ namespace integra_internal
 	const int CModuleManager::checksum_seed = 53;
 
 
-	CModuleManager::CModuleManager( const CServer &server, const string &system_module_directory, const string &third_party_module_directory )
-		:	m_server( server )
+	static double get_seconds()
 	{
+		return std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+	}
+
+
+	/*
+	 CParallelJobs runs a fixed number of independent jobs on a set of threads.
+	 The calling thread takes part, and each thread claims the next job index until none remain
+	*/
+
+	class CParallelJobs
+	{
+		public:
+
+			typedef void ( *job_function )( void *context, int job_index );
+
+			CParallelJobs( int number_of_jobs, job_function function, void *context )
+			{
+				m_number_of_jobs = number_of_jobs;
+				m_function = function;
+				m_context = context;
+				m_next_job.store( 0 );
+			}
+
+			void run( int number_of_threads )
+			{
+				number_of_threads = MIN( number_of_threads, m_number_of_jobs );
+
+				std::vector<pthread_t> threads;
+				for( int i = 1; i < number_of_threads; i++ )
+				{
+					pthread_t thread;
+					if( pthread_create( &thread, NULL, thread_function, this ) == 0 )
+					{
+						threads.push_back( thread );
+					}
+					else
+					{
+						INTEGRA_TRACE_ERROR << "failed to create worker thread";
+					}
+				}
+
+				run_jobs();
+
+				for( std::vector<pthread_t>::iterator i = threads.begin(); i != threads.end(); i++ )
+				{
+					pthread_join( *i, NULL );
+				}
+			}
+
+		private:
+
+			static void *thread_function( void *argument )
+			{
+				static_cast<CParallelJobs *>( argument )->run_jobs();
+				return NULL;
+			}
+
+			void run_jobs()
+			{
+				while( true )
+				{
+					int job_index = m_next_job.fetch_add( 1 );
+					if( job_index >= m_number_of_jobs )
+					{
+						return;
+					}
+
+					m_function( m_context, job_index );
+				}
+			}
+
+			int m_number_of_jobs;
+			job_function m_function;
+			void *m_context;
+			std::atomic<int> m_next_job;
+	};
+
+
+	class CModuleLoadJob
+	{
+		public:
+
+			CModuleLoadJob( const string &filename )
+				:	m_filename( filename )
+			{
+				m_interface_definition = NULL;
+				m_checksum = 0;
+				m_from_cache = false;
+			}
+
+			string m_filename;
+			CInterfaceDefinition *m_interface_definition;
+			unsigned int m_checksum;
+			bool m_from_cache;
+			CModuleLoadTimings m_timings;
+	};
+
+
+	typedef std::vector<CModuleLoadJob> module_load_job_array;
+
+	struct CModuleLoadContext
+	{
+		CModuleManager *module_manager;
+		module_load_job_array *jobs;
+	};
+
+
+	CModuleLoadTimings::CModuleLoadTimings()
+	{
+		unzip_seconds = 0;
+		parse_seconds = 0;
+		extraction_seconds = 0;
+		checksum_seconds = 0;
+		cache_seconds = 0;
+		total_seconds = 0;
+
+		number_of_modules = 0;
+		number_of_cache_hits = 0;
+		number_of_threads = 0;
+	}
+
+
+	void CModuleLoadTimings::add_phase_times( const CModuleLoadTimings &other )
+	{
+		unzip_seconds += other.unzip_seconds;
+		parse_seconds += other.parse_seconds;
+		extraction_seconds += other.extraction_seconds;
+		checksum_seconds += other.checksum_seconds;
+		cache_seconds += other.cache_seconds;
+	}
+
+
+	CModuleManager::CModuleManager( const CServer &server, const string &system_module_directory, const string &third_party_module_directory, const string &module_cache_directory, bool extract_implementations )
+		:	m_server( server ),
+			m_module_cache( module_cache_directory ),
+			m_implementation_files( internal_implementation_directory_name )
+	{
+		m_extract_implementations = extract_implementations;
+
 		load_legacy_module_id_file();
 
 		string scratch_directory_root = server.get_scratch_directory();
@@ -565,7 +712,8 @@ namespace integra_internal
 		struct dirent *directory_entry;
 		const char *name;
 		struct stat entry_data;
-		GUID module_guid;
+
+		double start_time = get_seconds();
 
 		directory_stream = opendir( module_directory.c_str() );
 		if( !directory_stream )
@@ -574,6 +722,8 @@ namespace integra_internal
 			return;
 		}
 
+		string_vector filenames;
+
 		while( true )
 		{
 			directory_entry = readdir( directory_stream );
@@ -598,10 +748,209 @@ namespace integra_internal
 					continue;
 
 				default:
-					load_module( full_path, source, module_guid );
+					filenames.push_back( full_path );
 					break;
 			}
 		}
+
+		closedir( directory_stream );
+
+		std::sort( filenames.begin(), filenames.end() );
+
+		module_load_job_array jobs;
+		for( string_vector::const_iterator i = filenames.begin(); i != filenames.end(); i++ )
+		{
+			jobs.push_back( CModuleLoadJob( *i ) );
+		}
+
+		int number_of_threads = MAX( ( int ) std::thread::hardware_concurrency(), 1 );
+
+		CModuleLoadContext context;
+		context.module_manager = this;
+		context.jobs = &jobs;
+
+		/* libxml2 must be initialised on the main thread before it is used from worker threads */
+		xmlInitParser();
+
+		/* first pass - restore interface definitions from the module cache, or unzip and parse them, in parallel */
+		CParallelJobs parse_jobs( jobs.size(), parse_module_job, &context );
+		parse_jobs.run( number_of_threads );
+
+		/* second pass - register in filename order, rejecting duplicates */
+		for( module_load_job_array::iterator i = jobs.begin(); i != jobs.end(); i++ )
+		{
+			if( !i->m_interface_definition )
+			{
+				continue;
+			}
+
+			if( !register_module( i->m_interface_definition, i->m_filename, source ) )
+			{
+				i->m_interface_definition = NULL;
+			}
+		}
+
+		/* third pass - restore or extract implementations of registered modules in parallel, updating the module cache */
+		CParallelJobs extract_jobs( jobs.size(), extract_module_job, &context );
+		extract_jobs.run( number_of_threads );
+
+		/* fourth pass - store checksums and collect timings */
+		for( module_load_job_array::iterator i = jobs.begin(); i != jobs.end(); i++ )
+		{
+			if( i->m_interface_definition )
+			{
+				if( i->m_interface_definition->has_implementation() )
+				{
+					i->m_interface_definition->set_implementation_checksum( i->m_checksum );
+				}
+
+				m_load_timings.number_of_modules++;
+
+				if( i->m_from_cache )
+				{
+					m_load_timings.number_of_cache_hits++;
+				}
+			}
+
+			m_load_timings.add_phase_times( i->m_timings );
+		}
+
+		m_load_timings.number_of_threads = MAX( m_load_timings.number_of_threads, number_of_threads );
+		m_load_timings.total_seconds += ( get_seconds() - start_time );
+
+		INTEGRA_TRACE_PROGRESS << "Loaded modules from " << module_directory << " using " << number_of_threads << " threads.  Running totals: "  << m_load_timings.number_of_modules << " modules (" << m_load_timings.number_of_cache_hits << " from cache) in " << m_load_timings.total_seconds << "s (unzip " << m_load_timings.unzip_seconds << "s, parse " << m_load_timings.parse_seconds << "s, extraction " << m_load_timings.extraction_seconds << "s, checksum " << m_load_timings.checksum_seconds << "s, cache " << m_load_timings.cache_seconds << "s)";
+	}
+
+
+	void CModuleManager::parse_module_job( void *context, int job_index )
+	{
+		CModuleLoadContext &load_context = *static_cast<CModuleLoadContext *>( context );
+		CModuleLoadJob &job = ( *load_context.jobs )[ job_index ];
+
+		const CModuleCache &module_cache = load_context.module_manager->m_module_cache;
+		if( module_cache.is_enabled() )
+		{
+			double cache_start_time = get_seconds();
+			job.m_interface_definition = module_cache.lookup( job.m_filename, job.m_checksum );
+			job.m_timings.cache_seconds += ( get_seconds() - cache_start_time );
+
+			if( job.m_interface_definition )
+			{
+				job.m_from_cache = true;
+				return;
+			}
+		}
+
+		double start_time = get_seconds();
+		unzFile unzip_file = unzOpen( job.m_filename.c_str() );
+		job.m_timings.unzip_seconds += ( get_seconds() - start_time );
+
+		if( !unzip_file )
+		{
+			INTEGRA_TRACE_ERROR << "Unable to open zip: " << job.m_filename;
+			return;
+		}
+
+		job.m_interface_definition = load_interface( unzip_file, job.m_timings );
+		if( !job.m_interface_definition ) 
+		{
+			INTEGRA_TRACE_ERROR << "Failed to load interface: " << job.m_filename;
+		}
+
+		unzClose( unzip_file );
+	}
+
+
+	void CModuleManager::extract_module_job( void *context, int job_index )
+	{
+		CModuleLoadContext &load_context = *static_cast<CModuleLoadContext *>( context );
+		CModuleLoadJob &job = ( *load_context.jobs )[ job_index ];
+		CModuleManager &module_manager = *load_context.module_manager;
+		const CModuleCache &module_cache = module_manager.m_module_cache;
+
+		if( !job.m_interface_definition )
+		{
+			return;
+		}
+
+		bool has_implementation = job.m_interface_definition->has_implementation();
+		string implementation_directory = has_implementation ? module_manager.get_implementation_path( *job.m_interface_definition ) : "";
+
+		if( job.m_from_cache )
+		{
+			if( !has_implementation )
+			{
+				return;
+			}
+
+			unzFile unzip_file = unzOpen( job.m_filename.c_str() );
+			if( !unzip_file )
+			{
+				INTEGRA_TRACE_ERROR << "Unable to open zip: " << job.m_filename;
+				return;
+			}
+
+			bool should_extract = module_manager.should_extract_implementation( unzip_file );
+
+			unzClose( unzip_file );
+
+			if( !should_extract )
+			{
+				/* the cached checksum is all that's needed - the implementation is decompressed when libpd first reads it */
+				module_manager.m_implementation_files.add_implementation( implementation_directory, job.m_filename );
+				return;
+			}
+
+			double cache_start_time = get_seconds();
+			CError error = module_cache.restore_implementation( job.m_filename, implementation_directory );
+			job.m_timings.cache_seconds += ( get_seconds() - cache_start_time );
+
+			if( error == CError::SUCCESS )
+			{
+				return;
+			}
+
+			/* fall back to extracting from the module file */
+			INTEGRA_TRACE_ERROR << "Failed to restore cached implementation of " << job.m_filename;
+			CFileHelper::delete_directory( implementation_directory );
+			job.m_from_cache = false;
+		}
+
+		bool is_extracted = false;
+
+		if( has_implementation )
+		{
+			unzFile unzip_file = unzOpen( job.m_filename.c_str() );
+			if( !unzip_file )
+			{
+				INTEGRA_TRACE_ERROR << "Unable to open zip: " << job.m_filename;
+				return;
+			}
+
+			is_extracted = module_manager.should_extract_implementation( unzip_file );
+
+			CError error = module_manager.extract_implementation( unzip_file, *job.m_interface_definition, is_extracted, job.m_checksum, job.m_timings );
+
+			unzClose( unzip_file );
+
+			if( error != CError::SUCCESS )
+			{
+				return;
+			}
+
+			if( !is_extracted )
+			{
+				module_manager.m_implementation_files.add_implementation( implementation_directory, job.m_filename );
+			}
+		}
+
+		if( module_cache.is_enabled() )
+		{
+			/* implementations served from memory aren't cached, so a later session which extracts them extracts from the module file */
+			double cache_start_time = get_seconds();
+			module_cache.store( job.m_filename, *job.m_interface_definition, job.m_checksum, is_extracted ? implementation_directory : "" );
+			job.m_timings.cache_seconds += ( get_seconds() - cache_start_time );
+		}
 	}
 
 
@@ -672,6 +1021,7 @@ namespace integra_internal
 	bool CModuleManager::load_module( const string &filename, CInterfaceDefinition::module_source source, GUID &module_guid )
 	{
 		unzFile unzip_file;
+		CModuleLoadTimings timings;
 
 		module_guid = CGuidHelper::null_guid;
 
@@ -682,7 +1032,7 @@ namespace integra_internal
 			return false;
 		}
 
-		CInterfaceDefinition *interface_definition = load_interface( unzip_file );
+		CInterfaceDefinition *interface_definition = load_interface( unzip_file, timings );
 		if( !interface_definition ) 
 		{
 			INTEGRA_TRACE_ERROR << "Failed to load interface: " << filename;
@@ -692,11 +1042,39 @@ namespace integra_internal
 
 		module_guid = interface_definition->get_module_guid();
 
-		if( m_module_id_map.count( module_guid ) > 0 )
+		if( !register_module( interface_definition, filename, source ) )
+		{
+			unzClose( unzip_file );
+			return false;
+		}
+
+		if( interface_definition->has_implementation() )
+		{
+			bool should_extract = should_extract_implementation( unzip_file );
+
+			unsigned int checksum = 0;
+			if( extract_implementation( unzip_file, *interface_definition, should_extract, checksum, timings ) == CError::SUCCESS && !should_extract )
+			{
+				m_implementation_files.add_implementation( get_implementation_path( *interface_definition ), filename );
+			}
+
+			interface_definition->set_implementation_checksum( checksum );
+		}
+
+		unzClose( unzip_file );
+
+		return true;
+	}
+
+
+	bool CModuleManager::register_module( CInterfaceDefinition *interface_definition, const string &filename, CInterfaceDefinition::module_source source )
+	{
+		assert( interface_definition );
+
+		if( m_module_id_map.count( interface_definition->get_module_guid() ) > 0 )
 		{
 			INTEGRA_TRACE_VERBOSE << "Module already loaded: " << interface_definition->get_interface_info().get_name();
 			delete interface_definition;
-			unzClose( unzip_file );
 			return false;
 		}
 
@@ -705,7 +1083,6 @@ namespace integra_internal
 		{
 			INTEGRA_TRACE_ERROR << "Attempt to load 'implemented in libintegra' module as 3rd party or embedded: " << interface_definition->get_interface_info().get_name();
 			delete interface_definition;
-			unzClose( unzip_file );
 			return false;
 		}
 
@@ -738,16 +1115,6 @@ namespace integra_internal
 	
 		m_module_ids.insert( interface_definition->get_module_guid() );
 
-		if( interface_definition->has_implementation() )
-		{
-			unsigned int checksum = 0;
-			extract_implementation( unzip_file, *interface_definition, checksum );
-
-			interface_definition->set_implementation_checksum( checksum );
-		}
-
-		unzClose( unzip_file );
-
 		return true;
 	}
 
@@ -772,7 +1139,7 @@ namespace integra_internal
 	}
 
 
-	CInterfaceDefinition *CModuleManager::load_interface( unzFile unzip_file )
+	CInterfaceDefinition *CModuleManager::load_interface( unzFile unzip_file, CModuleLoadTimings &timings )
 	{
 		unz_file_info file_info;
 		unsigned char *buffer = NULL;
@@ -780,6 +1147,8 @@ namespace integra_internal
 
 		assert( unzip_file );
 
+		double start_time = get_seconds();
+
 		if( unzLocateFile( unzip_file, idd_file_name.c_str(), 0 ) != UNZ_OK )
 		{
 			INTEGRA_TRACE_ERROR << "Unable to locate " << idd_file_name;
@@ -808,29 +1177,40 @@ namespace integra_internal
 			return NULL;
 		}
 
+		double unzipped_time = get_seconds();
+		timings.unzip_seconds += ( unzipped_time - start_time );
+
 		CInterfaceDefinitionLoader interface_definition_loader;
 		CInterfaceDefinition *interface_definition = interface_definition_loader.load( *buffer, buffer_size );
 		delete[] buffer;
 
+		timings.parse_seconds += ( get_seconds() - unzipped_time );
+
 		return interface_definition;
 	}
 
 
-	CError CModuleManager::extract_implementation( unzFile unzip_file, const CInterfaceDefinition &interface_definition, unsigned int &checksum )
+	CError CModuleManager::extract_implementation( unzFile unzip_file, const CInterfaceDefinition &interface_definition, bool write_files, unsigned int &checksum, CModuleLoadTimings &timings ) const
 	{
 		assert( unzip_file );
 
 		checksum = 0;
 
+		double start_time = get_seconds();
+		double checksum_seconds = 0;
+
 		string implementation_directory = get_implementation_path( interface_definition );
 
-		if( CFileHelper::is_directory( implementation_directory.c_str() ) )
+		if( write_files )
 		{
-			INTEGRA_TRACE_ERROR << "Can't extract module implementation - target directory already exists: " << implementation_directory;
-			return CError::FAILED;
-		}
+			if( CFileHelper::is_directory( implementation_directory.c_str() ) )
+			{
+				INTEGRA_TRACE_ERROR << "Can't extract module implementation - target directory already exists: " << implementation_directory;
+				return CError::FAILED;
+			}
 
-		mkdir( implementation_directory.c_str() );
+			mkdir( implementation_directory.c_str() );
+		}
 
 		if( unzGoToFirstFile( unzip_file ) != UNZ_OK )
 		{
@@ -864,16 +1244,27 @@ namespace integra_internal
 
 			string relative_file_path = file_name.substr( internal_implementation_directory_name.length() );
 
-			CFileHelper::construct_subdirectories( implementation_directory, relative_file_path );
-
 			string target_path = implementation_directory + relative_file_path;
 
+			double checksum_start_time = get_seconds();
 			checksum ^= MurmurHash2( relative_file_path.c_str(), relative_file_path.length(), checksum_seed );
+			checksum_seconds += ( get_seconds() - checksum_start_time );
 
 			if( unzOpenCurrentFile( unzip_file ) == UNZ_OK )
 			{
-				FILE *output_file = fopen( target_path.c_str(), "wb" );
-				if( output_file )
+				FILE *output_file = NULL;
+				if( write_files )
+				{
+					CFileHelper::construct_subdirectories( implementation_directory, relative_file_path );
+
+					output_file = fopen( target_path.c_str(), "wb" );
+					if( !output_file )
+					{
+						INTEGRA_TRACE_ERROR << "Couldn't write to implementation file: " << target_path;
+					}
+				}
+
+				if( output_file || !write_files )
 				{
 					unsigned char *output_buffer = new unsigned char[ file_info.uncompressed_size ];
 
@@ -883,18 +1274,22 @@ namespace integra_internal
 					}
 					else
 					{
+						checksum_start_time = get_seconds();
 						checksum ^= MurmurHash2( output_buffer, file_info.uncompressed_size, checksum_seed );
+						checksum_seconds += ( get_seconds() - checksum_start_time );
 
-						fwrite( output_buffer, 1, file_info.uncompressed_size, output_file );
+						if( output_file )
+						{
+							fwrite( output_buffer, 1, file_info.uncompressed_size, output_file );
+						}
 					}
 
 					delete[] output_buffer;
 
-					fclose( output_file );
-				}
-				else
-				{
-					INTEGRA_TRACE_ERROR << "Couldn't write to implementation file: " << target_path;
+					if( output_file )
+					{
+						fclose( output_file );
+					}
 				}
 
 				unzCloseCurrentFile( unzip_file );
@@ -906,16 +1301,68 @@ namespace integra_internal
 		}
 		while( unzGoToNextFile( unzip_file ) != UNZ_END_OF_LIST_OF_FILE );
 
+		timings.checksum_seconds += checksum_seconds;
+		timings.extraction_seconds += ( get_seconds() - start_time - checksum_seconds );
+
 		return CError::SUCCESS;
 	}
 
 
+	bool CModuleManager::should_extract_implementation( unzFile unzip_file ) const
+	{
+		assert( unzip_file );
+
+		if( m_extract_implementations )
+		{
+			return true;
+		}
+
+		const string abstraction_suffix = "pd";
+
+		if( unzGoToFirstFile( unzip_file ) != UNZ_OK )
+		{
+			return true;
+		}
+
+		do
+		{
+			char file_name_buffer[ CStringHelper::string_buffer_length ];
+			if( unzGetCurrentFileInfo( unzip_file, NULL, file_name_buffer, CStringHelper::string_buffer_length, NULL, 0, NULL, 0 ) != UNZ_OK )
+			{
+				return true;
+			}
+
+			string file_name( file_name_buffer );
+
+			if( file_name.substr( 0, internal_implementation_directory_name.length() ) != internal_implementation_directory_name || file_name.back() == CFileIO::path_separator )
+			{
+				continue;
+			}
+
+			if( CFileHelper::extract_suffix_from_path( file_name ) != abstraction_suffix )
+			{
+				INTEGRA_TRACE_VERBOSE << "Extracting implementation containing " << file_name;
+				return true;
+			}
+		}
+		while( unzGoToNextFile( unzip_file ) != UNZ_END_OF_LIST_OF_FILE );
+
+		return false;
+	}
+
+
 	void CModuleManager::unload_module( CInterfaceDefinition *interface_definition )
 	{
 		assert( interface_definition );
 
 		if( interface_definition->has_implementation() )
 		{
+			if( m_server.has_dsp_engine() )
+			{
+				/* the implementation directory may be reused if the module is loaded again, eg when reloading a module in development */
+				m_server.get_dsp_engine().invalidate_abstractions( get_implementation_path( *interface_definition ) );
+			}
+
 			delete_implementation( *interface_definition );
 		}
 
@@ -970,7 +1417,16 @@ namespace integra_internal
 
 	void CModuleManager::delete_implementation( const CInterfaceDefinition &interface_definition )
 	{
-		CFileHelper::delete_directory( get_implementation_path( interface_definition ).c_str() );
+		string implementation_directory = get_implementation_path( interface_definition );
+
+		if( m_implementation_files.has_implementation( implementation_directory ) )
+		{
+			m_implementation_files.remove_implementation( implementation_directory );
+		}
+		else
+		{
+			CFileHelper::delete_directory( implementation_directory.c_str() );
+		}
 	}
 
 
@@ -1007,6 +1463,11 @@ namespace integra_internal
 
 		interface_definition->set_file_path( module_storage_path );
 
+		if( interface_definition->has_implementation() )
+		{
+			m_implementation_files.set_module_file( get_implementation_path( *interface_definition ), module_storage_path );
+		}
+
 		return CError::SUCCESS;
 	}
 
@@ -1062,6 +1523,11 @@ namespace integra_internal
 		rename( interface_definition.get_file_path().c_str(), new_file_path.c_str() );
 
 		interface_definition.set_file_path( new_file_path );
+
+		if( interface_definition.has_implementation() )
+		{
+			m_implementation_files.set_module_file( get_implementation_path( interface_definition ), new_file_path );
+		}
 	
 		return CError::SUCCESS;
 	}
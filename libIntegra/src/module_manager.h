@@ -26,6 +26,8 @@
 #include "../externals/minizip/unzip.h"
 
 #include "interface_definition.h"
+#include "module_cache.h"
+#include "implementation_file_system.h"
 #include "node.h"
 #include "api/module_manager.h"
 
@@ -36,12 +38,42 @@ namespace integra_internal
 	typedef std::unordered_map<string, IInterfaceDefinition *> map_string_to_interface_definition;
 
 	class CServer;
+	class CModuleLoadJob;
+
+
+	/*
+	 CModuleLoadTimings records where startup module loading spends its time.
+	 Phase times are summed across worker threads, so with several workers they
+	 can add up to more than total_seconds.  cache_seconds covers module cache
+	 lookups, implementation restores and stores.
+	*/
+
+	class CModuleLoadTimings
+	{
+		public:
+
+			CModuleLoadTimings();
+
+			void add_phase_times( const CModuleLoadTimings &other );
+
+			double unzip_seconds;
+			double parse_seconds;
+			double extraction_seconds;
+			double checksum_seconds;
+			double cache_seconds;
+			double total_seconds;
+
+			int number_of_modules;
+			int number_of_cache_hits;
+			int number_of_threads;
+	};
+
 
 	class CModuleManager : public IModuleManager
 	{
 		public:
 
-			CModuleManager( const CServer &server, const string &system_module_directory, const string &third_party_module_directory );
+			CModuleManager( const CServer &server, const string &system_module_directory, const string &third_party_module_directory, const string &module_cache_directory, bool extract_implementations );
 			~CModuleManager();
 
 			static CModuleManager &downcast( IModuleManager &module_manager );
@@ -75,21 +107,51 @@ namespace integra_internal
 			*/
 			const CInterfaceDefinition *get_inhouse_replacement_version( const CInterfaceDefinition &interface_definition ) const;
 
+			/* module implementations which aren't extracted to disk, for libpd to read from memory */
+			CImplementationFileSystem &get_implementation_files() { return m_implementation_files; }
+
+			/* time spent loading the system and 3rd party module directories at startup */
+			const CModuleLoadTimings &get_load_timings() const { return m_load_timings; }
+
 			const static string module_suffix;
 
 		private:
 
+			/*
+			 load_modules_from_directory parses and extracts modules on a pool of worker threads.
+			 Files are registered in filename order, so the choice between duplicates doesn't 
+			 depend on readdir order or on thread scheduling
+			*/
 			void load_modules_from_directory( const string &module_directory, CInterfaceDefinition::module_source source );
 
+			static void parse_module_job( void *context, int job_index );
+			static void extract_module_job( void *context, int job_index );
+
 			/* 
 			 load_module only returns true if the module isn't already loaded
 			 however, it stores the id of the loaded module in module_guid regardless of whether the module was already loaded
 			*/
 			bool load_module( const string &filename, CInterfaceDefinition::module_source source, GUID &module_guid );
 
-			static CInterfaceDefinition *load_interface( unzFile unzip_file );
+			/* 
+			 register_module adds a parsed interface to the lookup tables.  
+			 It returns false and deletes the interface if it can't be registered
+			*/
+			bool register_module( CInterfaceDefinition *interface_definition, const string &filename, CInterfaceDefinition::module_source source );
 
-			CError extract_implementation( unzFile unzip_file, const CInterfaceDefinition &interface_definition, unsigned int &checksum );
+			static CInterfaceDefinition *load_interface( unzFile unzip_file, CModuleLoadTimings &timings );
+
+			/* 
+			 extract_implementation computes the implementation checksum, and writes the implementation's files to its 
+			 implementation directory when write_files is true.  Otherwise the caller registers it with m_implementation_files
+			*/
+			CError extract_implementation( unzFile unzip_file, const CInterfaceDefinition &interface_definition, bool write_files, unsigned int &checksum, CModuleLoadTimings &timings ) const;
+
+			/* 
+			 implementations are served from memory unless extraction was requested at startup, or they contain 
+			 files other than abstractions, which libpd and externals would look for on disk
+			*/
+			bool should_extract_implementation( unzFile unzip_file ) const;
 
 			void unload_module( CInterfaceDefinition *interface_definition );
 
@@ -125,6 +187,12 @@ namespace integra_internal
 			string m_third_party_module_directory;
 			string m_embedded_module_directory;
 
+			CModuleCache m_module_cache;
+
+			CImplementationFileSystem m_implementation_files;
+			bool m_extract_implementations;
+
+			CModuleLoadTimings m_load_timings;
 
 			static const string module_inner_directory_name;
 			static const string idd_file_name;
@@ -90,7 +90,7 @@ namespace integra_internal
 
 		if( !node->get_logic().can_be_child_of( parent ) )
 		{
-			INTEGRA_TRACE_ERROR << interface_definition->get_interface_info().get_name() << " cannot be created as child of " << parent ? parent->get_interface_definition().get_interface_info().get_name() : "top level";
+			INTEGRA_TRACE_ERROR << interface_definition->get_interface_info().get_name() << " cannot be created as child of " << ( parent ? parent->get_interface_definition().get_interface_info().get_name() : "top level" );
 			delete node;
 			return CError::TYPE_ERROR;
 		}
@@ -107,9 +107,9 @@ namespace integra_internal
 			{
 				INTEGRA_TRACE_ERROR << "Failed to get implementation path - cannot load module in host";
 			}
-			else
+			else if( server.get_dsp_engine().add_module( node->get_id(), patch_path ) != CError::SUCCESS )
 			{
-				server.get_dsp_engine().add_module( node->get_id(), patch_path );
+				INTEGRA_TRACE_ERROR << "Failed to load module in host: " << patch_path;
 			}
 		}
 
@@ -30,6 +30,36 @@
 #include "api/trace.h"
 
 
+namespace integra_api
+{
+	CEndpointHandle::CEndpointHandle()
+	{
+		/* generations start at 1, so a null handle never matches a live slot */
+		m_slot = 0;
+		m_generation = 0;
+	}
+
+
+	CEndpointHandle::CEndpointHandle( unsigned int slot, unsigned int generation )
+	{
+		m_slot = slot;
+		m_generation = generation;
+	}
+
+
+	bool CEndpointHandle::operator==( const CEndpointHandle &to_compare ) const
+	{
+		return ( m_slot == to_compare.m_slot && m_generation == to_compare.m_generation );
+	}
+
+
+	bool CEndpointHandle::is_null() const
+	{
+		return ( m_generation == 0 );
+	}
+}
+
+
 namespace integra_internal
 {
 	CNodeEndpoint::CNodeEndpoint()
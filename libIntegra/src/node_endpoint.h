@@ -62,11 +62,14 @@ namespace integra_internal
 
 			const CValue *get_value() const { return m_value; }
 			const CPath &get_path() const { return m_path; }
+			const CEndpointHandle &get_handle() const { return m_handle; }
 
 			CValue *get_value_writable() { return m_value; }
 
 			void update_path();
 
+			void set_handle( const CEndpointHandle &handle ) { m_handle = handle; }
+
 		private:
 
 			const CNode *m_node;
@@ -74,6 +77,7 @@ namespace integra_internal
 
 			CValue *m_value;
 			CPath m_path;
+			CEndpointHandle m_handle;
 	};
 }
 
@@ -0,0 +1,419 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+
+#include "platform_specifics.h"
+
+#include "offline_audio_engine.h"
+#include "dsp_engine.h"
+#include "player_handler.h"
+#include "player_logic.h"
+#include "server.h"
+#include "api/offline_render.h"
+#include "api/audio_statistics.h"
+#include "api/command.h"
+#include "api/trace.h"
+
+#include <chrono>
+#include <algorithm>
+#include <string.h>
+#include <assert.h>
+
+
+namespace integra_internal
+{
+	const int COfflineAudioEngine::default_sample_rate = 44100;
+	const int COfflineAudioEngine::default_number_of_channels = 2;
+	const int COfflineAudioEngine::max_number_of_channels = 64;
+
+	/* any positive rate can be rendered - these are just the ones offered to the AudioSettings module */
+	const int COfflineAudioEngine::potential_sample_rates[] = { 22050, 44100, 48000, 88200, 96000, 192000, 0 };
+
+
+	COfflineAudioEngine::COfflineAudioEngine()
+	{
+		m_sample_rate = default_sample_rate;
+		m_number_of_input_channels = 0;
+		m_number_of_output_channels = default_number_of_channels;
+
+		m_is_rendering = false;
+	}
+
+
+	COfflineAudioEngine::~COfflineAudioEngine()
+	{
+		assert( !m_is_rendering );
+	}
+
+
+	CError COfflineAudioEngine::set_driver( const string &driver )
+	{
+		return driver.empty() ? CError::SUCCESS : CError::INPUT_ERROR;
+	}
+
+
+	CError COfflineAudioEngine::set_input_device( const string &input_device )
+	{
+		return input_device.empty() ? CError::SUCCESS : CError::INPUT_ERROR;
+	}
+
+
+	CError COfflineAudioEngine::set_output_device( const string &output_device )
+	{
+		return output_device.empty() ? CError::SUCCESS : CError::INPUT_ERROR;
+	}
+
+
+	CError COfflineAudioEngine::set_sample_rate( int sample_rate )
+	{
+		if( sample_rate <= 0 )
+		{
+			return CError::INPUT_ERROR;
+		}
+
+		m_sample_rate = sample_rate;
+		return CError::SUCCESS;
+	}
+
+
+	CError COfflineAudioEngine::set_number_of_input_channels( int input_channels )
+	{
+		if( input_channels < 0 || input_channels > max_number_of_channels )
+		{
+			return CError::INPUT_ERROR;
+		}
+
+		m_number_of_input_channels = input_channels;
+		return CError::SUCCESS;
+	}
+
+
+	CError COfflineAudioEngine::set_number_of_output_channels( int output_channels )
+	{
+		if( output_channels < 0 || output_channels > max_number_of_channels )
+		{
+			return CError::INPUT_ERROR;
+		}
+
+		m_number_of_output_channels = output_channels;
+		return CError::SUCCESS;
+	}
+
+
+	CError COfflineAudioEngine::restore_defaults()
+	{
+		m_sample_rate = default_sample_rate;
+		m_number_of_input_channels = 0;
+		m_number_of_output_channels = default_number_of_channels;
+
+		return CError::SUCCESS;
+	}
+
+
+	string_vector COfflineAudioEngine::get_available_drivers() const
+	{
+		return string_vector();
+	}
+
+
+	string_vector COfflineAudioEngine::get_available_input_devices() const
+	{
+		return string_vector();
+	}
+
+
+	string_vector COfflineAudioEngine::get_available_output_devices() const
+	{
+		return string_vector();
+	}
+
+
+	int_vector COfflineAudioEngine::get_available_sample_rates() const
+	{
+		int_vector sample_rates;
+		for( int i = 0; potential_sample_rates[ i ] > 0; i++ )
+		{
+			sample_rates.push_back( potential_sample_rates[ i ] );
+		}
+
+		return sample_rates;
+	}
+
+
+	string COfflineAudioEngine::get_selected_driver() const
+	{
+		return "";
+	}
+
+
+	string COfflineAudioEngine::get_selected_input_device() const
+	{
+		return "";
+	}
+
+
+	string COfflineAudioEngine::get_selected_output_device() const
+	{
+		return "";
+	}
+
+
+	int COfflineAudioEngine::get_sample_rate() const
+	{
+		return m_sample_rate;
+	}
+
+
+	int COfflineAudioEngine::get_number_of_input_channels() const
+	{
+		return m_number_of_input_channels;
+	}
+
+
+	int COfflineAudioEngine::get_number_of_output_channels() const
+	{
+		return m_number_of_output_channels;
+	}
+
+
+	void COfflineAudioEngine::get_driver_statistics( CAudioStatistics &statistics ) const
+	{
+		/* there is no driver, so nothing can underflow or overflow */
+		statistics.input_underflows = 0;
+		statistics.input_overflows = 0;
+		statistics.output_underflows = 0;
+		statistics.output_overflows = 0;
+		statistics.ring_buffer_overruns = 0;
+		statistics.ring_buffer_underruns = 0;
+		statistics.stream_cpu_load = 0;
+	}
+
+
+	CError COfflineAudioEngine::render( CServer &server, const COfflineRenderInfo &render_info, COfflineRenderResult &result )
+	{
+		if( render_info.sample_rate <= 0 || render_info.duration_seconds <= 0 )
+		{
+			INTEGRA_TRACE_ERROR << "invalid sample rate or duration";
+			return CError::INPUT_ERROR;
+		}
+
+		if( render_info.input_channels < 0 || render_info.input_channels > max_number_of_channels || render_info.output_channels <= 0 || render_info.output_channels > max_number_of_channels )
+		{
+			INTEGRA_TRACE_ERROR << "invalid number of channels";
+			return CError::INPUT_ERROR;
+		}
+
+		if( !server.lock() )
+		{
+			return CError::FAILED;
+		}
+
+		CError error = prepare_render( server, render_info );
+
+		server.unlock();
+
+		if( error != CError::SUCCESS )
+		{
+			return error;
+		}
+
+		FILE *file = NULL;
+		if( !render_info.output_file.empty() )
+		{
+			file = fopen( render_info.output_file.c_str(), "wb" );
+			if( !file )
+			{
+				INTEGRA_TRACE_ERROR << "couldn't open " << render_info.output_file << " for writing";
+				error = CError::FAILED;
+			}
+			else if( render_info.format == COfflineRenderInfo::WAV )
+			{
+				/* sizes are filled in once the render is complete */
+				write_wav_header( file, 0 );
+			}
+		}
+
+		const int block_frames = CDspEngine::samples_per_buffer;
+		int64_t frames_to_render = int64_t( render_info.duration_seconds * m_sample_rate + block_frames - 1 ) / block_frames * block_frames;
+
+		int64_t frames_rendered = 0;
+		double elapsed_seconds = 0;
+
+		if( error == CError::SUCCESS )
+		{
+			int block_input_samples = block_frames * m_number_of_input_channels;
+			int block_output_samples = block_frames * m_number_of_output_channels;
+
+			/* inputs are silent.  The dsp engine never writes to its input */
+			float *input = new float[ block_input_samples + 1 ];
+			memset( input, 0, ( block_input_samples + 1 ) * sizeof( float ) );
+
+			float *output = new float[ block_output_samples ];
+
+			CPlayerHandler &player_handler = server.get_player_handler();
+			player_handler.set_is_stepped( true );
+
+			CDspEngine &dsp_engine = get_dsp_engine();
+
+			std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+			for( ; frames_rendered < frames_to_render; frames_rendered += block_frames )
+			{
+				/* ticks due in this block are scheduled for their exact frames before it is processed */
+				player_handler.step();
+
+				dsp_engine.process_buffer( input, output, m_number_of_input_channels, m_number_of_output_channels, m_sample_rate, true );
+
+				/* samples are written in the machine's byte order, which is little-endian on all supported platforms, as wav requires */
+				if( file && fwrite( output, sizeof( float ), block_output_samples, file ) != ( size_t ) block_output_samples )
+				{
+					INTEGRA_TRACE_ERROR << "error writing " << render_info.output_file;
+					error = CError::FAILED;
+					break;
+				}
+			}
+
+			elapsed_seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start_time ).count();
+
+			player_handler.set_is_stepped( false );
+
+			delete [] input;
+			delete [] output;
+		}
+
+		if( file )
+		{
+			if( render_info.format == COfflineRenderInfo::WAV && error == CError::SUCCESS )
+			{
+				fseek( file, 0, SEEK_SET );
+				write_wav_header( file, frames_rendered );
+			}
+
+			if( fclose( file ) != 0 && error == CError::SUCCESS )
+			{
+				INTEGRA_TRACE_ERROR << "error writing " << render_info.output_file;
+				error = CError::FAILED;
+			}
+		}
+
+		result.frames_rendered = frames_rendered;
+		result.rendered_seconds = double( frames_rendered ) / m_sample_rate;
+		result.elapsed_seconds = elapsed_seconds;
+		result.realtime_factor = ( elapsed_seconds > 0 ) ? result.rendered_seconds / elapsed_seconds : 0;
+
+		INTEGRA_TRACE_PROGRESS << "rendered " << result.rendered_seconds << " seconds in " << elapsed_seconds << " seconds (" << result.realtime_factor << "x realtime)";
+
+		/* m_is_rendering is otherwise only touched with the server locked, so that a second render is refused */
+		bool is_locked = server.lock();
+		m_is_rendering = false;
+		if( is_locked )
+		{
+			server.unlock();
+		}
+
+		return error;
+	}
+
+
+	CError COfflineAudioEngine::prepare_render( CServer &server, const COfflineRenderInfo &render_info )
+	{
+		/* caller must hold the server lock */
+
+		if( m_is_rendering )
+		{
+			INTEGRA_TRACE_ERROR << "can't render - a render is already in progress";
+			return CError::FAILED;
+		}
+
+		m_sample_rate = render_info.sample_rate;
+		m_number_of_input_channels = render_info.input_channels;
+		m_number_of_output_channels = render_info.output_channels;
+
+		if( !render_info.collection_file.empty() )
+		{
+			CError error = server.process_command( ILoadCommand::create( render_info.collection_file, CPath() ), NULL );
+			if( error != CError::SUCCESS )
+			{
+				INTEGRA_TRACE_ERROR << "couldn't load " << render_info.collection_file << ": " << error.get_text();
+				return error;
+			}
+		}
+
+		for( string_vector::const_iterator i = render_info.players_to_start.begin(); i != render_info.players_to_start.end(); i++ )
+		{
+			CPath play_path( *i );
+			play_path.append_element( CPlayerLogic::endpoint_play );
+
+			CError error = server.process_command( ISetCommand::create( play_path, CIntegerValue( 1 ) ), NULL );
+			if( error != CError::SUCCESS )
+			{
+				INTEGRA_TRACE_ERROR << "couldn't start player " << *i << ": " << error.get_text();
+				return error;
+			}
+		}
+
+		m_is_rendering = true;
+		return CError::SUCCESS;
+	}
+
+
+	void COfflineAudioEngine::write_wav_header( FILE *file, int64_t frames ) const
+	{
+		/* 32-bit float wav, with the fact chunk which non-pcm formats require */
+		const int bytes_per_frame = m_number_of_output_channels * sizeof( float );
+		const int fmt_chunk_bytes = 18;
+		const int fact_chunk_bytes = 4;
+
+		/* the riff sizes are 32-bit - a longer render is still written in full, with its header saturated */
+		int64_t data_bytes = std::min<int64_t>( frames * bytes_per_frame, 0xFFFFFFFF - 4 - ( 8 + fmt_chunk_bytes ) - ( 8 + fact_chunk_bytes ) - 8 );
+
+		fwrite( "RIFF", 1, 4, file );
+		write_little_endian( file, 4 + ( 8 + fmt_chunk_bytes ) + ( 8 + fact_chunk_bytes ) + 8 + data_bytes, 4 );
+		fwrite( "WAVE", 1, 4, file );
+
+		fwrite( "fmt ", 1, 4, file );
+		write_little_endian( file, fmt_chunk_bytes, 4 );
+		write_little_endian( file, 3, 2 );		/* WAVE_FORMAT_IEEE_FLOAT */
+		write_little_endian( file, m_number_of_output_channels, 2 );
+		write_little_endian( file, m_sample_rate, 4 );
+		write_little_endian( file, m_sample_rate * bytes_per_frame, 4 );
+		write_little_endian( file, bytes_per_frame, 2 );
+		write_little_endian( file, sizeof( float ) * 8, 2 );
+		write_little_endian( file, 0, 2 );
+
+		fwrite( "fact", 1, 4, file );
+		write_little_endian( file, fact_chunk_bytes, 4 );
+		write_little_endian( file, data_bytes / bytes_per_frame, 4 );
+
+		fwrite( "data", 1, 4, file );
+		write_little_endian( file, data_bytes, 4 );
+	}
+
+
+	void COfflineAudioEngine::write_little_endian( FILE *file, uint32_t value, int bytes ) const
+	{
+		for( int i = 0; i < bytes; i++ )
+		{
+			fputc( ( value >> ( i * 8 ) ) & 0xFF, file );
+		}
+	}
+}
+
@@ -0,0 +1,105 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+#ifndef INTEGRA_OFFLINE_AUDIO_ENGINE_H
+#define INTEGRA_OFFLINE_AUDIO_ENGINE_H
+
+#include "audio_engine.h"
+
+#include <stdio.h>
+#include <stdint.h>
+
+
+namespace integra_api
+{
+	class COfflineRenderInfo;
+	class COfflineRenderResult;
+}
+
+
+namespace integra_internal
+{
+	class CServer;
+
+	/*
+	 COfflineAudioEngine has no driver or devices.  It only processes audio when render is called, 
+	 which drives the dsp engine in a tight loop, as fast as the machine allows, and advances 
+	 players in step with it
+	*/
+
+	class COfflineAudioEngine : public IAudioEngine
+	{
+		public:
+
+			COfflineAudioEngine();
+			~COfflineAudioEngine();
+
+			CError set_driver( const string &driver );
+			CError set_input_device( const string &input_device );
+			CError set_output_device( const string &output_device );
+
+			CError set_sample_rate( int sample_rate );
+			CError set_number_of_input_channels( int input_channels );
+			CError set_number_of_output_channels( int output_channels );
+
+			CError restore_defaults();
+
+			string_vector get_available_drivers() const;
+			string_vector get_available_input_devices() const;
+			string_vector get_available_output_devices() const;
+			int_vector get_available_sample_rates() const;
+
+			string get_selected_driver() const;
+			string get_selected_input_device() const;
+			string get_selected_output_device() const;
+
+			int get_sample_rate() const;
+			int get_number_of_input_channels() const;
+			int get_number_of_output_channels() const;
+
+			void get_driver_statistics( CAudioStatistics &statistics ) const;
+
+			/* must be called without the server locked */
+			CError render( CServer &server, const COfflineRenderInfo &render_info, COfflineRenderResult &result );
+
+		private:
+
+			CError prepare_render( CServer &server, const COfflineRenderInfo &render_info );
+
+			void write_wav_header( FILE *file, int64_t frames ) const;
+			void write_little_endian( FILE *file, uint32_t value, int bytes ) const;
+
+			int m_sample_rate;
+			int m_number_of_input_channels;
+			int m_number_of_output_channels;
+
+			bool m_is_rendering;
+
+			static const int default_sample_rate;
+			static const int default_number_of_channels;
+			static const int max_number_of_channels;
+			static const int potential_sample_rates[];
+	};
+}
+
+
+
+#endif /* INTEGRA_OFFLINE_AUDIO_ENGINE_H */
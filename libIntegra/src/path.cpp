@@ -30,7 +30,8 @@ namespace integra_api
 {
 	CPath::CPath()
 	{
-		m_string_is_valid = false;
+		/* an empty path's string is the empty string */
+		m_string_is_valid = true;
 	}
 
 
@@ -42,7 +43,7 @@ namespace integra_api
 
 	CPath::CPath( const string &path_string )
 	{
-		m_string_is_valid = false;
+		m_string_is_valid = true;
 
 		int element_start = 0;
 		while( true )
@@ -142,16 +143,26 @@ namespace integra_api
 			return;
 		}
 
-		m_elements.push_back( element );
+		if( m_string_is_valid )
+		{
+			/* extend the cached string rather than rebuilding it next time */
+			if( !m_elements.empty() )
+			{
+				m_string += ".";
+			}
 
-		m_string_is_valid = false;
+			m_string += element;
+		}
+
+		m_elements.push_back( element );
 	}
 
 
 	void CPath::copy_from( const CPath &to_copy )
 	{
 		m_elements = to_copy.m_elements;
-		m_string_is_valid = false;
+		m_string = to_copy.m_string;
+		m_string_is_valid = to_copy.m_string_is_valid;
 	}
 
 
@@ -177,6 +188,8 @@ namespace integra_api
 			m_string += m_elements[ i ];
 
 		}
+
+		m_string_is_valid = true;
 	}
 
 
@@ -26,11 +26,13 @@
 #include "node_endpoint.h"
 #include "player_logic.h"
 #include "server.h"
+#include "dsp_engine.h"
 #include "api/command.h"
 #include "api/trace.h"
 
 #include <assert.h>
 #include <unistd.h>
+#include <algorithm>
 
 #ifdef _WINDOWS
 #include <windows.h>	/*for Sleep function */
@@ -42,22 +44,42 @@
 namespace integra_internal
 {
 	/* 
-	 hardcoded player update rate of 40hz 
+	 how often the player thread looks at the audio clock.  Ticks are scheduled ahead by the 
+	 lookahead, so this only needs to be comfortably shorter than the lookahead 
 	*/
-	const int CPlayerHandler::player_update_microseconds = 25000;
+	const int CPlayerHandler::player_poll_microseconds = 5000;
+
+	/* 
+	 when the dsp engine's frame count hasn't advanced for this long, audio is assumed to have 
+	 stopped and players free-run from the system clock instead
+	*/
+	const int CPlayerHandler::free_running_threshold_microseconds = 100000;
 
 	/* 
 	 in case the user updates their clock, or DST starts or ends.  
-	 When elapsed time between player updates exceeds this value, clock is reset to avoid jumping around 
+	 When the free-running clock jumps by more than this, it is reset to avoid jumping around 
 	*/
 	const int CPlayerHandler::player_sanity_check_seconds = 30;
 
 
 
-	CPlayerHandler::CPlayerHandler( CServer &server )
+	CPlayerHandler::CPlayerHandler( CServer &server, int lookahead_milliseconds )
 		:	m_server( server )
 	{
 		pthread_mutex_init( &m_mutex, NULL);
+		pthread_mutex_init( &m_process_mutex, NULL );
+
+		m_lookahead_milliseconds = std::max( lookahead_milliseconds, 0 );
+		m_current_rate = 0;
+
+		m_clock_frames = 0;
+		m_clock_offset = 0;
+		m_audio_clock_is_running = false;
+		m_previous_audio_frames = 0;
+		m_last_audio_microseconds = 0;
+		m_free_running_start_frames = 0;
+		m_free_running_start_microseconds = get_current_microseconds();
+		m_is_stepped = false;
 
 		#ifdef __APPLE__
 			m_thread_shutdown_semaphore= sem_open( "sem_player_thread_shutdown" , O_CREAT, 0777, 0 );
@@ -96,6 +118,7 @@ namespace integra_internal
 		pthread_mutex_unlock( &m_mutex );
 
 		pthread_mutex_destroy( &m_mutex );
+		pthread_mutex_destroy( &m_process_mutex );
 	}
 
 
@@ -148,48 +171,35 @@ namespace integra_internal
 			player_state = lookup->second;
 		}
 
-		/* recreate paths, in case they have changed */
-		player_state->m_tick_path = player_node.get_path();
-		player_state->m_tick_path.append_element( CPlayerLogic::endpoint_tick );
-
-		player_state->m_play_path = player_node.get_path();
-		player_state->m_play_path.append_element( CPlayerLogic::endpoint_play );
+		/* handles stay valid if the player is renamed or moved while playing */
+		player_state->m_tick_handle = tick_endpoint->get_handle();
+		player_state->m_play_handle = play_endpoint->get_handle();
 
 		/*
-		setup all other player state fields
+		restart the player's transport
 		*/
 
-		player_state->m_initial_ticks = *tick_endpoint->get_value(); 
-		player_state->m_previous_ticks = player_state->m_initial_ticks; 
-		player_state->m_rate = *rate_endpoint->get_value();
-		player_state->m_start_msecs = get_current_msecs();
-
-		int loop_value = *loop_endpoint->get_value();
-		player_state->m_loop = ( loop_value != 0 );
-		player_state->m_loop_start_ticks = *start_endpoint->get_value();
-		player_state->m_loop_end_ticks = *end_endpoint->get_value();
-
-		pthread_mutex_unlock( &m_mutex );
-	}
-
-
-	void CPlayerHandler::handle_path_change( const CNode &player_node )
-	{
-		pthread_mutex_lock( &m_mutex );
+		int64_t current_frame = advance_clock();
+		int tick = *tick_endpoint->get_value();
 
-		player_state_map::iterator lookup = m_player_states.find( player_node.get_id() );
-		if( lookup != m_player_states.end() )
+		int64_t start_frame = current_frame;
+		if( lookup != m_player_states.end() && tick == player_state->m_transport.get_current_tick() )
 		{
-			CPlayerState *player_state = lookup->second;
+			/* 
+			 a playing player's other attributes have changed - carry on from the frame of its current tick, 
+			 which may be ahead of current_frame by up to the lookahead
+			*/
+			start_frame = player_state->m_transport.get_current_tick_frame();
+		}
 
-			player_state->m_tick_path = player_node.get_path();
-			player_state->m_tick_path.append_element( CPlayerLogic::endpoint_tick );
+		int rate = *rate_endpoint->get_value();
+		int loop_value = *loop_endpoint->get_value();
+		int loop_start = *start_endpoint->get_value();
+		int loop_end = *end_endpoint->get_value();
 
-			player_state->m_play_path = player_node.get_path();
-			player_state->m_play_path.append_element( CPlayerLogic::endpoint_play );
-		}
+		player_state->m_transport.start( start_frame, m_server.get_dsp_engine().get_sample_rate(), tick, rate, loop_value != 0, loop_start, loop_end );
 
-		pthread_mutex_unlock( &m_mutex );	
+		pthread_mutex_unlock( &m_mutex );
 	}
 
 
@@ -217,12 +227,12 @@ namespace integra_internal
 	}
 
 
-	int64_t CPlayerHandler::get_current_msecs() const
+	int64_t CPlayerHandler::get_current_microseconds() const
 	{
 		#ifdef _WINDOWS
 
 			assert( CLOCKS_PER_SEC == 1000 );
-			return clock();
+			return int64_t( clock() ) * 1000;
 
 		#else
 
@@ -231,9 +241,9 @@ namespace integra_internal
 			gettimeofday( &time_data, NULL );
 
 			int64_t result = time_data.tv_sec;
-			result *= 1000;
+			result *= 1000000;
 	
-			result += ( time_data.tv_usec / 1000 );
+			result += time_data.tv_usec;
 	
 			return result;
 
@@ -241,85 +251,190 @@ namespace integra_internal
 	}
 
 
+	int64_t CPlayerHandler::advance_clock()
+	{
+		/* caller must hold m_mutex */
+
+		const CDspEngine &dsp_engine = m_server.get_dsp_engine();
+
+		int64_t audio_frames = dsp_engine.get_frames_processed();
+		int sample_rate = dsp_engine.get_sample_rate();
+		int64_t current_microseconds = get_current_microseconds();
+
+		if( audio_frames != m_previous_audio_frames )
+		{
+			if( !m_audio_clock_is_running )
+			{
+				/* audio has started - follow it from here without jumping */
+				m_clock_offset = m_clock_frames - audio_frames;
+				m_audio_clock_is_running = true;
+			}
+
+			m_previous_audio_frames = audio_frames;
+			m_last_audio_microseconds = current_microseconds;
+			m_clock_frames = audio_frames + m_clock_offset;
+
+			return m_clock_frames;
+		}
+
+		if( m_is_stepped )
+		{
+			/* the offline renderer drives the clock - it doesn't advance between blocks */
+			return m_clock_frames;
+		}
+
+		if( m_audio_clock_is_running )
+		{
+			if( current_microseconds - m_last_audio_microseconds <= free_running_threshold_microseconds )
+			{
+				return m_clock_frames;
+			}
+
+			/* audio has stopped - free-run from the system clock so that players keep going */
+			m_audio_clock_is_running = false;
+			m_free_running_start_frames = m_clock_frames;
+			m_free_running_start_microseconds = m_last_audio_microseconds;
+		}
+
+		int64_t free_running_frames = m_free_running_start_frames + ( current_microseconds - m_free_running_start_microseconds ) * sample_rate / 1000000;
+
+		if( free_running_frames < m_clock_frames || free_running_frames - m_clock_frames > int64_t( player_sanity_check_seconds ) * sample_rate )
+		{
+			/* the system clock has jumped */
+			m_free_running_start_frames = m_clock_frames;
+			m_free_running_start_microseconds = current_microseconds;
+		}
+		else
+		{
+			m_clock_frames = free_running_frames;
+		}
+
+		return m_clock_frames;
+	}
+
+
+	void CPlayerHandler::set_is_stepped( bool is_stepped )
+	{
+		pthread_mutex_lock( &m_mutex );
+		m_is_stepped = is_stepped;
+		pthread_mutex_unlock( &m_mutex );
+	}
+
+
+	void CPlayerHandler::step()
+	{
+		process_players( true );
+	}
+
+
 	void CPlayerHandler::thread_function()
 	{
 		while( sem_trywait( m_thread_shutdown_semaphore ) < 0 ) 
 		{
-			usleep( CPlayerHandler::player_update_microseconds );
+			usleep( CPlayerHandler::player_poll_microseconds );
+
+			process_players( false );
+		}
+	}
+
+
+	void CPlayerHandler::process_players( bool is_step )
+	{
+		/* players are processed either by the player thread or by step, according to m_is_stepped */
+		pthread_mutex_lock( &m_process_mutex );
+
+		m_scheduled_events.clear();
+
+		pthread_mutex_lock( &m_mutex );
+
+		if( m_is_stepped != is_step )
+		{
+			pthread_mutex_unlock( &m_mutex );
+			pthread_mutex_unlock( &m_process_mutex );
+			return;
+		}
+
+		int64_t current_frame = advance_clock();
+		bool is_audio_clocked = m_audio_clock_is_running;
+		int64_t clock_offset = m_clock_offset;
+
+		/* 
+		 while audio is running, schedule ticks up to the lookahead in advance so that the dsp engine 
+		 can deliver their consequences in the right block regardless of when this thread wakes
+		*/
+		int64_t schedule_end_frame = current_frame;
+		if( is_audio_clocked )
+		{
+			schedule_end_frame += int64_t( m_lookahead_milliseconds ) * m_server.get_dsp_engine().get_sample_rate() / 1000;
+		}
 
-			std::list<ISetCommand *> commands;
+		for( player_state_map::const_iterator i = m_player_states.begin(); i != m_player_states.end(); i++ )
+		{
+			CPlayerState *player_state = i->second;
+
+			m_transport_events.clear();
+			player_state->m_transport.schedule_until( schedule_end_frame, m_transport_events );
+
+			for( CPlayerTransport::event_list::const_iterator j = m_transport_events.begin(); j != m_transport_events.end(); j++ )
+			{
+				CScheduledEvent event;
+				event.m_tick_handle = player_state->m_tick_handle;
+				event.m_play_handle = player_state->m_play_handle;
+				event.m_rate = player_state->m_transport.get_rate();
+				event.m_event = *j;
+				m_scheduled_events.push_back( event );
+			}
+		}
+
+		pthread_mutex_unlock( &m_mutex );
+
+		if( m_scheduled_events.empty() )
+		{
+			pthread_mutex_unlock( &m_process_mutex );
+			return;
+		}
 
-			pthread_mutex_lock( &m_mutex );
+		/* so that scheduled dsp commands reach the dsp engine in frame order */
+		std::stable_sort( m_scheduled_events.begin(), m_scheduled_events.end() );
 
-			int64_t current_msecs = get_current_msecs();
+		if( m_server.lock() )
+		{
+			CDspEngine &dsp_engine = m_server.get_dsp_engine();
 
-			for( player_state_map::const_iterator i = m_player_states.begin(); i != m_player_states.end(); i++ )
+			for( scheduled_event_list::const_iterator i = m_scheduled_events.begin(); i != m_scheduled_events.end(); i++ )
 			{
-				CPlayerState *player_state = i->second;
-				int player_rate = player_state->m_rate;
-				int elapsed_ticks = ( current_msecs - player_state->m_start_msecs ) * player_rate / 1000;
-			
-				int new_tick_value = player_state->m_initial_ticks + elapsed_ticks;
+				const CPlayerTransport::CEvent &event = i->m_event;
 
-				if( abs( new_tick_value - player_state->m_previous_ticks ) > player_sanity_check_seconds * player_rate )
+				if( is_audio_clocked )
 				{
-					/* special case to handle unusual number of elapsed ticks - for example when clocks go forward or back */
-					player_state->m_start_msecs = current_msecs - ( player_state->m_previous_ticks - player_state->m_initial_ticks ) * 1000 / player_rate; 
-					new_tick_value = player_state->m_previous_ticks;
-				}
-		
-				if( new_tick_value >= player_state->m_loop_end_ticks && player_state->m_loop_end_ticks > 0 )
-				{
-					if( player_state->m_loop )
-					{
-						int loop_duration = ( player_state->m_loop_end_ticks - player_state->m_loop_start_ticks );
-						if( loop_duration > 0 )
-						{
-							new_tick_value = ( new_tick_value - player_state->m_loop_start_ticks ) % loop_duration + player_state->m_loop_start_ticks;
-						}
-					}
-					else
-					{
-						commands.push_back( ISetCommand::create( player_state->m_play_path, CIntegerValue( 0 ) ) );
-					}
+					/* any dsp commands which result from this tick are due at the tick's own frame */
+					dsp_engine.set_schedule_frame( event.m_frame - clock_offset );
 				}
 
-				if( new_tick_value != player_state->m_previous_ticks )
+				m_current_rate = i->m_rate;
+
+				if( event.m_stop )
 				{
-					commands.push_back( ISetCommand::create( player_state->m_tick_path, CIntegerValue( new_tick_value ) ) );
-					player_state->m_previous_ticks = new_tick_value;
+					m_server.process_command( ISetCommand::create( i->m_play_handle, CIntegerValue( 0 ) ), CCommandSource::SYSTEM );
 				}
+
+				m_server.process_command( ISetCommand::create( i->m_tick_handle, CIntegerValue( event.m_tick ) ), CCommandSource::SYSTEM );
 			}
 
-			pthread_mutex_unlock( &m_mutex );
+			dsp_engine.set_schedule_frame( 0 );
+			m_current_rate = 0;
 
-			if( !commands.empty() )
-			{
-				if( m_server.lock() )
-				{
-					for( std::list<ISetCommand *>::const_iterator i = commands.begin(); i != commands.end(); i++ )
-					{
-						m_server.process_command( *i, CCommandSource::SYSTEM );
-					}
-				
-					m_server.unlock();
-				}
-			}
+			m_server.unlock();
 		}
+
+		pthread_mutex_unlock( &m_process_mutex );
 	}
 
 
 	CPlayerHandler::CPlayerState::CPlayerState()
+		:	m_transport( CDspEngine::samples_per_buffer )
 	{
 		m_id = 0;
-		m_rate = 0;
-		m_initial_ticks = 0;
-		m_previous_ticks = 0;
-		m_start_msecs = 0;
-
-		m_loop = 0;
-		m_loop_start_ticks = false;
-		m_loop_end_ticks = false;
 	}
 
 
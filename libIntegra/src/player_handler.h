@@ -30,6 +30,7 @@
 
 #include "api/path.h"
 #include "node.h"
+#include "player_transport.h"
 
 using namespace integra_api;
 
@@ -42,22 +43,39 @@ namespace integra_internal
 	class CPlayerHandler
 	{
 		public:
-			CPlayerHandler( CServer &server );
+			CPlayerHandler( CServer &server, int lookahead_milliseconds );
 			~CPlayerHandler();
 
 			void update( const CNode &player_node );
 
-			void handle_path_change( const CNode &player_node );
 			void handle_delete( const CNode &player_node );
 
+			/* 
+			 the rate, in ticks per second, of the player whose tick is currently being processed, 
+			 or 0 if ticks are not currently being processed.  Only meaningful whilst the server is locked
+			*/
+			int get_current_rate() const { return m_current_rate; }
+
+			/* 
+			 while stepped, players are only advanced by calls to step, which the offline renderer makes 
+			 before each block, instead of by the player thread.  This keeps ticks in step with the audio 
+			 however much faster than realtime it is rendered.  step must not be called with the server locked
+			*/
+			void set_is_stepped( bool is_stepped );
+			void step();
+
 		private:
 
 			friend void *player_handler_thread_function( void *context );
 
 			void thread_function();
 
+			void process_players( bool is_step );
+
 			void stop_player( internal_id player_id );
-			int64_t get_current_msecs() const;
+
+			int64_t advance_clock();
+			int64_t get_current_microseconds() const;
 
 
 			class CPlayerState 
@@ -66,30 +84,60 @@ namespace integra_internal
 					CPlayerState();
 
 					integra_internal::internal_id m_id;
-					CPath m_tick_path;
-					CPath m_play_path;
+					CEndpointHandle m_tick_handle;
+					CEndpointHandle m_play_handle;
+
+					CPlayerTransport m_transport;
+			};
+
+			class CScheduledEvent
+			{
+				public:
+					CEndpointHandle m_tick_handle;
+					CEndpointHandle m_play_handle;
 					int m_rate;
-					int m_initial_ticks;
-					int m_previous_ticks;
-					int64_t m_start_msecs;
+					CPlayerTransport::CEvent m_event;
 
-					bool m_loop;
-					int m_loop_start_ticks;
-					int m_loop_end_ticks;
+					bool operator<( const CScheduledEvent &other ) const { return m_event.m_frame < other.m_event.m_frame; }
 			};
 
 			typedef std::unordered_map<internal_id, CPlayerState *> player_state_map;
+			typedef std::vector<CScheduledEvent> scheduled_event_list;
 
 			player_state_map m_player_states;
 
+			/* 
+			 the players' clock, in frames.  It follows the dsp engine's frame count while audio is 
+			 running, and free-runs from the system clock while it is not.  Guarded by m_mutex
+			*/
+			int64_t m_clock_frames;
+			int64_t m_clock_offset;
+			bool m_audio_clock_is_running;
+			int64_t m_previous_audio_frames;
+			int64_t m_last_audio_microseconds;
+			int64_t m_free_running_start_frames;
+			int64_t m_free_running_start_microseconds;
+			bool m_is_stepped;
+
+			int m_lookahead_milliseconds;
+
+			int m_current_rate;
+
+			CPlayerTransport::event_list m_transport_events;
+
+			/* guarded by m_process_mutex, which makes sure players are processed by one thread at a time */
+			scheduled_event_list m_scheduled_events;
+
 			pthread_t m_thread;
 			pthread_mutex_t m_mutex;
+			pthread_mutex_t m_process_mutex;
 
 			sem_t *m_thread_shutdown_semaphore;
 
 			CServer &m_server;
 
-			static const int player_update_microseconds;
+			static const int player_poll_microseconds;
+			static const int free_running_threshold_microseconds;
 			static const int player_sanity_check_seconds;
 	};
     
@@ -23,6 +23,7 @@
 
 #include "player_logic.h"
 #include "scene_logic.h"
+#include "envelope_logic.h"
 #include "server.h"
 #include "node.h"
 #include "node_endpoint.h"
@@ -72,6 +73,7 @@ namespace integra_internal
 			endpoint_name == endpoint_start ||
 			endpoint_name == endpoint_end )
 		{
+			stop_envelopes_rendering_in_dsp( server );
 			server.get_player_handler().update( get_node() );
 			return;
 		}
@@ -80,6 +82,7 @@ namespace integra_internal
 		{
 			if( source != CCommandSource::SYSTEM )
 			{
+				stop_envelopes_rendering_in_dsp( server );
 				server.get_player_handler().update( get_node() );
 			}
 			return;
@@ -111,26 +114,11 @@ namespace integra_internal
 	}
 
 
-	void CPlayerLogic::handle_rename( CServer &server, const string &previous_name, CCommandSource source )
-	{
-		CLogic::handle_rename( server, previous_name, source );
-
-		server.get_player_handler().handle_path_change( get_node() );
-	}
-
-
-	void CPlayerLogic::handle_move( CServer &server, const CPath &previous_path, CCommandSource source )
-	{
-		CLogic::handle_move( server, previous_path, source );
-
-		server.get_player_handler().handle_path_change( get_node() );
-	}
-
-
 	void CPlayerLogic::handle_delete( CServer &server, CCommandSource source )
 	{
 		CLogic::handle_delete( server, source );
 
+		stop_envelopes_rendering_in_dsp( server );
 		server.get_player_handler().handle_delete( get_node() );
 	}
 
@@ -146,14 +134,6 @@ namespace integra_internal
 	}
 
 
-	void CPlayerLogic::update_on_path_change( CServer &server )
-	{
-		CLogic::update_on_path_change( server );
-
-		server.get_player_handler().handle_path_change( get_node() );
-	}
-
-
 	void CPlayerLogic::scene_handler( CServer &server )
 	{
 		/* defaults for values to copy into the player.  The logic below updates these variables */
@@ -412,4 +392,42 @@ namespace integra_internal
 
 		server.process_command( ISetCommand::create( player_play_endpoint->get_path(), CIntegerValue( play ) ), CCommandSource::SYSTEM );
 	}
+
+
+	void CPlayerLogic::stop_envelopes_rendering_in_dsp( CServer &server )
+	{
+		if( !server.should_render_envelopes_in_dsp() )
+		{
+			return;
+		}
+
+		const INodeEndpoint *tick_endpoint = get_node().get_node_endpoint( endpoint_tick );
+		assert( tick_endpoint );
+
+		const connection_list *connections = server.get_connection_routing_table().lookup( tick_endpoint->get_path() );
+		if( !connections )
+		{
+			return;
+		}
+
+		for( connection_list::const_iterator i = connections->begin(); i != connections->end(); i++ )
+		{
+			const CNode *connection = *i;
+
+			const INodeEndpoint *target_path_endpoint = connection->get_node_endpoint( endpoint_target_path );
+			assert( target_path_endpoint );
+
+			const INodeEndpoint *destination = server.find_node_endpoint( CPath( *target_path_endpoint->get_value() ), CNode::downcast( connection->get_parent() ) );
+			if( !destination )
+			{
+				continue;
+			}
+
+			CEnvelopeLogic *envelope_logic = dynamic_cast< CEnvelopeLogic * >( &CNode::downcast( destination->get_node() ).get_logic() );
+			if( envelope_logic )
+			{
+				envelope_logic->stop_rendering_in_dsp( server );
+			}
+		}
+	}
 }
@@ -32,20 +32,18 @@ namespace integra_internal
 	{
 		friend class CSceneLogic;
 		friend class CPlayerHandler;
+		friend class COfflineAudioEngine;
 
 		public:
 			CPlayerLogic( const CNode &node );
 			~CPlayerLogic();
 
 			void handle_set( CServer &server, const CNodeEndpoint &node_endpoint, const CValue *previous_value, CCommandSource source );
-			void handle_rename( CServer &server, const string &previous_name, CCommandSource source );
-			void handle_move( CServer &server, const CPath &previous_path, CCommandSource source );
 			void handle_delete( CServer &server, CCommandSource source );
 
 		private:
 
 			void update_on_activation( CServer &server );
-			void update_on_path_change( CServer &server );
 
 			void scene_handler( CServer &server );
 			void next_handler( CServer &server );
@@ -55,6 +53,9 @@ namespace integra_internal
 
 			void update_player( CServer &server, int tick, int play, int loop, int start, int end );
 
+			/* envelopes driven by this player mustn't carry on ramping in the dsp engine once it stops or jumps */
+			void stop_envelopes_rendering_in_dsp( CServer &server );
+
 			static const string endpoint_play;
 			static const string endpoint_tick;
 			static const string endpoint_start;
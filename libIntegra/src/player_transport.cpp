@@ -0,0 +1,166 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+
+#include "platform_specifics.h"
+
+#include "player_transport.h"
+
+#include <assert.h>
+#include <algorithm>
+
+
+namespace integra_internal
+{
+	CPlayerTransport::CPlayerTransport( int frames_per_block )
+	{
+		assert( frames_per_block > 0 );
+
+		m_frames_per_block = frames_per_block;
+
+		start( 0, 0, 0, 0, false, 0, 0 );
+	}
+
+
+	void CPlayerTransport::start( int64_t start_frame, int sample_rate, int initial_tick, int rate, bool loop, int loop_start_tick, int loop_end_tick )
+	{
+		m_start_frame = start_frame;
+		m_sample_rate = sample_rate;
+		m_initial_tick = initial_tick;
+		m_rate = rate;
+		m_loop = loop;
+		m_loop_start_tick = loop_start_tick;
+		m_loop_end_tick = loop_end_tick;
+
+		/* the initial tick is already current - the first event is for the next tick */
+		m_next_elapsed_ticks = 1;
+		m_previous_tick = initial_tick;
+		m_previous_tick_frame = start_frame;
+		m_stopped = false;
+
+		/* the block containing start_frame may still hold ticks */
+		m_scheduled_until = start_frame - ( start_frame % m_frames_per_block );
+	}
+
+
+	void CPlayerTransport::schedule_until( int64_t end_frame, event_list &events )
+	{
+		int64_t last_block_end = end_frame - ( end_frame % m_frames_per_block );
+
+		if( m_stopped || m_rate <= 0 || m_sample_rate <= 0 )
+		{
+			m_scheduled_until = std::max( m_scheduled_until, last_block_end );
+			return;
+		}
+
+		for( int64_t block_start = m_scheduled_until; block_start < last_block_end; block_start += m_frames_per_block )
+		{
+			int64_t block_end = block_start + m_frames_per_block;
+
+			bool have_event = false;
+			CEvent event;
+
+			while( true )
+			{
+				int64_t tick_frame = get_tick_frame( m_next_elapsed_ticks );
+				if( tick_frame >= block_end )
+				{
+					break;
+				}
+
+				bool stop = false;
+				int tick = get_tick_value( m_next_elapsed_ticks, stop );
+				m_next_elapsed_ticks++;
+
+				if( stop )
+				{
+					event.m_frame = tick_frame;
+					event.m_tick = tick;
+					event.m_stop = true;
+					have_event = true;
+					m_previous_tick = tick;
+					m_previous_tick_frame = tick_frame;
+					m_stopped = true;
+					break;
+				}
+
+				if( tick != m_previous_tick )
+				{
+					event.m_frame = tick_frame;
+					event.m_tick = tick;
+					event.m_stop = false;
+					have_event = true;
+					m_previous_tick = tick;
+					m_previous_tick_frame = tick_frame;
+				}
+			}
+
+			if( have_event )
+			{
+				events.push_back( event );
+			}
+
+			m_scheduled_until = block_end;
+
+			if( m_stopped )
+			{
+				break;
+			}
+		}
+
+		m_scheduled_until = std::max( m_scheduled_until, last_block_end );
+	}
+
+
+	int64_t CPlayerTransport::get_tick_frame( int64_t elapsed_ticks ) const
+	{
+		assert( m_rate > 0 );
+
+		/* rounded up, so that a tick never falls before the frame at which it becomes due */
+		return m_start_frame + ( elapsed_ticks * m_sample_rate + m_rate - 1 ) / m_rate;
+	}
+
+
+	int CPlayerTransport::get_tick_value( int64_t elapsed_ticks, bool &stop ) const
+	{
+		int tick = m_initial_tick + ( int ) elapsed_ticks;
+
+		stop = false;
+
+		if( tick >= m_loop_end_tick && m_loop_end_tick > 0 )
+		{
+			if( m_loop )
+			{
+				int loop_duration = ( m_loop_end_tick - m_loop_start_tick );
+				if( loop_duration > 0 )
+				{
+					tick = ( tick - m_loop_start_tick ) % loop_duration + m_loop_start_tick;
+				}
+			}
+			else
+			{
+				stop = true;
+			}
+		}
+
+		return tick;
+	}
+}
@@ -0,0 +1,103 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+
+#ifndef INTEGRA_PLAYER_TRANSPORT_H
+#define INTEGRA_PLAYER_TRANSPORT_H
+
+#include "api/common_typedefs.h"
+
+#include <vector>
+
+
+namespace integra_internal
+{
+	/*
+	 CPlayerTransport derives a player's tick values from an audio frame count rather than from 
+	 the system clock, so that tick timing depends only on how many frames have been rendered.
+
+	 Tick n (counting from when the player was started) falls exactly on frame 
+	 start_frame + ceil( n * sample_rate / rate ).  schedule_until walks forward in blocks of 
+	 frames_per_block, and produces at most one event per block: the last tick value reached 
+	 within that block, stamped with the exact frame of that tick.
+	*/
+
+	class CPlayerTransport
+	{
+		public:
+
+			class CEvent
+			{
+				public:
+					int64_t m_frame;
+					int m_tick;
+
+					/* a non-looping player has reached its end tick */
+					bool m_stop;
+			};
+
+			typedef std::vector<CEvent> event_list;
+
+			CPlayerTransport( int frames_per_block );
+
+			void start( int64_t start_frame, int sample_rate, int initial_tick, int rate, bool loop, int loop_start_tick, int loop_end_tick );
+
+			/* 
+			 appends events for every whole block which ends at or before end_frame and has not yet 
+			 been scheduled.  Blocks are aligned to multiples of frames_per_block
+			*/
+			void schedule_until( int64_t end_frame, event_list &events );
+
+			bool is_stopped() const { return m_stopped; }
+
+			int get_rate() const { return m_rate; }
+
+			/* the most recently scheduled tick value, and the frame at which it falls */
+			int get_current_tick() const { return m_previous_tick; }
+			int64_t get_current_tick_frame() const { return m_previous_tick_frame; }
+
+			int64_t get_tick_frame( int64_t elapsed_ticks ) const;
+
+		private:
+
+			int get_tick_value( int64_t elapsed_ticks, bool &stop ) const;
+
+			int m_frames_per_block;
+
+			int64_t m_start_frame;
+			int m_sample_rate;
+			int m_initial_tick;
+			int m_rate;
+			bool m_loop;
+			int m_loop_start_tick;
+			int m_loop_end_tick;
+
+			int64_t m_next_elapsed_ticks;
+			int64_t m_scheduled_until;
+			int m_previous_tick;
+			int64_t m_previous_tick_frame;
+			bool m_stopped;
+	};
+}
+
+
+
+#endif /* INTEGRA_PLAYER_TRANSPORT_H */
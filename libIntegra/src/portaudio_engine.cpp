@@ -27,6 +27,7 @@
 #include "ring_buffer.h"
 #include "api/trace.h"
 #include "api/string_helper.h"
+#include "api/audio_statistics.h"
 
 #include <assert.h>
 #include <algorithm>	
@@ -62,6 +63,13 @@ namespace integra_internal
 		m_duplex_stream = NULL;
 
 		m_ring_buffer = new CRingBuffer;
+		m_closed_ring_buffer_overruns = 0;
+		m_closed_ring_buffer_underruns = 0;
+
+		m_input_underflows.store( 0 );
+		m_input_overflows.store( 0 );
+		m_output_underflows.store( 0 );
+		m_output_overflows.store( 0 );
 
 		m_dummy_input_buffer = NULL;
 		m_process_buffer = NULL;
@@ -563,6 +571,30 @@ namespace integra_internal
 	}
 
 
+	void CPortAudioEngine::get_driver_statistics( CAudioStatistics &statistics ) const
+	{
+		statistics.input_underflows = m_input_underflows.load( std::memory_order_relaxed );
+		statistics.input_overflows = m_input_overflows.load( std::memory_order_relaxed );
+		statistics.output_underflows = m_output_underflows.load( std::memory_order_relaxed );
+		statistics.output_overflows = m_output_overflows.load( std::memory_order_relaxed );
+
+		statistics.ring_buffer_overruns = m_closed_ring_buffer_overruns + m_ring_buffer->get_overrun_count();
+		statistics.ring_buffer_underruns = m_closed_ring_buffer_underruns + m_ring_buffer->get_underrun_count();
+
+		/* when input and output are separate streams, report the busier one */
+		statistics.stream_cpu_load = 0;
+
+		PaStream *streams[] = { m_duplex_stream, m_input_stream, m_output_stream };
+		for( int i = 0; i < 3; i++ )
+		{
+			if( streams[ i ] )
+			{
+				statistics.stream_cpu_load = std::max( statistics.stream_cpu_load, Pa_GetStreamCpuLoad( streams[ i ] ) );
+			}
+		}
+	}
+
+
 	void CPortAudioEngine::update_available_apis()
 	{
 		assert( m_initialized_ok );
@@ -819,10 +851,14 @@ namespace integra_internal
 					}
 				}
 
-				create_process_buffer();
-
+				/* 
+				 the input stream may already be running, and only writes to the ring buffer once 
+				 m_process_buffer exists, so the ring buffer must be ready before the process buffer 
+				*/
 				initialize_ring_buffer();
 
+				create_process_buffer();
+
 				PaError result = Pa_OpenStream( &m_output_stream, NULL, &output_parameters, m_sample_rate, CDspEngine::samples_per_buffer, paNoFlag, output_callback, this );
 				if( result == paNoError )
 				{
@@ -889,6 +925,16 @@ namespace integra_internal
 			stop_no_device_thread();
 		}
 
+		if( m_ring_buffer->get_overrun_count() > 0 || m_ring_buffer->get_underrun_count() > 0 )
+		{
+			INTEGRA_TRACE_ERROR << "Ring buffer overruns: " << m_ring_buffer->get_overrun_count() << " (" << m_ring_buffer->get_dropped_frames() << " frames dropped), underruns: " << m_ring_buffer->get_underrun_count() << " (" << m_ring_buffer->get_silent_frames() << " silent frames)";
+		}
+
+		m_closed_ring_buffer_overruns += m_ring_buffer->get_overrun_count();
+		m_closed_ring_buffer_underruns += m_ring_buffer->get_underrun_count();
+
+		m_ring_buffer->reset_counters();
+
 		if( m_dummy_input_buffer )
 		{
 			delete [] m_dummy_input_buffer;
@@ -960,17 +1006,33 @@ namespace integra_internal
 	}
 
 
-	void CPortAudioEngine::input_handler( const void *input_buffer, unsigned long frames_per_buffer, const PaStreamCallbackTimeInfo* time_info, PaStreamCallbackFlags status_flags )
+	void CPortAudioEngine::record_status_flags( PaStreamCallbackFlags status_flags )
 	{
 		if( status_flags & paInputUnderflow )
 		{
-			INTEGRA_TRACE_ERROR << "input underflow";
+			m_input_underflows.fetch_add( 1, std::memory_order_relaxed );
 		}
 
 		if( status_flags & paInputOverflow )
 		{
-			INTEGRA_TRACE_ERROR << "input overflow";
+			m_input_overflows.fetch_add( 1, std::memory_order_relaxed );
 		}
+
+		if( status_flags & paOutputUnderflow )
+		{
+			m_output_underflows.fetch_add( 1, std::memory_order_relaxed );
+		}
+
+		if( status_flags & paOutputOverflow )
+		{
+			m_output_overflows.fetch_add( 1, std::memory_order_relaxed );
+		}
+	}
+
+
+	void CPortAudioEngine::input_handler( const void *input_buffer, unsigned long frames_per_buffer, const PaStreamCallbackTimeInfo* time_info, PaStreamCallbackFlags status_flags )
+	{
+		record_status_flags( status_flags );
 		
 		const float *input = static_cast< const float * > ( input_buffer );
 
@@ -988,15 +1050,7 @@ namespace integra_internal
 
 	void CPortAudioEngine::output_handler( void *output_buffer, unsigned long frames_per_buffer, const PaStreamCallbackTimeInfo* time_info, PaStreamCallbackFlags status_flags )
 	{
-		if( status_flags & paOutputUnderflow )
-		{
-			INTEGRA_TRACE_ERROR << "output underflow";
-		}
-
-		if( status_flags & paOutputOverflow )
-		{
-			INTEGRA_TRACE_ERROR << "output overflow";
-		}
+		record_status_flags( status_flags );
 
 		assert( frames_per_buffer == CDspEngine::samples_per_buffer );
 
@@ -1023,25 +1077,7 @@ namespace integra_internal
 
 	void CPortAudioEngine::duplex_handler( const void *input_buffer, void *output_buffer, unsigned long frames_per_buffer, const PaStreamCallbackTimeInfo* time_info, PaStreamCallbackFlags status_flags )
 	{
-		if( status_flags & paInputUnderflow )
-		{
-			INTEGRA_TRACE_ERROR << "input underflow";
-		}
-
-		if( status_flags & paInputOverflow )
-		{
-			INTEGRA_TRACE_ERROR << "input overflow";
-		}
-
-		if( status_flags & paOutputUnderflow )
-		{
-			INTEGRA_TRACE_ERROR << "output underflow";
-		}
-
-		if( status_flags & paOutputOverflow )
-		{
-			INTEGRA_TRACE_ERROR << "output overflow";
-		}
+		record_status_flags( status_flags );
 
 		assert( frames_per_buffer == CDspEngine::samples_per_buffer );
 
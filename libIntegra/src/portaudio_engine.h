@@ -26,6 +26,8 @@
 #include "portaudio.h"
 
 #include <unordered_map>
+#include <atomic>
+#include <stdint.h>
 
 #include "pthread.h"
 #include <semaphore.h>
@@ -74,6 +76,8 @@ namespace integra_internal
 			int get_number_of_input_channels() const;
 			int get_number_of_output_channels() const;
 
+			void get_driver_statistics( CAudioStatistics &statistics ) const;
+
 		private:
 
 			typedef std::unordered_map<string, PaHostApiTypeId> api_map;
@@ -92,6 +96,9 @@ namespace integra_internal
 
 			int get_default_sample_rate( int device_index ) const;
 
+			/* counts xruns, since audio callbacks mustn't trace */
+			void record_status_flags( PaStreamCallbackFlags status_flags );
+
 			void input_handler( const void *input_buffer, unsigned long frames_per_buffer, const PaStreamCallbackTimeInfo* time_info, PaStreamCallbackFlags status_flags );
 			void output_handler( void *output_buffer, unsigned long frames_per_buffer, const PaStreamCallbackTimeInfo* time_info, PaStreamCallbackFlags status_flags );
 			void duplex_handler( const void *input_buffer, void *output_buffer, unsigned long frames_per_buffer, const PaStreamCallbackTimeInfo* time_info, PaStreamCallbackFlags status_flags );
@@ -137,6 +144,15 @@ namespace integra_internal
 
 			CRingBuffer *m_ring_buffer;
 
+			/* ring buffer counts from streams which have since been closed */
+			int64_t m_closed_ring_buffer_overruns;
+			int64_t m_closed_ring_buffer_underruns;
+
+			std::atomic<unsigned int> m_input_underflows;
+			std::atomic<unsigned int> m_input_overflows;
+			std::atomic<unsigned int> m_output_underflows;
+			std::atomic<unsigned int> m_output_overflows;
+
 			pthread_t *m_no_device_thread;
 			sem_t *m_stop_no_device_thread;
 
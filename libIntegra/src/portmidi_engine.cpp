@@ -27,15 +27,34 @@
 #include "api/string_helper.h"
 
 #include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
 #include <algorithm>	
 
 
 namespace integra_internal
 {
-	CPortMidiEngine::CPortMidiEngine()
+	const int CPortMidiEngine::event_queue_size = 4096;
+	const int CPortMidiEngine::thread_poll_microseconds = 1000;
+
+	/* 
+	 output is opened with latency so that portmidi honours timestamps.  Audio thread output is 
+	 stamped with when its block was processed, so is sent this long afterwards, with its timing intact
+	*/
+	const int CPortMidiEngine::output_latency_milliseconds = 10;
+
+
+	CPortMidiEngine::CPortMidiEngine( CMidiInputDispatcher &input_dispatcher )
+		:	m_input_dispatcher( input_dispatcher )
 	{
 		m_input_event_buffer = new PmEvent[ CMidiInputBuffer::input_buffer_size ];
 
+		m_input_events = new CSpscQueue<CMidiEvent>( event_queue_size );
+		m_output_events = new CSpscQueue<CMidiEvent>( event_queue_size );
+
+		m_clock_start = std::chrono::steady_clock::now();
+		m_thread_is_running = false;
+
 		pthread_mutex_init( &m_input_mutex, NULL );
 		pthread_mutex_init( &m_output_mutex, NULL );
 
@@ -52,12 +71,38 @@ namespace integra_internal
 
 		m_initialized_ok = true;
 
+		#ifdef __APPLE__
+			m_thread_shutdown_semaphore = sem_open( "sem_midi_thread_shutdown", O_CREAT, 0777, 0 );
+		#else
+			m_thread_shutdown_semaphore = new sem_t;
+			sem_init( m_thread_shutdown_semaphore, 0, 0 );
+		#endif
+
+		pthread_create( &m_thread, NULL, portmidi_engine_thread_function, this );
+		m_thread_is_running = true;
+
 		INTEGRA_TRACE_PROGRESS << "Created PortMidi engine";
 	}
 
 
 	CPortMidiEngine::~CPortMidiEngine()
 	{
+		if( m_thread_is_running )
+		{
+			sem_post( m_thread_shutdown_semaphore );
+			pthread_join( m_thread, NULL );
+
+			#ifdef __APPLE__
+				sem_close( m_thread_shutdown_semaphore );
+			#else
+				sem_destroy( m_thread_shutdown_semaphore );
+				delete m_thread_shutdown_semaphore;
+			#endif
+		}
+
+		delete m_input_events;
+		delete m_output_events;
+
 		if( !m_initialized_ok ) 
 		{
 			return;
@@ -327,7 +372,7 @@ namespace integra_internal
 		device.id = device_id;
 		device.name = m_available_input_devices.at( device_id );
 
-		PmError result = Pm_OpenInput( &device.stream, device_id, NULL, CMidiInputBuffer::input_buffer_size, NULL, NULL );
+		PmError result = Pm_OpenInput( &device.stream, device_id, NULL, CMidiInputBuffer::input_buffer_size, get_portmidi_time, this );
 
 		if( result == pmNoError )
 		{
@@ -371,7 +416,7 @@ namespace integra_internal
 		device.id = device_id;
 		device.name = m_available_output_devices.at( device_id );
 
-		PmError result = Pm_OpenOutput( &device.stream, device_id, NULL, 0, NULL, NULL, 0 );
+		PmError result = Pm_OpenOutput( &device.stream, device_id, NULL, event_queue_size, get_portmidi_time, this, output_latency_milliseconds );
 
 		if( result == pmNoError )
 		{
@@ -418,128 +463,143 @@ namespace integra_internal
 	}
 
 
-	CError CPortMidiEngine::poll_input( midi_input_buffer_array &input_buffers )
+	bool CPortMidiEngine::read_input_event( CMidiEvent &event )
+	{
+		return m_input_events->pop( event );
+	}
+
+
+	bool CPortMidiEngine::write_output_event( const CMidiEvent &event )
+	{
+		return m_output_events->push( event );
+	}
+
+
+	int CPortMidiEngine::get_time() const
 	{
-		CError result = CError::SUCCESS;
+		return std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - m_clock_start ).count();
+	}
+
+
+	PmTimestamp CPortMidiEngine::get_portmidi_time( void *context )
+	{
+		return static_cast< CPortMidiEngine * >( context )->get_time();
+	}
+
+
+	void CPortMidiEngine::thread_function()
+	{
+		midi_message_list dispatch_messages;
+
+		while( sem_trywait( m_thread_shutdown_semaphore ) < 0 )
+		{
+			usleep( thread_poll_microseconds );
 
+			read_input( dispatch_messages );
+
+			if( !dispatch_messages.empty() )
+			{
+				m_input_dispatcher.dispatch_midi( dispatch_messages );
+				dispatch_messages.clear();
+			}
+
+			write_output();
+		}
+	}
+
+
+	void CPortMidiEngine::read_input( midi_message_list &dispatch_messages )
+	{
 		pthread_mutex_lock( &m_input_mutex );
 
-		input_buffers.resize( m_active_input_devices.size() );
+		CMidiMessage midi_message;
+		CMidiEvent event;
 
 		for( int i = 0; i < m_active_input_devices.size(); i++ )
 		{
 			const CMidiDevice &midi_device = m_active_input_devices[ i ];
-			CMidiInputBuffer &buffer = input_buffers[ i ];
-			buffer.device_name = midi_device.name;
-			buffer.number_of_messages = 0;
 
 			PmError poll_result = Pm_Poll( midi_device.stream );
 			if( poll_result != TRUE )
 			{
-				if( poll_result == FALSE )
-				{
-					continue;
-				}
-				else
+				if( poll_result != FALSE )
 				{
 					INTEGRA_TRACE_ERROR << "Error polling for incoming midi: " << Pm_GetErrorText( poll_result );
-					result = CError::FAILED;
-					continue;
 				}
+
+				continue;
 			}
 
 			int number_of_events = Pm_Read( midi_device.stream, m_input_event_buffer, CMidiInputBuffer::input_buffer_size );
 			if( number_of_events < 0 )
 			{
 				INTEGRA_TRACE_ERROR << "Error reading midi input: " << Pm_GetErrorText( ( PmError ) number_of_events );
-				result = CError::FAILED;
 				continue;			
 			}
 
-			buffer.number_of_messages = number_of_events;
+			midi_message.device = midi_device.name;
+			event.device_index = i;
 
-			for( int i = 0; i < number_of_events; i++ )
+			for( int j = 0; j < number_of_events; j++ )
 			{
-				PmMessage &message = m_input_event_buffer[ i ].message;
+				const PmEvent &input_event = m_input_event_buffer[ j ];
+
+				event.timestamp = input_event.timestamp;
+				event.message = input_event.message;
+
+				if( !m_input_events->push( event ) )
+				{
+					INTEGRA_TRACE_ERROR << "midi input queue is full - dropping incoming midi";
+				}
 
-				buffer.messages[ i ] = message;
+				midi_message.message = input_event.message;
+				dispatch_messages.push_back( midi_message );
 			}
 		}
 
 		pthread_mutex_unlock( &m_input_mutex );
-
-		return result;
 	}
 
 
-	CError CPortMidiEngine::send_midi_message( const string &device_name, unsigned int message )
+	void CPortMidiEngine::write_output()
 	{
-		CError result( CError::SUCCESS );
+		if( m_output_events->is_empty() )
+		{
+			return;
+		}
 
 		pthread_mutex_lock( &m_output_mutex );
 
-		bool found = false;
+		CMidiEvent event;
+		PmEvent output_event;
 
-		for( device_vector::const_iterator i = m_active_output_devices.begin(); i != m_active_output_devices.end(); i++ )
+		while( m_output_events->pop( event ) )
 		{
-			if( i->name == device_name ) 
+			if( event.device_index < 0 || event.device_index >= m_active_output_devices.size() )
 			{
-				found = true;
-				PmError error = Pm_WriteShort( i->stream, 0, message );
-				if( error == pmNoError )
-				{
-					break;
-				}
-				else
-				{
-					INTEGRA_TRACE_ERROR << "Error sending midi output: " << Pm_GetErrorText( error );
-					result = CError::FAILED;
-					break;
-				}
+				INTEGRA_TRACE_ERROR << "Can't send midi output.  Device index " << event.device_index << " is out of range";
+				continue;
 			}
-		}
-
-		if( !found )
-		{
-			//device not open / not found
-			INTEGRA_TRACE_ERROR << "Can't send midi output to device: " << device_name << " as this device doesn't exist, or isn't open";
-			result = CError::INPUT_ERROR;
-		}
-
-		pthread_mutex_unlock( &m_output_mutex );
-
-		return result;
-	}
-
-
-	CError CPortMidiEngine::send_midi_message( int device_index, unsigned int message )
-	{
-		CError result( CError::SUCCESS );
-
-		pthread_mutex_lock( &m_output_mutex );
 
-		if( device_index >= 0 && device_index < m_active_output_devices.size() )
-		{
-			const CMidiDevice &device = m_active_output_devices[ device_index ];
+			output_event.message = event.message;
+			output_event.timestamp = event.timestamp;
 
-			PmError error = Pm_WriteShort( device.stream, 0, message );
+			PmError error = Pm_Write( m_active_output_devices[ event.device_index ].stream, &output_event, 1 );
 			if( error != pmNoError )
 			{
 				INTEGRA_TRACE_ERROR << "Error sending midi output: " << Pm_GetErrorText( error );
-				result = CError::FAILED;
 			}
 		}
-		else
-		{
-			//device index out of range
-			INTEGRA_TRACE_ERROR << "Can't send midi output.  Device index " << device_index << " is out of range";
-			result = CError::INPUT_ERROR;
-		}
 
 		pthread_mutex_unlock( &m_output_mutex );
+	}
+
 
-		return result;
+	void *portmidi_engine_thread_function( void *context )
+	{
+		CPortMidiEngine *midi_engine = static_cast< CPortMidiEngine * >( context );
+		midi_engine->thread_function();
+
+		return NULL;
 	}
 }
-
- 
\ No newline at end of file
@@ -23,9 +23,13 @@
 #define INTEGRA_PORT_MIDI_ENGINE_H
 
 #include "midi_engine.h"
+#include "midi_input_dispatcher.h"
+#include "spsc_queue.h"
 #include "portmidi.h"
 
 #include <pthread.h>
+#include <semaphore.h>
+#include <chrono>
 
 #include <map>
 
@@ -36,7 +40,7 @@ namespace integra_internal
 	{
 		public:
 
-			CPortMidiEngine();
+			CPortMidiEngine( CMidiInputDispatcher &input_dispatcher );
 			~CPortMidiEngine();
 
 			CError set_input_devices( const string_vector &input_devices );
@@ -50,13 +54,23 @@ namespace integra_internal
 			string_vector get_active_input_devices() const;
 			string_vector get_active_output_devices() const;
 
-			CError poll_input( midi_input_buffer_array &input_buffers );
+			bool read_input_event( CMidiEvent &event );
+			bool write_output_event( const CMidiEvent &event );
 
-			CError send_midi_message( const string &device_name, unsigned int message );
-			CError send_midi_message( int device_index, unsigned int message );
+			int get_time() const;
 
 		private:
 
+			friend void *portmidi_engine_thread_function( void *context );
+
+			/* the midi i/o thread reads input devices and writes output devices, so the audio thread never calls portmidi */
+			void thread_function();
+
+			void read_input( midi_message_list &dispatch_messages );
+			void write_output();
+
+			static PmTimestamp get_portmidi_time( void *context );
+
 			class CMidiDevice
 			{
 				public:
@@ -99,7 +113,26 @@ namespace integra_internal
 			pthread_mutex_t m_output_mutex;
 
 			PmEvent *m_input_event_buffer;
+
+			CMidiInputDispatcher &m_input_dispatcher;
+
+			/* input for the audio thread, and output from it */
+			CSpscQueue<CMidiEvent> *m_input_events;
+			CSpscQueue<CMidiEvent> *m_output_events;
+
+			std::chrono::steady_clock::time_point m_clock_start;
+
+			pthread_t m_thread;
+			sem_t *m_thread_shutdown_semaphore;
+			bool m_thread_is_running;
+
+			static const int event_queue_size;
+			static const int thread_poll_microseconds;
+			static const int output_latency_milliseconds;
 	};
+
+
+	void *portmidi_engine_thread_function( void *context );
 }
 
 
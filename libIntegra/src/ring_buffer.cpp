@@ -23,7 +23,6 @@
 #include "platform_specifics.h"
 
 #include "ring_buffer.h"
-#include "api/trace.h"
 
 #include <string.h>
 #include <assert.h>
@@ -35,27 +34,22 @@ namespace integra_internal
 	{
 		m_buffer = NULL;
 		m_buffer_frames = 0;
+		m_frame_mask = 0;
 		m_number_of_channels = 0;
 
-		m_read_pos = 0;
-		m_frames_used = 0;
+		m_write_frame.store( 0 );
+		m_read_frame.store( 0 );
 
-		pthread_mutex_init( &m_mutex, NULL );
+		reset_counters();
 	}
 
 
 	CRingBuffer::~CRingBuffer()
 	{
-		pthread_mutex_lock( &m_mutex );
-
 		if( m_buffer )
 		{
 			delete [] m_buffer;
 		}
-
-		pthread_mutex_unlock( &m_mutex );
-
-		pthread_mutex_destroy( &m_mutex );
 	}
 
 
@@ -76,142 +70,146 @@ namespace integra_internal
 			m_buffer = NULL;
 		}
 
-		m_read_pos = 0;
-		m_frames_used = 0;
+		m_write_frame.store( 0 );
+		m_read_frame.store( 0 );
 	}
 
 
 	void CRingBuffer::set_number_of_channels( unsigned int number_of_channels )
 	{
-		pthread_mutex_lock( &m_mutex );
-
 		if( number_of_channels != m_number_of_channels )
 		{
 			m_number_of_channels = number_of_channels;
 
 			recreate_buffer();
 		}
-
-		pthread_mutex_unlock( &m_mutex );
 	}
 
 
 	void CRingBuffer::set_buffer_length( unsigned int buffer_frames )
 	{
-		pthread_mutex_lock( &m_mutex );
+		unsigned int rounded_buffer_frames = 0;
+		if( buffer_frames > 0 )
+		{
+			rounded_buffer_frames = 1;
+			while( rounded_buffer_frames < buffer_frames )
+			{
+				rounded_buffer_frames <<= 1;
+			}
+		}
 
-		if( buffer_frames != m_buffer_frames )
+		if( rounded_buffer_frames != m_buffer_frames )
 		{
-			m_buffer_frames = buffer_frames;
+			m_buffer_frames = rounded_buffer_frames;
+			m_frame_mask = ( m_buffer_frames > 0 ) ? m_buffer_frames - 1 : 0;
 
 			recreate_buffer();
 		}
-
-		pthread_mutex_unlock( &m_mutex );
 	}
 
 
 	void CRingBuffer::clear()
 	{
-		pthread_mutex_lock( &m_mutex );
-
 		if( m_buffer )
 		{
 			memset( m_buffer, 0, m_buffer_frames * m_number_of_channels * sizeof( float ) );
-			m_read_pos = 0;
-			m_frames_used = 0;
 		}
 
-		pthread_mutex_unlock( &m_mutex );
+		m_write_frame.store( 0 );
+		m_read_frame.store( 0 );
 	}
 
 
-	void CRingBuffer::write( const float *buffer, unsigned int sample_frames )
+	void CRingBuffer::reset_counters()
 	{
-		pthread_mutex_lock( &m_mutex );
+		m_overrun_count.store( 0 );
+		m_underrun_count.store( 0 );
+		m_dropped_frames.store( 0 );
+		m_silent_frames.store( 0 );
+	}
 
-		if( m_buffer )
+
+	void CRingBuffer::write( const float *buffer, unsigned int sample_frames )
+	{
+		if( !m_buffer )
 		{
-			if( m_frames_used + sample_frames > m_buffer_frames )
-			{
-				int overrun = m_frames_used + sample_frames - m_buffer_frames;
-				assert( overrun > 0 );
+			return;
+		}
 
-				INTEGRA_TRACE_ERROR << "Ringbuffer overrun - skipping " << overrun << " frames";
-				sample_frames -= overrun;
-			}
+		unsigned int write_frame = m_write_frame.load( std::memory_order_relaxed );
+		unsigned int read_frame = m_read_frame.load( std::memory_order_acquire );
 
-			int write_pos = m_read_pos + m_frames_used;
-			if( write_pos >= m_buffer_frames )
-			{
-				write_pos -= m_buffer_frames;
-			}
+		unsigned int frames_used = write_frame - read_frame;
+		assert( frames_used <= m_buffer_frames );
 
-			assert( write_pos >= 0 && write_pos < m_buffer_frames );
+		unsigned int frames_free = m_buffer_frames - frames_used;
+		if( sample_frames > frames_free )
+		{
+			/* overrun - skip the frames which don't fit */
+			m_overrun_count.fetch_add( 1, std::memory_order_relaxed );
+			m_dropped_frames.fetch_add( sample_frames - frames_free, std::memory_order_relaxed );
 
-			int unwrapped_frames = MIN( sample_frames, m_buffer_frames - write_pos );
-			memcpy( m_buffer + write_pos * m_number_of_channels, buffer, unwrapped_frames * m_number_of_channels * sizeof( float ) );
+			sample_frames = frames_free;
+		}
 
-			if( unwrapped_frames < sample_frames )
-			{
-				int wrapped_frames = sample_frames - unwrapped_frames;
-				memcpy( m_buffer, buffer + unwrapped_frames * m_number_of_channels, wrapped_frames * m_number_of_channels * sizeof( float ) );
-			}
+		unsigned int write_pos = write_frame & m_frame_mask;
 
-			m_frames_used += sample_frames;
-		}
-		else
+		unsigned int unwrapped_frames = MIN( sample_frames, m_buffer_frames - write_pos );
+		memcpy( m_buffer + write_pos * m_number_of_channels, buffer, unwrapped_frames * m_number_of_channels * sizeof( float ) );
+
+		if( unwrapped_frames < sample_frames )
 		{
-			INTEGRA_TRACE_ERROR << "Can't write to buffer - not initialised";
+			unsigned int wrapped_frames = sample_frames - unwrapped_frames;
+			memcpy( m_buffer, buffer + unwrapped_frames * m_number_of_channels, wrapped_frames * m_number_of_channels * sizeof( float ) );
 		}
 
-		pthread_mutex_unlock( &m_mutex );
+		m_write_frame.store( write_frame + sample_frames, std::memory_order_release );
 	}
 
 
 	void CRingBuffer::read( float *buffer, unsigned int sample_frames )
 	{
-		pthread_mutex_lock( &m_mutex );
+		if( !buffer )
+		{
+			return;
+		}
 
-		if( buffer )
+		if( !m_buffer )
 		{
-			if( sample_frames > m_frames_used )
-			{
-				int underrun_frames = sample_frames - m_frames_used;
+			memset( buffer, 0, sample_frames * m_number_of_channels * sizeof( float ) );
+			return;
+		}
 
-				INTEGRA_TRACE_ERROR << "Ringbuffer underrun - skipping " << underrun_frames << " frames";
+		unsigned int read_frame = m_read_frame.load( std::memory_order_relaxed );
+		unsigned int write_frame = m_write_frame.load( std::memory_order_acquire );
 
-				memset( buffer + m_frames_used * m_number_of_channels, 0, underrun_frames * m_number_of_channels * sizeof( float ) );
+		unsigned int frames_used = write_frame - read_frame;
+		assert( frames_used <= m_buffer_frames );
 
-				sample_frames = m_frames_used;
-			}
+		if( sample_frames > frames_used )
+		{
+			/* underrun - pad with silence */
+			unsigned int underrun_frames = sample_frames - frames_used;
 
-			int unwrapped_frames = MIN( sample_frames, m_buffer_frames - m_read_pos );
-			memcpy( buffer, m_buffer + m_read_pos * m_number_of_channels, unwrapped_frames * m_number_of_channels * sizeof( float ) );
+			m_underrun_count.fetch_add( 1, std::memory_order_relaxed );
+			m_silent_frames.fetch_add( underrun_frames, std::memory_order_relaxed );
 
-			if( unwrapped_frames < sample_frames )
-			{
-				int wrapped_frames = sample_frames - unwrapped_frames;
-				memcpy( buffer + unwrapped_frames * m_number_of_channels, m_buffer, wrapped_frames * m_number_of_channels * sizeof( float ) );
-			}
+			memset( buffer + frames_used * m_number_of_channels, 0, underrun_frames * m_number_of_channels * sizeof( float ) );
 
-			m_frames_used -= sample_frames;
-			m_read_pos += sample_frames;
+			sample_frames = frames_used;
+		}
 
-			if( m_read_pos >= m_buffer_frames )
-			{
-				m_read_pos -= m_buffer_frames;
-			}
+		unsigned int read_pos = read_frame & m_frame_mask;
 
-			assert( m_read_pos >= 0 && m_read_pos < m_buffer_frames );
-		}
-		else
+		unsigned int unwrapped_frames = MIN( sample_frames, m_buffer_frames - read_pos );
+		memcpy( buffer, m_buffer + read_pos * m_number_of_channels, unwrapped_frames * m_number_of_channels * sizeof( float ) );
+
+		if( unwrapped_frames < sample_frames )
 		{
-			INTEGRA_TRACE_ERROR << "Can't read from buffer - not initialised";
+			unsigned int wrapped_frames = sample_frames - unwrapped_frames;
+			memcpy( buffer + unwrapped_frames * m_number_of_channels, m_buffer, wrapped_frames * m_number_of_channels * sizeof( float ) );
 		}
 
-		pthread_mutex_unlock( &m_mutex );
+		m_read_frame.store( read_frame + sample_frames, std::memory_order_release );
 	}
 }
-
- 
\ No newline at end of file
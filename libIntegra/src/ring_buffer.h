@@ -22,11 +22,22 @@
 #ifndef INTEGRA_RING_BUFFER_H
 #define INTEGRA_RING_BUFFER_H
 
-#include <pthread.h>
+#include <atomic>
 
 
 namespace integra_internal
 {
+	/*
+	 CRingBuffer is a wait-free single-producer/single-consumer ring of interleaved audio frames.
+
+	 write may only be called from one thread and read from one other thread.  Neither ever blocks 
+	 or traces, so they are safe to call from audio callbacks.  Overruns and underruns are counted 
+	 instead, and can be read from any thread.
+
+	 set_number_of_channels, set_buffer_length and clear must not be called whilst another thread 
+	 is reading or writing.
+	*/
+
 	class CRingBuffer
 	{
 		public:
@@ -35,6 +46,8 @@ namespace integra_internal
 			~CRingBuffer();
 
 			void set_number_of_channels( unsigned int number_of_channels );
+
+			/* buffer length is rounded up to the next power of two */
 			void set_buffer_length( unsigned int buffer_frames );
 
 			void clear();
@@ -42,21 +55,33 @@ namespace integra_internal
 			void write( const float *buffer, unsigned int sample_frames );
 			void read( float *buffer, unsigned int sample_frames );
 
+			unsigned int get_overrun_count() const { return m_overrun_count.load( std::memory_order_relaxed ); }
+			unsigned int get_underrun_count() const { return m_underrun_count.load( std::memory_order_relaxed ); }
+			unsigned int get_dropped_frames() const { return m_dropped_frames.load( std::memory_order_relaxed ); }
+			unsigned int get_silent_frames() const { return m_silent_frames.load( std::memory_order_relaxed ); }
+
+			void reset_counters();
+
 		private:
 
 			void recreate_buffer();
 
 			float *m_buffer;
 			unsigned int m_buffer_frames;
+			unsigned int m_frame_mask;
 			unsigned int m_number_of_channels;
 
-			unsigned int m_read_pos;
-			unsigned int m_frames_used;
+			/* free-running frame counters - only their difference (masked) is meaningful */
+			std::atomic<unsigned int> m_write_frame;
+			std::atomic<unsigned int> m_read_frame;
 
-			pthread_mutex_t m_mutex;
+			std::atomic<unsigned int> m_overrun_count;
+			std::atomic<unsigned int> m_underrun_count;
+			std::atomic<unsigned int> m_dropped_frames;
+			std::atomic<unsigned int> m_silent_frames;
 	};
 }
 
 
 
-#endif /* INTEGRA_PORT_AUDIO_ENGINE_H */
\ No newline at end of file
+#endif /* INTEGRA_RING_BUFFER_H */
\ No newline at end of file
@@ -221,7 +221,7 @@ namespace integra_internal
 		}
 
 		/*store result*/
-		server.process_command( ISetCommand::create( out_value_endpoint->get_path(), CFloatValue( output_value ) ), CCommandSource::SYSTEM );
+		server.process_command( ISetCommand::create( out_value_endpoint->get_handle(), CFloatValue( output_value ) ), CCommandSource::SYSTEM );
 	}
 
 
@@ -44,11 +44,17 @@ namespace integra_internal
 	CScriptLogic::CScriptLogic( const CNode &node )
 		:	CLogic( node )
 	{
+		m_script_state = NULL;
+		m_run_depth = 0;
 	}
 
 
 	CScriptLogic::~CScriptLogic()
 	{
+		if( m_script_state )
+		{
+			delete m_script_state;
+		}
 	}
 
 	
@@ -77,9 +83,42 @@ namespace integra_internal
 
 		INTEGRA_TRACE_VERBOSE << "running script...   " << script;
 
+		CLuaEngine &lua_engine = server.get_lua_engine();
+
+		CLuaScriptState *script_state = NULL;
+
+		if( m_run_depth > 0 )
+		{
+			/* nested run - the cached state can't be reset or replaced until the outer run returns */
+			script_state = lua_engine.create_script_state( script );
+		}
+		else
+		{
+			if( m_script_state && m_script_state->get_script() != script )
+			{
+				delete m_script_state;
+				m_script_state = NULL;
+			}
+
+			if( !m_script_state )
+			{
+				m_script_state = lua_engine.create_script_state( script );
+			}
+
+			script_state = m_script_state;
+		}
+
 		const CPath &parent_path = script_node.get_parent_path();
 	
-		string script_output = server.get_lua_engine().run_script( server, parent_path, script );
+		m_run_depth++;
+		string script_output = lua_engine.run_script( server, parent_path, *script_state );
+		m_run_depth--;
+
+		if( script_state != m_script_state )
+		{
+			delete script_state;
+		}
+
 		server.process_command( ISetCommand::create( script_node.get_node_endpoint( endpoint_info )->get_path(), CStringValue( script_output ) ), CCommandSource::SYSTEM );
 
 		INTEGRA_TRACE_VERBOSE << "script finished";
@@ -30,6 +30,9 @@ using namespace integra_api;
 
 namespace integra_internal
 {
+	class CLuaScriptState;
+
+
 	class CScriptLogic : public CLogic
 	{
 		public:
@@ -42,6 +45,15 @@ namespace integra_internal
 
 			void trigger_handler( CServer &server );
 
+			/* kept between triggers, and recreated when the script text changes */
+			CLuaScriptState *m_script_state;
+
+			/* 
+			 scripts which are running.  A script which triggers its own node runs in a temporary state, 
+			 since m_script_state is still executing the outer run
+			*/
+			int m_run_depth;
+
 			const static string endpoint_trigger;
 			const static string endpoint_text;
 			const static string endpoint_info;
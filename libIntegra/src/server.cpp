@@ -33,6 +33,7 @@
 #include "audio_engine.h"
 #include "midi_engine.h"
 #include "midi_input_dispatcher.h"
+#include "audio_statistics_publisher.h"
 
 #include "api/server_startup_info.h"
 #include "api/command.h"
@@ -41,6 +42,7 @@
 #include "api/path.h"
 #include "api/trace.h"
 #include "api/notification_sink.h"
+#include "api/audio_statistics.h"
 
 #include <assert.h>
 #include <iostream>
@@ -76,26 +78,36 @@ namespace integra_internal
 
 		m_next_internal_id = 0;
 
+		m_dsp_engine = NULL;
+
 		m_scratch_directory = new CScratchDirectory;
 
 		m_lua_engine = new CLuaEngine;
 
-		m_player_handler = new CPlayerHandler( *this );
-
-		m_module_manager = new CModuleManager( *this, startup_info.system_module_directory, startup_info.third_party_module_directory );
+		m_module_manager = new CModuleManager( *this, startup_info.system_module_directory, startup_info.third_party_module_directory, startup_info.module_cache_directory, startup_info.extract_module_implementations );
 
 		m_midi_input_dispatcher = new CMidiInputDispatcher( *this );
 
-		m_midi_engine = IMidiEngine::create_midi_engine();
+		m_midi_engine = IMidiEngine::create_midi_engine( *m_midi_input_dispatcher );
 
 		m_dsp_engine = new CDspEngine( *this );
 
-		m_audio_engine = IAudioEngine::create_audio_engine( *m_dsp_engine );
+		m_audio_engine = IAudioEngine::create_audio_engine( *m_dsp_engine, startup_info.offline_rendering );
+
+		/* players are clocked by the dsp engine, so must be created after it */
+		m_player_handler = new CPlayerHandler( *this, startup_info.player_lookahead_milliseconds );
 
 		m_notification_sink = startup_info.notification_sink;
 
+		m_open_command_batch = NULL;
+
+		m_render_envelopes_in_dsp = startup_info.render_envelopes_in_dsp;
+
 		m_reentrance_checker = new CReentranceChecker();
 
+		/* reads the dsp and audio engines, and publishes to nodes, so must be created last */
+		m_audio_statistics_publisher = new CAudioStatisticsPublisher( *this );
+
 		INTEGRA_TRACE_PROGRESS << "Server construction complete";
 	}
 
@@ -110,16 +122,25 @@ namespace integra_internal
 
 		unlock();
 
+		delete m_audio_statistics_publisher;
+
 		/* delete all nodes */
+		m_dsp_engine->begin_graph_edit();
+
 		node_map copy_of_nodes = m_nodes;
 		for( node_map::const_iterator i = copy_of_nodes.begin(); i != copy_of_nodes.end(); i++ )
 		{
 			process_command( IDeleteCommand::create( i->second->get_path() ), CCommandSource::SYSTEM );
 		}
+
+		m_dsp_engine->end_graph_edit();
 	
+		delete m_player_handler;
+
 		delete m_audio_engine;
 
 		delete m_dsp_engine;
+		m_dsp_engine = NULL;
 
 		delete m_midi_engine;
 
@@ -133,8 +154,6 @@ namespace integra_internal
 
 		delete m_lua_engine;
 
-		delete m_player_handler;
-
 		INTEGRA_TRACE_PROGRESS << "cleaning up XML parser";
 		xmlCleanupParser();
 		xmlCleanupGlobals();
@@ -280,9 +299,29 @@ namespace integra_internal
 	}
 
 
+	const INodeEndpoint *CServer::find_node_endpoint( const CEndpointHandle &handle ) const
+	{
+		return m_state_table.lookup_node_endpoint( handle );
+	}
+
+
+	CNodeEndpoint *CServer::find_node_endpoint_writable( const CEndpointHandle &handle )
+	{
+		return m_state_table.lookup_node_endpoint_writable( handle );
+	}
+
+
 	const CValue *CServer::get_value( const CPath &path ) const
 	{
-		const INodeEndpoint *node_endpoint = find_node_endpoint( path.get_string() );
+		const INodeEndpoint *node_endpoint = find_node_endpoint( path );
+		
+		return node_endpoint ? node_endpoint->get_value() : NULL;
+	}
+
+
+	const CValue *CServer::get_value( const CEndpointHandle &handle ) const
+	{
+		const INodeEndpoint *node_endpoint = find_node_endpoint( handle );
 		
 		return node_endpoint ? node_endpoint->get_value() : NULL;
 	}
@@ -420,7 +459,7 @@ namespace integra_internal
 
 			GetModuleHandleEx( GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS| 
 							GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
-							(LPCTSTR) CTrace::error, 
+							(LPCTSTR) CTrace::set_categories_to_trace, 
 							&module_handle);
 
 			size = GetModuleFileName(module_handle, file_name, _MAX_PATH);
@@ -455,6 +494,12 @@ namespace integra_internal
 
 		#endif
 	}
+
+
+	CAudioStatistics CServer::get_audio_statistics() const
+	{
+		return m_audio_statistics_publisher->get_latest_statistics();
+	}
 }
 
 
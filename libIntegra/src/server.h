@@ -26,6 +26,7 @@
 
 #include "node.h"
 #include "state_table.h"
+#include "connection_routing_table.h"
 
 #include "api/path.h"
 #include "api/command_source.h"
@@ -58,6 +59,8 @@ namespace integra_internal
 	class IAudioEngine;
 	class IMidiEngine;
 	class CMidiInputDispatcher;
+	class CCommandBatch;
+	class CAudioStatisticsPublisher;
 
 
 	class CServer : public IServer
@@ -85,7 +88,11 @@ namespace integra_internal
 			const INodeEndpoint *find_node_endpoint( const CPath &path, const INode *relative_to = NULL ) const;
 			CNodeEndpoint *find_node_endpoint_writable( const CPath &path, const CNode *relative_to = NULL );
 
+			const INodeEndpoint *find_node_endpoint( const CEndpointHandle &handle ) const;
+			CNodeEndpoint *find_node_endpoint_writable( const CEndpointHandle &handle );
+
 			const CValue *get_value( const CPath &path ) const;
+			const CValue *get_value( const CEndpointHandle &handle ) const;
 
 			/* exposed in IServer, to process commands from the public api */
 			CError process_command( ICommand *command, CCommandResult *result );
@@ -95,12 +102,17 @@ namespace integra_internal
 
 			CStateTable &get_state_table() { return m_state_table;  }
 
+			CConnectionRoutingTable &get_connection_routing_table() { return m_connection_routing_table; }
+
 			CReentranceChecker &get_reentrance_checker() const { return *m_reentrance_checker; }
 
 			IModuleManager &get_module_manager() const;
 
 			CDspEngine &get_dsp_engine() const { return *m_dsp_engine; }
 
+			/* false whilst modules are loaded during construction, and once the dsp engine has been shut down */
+			bool has_dsp_engine() const { return ( m_dsp_engine != NULL ); }
+
 			IAudioEngine &get_audio_engine() const { return *m_audio_engine; }
 			IMidiEngine &get_midi_engine() const { return *m_midi_engine; }
 
@@ -117,6 +129,12 @@ namespace integra_internal
 
 			INotificationSink *get_notification_sink() { return m_notification_sink; }
 
+			bool should_render_envelopes_in_dsp() const { return m_render_envelopes_in_dsp; }
+
+			/* the batch currently being applied, if any.  Set commands defer dsp sends and notifications to it */
+			CCommandBatch *get_open_command_batch() const { return m_open_command_batch; }
+			void set_open_command_batch( CCommandBatch *command_batch ) { m_open_command_batch = command_batch; }
+
 			internal_id create_internal_id();
 
 			void dump_libintegra_state();
@@ -125,6 +143,8 @@ namespace integra_internal
 
 			string get_libintegra_version() const;
 
+			CAudioStatistics get_audio_statistics() const;
+
 		private:
 
 			void dump_state( const node_map &nodes, int indentation ) const;
@@ -136,6 +156,7 @@ namespace integra_internal
 
 			node_map m_nodes;
 			CStateTable m_state_table; 
+			CConnectionRoutingTable m_connection_routing_table;
 			CReentranceChecker *m_reentrance_checker;
 			CModuleManager *m_module_manager;
 			CScratchDirectory *m_scratch_directory;
@@ -145,9 +166,14 @@ namespace integra_internal
 			IAudioEngine *m_audio_engine;
 			IMidiEngine *m_midi_engine;
 			CMidiInputDispatcher *m_midi_input_dispatcher;
+			CAudioStatisticsPublisher *m_audio_statistics_publisher;
 
 			INotificationSink *m_notification_sink;
 
+			CCommandBatch *m_open_command_batch;
+
+			bool m_render_envelopes_in_dsp;
+
 			internal_id m_next_internal_id; 
 	};
 }
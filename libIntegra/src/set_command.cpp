@@ -27,6 +27,7 @@
 #include "reentrance_checker.h"
 #include "logic.h"
 #include "dsp_engine.h"
+#include "command_batch.h"
 #include "api/value.h"
 #include "api/trace.h"
 #include "api/notification_sink.h"
@@ -45,6 +46,16 @@ namespace integra_api
 	{
 		return new integra_internal::CSetCommand( endpoint_path );
 	}
+
+	ISetCommand *ISetCommand::create( const CEndpointHandle &endpoint_handle, const CValue &value )
+	{
+		return new integra_internal::CSetCommand( endpoint_handle, value );
+	}
+
+	ISetCommand *ISetCommand::create( const CEndpointHandle &endpoint_handle )
+	{
+		return new integra_internal::CSetCommand( endpoint_handle );
+	}
 }
 
 
@@ -64,6 +75,20 @@ namespace integra_internal
 	}
 
 
+	CSetCommand::CSetCommand( const CEndpointHandle &endpoint_handle, const CValue &value )
+	{
+		m_endpoint_handle = endpoint_handle;
+		m_value = value.clone();
+	}
+
+
+	CSetCommand::CSetCommand( const CEndpointHandle &endpoint_handle )
+	{
+		m_endpoint_handle = endpoint_handle;
+		m_value = NULL;
+	}
+
+
 	CSetCommand::~CSetCommand()
 	{
 		if( m_value )
@@ -73,22 +98,144 @@ namespace integra_internal
 	}
 
 
+	const INodeEndpoint *CSetCommand::find_endpoint( const CServer &server ) const
+	{
+		if( m_endpoint_handle.is_null() )
+		{
+			return server.find_node_endpoint( m_endpoint_path );
+		}
+		else
+		{
+			return server.find_node_endpoint( m_endpoint_handle );
+		}
+	}
+
+
+	CError CSetCommand::validate( const CServer &server ) const
+	{
+		const INodeEndpoint *node_endpoint = find_endpoint( server );
+		if( node_endpoint == NULL) 
+		{
+			INTEGRA_TRACE_ERROR << "endpoint not found: " << ( m_endpoint_handle.is_null() ? m_endpoint_path.get_string() : string( "stale endpoint handle" ) );
+			return CError::PATH_ERROR;
+		}
+
+		CError error = test_type( *node_endpoint );
+		if( error != CError::SUCCESS )
+		{
+			return error;
+		}
+
+		return test_constraint( *node_endpoint );
+	}
+
+
 	CError CSetCommand::execute( CServer &server, CCommandSource source, CCommandResult *result )
 	{
-		/* get node endpoint from path */
-		CNodeEndpoint *node_endpoint = server.find_node_endpoint_writable( m_endpoint_path.get_string() );
+		/* get node endpoint from handle or path */
+		CNodeEndpoint *node_endpoint( NULL );
+		if( m_endpoint_handle.is_null() )
+		{
+			node_endpoint = server.find_node_endpoint_writable( m_endpoint_path );
+		}
+		else
+		{
+			node_endpoint = server.find_node_endpoint_writable( m_endpoint_handle );
+		}
+
 		if( node_endpoint == NULL) 
 		{
-			INTEGRA_TRACE_ERROR << "endpoint not found: " << m_endpoint_path.get_string();
+			INTEGRA_TRACE_ERROR << "endpoint not found: " << ( m_endpoint_handle.is_null() ? m_endpoint_path.get_string() : string( "stale endpoint handle" ) );
 			return CError::PATH_ERROR;
 		}
 
-		const IEndpointDefinition &endpoint_definition = node_endpoint->get_endpoint_definition();
+		CError error = test_type( *node_endpoint );
+		if( error != CError::SUCCESS )
+		{
+			return error;
+		}
+
+		if( source == CCommandSource::MODULE_IMPLEMENTATION && !CNode::downcast( &node_endpoint->get_node() )->get_logic().node_is_active() )
+		{
+			return CError::SUCCESS;
+		}
+
+		error = test_constraint( *node_endpoint );
+		if( error != CError::SUCCESS )
+		{
+			return error;
+		}
+
+		if( server.get_reentrance_checker().push( node_endpoint, source ) )
+		{
+			INTEGRA_TRACE_ERROR << "detected reentry - aborting set command: " << node_endpoint->get_path().get_string();
+			return CError::REENTRANCE_ERROR;
+		}
+
+		CValue *previous_value( NULL );
+		if( node_endpoint->get_value() )
+		{
+			previous_value = node_endpoint->get_value()->clone();
+		}
+
+		/* set the attribute value */
+		if( m_value )
+		{
+			assert( node_endpoint->get_value() );
+			m_value->convert( *node_endpoint->get_value_writable() );
+		}
+
+		/* send the attribute value to the host if needed */
+		const CInterfaceDefinition &interface_definition = CInterfaceDefinition::downcast( node_endpoint->get_node().get_interface_definition() );
+		CCommandBatch *command_batch = server.get_open_command_batch();
+		if( should_send_to_host( *node_endpoint, interface_definition, source ) ) 
+		{
+			if( command_batch )
+			{
+				command_batch->defer_send_value( *node_endpoint );
+			}
+			else
+			{
+				error = server.get_dsp_engine().send_value( *node_endpoint );
+			}
+		}
+
+		/* callback into the notification sink */
+		INotificationSink *notification_sink = server.get_notification_sink();
+		if( notification_sink )
+		{
+			if( command_batch )
+			{
+				command_batch->defer_notification( node_endpoint->get_path(), source );
+			}
+			else
+			{
+				notification_sink->on_set_command( server, node_endpoint->get_path(), source );
+			}
+		}
+		
+		/* handle any system class logic */
+		CNode::downcast( &node_endpoint->get_node() )->get_logic().handle_set( server, *node_endpoint, previous_value, source );
+
+		if( previous_value )
+		{
+			delete previous_value;
+		}
+
+		server.get_reentrance_checker().pop();
+
+		return error;
+	}
+
+
+	CError CSetCommand::test_type( const INodeEndpoint &endpoint ) const
+	{
+		const IEndpointDefinition &endpoint_definition = endpoint.get_endpoint_definition();
 
 		switch( endpoint_definition.get_type() )
 		{
 			case CEndpointDefinition::STREAM:
-				INTEGRA_TRACE_ERROR << "can't call set for a stream attribute: " << m_endpoint_path.get_string();
+				INTEGRA_TRACE_ERROR << "can't call set for a stream attribute: " << endpoint.get_path().get_string();
 				return CError::TYPE_ERROR;
 
 			case CEndpointDefinition::CONTROL:
@@ -98,7 +245,7 @@ namespace integra_internal
 					{
 						if( !m_value )
 						{
-							INTEGRA_TRACE_ERROR << "called set without a value for a stateful endpoint: " << m_endpoint_path.get_string();
+							INTEGRA_TRACE_ERROR << "called set without a value for a stateful endpoint: " << endpoint.get_path().get_string();
 							return CError::TYPE_ERROR;
 						}
 
@@ -111,7 +258,7 @@ namespace integra_internal
 							/* we allow passing integers to float attributes and vice-versa, but no other mismatched types */
 							if( ( value_type != CValue::INTEGER && m_value->get_type() != CValue::FLOAT ) || ( endpoint_type != CValue::INTEGER && endpoint_type != CValue::FLOAT ) )
 							{
-								INTEGRA_TRACE_ERROR << "called set with incorrect value type: " << m_endpoint_path.get_string();
+								INTEGRA_TRACE_ERROR << "called set with incorrect value type: " << endpoint.get_path().get_string();
 								return CError::TYPE_ERROR;
 							}
 						} 
@@ -122,7 +269,7 @@ namespace integra_internal
 					case CControlInfo::BANG:
 						if( m_value )
 						{
-							INTEGRA_TRACE_ERROR << "called set with a value for a stateless endpoint: " << m_endpoint_path.get_string();
+							INTEGRA_TRACE_ERROR << "called set with a value for a stateless endpoint: " << endpoint.get_path().get_string();
 							return CError::TYPE_ERROR;
 						}
 						break;
@@ -138,66 +285,23 @@ namespace integra_internal
 				break;
 		}
 
-		if( source == CCommandSource::MODULE_IMPLEMENTATION && !CNode::downcast( &node_endpoint->get_node() )->get_logic().node_is_active() )
-		{
-			return CError::SUCCESS;
-		}
+		return CError::SUCCESS;
+	}
+
 
+	CError CSetCommand::test_constraint( const INodeEndpoint &endpoint ) const
+	{
 		/* test constraint */
 		if( m_value )
 		{
-			const IStateInfo *state_info = node_endpoint->get_endpoint_definition().get_control_info()->get_state_info();
+			const IStateInfo *state_info = endpoint.get_endpoint_definition().get_control_info()->get_state_info();
 			if( !state_info->test_constraint( *m_value ) )
 			{
-				INTEGRA_TRACE_ERROR << "attempting to set value which doesn't conform to constraint - aborting set command: " << m_endpoint_path.get_string();
+				INTEGRA_TRACE_ERROR << "attempting to set value which doesn't conform to constraint - aborting set command: " << endpoint.get_path().get_string();
 				return CError::CONSTRAINT_ERROR;
 			}
 		}
 
-
-		if( server.get_reentrance_checker().push( node_endpoint, source ) )
-		{
-			INTEGRA_TRACE_ERROR << "detected reentry - aborting set command: " << m_endpoint_path.get_string();
-			return CError::REENTRANCE_ERROR;
-		}
-
-		CValue *previous_value( NULL );
-		if( node_endpoint->get_value() )
-		{
-			previous_value = node_endpoint->get_value()->clone();
-		}
-
-		/* set the attribute value */
-		if( m_value )
-		{
-			assert( node_endpoint->get_value() );
-			m_value->convert( *node_endpoint->get_value_writable() );
-		}
-
-		/* send the attribute value to the host if needed */
-		const CInterfaceDefinition &interface_definition = CInterfaceDefinition::downcast( node_endpoint->get_node().get_interface_definition() );
-		if( should_send_to_host( *node_endpoint, interface_definition, source ) ) 
-		{
-			server.get_dsp_engine().send_value( *node_endpoint );
-		}
-
-		/* callback into the notification sink */
-		INotificationSink *notification_sink = server.get_notification_sink();
-		if( notification_sink )
-		{
-			notification_sink->on_set_command( server, m_endpoint_path, source );
-		}
-		
-		/* handle any system class logic */
-		CNode::downcast( &node_endpoint->get_node() )->get_logic().handle_set( server, *node_endpoint, previous_value, source );
-
-		if( previous_value )
-		{
-			delete previous_value;
-		}
-
-		server.get_reentrance_checker().pop();
-
 		return CError::SUCCESS;
 	}
 
@@ -25,6 +25,7 @@
 
 #include "api/command.h"
 #include "api/path.h"
+#include "api/node_endpoint.h"
 
 using namespace integra_api;
 
@@ -40,17 +41,30 @@ namespace integra_internal
 		public:
 			CSetCommand( const CPath &endpoint_path, const CValue &value );
 			CSetCommand( const CPath &endpoint_path );
+			CSetCommand( const CEndpointHandle &endpoint_handle, const CValue &value );
+			CSetCommand( const CEndpointHandle &endpoint_handle );
 			~CSetCommand();
 
+			/* checks endpoint path, value type and constraint against the current state without applying anything */
+			CError validate( const CServer &server ) const;
+
+			const INodeEndpoint *find_endpoint( const CServer &server ) const;
+
 		private:
 			
 			CError execute( CServer &server, CCommandSource source, CCommandResult *result );
 
+			CError test_type( const INodeEndpoint &endpoint ) const;
+			CError test_constraint( const INodeEndpoint &endpoint ) const;
+
 			bool should_send_to_host( const CNodeEndpoint &endpoint, const CInterfaceDefinition &interface_definition, CCommandSource source ) const;
 
 			const CPath &get_endpoint_path() const { return m_endpoint_path; }
+			const CEndpointHandle &get_endpoint_handle() const { return m_endpoint_handle; }
 
+			/* set commands address their endpoint either by path or by handle.  The other is left empty */
 			CPath m_endpoint_path;
+			CEndpointHandle m_endpoint_handle;
 			CValue *m_value;
 	};
 }
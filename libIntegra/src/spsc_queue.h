@@ -0,0 +1,156 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+
+
+#ifndef INTEGRA_SPSC_QUEUE_H
+#define INTEGRA_SPSC_QUEUE_H
+
+#include <atomic>
+#include <assert.h>
+
+
+namespace integra_internal
+{
+	/*
+	 CSpscQueue is a wait-free single-producer/single-consumer queue of fixed capacity, for passing 
+	 small copyable items between a real-time thread and another thread.
+
+	 push may only be called from one thread, and peek / pop from one other thread (or, as with 
+	 CDspCommandQueue, from whichever thread currently holds a lock which hands over the role).  
+	 Neither side ever blocks, allocates or traces.
+	*/
+
+	template <class T> class CSpscQueue
+	{
+		public:
+
+			/* capacity is rounded up to a power of two */
+			CSpscQueue( unsigned int capacity );
+			~CSpscQueue();
+
+			/* producer side.  Returns false when the queue is full */
+			bool push( const T &item );
+
+			/* consumer side.  Return false when the queue is empty */
+			bool peek( T &item ) const;
+			bool pop( T &item );
+			bool pop();
+
+			bool is_empty() const;
+
+		private:
+
+			T *m_items;
+			unsigned int m_capacity;
+			unsigned int m_index_mask;
+
+			/* free-running indices - only their difference (masked) is meaningful */
+			std::atomic<unsigned int> m_write_index;
+			std::atomic<unsigned int> m_read_index;
+	};
+
+
+	template <class T> CSpscQueue<T>::CSpscQueue( unsigned int capacity )
+	{
+		m_capacity = 1;
+		while( m_capacity < capacity )
+		{
+			m_capacity <<= 1;
+		}
+
+		m_index_mask = m_capacity - 1;
+		m_items = new T[ m_capacity ];
+
+		m_write_index.store( 0 );
+		m_read_index.store( 0 );
+	}
+
+
+	template <class T> CSpscQueue<T>::~CSpscQueue()
+	{
+		delete [] m_items;
+	}
+
+
+	template <class T> bool CSpscQueue<T>::push( const T &item )
+	{
+		unsigned int write_index = m_write_index.load( std::memory_order_relaxed );
+		unsigned int read_index = m_read_index.load( std::memory_order_acquire );
+
+		if( write_index - read_index >= m_capacity )
+		{
+			return false;
+		}
+
+		m_items[ write_index & m_index_mask ] = item;
+		m_write_index.store( write_index + 1, std::memory_order_release );
+		return true;
+	}
+
+
+	template <class T> bool CSpscQueue<T>::peek( T &item ) const
+	{
+		unsigned int read_index = m_read_index.load( std::memory_order_relaxed );
+		unsigned int write_index = m_write_index.load( std::memory_order_acquire );
+
+		if( read_index == write_index )
+		{
+			return false;
+		}
+
+		item = m_items[ read_index & m_index_mask ];
+		return true;
+	}
+
+
+	template <class T> bool CSpscQueue<T>::pop( T &item )
+	{
+		if( !peek( item ) )
+		{
+			return false;
+		}
+
+		return pop();
+	}
+
+
+	template <class T> bool CSpscQueue<T>::pop()
+	{
+		unsigned int read_index = m_read_index.load( std::memory_order_relaxed );
+		if( read_index == m_write_index.load( std::memory_order_acquire ) )
+		{
+			return false;
+		}
+
+		m_read_index.store( read_index + 1, std::memory_order_release );
+		return true;
+	}
+
+
+	template <class T> bool CSpscQueue<T>::is_empty() const
+	{
+		return ( m_read_index.load( std::memory_order_acquire ) == m_write_index.load( std::memory_order_acquire ) );
+	}
+}
+
+
+
+#endif /* INTEGRA_SPSC_QUEUE_H */
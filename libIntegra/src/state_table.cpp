@@ -24,6 +24,8 @@
 #include "state_table.h"
 #include "api/trace.h"
 
+#include <assert.h>
+
 
 namespace integra_internal
 {
@@ -75,6 +77,12 @@ namespace integra_internal
 			{
 				m_node_endpoints[ path ] = node_endpoint;
 			}
+
+			/* endpoints keep their handle when re-added after a rename or move */
+			if( node_endpoint->get_handle().is_null() )
+			{
+				allocate_handle( *CNodeEndpoint::downcast_writable( node_endpoint ) );
+			}
 		}
 
 		/* add child nodes */
@@ -198,5 +206,98 @@ namespace integra_internal
 
 		return CNodeEndpoint::downcast_writable( lookup->second );
 	}
-}	
 
+
+	void CStateTable::release_handles( CNode &node )
+	{
+		node_endpoint_map &node_endpoints = node.get_node_endpoints_writable();
+		for( node_endpoint_map::iterator i = node_endpoints.begin(); i != node_endpoints.end(); i++ )
+		{
+			CNodeEndpoint *node_endpoint = CNodeEndpoint::downcast_writable( i->second );
+			const CEndpointHandle &handle = node_endpoint->get_handle();
+			if( handle.is_null() )
+			{
+				continue;
+			}
+
+			assert( handle.get_slot() < m_handle_slots.size() );
+			CHandleSlot &slot = m_handle_slots[ handle.get_slot() ];
+			assert( slot.node_endpoint == node_endpoint && slot.generation == handle.get_generation() );
+
+			/* bump the generation so that outstanding copies of the handle go stale */
+			slot.node_endpoint = NULL;
+			slot.generation++;
+			if( slot.generation == 0 )
+			{
+				slot.generation = 1;
+			}
+
+			m_free_handle_slots.push_back( handle.get_slot() );
+
+			node_endpoint->set_handle( CEndpointHandle() );
+		}
+	}
+
+
+	const CNodeEndpoint *CStateTable::lookup_node_endpoint( const CEndpointHandle &handle ) const
+	{
+		if( handle.get_slot() >= m_handle_slots.size() )
+		{
+			return NULL;
+		}
+
+		const CHandleSlot &slot = m_handle_slots[ handle.get_slot() ];
+		if( slot.generation != handle.get_generation() )
+		{
+			/* stale or null handle */
+			return NULL;
+		}
+
+		return slot.node_endpoint;
+	}
+
+
+	CNodeEndpoint *CStateTable::lookup_node_endpoint_writable( const CEndpointHandle &handle )
+	{
+		if( handle.get_slot() >= m_handle_slots.size() )
+		{
+			return NULL;
+		}
+
+		CHandleSlot &slot = m_handle_slots[ handle.get_slot() ];
+		if( slot.generation != handle.get_generation() )
+		{
+			/* stale or null handle */
+			return NULL;
+		}
+
+		return slot.node_endpoint;
+	}
+
+
+	void CStateTable::allocate_handle( CNodeEndpoint &node_endpoint )
+	{
+		unsigned int slot_index;
+
+		if( m_free_handle_slots.empty() )
+		{
+			slot_index = m_handle_slots.size();
+
+			CHandleSlot slot;
+			slot.node_endpoint = NULL;
+			slot.generation = 1;
+			m_handle_slots.push_back( slot );
+		}
+		else
+		{
+			slot_index = m_free_handle_slots.back();
+			m_free_handle_slots.pop_back();
+		}
+
+		CHandleSlot &slot = m_handle_slots[ slot_index ];
+		assert( !slot.node_endpoint );
+		slot.node_endpoint = &node_endpoint;
+
+		node_endpoint.set_handle( CEndpointHandle( slot_index, slot.generation ) );
+	}
+}
@@ -27,6 +27,8 @@
 #include "node.h"
 #include "node_endpoint.h"
 
+#include <vector>
+
 
 namespace integra_internal
 {
@@ -37,8 +39,13 @@ namespace integra_internal
 			CStateTable();
 			~CStateTable();
 
+			/* 
+			 add and remove are also used to re-key nodes when they are renamed or moved, so they leave 
+			 endpoint handles alone.  release_handles must be called when a node is deleted
+			*/
 			void add( CNode &node );
 			void remove( const CNode &node );
+			void release_handles( CNode &node );
 
 			const CNode *lookup_node( const string &path ) const;
 			CNode *lookup_node_writable( const string &path );
@@ -48,8 +55,26 @@ namespace integra_internal
 			const CNodeEndpoint *lookup_node_endpoint( const string &path ) const;
 			CNodeEndpoint *lookup_node_endpoint_writable( const string &path );
 
+			const CNodeEndpoint *lookup_node_endpoint( const CEndpointHandle &handle ) const;
+			CNodeEndpoint *lookup_node_endpoint_writable( const CEndpointHandle &handle );
+
 		private:
 
+			void allocate_handle( CNodeEndpoint &node_endpoint );
+
+			class CHandleSlot
+			{
+				public:
+					CNodeEndpoint *node_endpoint;
+					unsigned int generation;
+			};
+
+			typedef std::vector<CHandleSlot> handle_slot_vector;
+			typedef std::vector<unsigned int> handle_slot_index_vector;
+
+			handle_slot_vector m_handle_slots;
+			handle_slot_index_vector m_free_handle_slots;
+
 			node_map m_nodes;
 			map_id_to_node m_nodes_by_id;
 			node_endpoint_map m_node_endpoints;
@@ -25,6 +25,7 @@
 
 
 #include <pthread.h>
+#include <atomic>
 
 #ifdef __APPLE__
 #include <dispatch/dispatch.h>
@@ -47,29 +48,68 @@ namespace integra_internal
 	template <class T> void *threaded_queue_thread_function( void *context );
 
 
+	/*
+	 CThreadedQueue passes items from any number of producer threads to an output thread, which 
+	 delivers them to the output sink in the order in which they were pushed.
+
+	 The queue is bounded and lock-free.  Items are copied into a ring of cells which are constructed 
+	 once and then reused, so pushing never allocates unless T's own assignment does, and cells 
+	 keep any capacity they acquired (eg string buffers) for next time.  Each cell's sequence number 
+	 tells producers whether it is free, and tells the consumer whether it has been filled.
+
+	 The output thread is only signalled when it isn't already due to run, so a burst of pushes 
+	 costs one wakeup.  When the ring is full, push returns false and the item is counted as dropped
+	*/
+
 	template<class T> class CThreadedQueue
 	{
 		public:
 
-			CThreadedQueue( IThreadedQueueOutputSink<T> &output_sink );
+			CThreadedQueue( IThreadedQueueOutputSink<T> &output_sink, unsigned int capacity = default_capacity );
 			~CThreadedQueue();
 
-			void push( const T&item );
-			void push( const std::list<T> &items );
+			bool push( const T&item );
+			bool push( const std::list<T> &items );
+
+			unsigned long get_dropped_count() const { return m_dropped_count.load( std::memory_order_relaxed ); }
 
 			friend void *threaded_queue_thread_function<T>( void *context );
 
+			static const unsigned int default_capacity = 1024;
+
 		private:
 
+			class CCell
+			{
+				public:
+					std::atomic<unsigned int> sequence;
+					T item;
+			};
+
+			bool push_without_signal( const T &item );
+			bool pop( T &item );
+
 			void send_signal_to_output_thread();
+			void wait_for_signal();
 
 			void output_thread();
 
 			IThreadedQueueOutputSink<T> &m_output_sink;
 
-			std::list<T> *m_content;
+			CCell *m_cells;
+			unsigned int m_index_mask;
+
+			/* free-running positions - only their difference (masked) is meaningful */
+			std::atomic<unsigned int> m_push_position;
+			unsigned int m_pop_position;
+
+			/* output thread only.  Reused for each delivery */
+			std::list<T> m_delivery;
+
+			std::atomic<bool> m_signal_is_pending;
+			std::atomic<unsigned long> m_dropped_count;
+			unsigned long m_reported_dropped_count;
 
-			pthread_mutex_t m_queue_mutex;
 #ifdef __APPLE__
             dispatch_semaphore_t m_semaphore;
 #else
@@ -78,7 +118,7 @@ namespace integra_internal
 
 			pthread_t m_output_thread;
 
-			bool m_finished;
+			std::atomic<bool> m_finished;
 	};
 
 }
@@ -28,18 +28,38 @@
 #include "api/trace.h"
 #include "api/error.h"
 
+#include <errno.h>
+
 using namespace integra_api;
 
 namespace integra_internal
 {
-	template<class T> CThreadedQueue<T>::CThreadedQueue( IThreadedQueueOutputSink<T> &output_sink )
+	template<class T> CThreadedQueue<T>::CThreadedQueue( IThreadedQueueOutputSink<T> &output_sink, unsigned int capacity )
 		:	m_output_sink( output_sink )
 	{
-		m_content = new std::list<T>;
+		/* round up to a power of two so that positions can be masked rather than wrapped */
+		unsigned int number_of_cells = 1;
+		while( number_of_cells < capacity )
+		{
+			number_of_cells <<= 1;
+		}
+
+		m_index_mask = number_of_cells - 1;
+
+		m_cells = new CCell[ number_of_cells ];
+		for( unsigned int i = 0; i < number_of_cells; i++ )
+		{
+			m_cells[ i ].sequence.store( i, std::memory_order_relaxed );
+		}
+
+		m_push_position.store( 0 );
+		m_pop_position = 0;
 
-		m_finished = false;
+		m_signal_is_pending.store( false );
+		m_dropped_count.store( 0 );
+		m_reported_dropped_count = 0;
 
-		pthread_mutex_init( &m_queue_mutex, NULL );
+		m_finished.store( false );
 
         CError error = CError::SUCCESS;
 #ifdef __APPLE__
@@ -68,14 +88,12 @@ namespace integra_internal
 
 	template<class T> CThreadedQueue<T>::~CThreadedQueue()
 	{
-		m_finished = true;
+		m_finished.store( true );
 
 		send_signal_to_output_thread();
 
 		pthread_join( m_output_thread, NULL);
 
-		pthread_mutex_destroy( &m_queue_mutex );
-
         int sem_rv = 0;
         
 #ifdef __APPLE__
@@ -90,36 +108,103 @@ namespace integra_internal
             INTEGRA_TRACE_ERROR << "Semaphore close error: " << strerror(errno);
         }
 
-		assert( m_content );
-		assert( m_content->empty() );
+		assert( m_delivery.empty() );
 
-		delete m_content;
+		delete [] m_cells;
 	}
 
 
-	template<class T> void CThreadedQueue<T>::push( const T &item )
+	template<class T> bool CThreadedQueue<T>::push( const T &item )
 	{
-		pthread_mutex_lock( &m_queue_mutex );
+		bool pushed = push_without_signal( item );
 
-		assert( m_content );
-		m_content->push_back( item );
+		if( pushed && !m_signal_is_pending.exchange( true ) )
+		{
+			send_signal_to_output_thread();
+		}
 
-		pthread_mutex_unlock( &m_queue_mutex );
+		return pushed;
+	}
 
-		send_signal_to_output_thread();
+
+	template<class T> bool CThreadedQueue<T>::push( const std::list<T> &items )
+	{
+		bool pushed_all( true );
+		bool pushed_any( false );
+
+		for( typename std::list<T>::const_iterator i = items.begin(); i != items.end(); i++ )
+		{
+			if( push_without_signal( *i ) )
+			{
+				pushed_any = true;
+			}
+			else
+			{
+				pushed_all = false;
+			}
+		}
+
+		if( pushed_any && !m_signal_is_pending.exchange( true ) )
+		{
+			send_signal_to_output_thread();
+		}
+
+		return pushed_all;
 	}
 
 
-	template<class T> void CThreadedQueue<T>::push( const std::list<T> &items )
+	template<class T> bool CThreadedQueue<T>::push_without_signal( const T &item )
 	{
-		pthread_mutex_lock( &m_queue_mutex );
+		unsigned int position = m_push_position.load( std::memory_order_relaxed );
 
-		assert( m_content );
-		m_content->insert( m_content->end(), items.begin(), items.end() );
+		while( true )
+		{
+			CCell &cell = m_cells[ position & m_index_mask ];
+			unsigned int sequence = cell.sequence.load( std::memory_order_acquire );
+			int difference = ( int ) ( sequence - position );
 
-		pthread_mutex_unlock( &m_queue_mutex );
+			if( difference == 0 )
+			{
+				/* the cell is free - claim it, unless another producer got there first */
+				if( m_push_position.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ) )
+				{
+					cell.item = item;
+					cell.sequence.store( position + 1, std::memory_order_release );
+					return true;
+				}
+			}
+			else if( difference < 0 )
+			{
+				/* the cell still holds an item from the previous lap - the queue is full */
+				m_dropped_count.fetch_add( 1, std::memory_order_relaxed );
+				return false;
+			}
+			else
+			{
+				position = m_push_position.load( std::memory_order_relaxed );
+			}
+		}
+	}
 
-		send_signal_to_output_thread();
+
+	template<class T> bool CThreadedQueue<T>::pop( T &item )
+	{
+		CCell &cell = m_cells[ m_pop_position & m_index_mask ];
+		unsigned int sequence = cell.sequence.load( std::memory_order_acquire );
+
+		if( sequence != m_pop_position + 1 )
+		{
+			/* empty, or a producer has claimed the cell but not yet filled it */
+			return false;
+		}
+
+		item = cell.item;
+
+		/* hand the cell back to producers for the next lap */
+		cell.sequence.store( m_pop_position + m_index_mask + 1, std::memory_order_release );
+		m_pop_position++;
+
+		return true;
 	}
 
 
@@ -133,40 +218,51 @@ namespace integra_internal
 	}
 
 
+	template<class T> void CThreadedQueue<T>::wait_for_signal()
+	{
+#ifdef __APPLE__
+        dispatch_semaphore_wait( m_semaphore, DISPATCH_TIME_FOREVER );
+#else
+		while( sem_wait( m_semaphore ) == -1 && errno == EINTR )
+		{
+		}
+#endif
+	}
+
+
 	template<class T> void CThreadedQueue<T>::output_thread()
 	{
 		bool finished( false );
 
 		while( !finished )
 		{
-#ifdef __APPLE__
-            dispatch_semaphore_wait( m_semaphore, DISPATCH_TIME_FOREVER );
-#else
-			sem_wait( m_semaphore );
-#endif
+			wait_for_signal();
 
-			pthread_mutex_lock( &m_queue_mutex );
+			finished = m_finished.load();
 
-			std::list<T> *content_to_deliver = NULL;
+			/* 
+			 clear the flag before draining, so that anything pushed from now on either 
+			 signals again or is picked up by this drain
+			*/
+			m_signal_is_pending.store( false );
 
-			assert( m_content );
-			if( !m_content->empty() )
+			T item;
+			while( pop( item ) )
 			{
-				content_to_deliver = m_content;
-				m_content = new std::list<T>;
+				m_delivery.push_back( item );
 			}
 
-			if( m_finished ) 
+			unsigned long dropped_count = m_dropped_count.load( std::memory_order_relaxed );
+			if( dropped_count != m_reported_dropped_count )
 			{
-				finished = true;
+				INTEGRA_TRACE_ERROR << "threaded queue full - dropped " << dropped_count - m_reported_dropped_count << " items";
+				m_reported_dropped_count = dropped_count;
 			}
 
-			pthread_mutex_unlock( &m_queue_mutex );
-
-			if( content_to_deliver )
+			if( !m_delivery.empty() )
 			{
-				m_output_sink.handle_queue_items( *content_to_deliver );
-				delete content_to_deliver;
+				m_output_sink.handle_queue_items( m_delivery );
+				m_delivery.clear();
 			}
 		}
 	}
@@ -22,8 +22,10 @@
 #include "platform_specifics.h"
 
 #include "api/trace.h"
+#include "trace_buffer.h"
 
 #include <pthread.h>
+#include <sched.h>
 #include <iostream>
 
 
@@ -38,45 +40,83 @@ namespace integra_api
 	bool CTrace::s_trace_location = true;
 	bool CTrace::s_trace_thread = false;
 
+	std::atomic<bool> CTrace::s_deferred( false );
+	std::atomic<int> CTrace::s_deferred_writers( 0 );
+
 	std::ofstream CTrace::s_null_stream;
 	std::ostream &CTrace::s_trace_stream = std::cout;
 
 	const int CTrace::max_timestamp_length = 32;
 
+	const char *CTrace::s_category_names[] = { "Error", "Progress", "Verbose" };
+
 
-	std::ostream &CTrace::error( const char *location, const char *function )
+	std::ostream &CTrace::begin_message( category message_category, const char *location, const char *function, integra_internal::CTraceThreadBuffer *&deferred_buffer )
 	{
-		if( !s_trace_errors ) 
+		deferred_buffer = NULL;
+
+		if( !should_trace( message_category ) ) 
 		{
 			return s_null_stream;
 		}
 
-		do_trace( "Error", location, function );
+		if( s_deferred )
+		{
+			/* 
+			 register as a writer, then check again, so that set_deferred_mode( false ) either sees this 
+			 message and waits for it, or this message sees deferred mode ending and is traced directly
+			*/
+			s_deferred_writers++;
+
+			if( s_deferred )
+			{
+				integra_internal::CTraceThreadBuffer *buffer = integra_internal::CTraceThreadBuffer::get_current_thread_buffer();
+				if( !buffer )
+				{
+					/* the buffer pool is exhausted - the writer thread reports the message as dropped */
+					s_deferred_writers--;
+					return s_null_stream;
+				}
+
+				std::ostream *stream = buffer->begin_record( message_category, location, function );
+				if( !stream )
+				{
+					/* nested trace whilst streaming a value into another message */
+					s_deferred_writers--;
+					return s_null_stream;
+				}
+
+				deferred_buffer = buffer;
+				return *stream;
+			}
+
+			s_deferred_writers--;
+		}
+
+		do_trace( s_category_names[ message_category ], location, function );
 		return s_trace_stream;
 	}
 
 
-	std::ostream &CTrace::progress( const char *location, const char *function )
+	void CTrace::end_message( integra_internal::CTraceThreadBuffer *deferred_buffer )
 	{
-		if( !s_trace_progress )
-		{
-			return s_null_stream;
-		}
+		deferred_buffer->end_record();
 
-		do_trace( "Progress", location, function );
-		return s_trace_stream;
+		s_deferred_writers--;
 	}
 
 
-	std::ostream &CTrace::verbose( const char *location, const char *function )
+	bool CTrace::should_trace( category message_category )
 	{
-		if( !s_trace_verbose )
+		switch( message_category )
 		{
-			return s_null_stream;
-		}
+			case CATEGORY_ERROR:		return s_trace_errors;
+			case CATEGORY_PROGRESS:		return s_trace_progress;
+			case CATEGORY_VERBOSE:		return s_trace_verbose;
 
-		do_trace( "Verbose", location, function );
-		return s_trace_stream;
+			default:
+				return false;
+		}
 	}
 
 
@@ -96,42 +136,75 @@ namespace integra_api
 	}
 
 
+	void CTrace::set_deferred_mode( bool deferred )
+	{
+		if( deferred == s_deferred )
+		{
+			return;
+		}
+
+		if( deferred )
+		{
+			integra_internal::CDeferredTraceWriter::start();
+			s_deferred = true;
+		}
+		else
+		{
+			s_deferred = false;
+
+			/* messages which began before the flag was cleared must reach their buffers before the final flush */
+			while( s_deferred_writers > 0 )
+			{
+				sched_yield();
+			}
+
+			integra_internal::CDeferredTraceWriter::stop();
+		}
+	}
+
+
 	void CTrace::do_trace( const char *category, const char *location, const char *function )
 	{
-		s_trace_stream << std::unitbuf << std::endl;
-		s_trace_stream << category;
+		time_t rawtime;
+		time( &rawtime );
+
+		pthread_t thread_id = pthread_self();
+
+		write_header( s_trace_stream, category, rawtime, &thread_id, sizeof( thread_id ), location, function );
+	}
+
+
+	void CTrace::write_header( std::ostream &stream, const char *category, time_t time, const void *thread_id, unsigned int thread_id_size, const char *location, const char *function )
+	{
+		stream << std::unitbuf << std::endl;
+		stream << category;
 
 		if( s_trace_timestamp )
 		{
-			time_t rawtime;
 			char timestamp_string[ max_timestamp_length ];
-			time( &rawtime );
-			strftime( timestamp_string, max_timestamp_length, "%X %x", localtime( &rawtime ) );
-			s_trace_stream << " [" << timestamp_string << "]";
+			strftime( timestamp_string, max_timestamp_length, "%X %x", localtime( &time ) );
+			stream << " [" << timestamp_string << "]";
 		}
 
 		if( s_trace_thread )
 		{
-			pthread_t thread_id = pthread_self();
-			const unsigned char *thread_id_bytes = (const unsigned char *) ( &thread_id );
+			const unsigned char *thread_id_bytes = (const unsigned char *) thread_id;
 
-			s_trace_stream << " threadID: 0x" << std::hex;
+			stream << " threadID: 0x" << std::hex;
 
-			for( int i = 0; i < sizeof( thread_id ); i++ )
+			for( unsigned int i = 0; i < thread_id_size; i++ )
 			{
-				s_trace_stream << ( int ) ( thread_id_bytes[ i ] );
+				stream << ( int ) ( thread_id_bytes[ i ] );
 			}
 
-			s_trace_stream << std::dec;
+			stream << std::dec;
 		}
 
 		if( s_trace_location )
 		{
-			s_trace_stream << " " << location << "(" << function << ")";
+			stream << " " << location << "(" << function << ")";
 		}
 
-		s_trace_stream << "     ";
+		stream << "     ";
 	}
 }
-
-
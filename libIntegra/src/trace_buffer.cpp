@@ -0,0 +1,345 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, 
+ * USA.
+ */
+
+
+
+
+#include "platform_specifics.h"
+
+#include "trace_buffer.h"
+
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+
+
+namespace integra_internal
+{
+	static long long get_timestamp_nanoseconds()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+	}
+
+
+	pthread_key_t CTraceThreadBuffer::s_thread_key;
+	pthread_once_t CTraceThreadBuffer::s_thread_key_once = PTHREAD_ONCE_INIT;
+
+
+	CTraceThreadBuffer::CTraceThreadBuffer()
+		:	m_stream( &m_stream_buffer )
+	{
+		m_current_record = NULL;
+
+		m_write_index.store( 0 );
+		m_read_index.store( 0 );
+		m_dropped_count.store( 0 );
+		m_state.store( FREE );
+	}
+
+
+	bool CTraceThreadBuffer::claim()
+	{
+		int expected_state = FREE;
+		if( !m_state.compare_exchange_strong( expected_state, CLAIMING, std::memory_order_acquire ) )
+		{
+			return false;
+		}
+
+		/* the writer thread doesn't look at the buffer until it is active */
+		m_current_record = NULL;
+		m_thread_id = pthread_self();
+
+		m_state.store( ACTIVE, std::memory_order_release );
+		return true;
+	}
+
+
+	void CTraceThreadBuffer::release()
+	{
+		assert( is_retired() );
+		assert( !peek_record() );
+
+		m_dropped_count.store( 0, std::memory_order_relaxed );
+		m_state.store( FREE, std::memory_order_release );
+	}
+
+
+	void CTraceThreadBuffer::create_thread_key()
+	{
+		pthread_key_create( &s_thread_key, retire_thread_buffer );
+	}
+
+
+	void CTraceThreadBuffer::retire_thread_buffer( void *buffer )
+	{
+		/* the writer thread releases the buffer once it has written the remaining messages */
+		static_cast< CTraceThreadBuffer * >( buffer )->m_state.store( RETIRED, std::memory_order_release );
+	}
+
+
+	CTraceThreadBuffer *CTraceThreadBuffer::get_current_thread_buffer()
+	{
+		pthread_once( &s_thread_key_once, create_thread_key );
+
+		CTraceThreadBuffer *buffer = static_cast< CTraceThreadBuffer * >( pthread_getspecific( s_thread_key ) );
+		if( !buffer )
+		{
+			buffer = CDeferredTraceWriter::claim_thread_buffer();
+			if( buffer )
+			{
+				pthread_setspecific( s_thread_key, buffer );
+			}
+		}
+
+		return buffer;
+	}
+
+
+	std::ostream *CTraceThreadBuffer::begin_record( integra_api::CTrace::category category, const char *location, const char *function )
+	{
+		if( m_current_record )
+		{
+			return NULL;
+		}
+
+		unsigned int write_index = m_write_index.load( std::memory_order_relaxed );
+		unsigned int read_index = m_read_index.load( std::memory_order_acquire );
+
+		if( write_index - read_index < number_of_records )
+		{
+			m_current_record = &m_records[ write_index % number_of_records ];
+		}
+		else
+		{
+			m_current_record = &m_scratch_record;
+		}
+
+		m_current_record->m_category = category;
+		m_current_record->m_location = location;
+		m_current_record->m_function = function;
+		m_current_record->m_timestamp_nanoseconds = get_timestamp_nanoseconds();
+
+		/* each message starts with default formatting, regardless of manipulators used by previous messages */
+		m_stream_buffer.reset( m_current_record->m_payload, CTraceRecord::max_payload_length );
+		m_stream.clear();
+		m_stream.flags( std::ios_base::skipws | std::ios_base::dec );
+		m_stream.precision( 6 );
+		m_stream.width( 0 );
+		m_stream.fill( ' ' );
+
+		return &m_stream;
+	}
+
+
+	void CTraceThreadBuffer::end_record()
+	{
+		assert( m_current_record );
+
+		m_current_record->m_payload[ m_stream_buffer.get_length() ] = 0;
+
+		if( m_current_record == &m_scratch_record )
+		{
+			m_dropped_count.fetch_add( 1, std::memory_order_relaxed );
+		}
+		else
+		{
+			unsigned int write_index = m_write_index.load( std::memory_order_relaxed );
+			m_write_index.store( write_index + 1, std::memory_order_release );
+		}
+
+		m_current_record = NULL;
+	}
+
+
+	const CTraceRecord *CTraceThreadBuffer::peek_record()
+	{
+		unsigned int read_index = m_read_index.load( std::memory_order_relaxed );
+		unsigned int write_index = m_write_index.load( std::memory_order_acquire );
+
+		if( read_index == write_index )
+		{
+			return NULL;
+		}
+
+		return &m_records[ read_index % number_of_records ];
+	}
+
+
+	void CTraceThreadBuffer::pop_record()
+	{
+		unsigned int read_index = m_read_index.load( std::memory_order_relaxed );
+		m_read_index.store( read_index + 1, std::memory_order_release );
+	}
+
+
+	unsigned int CTraceThreadBuffer::take_dropped_count()
+	{
+		return m_dropped_count.exchange( 0, std::memory_order_relaxed );
+	}
+
+
+	CTraceThreadBuffer *CDeferredTraceWriter::s_thread_buffers = NULL;
+	std::atomic<unsigned int> CDeferredTraceWriter::s_unbuffered_dropped_count( 0 );
+
+	pthread_t CDeferredTraceWriter::s_writer_thread;
+	std::atomic<bool> CDeferredTraceWriter::s_finished( true );
+
+	time_t CDeferredTraceWriter::s_start_time = 0;
+	long long CDeferredTraceWriter::s_start_timestamp_nanoseconds = 0;
+
+	const int CDeferredTraceWriter::flush_interval_microseconds = 20000;
+
+
+	void CDeferredTraceWriter::start()
+	{
+		assert( s_finished );
+
+		if( !s_thread_buffers )
+		{
+			s_thread_buffers = new CTraceThreadBuffer[ max_thread_buffers ];
+		}
+
+		time( &s_start_time );
+		s_start_timestamp_nanoseconds = get_timestamp_nanoseconds();
+
+		s_finished = false;
+		pthread_create( &s_writer_thread, NULL, writer_thread_function, NULL );
+	}
+
+
+	void CDeferredTraceWriter::stop()
+	{
+		assert( !s_finished );
+
+		s_finished = true;
+		pthread_join( s_writer_thread, NULL );
+
+		flush();
+	}
+
+
+	CTraceThreadBuffer *CDeferredTraceWriter::claim_thread_buffer()
+	{
+		assert( s_thread_buffers );
+
+		for( int i = 0; i < max_thread_buffers; i++ )
+		{
+			if( s_thread_buffers[ i ].claim() )
+			{
+				return &s_thread_buffers[ i ];
+			}
+		}
+
+		s_unbuffered_dropped_count.fetch_add( 1, std::memory_order_relaxed );
+		return NULL;
+	}
+
+
+	void *CDeferredTraceWriter::writer_thread_function( void * )
+	{
+		while( !s_finished )
+		{
+			flush();
+
+			usleep( flush_interval_microseconds );
+		}
+
+		return NULL;
+	}
+
+
+	void CDeferredTraceWriter::flush()
+	{
+		std::vector<CFlushedRecord> records;
+		std::vector<std::pair<pthread_t, unsigned int> > dropped_counts;
+
+		for( int i = 0; i < max_thread_buffers; i++ )
+		{
+			CTraceThreadBuffer *buffer = &s_thread_buffers[ i ];
+
+			/* check retirement first - once a thread has exited, it can't trace any more messages */
+			bool retired = buffer->is_retired();
+			if( !retired && !buffer->is_active() )
+			{
+				continue;
+			}
+
+			while( const CTraceRecord *record = buffer->peek_record() )
+			{
+				records.push_back( CFlushedRecord() );
+				records.back().m_record = *record;
+				records.back().m_thread_id = buffer->get_thread_id();
+
+				buffer->pop_record();
+			}
+
+			unsigned int dropped_count = buffer->take_dropped_count();
+			if( dropped_count > 0 )
+			{
+				dropped_counts.push_back( std::make_pair( buffer->get_thread_id(), dropped_count ) );
+			}
+
+			if( retired )
+			{
+				buffer->release();
+			}
+		}
+
+		/* interleave messages from all threads in the order they were traced */
+		std::stable_sort( records.begin(), records.end() );
+
+		std::ostream &stream = integra_api::CTrace::s_trace_stream;
+
+		for( std::vector<CFlushedRecord>::const_iterator i = records.begin(); i != records.end(); i++ )
+		{
+			const CTraceRecord &record = i->m_record;
+
+			time_t time = s_start_time + ( record.m_timestamp_nanoseconds - s_start_timestamp_nanoseconds ) / 1000000000;
+
+			integra_api::CTrace::write_header( stream, integra_api::CTrace::s_category_names[ record.m_category ], time, &i->m_thread_id, sizeof( pthread_t ), record.m_location, record.m_function );
+			stream << record.m_payload;
+		}
+
+		for( std::vector<std::pair<pthread_t, unsigned int> >::const_iterator i = dropped_counts.begin(); i != dropped_counts.end(); i++ )
+		{
+			time_t now;
+			time( &now );
+
+			integra_api::CTrace::write_header( stream, integra_api::CTrace::s_category_names[ integra_api::CTrace::CATEGORY_ERROR ], now, &i->first, sizeof( pthread_t ), INTEGRA_LOCATION, INTEGRA_FUNCTION );
+			stream << "Dropped " << i->second << " deferred trace messages - trace buffer full";
+		}
+
+		unsigned int unbuffered_dropped_count = s_unbuffered_dropped_count.exchange( 0, std::memory_order_relaxed );
+		if( unbuffered_dropped_count > 0 )
+		{
+			time_t now;
+			time( &now );
+
+			pthread_t thread_id = pthread_self();
+
+			integra_api::CTrace::write_header( stream, integra_api::CTrace::s_category_names[ integra_api::CTrace::CATEGORY_ERROR ], now, &thread_id, sizeof( pthread_t ), INTEGRA_LOCATION, INTEGRA_FUNCTION );
+			stream << "Dropped " << unbuffered_dropped_count << " deferred trace messages - more than " << max_thread_buffers << " threads have traced";
+		}
+	}
+}
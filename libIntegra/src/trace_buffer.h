@@ -0,0 +1,191 @@
+/* libIntegra modular audio framework
+ *
+ * Copyright (C) 2007 Birmingham City University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, 
+ * USA.
+ */
+
+
+
+#ifndef INTEGRA_TRACE_BUFFER_H
+#define INTEGRA_TRACE_BUFFER_H
+
+#include "api/trace.h"
+
+#include <pthread.h>
+#include <streambuf>
+#include <atomic>
+
+
+namespace integra_internal
+{
+	/*
+	 CTraceRecord is a single deferred trace message.  location and function point to string 
+	 literals, so only the streamed payload needs to be copied.
+	*/
+
+	class CTraceRecord
+	{
+		public:
+
+			static const int max_payload_length = 256;
+
+			integra_api::CTrace::category m_category;
+			const char *m_location;
+			const char *m_function;
+			long long m_timestamp_nanoseconds;
+			char m_payload[ max_payload_length ];
+	};
+
+
+	/* CTraceStreamBuffer formats into a fixed array, silently truncating anything which doesn't fit */
+
+	class CTraceStreamBuffer : public std::streambuf
+	{
+		public:
+
+			void reset( char *buffer, unsigned int size ) { setp( buffer, buffer + size - 1 ); }
+			unsigned int get_length() const { return pptr() - pbase(); }
+	};
+
+
+	/*
+	 CTraceThreadBuffer is a lock-free single-producer/single-consumer ring of CTraceRecords.
+
+	 Each thread which traces in deferred mode owns one, claimed from CDeferredTraceWriter's 
+	 preallocated pool on its first message without locking or allocating.  The owning thread 
+	 formats each message directly into the next free record, and CDeferredTraceWriter's thread 
+	 reads them out.  When the ring is full, messages are formatted into a scratch record and 
+	 counted as dropped.  When a thread exits, its buffer is retired, and returned to the pool 
+	 once its remaining messages have been written.
+	*/
+
+	class CTraceThreadBuffer
+	{
+		public:
+
+			CTraceThreadBuffer();
+
+			/* returns NULL if every buffer in the pool is in use */
+			static CTraceThreadBuffer *get_current_thread_buffer();
+
+			/* claims the buffer for the calling thread.  Returns false if another thread owns it */
+			bool claim();
+
+			/* producer side.  begin_record returns NULL if the thread is already tracing a message */
+			std::ostream *begin_record( integra_api::CTrace::category category, const char *location, const char *function );
+			void end_record();
+
+			/* consumer side */
+			const CTraceRecord *peek_record();
+			void pop_record();
+			unsigned int take_dropped_count();
+
+			const pthread_t &get_thread_id() const { return m_thread_id; }
+
+			/* consumer side.  Only active and retired buffers have a thread id or records to read */
+			bool is_active() const { return m_state.load( std::memory_order_acquire ) == ACTIVE; }
+			bool is_retired() const { return m_state.load( std::memory_order_acquire ) == RETIRED; }
+
+			/* consumer side.  Returns a retired buffer to the pool */
+			void release();
+
+			static const int number_of_records = 256;
+
+		private:
+
+			enum state
+			{
+				FREE,
+				CLAIMING,
+				ACTIVE,
+				RETIRED
+			};
+
+			static void create_thread_key();
+			static void retire_thread_buffer( void *buffer );
+
+			CTraceRecord m_records[ number_of_records ];
+			CTraceRecord m_scratch_record;
+
+			CTraceRecord *m_current_record;
+
+			CTraceStreamBuffer m_stream_buffer;
+			std::ostream m_stream;
+
+			pthread_t m_thread_id;
+
+			std::atomic<unsigned int> m_write_index;
+			std::atomic<unsigned int> m_read_index;
+			std::atomic<unsigned int> m_dropped_count;
+			std::atomic<int> m_state;
+
+			static pthread_key_t s_thread_key;
+			static pthread_once_t s_thread_key_once;
+	};
+
+
+	/*
+	 CDeferredTraceWriter owns the background thread which formats and writes deferred trace 
+	 messages, and the pool of threads' trace buffers.  The pool is allocated by the first start, 
+	 and lives as long as the process, since threads keep pointers to their buffers.
+	*/
+
+	class CDeferredTraceWriter
+	{
+		public:
+
+			static void start();
+			static void stop();
+
+			/* lock-free.  Returns NULL if every buffer is in use, in which case the message is counted as dropped */
+			static CTraceThreadBuffer *claim_thread_buffer();
+
+			static const int max_thread_buffers = 64;
+
+		private:
+
+			static void *writer_thread_function( void * );
+
+			/* writes all outstanding messages, and deletes buffers whose threads have exited */
+			static void flush();
+
+			class CFlushedRecord
+			{
+				public:
+
+					bool operator<( const CFlushedRecord &other ) const { return m_record.m_timestamp_nanoseconds < other.m_record.m_timestamp_nanoseconds; }
+
+					CTraceRecord m_record;
+					pthread_t m_thread_id;
+			};
+
+			static CTraceThreadBuffer *s_thread_buffers;
+			static std::atomic<unsigned int> s_unbuffered_dropped_count;
+
+			static pthread_t s_writer_thread;
+			static std::atomic<bool> s_finished;
+
+			static time_t s_start_time;
+			static long long s_start_timestamp_nanoseconds;
+
+			static const int flush_interval_microseconds;
+	};
+}
+
+
+
+#endif /* INTEGRA_TRACE_BUFFER_H */
@@ -32,6 +32,10 @@ namespace integra_internal
 {
 	const char *CValidator::schema_file = "CollectionSchema.xsd";
 
+	CValidator *CValidator::s_shared_validator = NULL;
+	pthread_once_t CValidator::s_shared_validator_once = PTHREAD_ONCE_INIT;
+
+
 	static void schemaErrorCallback( void *none, const char *message, ...)
 	{
 		char trace[ CStringHelper::string_buffer_length ];
@@ -56,33 +60,32 @@ namespace integra_internal
 	}
 
 
+	static void readerErrorCallback( void *callbackData, const char *message, xmlParserSeverities severity, xmlTextReaderLocatorPtr locator )
+	{
+		INTEGRA_TRACE_ERROR << "line " << xmlTextReaderLocatorLineNumber( locator ) << ": " << message;
+	}
+
+
 	CValidator::CValidator()
 	{
-		m_schema_parser_context = NULL;
 		m_schema = NULL;
-		m_validity_context = NULL;
 
-		m_schema_parser_context = xmlSchemaNewParserCtxt( schema_file );
-
-		if( m_schema_parser_context )
-		{
-			m_schema = xmlSchemaParse( m_schema_parser_context );
-		}
-		else 
+		xmlSchemaParserCtxtPtr schema_parser_context = xmlSchemaNewParserCtxt( schema_file );
+		if( !schema_parser_context )
 		{
 			INTEGRA_TRACE_ERROR << "Unable to get schema parser context";
 			return;
 		}
 
-		if( m_schema)
-		{
-			m_validity_context = xmlSchemaNewValidCtxt( m_schema );
-		}
-		else 
+		xmlSchemaSetParserErrors( schema_parser_context, schemaErrorCallback, schemaWarningCallback, /* callback data */ 0 );
+
+		m_schema = xmlSchemaParse( schema_parser_context );
+		if( !m_schema )
 		{
 			INTEGRA_TRACE_ERROR << "Unable to get schema from schema parser context";
-			return;
 		}
+
+		xmlSchemaFreeParserCtxt( schema_parser_context );
 	}
 
 
@@ -92,92 +95,51 @@ namespace integra_internal
 		{
 			xmlSchemaFree( m_schema );
 		}
-
-		if( m_schema_parser_context ) 
-		{
-			xmlSchemaFreeParserCtxt( m_schema_parser_context );
-		}
-
-		if( m_validity_context ) 
-		{
-			xmlSchemaFreeValidCtxt( m_validity_context );
-		}
 	}
 
 
-	
-	CError CValidator::validate_ixd( const char *xml_buffer, unsigned int buffer_length )
+	const CValidator &CValidator::get_shared_validator()
 	{
-		assert( xml_buffer );
-
-		xmlDocPtr doc = document_read( xml_buffer, buffer_length );
+		pthread_once( &s_shared_validator_once, create_shared_validator );
 
-		CError validation_code = validate_against_schema( doc );
-
-		document_free( doc );
-
-		if( validation_code != CError::SUCCESS ) 
-		{
-			INTEGRA_TRACE_ERROR << "validation failed: " << validation_code.get_text();
-			return CError::FILE_VALIDATION_ERROR;
-		}
-
-		return CError::SUCCESS;	
+		assert( s_shared_validator );
+		return *s_shared_validator;
 	}
 
 
-	xmlDocPtr CValidator::document_read( const char *xml_buffer, unsigned int buffer_length )
+	void CValidator::create_shared_validator()
 	{
-		assert( xml_buffer );
-
-		xmlDocPtr doc = xmlParseMemory( xml_buffer, buffer_length );
+		xmlInitParser();
 
-		xmlNodePtr cur = xmlDocGetRootElement(doc);
-
-		if( !cur ) 
-		{
-			INTEGRA_TRACE_ERROR << "XML document is empty";
-			document_free( doc );
-			return NULL;
-		}
-
-		return doc;
+		/* never deleted - the schema lives for the rest of the process */
+		s_shared_validator = new CValidator;
 	}
 
 
-	CError CValidator::document_free( xmlDocPtr doc )
+	CError CValidator::validate_while_reading( xmlTextReaderPtr reader ) const
 	{
-		if( doc ) 
-		{
-			xmlFreeDoc( doc );
-			return CError::SUCCESS;
-		} 
-		else 
+		assert( reader );
+
+		if( !m_schema ) 
 		{
-			INTEGRA_TRACE_ERROR << "XML document pointer is NULL, no resource freed.";
-			return CError::INPUT_ERROR;
+			INTEGRA_TRACE_ERROR << "collection schema is not loaded";
+			return CError::FAILED;
 		}
-	}
 
+		xmlTextReaderSetErrorHandler( reader, readerErrorCallback, NULL );
 
-	CError CValidator::validate_against_schema( const xmlDocPtr doc )
-	{
-		int validation_code;
-
-		if( !m_validity_context ) 
+		if( xmlTextReaderSetSchema( reader, m_schema ) != 0 )
 		{
-			INTEGRA_TRACE_ERROR << "XML validity context is NULL";
+			INTEGRA_TRACE_ERROR << "failed to attach schema to reader";
 			return CError::FAILED;
 		}
 
-		xmlSchemaSetValidErrors( m_validity_context, schemaErrorCallback, schemaWarningCallback,
-								/* callback data */ 0 );
+		return CError::SUCCESS;
+	}
 
-		validation_code = xmlSchemaValidateDoc( m_validity_context, doc );
 
-		if( validation_code > 0 ) return CError::INPUT_ERROR;
-		if( validation_code < 0 ) return CError::FAILED;
-		return CError::SUCCESS;
+	bool CValidator::is_valid( xmlTextReaderPtr reader )
+	{
+		return ( xmlTextReaderIsValid( reader ) != 0 );
 	}
 }
-
@@ -24,8 +24,11 @@
 
 
 #include <libxml/parser.h>
+#include <libxml/xmlreader.h>
 #include <libxml/xmlschemas.h>
 
+#include <pthread.h>
+
 #include "api/error.h"
 
 using namespace integra_api;
@@ -33,33 +36,43 @@ using namespace integra_api;
 
 namespace integra_internal
 {
+	/*
+	 CValidator holds the compiled collection schema.  The schema is parsed once per process,
+	 on first use, and is shared by all loads - a compiled schema is read-only, so it can be 
+	 used by several readers at once.
+	
+	 Validation is done in streaming mode, by the same xmlTextReader pass which loads the file,
+	 so that each file is only parsed once.
+	*/
+
 	class CValidator
 	{
 		public:
 
-			CValidator();
-			~CValidator();
+			static const CValidator &get_shared_validator();
 
-			/* \brief high-level function to validate an IXD 
+			/* \brief make reader validate each node against the schema as it is read
 			 *
-			 * \param *xml_buffer pointer to buffer containing xml data
-			 * \param buffer_length size of buffer in bytes
+			 * Must be called before the first xmlTextReaderRead.  Afterwards, is_valid reports 
+			 * whether the content read so far conforms to the schema.
 			 */
-			CError validate_ixd( const char *xml_buffer, unsigned int buffer_length );
+			CError validate_while_reading( xmlTextReaderPtr reader ) const;
 
-		private:
+			static bool is_valid( xmlTextReaderPtr reader );
 
+		private:
 
-			xmlDocPtr document_read( const char *xml_buffer, unsigned int buffer_length );
-			CError document_free( xmlDocPtr doc );
+			CValidator();
+			~CValidator();
 
-			CError validate_against_schema( const xmlDocPtr doc );
+			static void create_shared_validator();
 
-			xmlSchemaParserCtxtPtr m_schema_parser_context;
 			xmlSchemaPtr m_schema;
-			xmlSchemaValidCtxtPtr m_validity_context;
 
 			static const char *schema_file;
+
+			static CValidator *s_shared_validator;
+			static pthread_once_t s_shared_validator_once;
 	};
 
 
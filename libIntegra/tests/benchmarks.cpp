@@ -0,0 +1,2616 @@
+//
+//  benchmarks.cpp
+//  UnitTests
+//
+//  Performance benchmarks for the real-time paths of libIntegra.
+//  Each benchmark prints its measurements to stdout; assertions only check correctness,
+//  so that results from slow build machines don't fail the suite.
+//
+
+#include "util.hpp"
+
+#include "server_startup_info.h"
+#include "integra_session.h"
+#include "error.h"
+#include "server.h"
+#include "trace.h"
+#include "server_lock.h"
+#include "guid_helper.h"
+#include "command.h"
+#include "path.h"
+#include "value.h"
+#include "node.h"
+#include "node_endpoint.h"
+#include "interface_definition.h"
+#include "audio_statistics.h"
+
+#include "../src/dsp_command_queue.h"
+#include "../src/ring_buffer.h"
+#include "../src/module_manager.h"
+#include "../src/file_helper.h"
+#include "../src/validator.h"
+#include "../src/server.h"
+#include "../src/dsp_engine.h"
+#include "../src/control_point_index.h"
+#include "../src/midi_input_dispatcher.h"
+#include "../src/threaded_queue.h"
+#include "../src/dsp_load_monitor.h"
+
+#include "gtest.h"
+
+#include <pthread.h>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <list>
+#include <map>
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+#include <random>
+#include <cstdlib>
+#include <cstdio>
+#include <sstream>
+#include <streambuf>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+using namespace testing;
+using namespace integra_api;
+using namespace integra_internal;
+
+namespace k
+{
+    namespace benchmark
+    {
+        const std::string moduleDirectory           = "Integra.framework/Resources/modules";
+        const std::string thirdPartyModuleDirectory = "third_party";
+        const std::string tapDelayGUID              = "c811c1b6-24b4-5a7a-065a-2c12cf061d4b";
+        const std::string tapDelayName              = "TapDelay1";
+        const std::string tapDelayEndpoint          = tapDelayName + "." + "delayTime";
+
+        const int samplesPerBuffer                  = 64;
+        const int sampleRate                        = 44100;
+        const int commandsPerSecond                 = 100000;
+        const int benchmarkSeconds                  = 1;
+
+        const int ringBufferChannels                = 2;
+        const int ringBufferFrames                  = 88200;
+        const int ringBufferBlocks                  = 200000;
+
+        const int tracingThreads                    = 4;
+        const int tracesPerThread                   = 10000;
+        const double traceIntervalMicroseconds      = 100;
+
+        const int routingContainers                 = 20;
+        const int routingScalersPerContainer        = 100;
+        const int routingConnectionsPerContainer    = 20;
+        const int routingTopLevelConnections        = 100;
+        const int routingSetCommands                = 20000;
+
+        const int scriptSiblingScalers              = 200;
+        const int scriptTriggers                    = 2000;
+
+        const int startupRepetitions                = 5;
+        const std::string moduleCacheDirectory      = "benchmark_module_cache";
+
+        const std::string collectionSchemaFile      = "CollectionSchema.xsd";
+        const int collectionCorpusSize              = 5;
+        const int collectionContainers              = 20;
+        const int collectionObjectsPerContainer     = 100;
+        const int collectionLoadRepetitions         = 4;
+
+        const int batchSetCommands                  = 10000;
+        const int batchTargetNodes                  = 100;
+
+        const int lookupMaximumDepth                = 8;
+        const int lookupsPerDepth                   = 100000;
+        const int handleSetCommands                 = 20000;
+
+        const int dispatchModuleCounts[]            = { 10, 100, 300 };
+        const int dispatchSendsPerBlock             = 500;
+        const int dispatchBlocks                    = 50;
+
+        const int envelopeControlPoints             = 10000;
+        const int envelopeTicksPerControlPoint      = 10;
+        const int envelopePlaybackStep              = 3;
+        const int envelopeSeeks                     = 20000;
+
+        const int midiMappedControlCounts[]         = { 10, 100, 500 };
+        const int midiMessagesPerSecond             = 10000;
+        const int midiStreamSeconds                 = 1;
+        const std::string midiDeviceName            = "Benchmark Device";
+
+        const int queuePushesPerBlock               = 8;
+        const int queueBackgroundPushesPerSecond    = 20000;
+        const int queueBenchmarkSeconds             = 2;
+
+        const int dspLoadRecordedBlocks             = 1000000;
+
+        const int graphModules                      = 500;
+        const int graphRepetitions                  = 3;
+        const std::string graphCollectionFile       = "graph_rebuild_benchmark.integra";
+
+        const int canvasModuleCounts[]              = { 100, 1000 };
+        const int canvasRemovals                    = 50;
+
+        const int abstractionInstances              = 64;
+    }
+}
+
+typedef std::chrono::steady_clock benchmark_clock;
+
+static double microseconds_between(benchmark_clock::time_point start, benchmark_clock::time_point end)
+{
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+static void spin_for_microseconds(double microseconds)
+{
+    benchmark_clock::time_point start = benchmark_clock::now();
+    while (microseconds_between(start, benchmark_clock::now()) < microseconds) {}
+}
+
+class BenchmarkStatistics
+{
+public:
+
+    void add(double sample) { samples.push_back(sample); }
+
+    void add_all(const BenchmarkStatistics &other) { samples.insert(samples.end(), other.samples.begin(), other.samples.end()); }
+
+    void report(const std::string &name, const std::string &units) const
+    {
+        if (samples.empty())
+        {
+            std::cout << "[ BENCHMARK] " << name << ": no samples" << std::endl;
+            return;
+        }
+
+        std::vector<double> sorted(samples);
+        std::sort(sorted.begin(), sorted.end());
+
+        double total = 0;
+        for (double sample : sorted) total += sample;
+        double mean = total / sorted.size();
+
+        double variance = 0;
+        for (double sample : sorted) variance += (sample - mean) * (sample - mean);
+        double deviation = std::sqrt(variance / sorted.size());
+
+        std::cout << "[ BENCHMARK] " << name << ": n=" << sorted.size()
+                  << " mean=" << mean << units
+                  << " stddev=" << deviation << units
+                  << " p99=" << percentile(sorted, 0.99) << units
+                  << " p99.9=" << percentile(sorted, 0.999) << units
+                  << " max=" << sorted.back() << units << std::endl;
+    }
+
+    std::size_t size() const { return samples.size(); }
+
+private:
+
+    static double percentile(const std::vector<double> &sorted, double fraction)
+    {
+        std::size_t index = std::min(sorted.size() - 1, (std::size_t) (fraction * sorted.size()));
+        return sorted[index];
+    }
+
+    std::vector<double> samples;
+};
+
+
+#pragma mark - DSP command channel
+
+/*
+ Micro-benchmark of the command channel on its own, without libpd.  A simulated audio callback
+ runs every 64 samples, spinning for a fixed time to stand in for dsp, alongside a control thread
+ firing set commands at k::benchmark::commandsPerSecond.  The callback cost (including any time
+ spent waiting for the control thread) is measured for both the previous mutex-based channel and
+ the lock-free CDspCommandQueue.  SetCommandStress below times the real process_buffer.
+ */
+
+namespace
+{
+    const double simulatedTickMicroseconds = 200;
+
+    struct MutexChannel
+    {
+        MutexChannel() { pthread_mutex_init(&mutex, NULL); }
+        ~MutexChannel() { pthread_mutex_destroy(&mutex); }
+
+        void send(int id, float value)
+        {
+            // previously the control thread held the dsp mutex whilst building each message
+            pthread_mutex_lock(&mutex);
+            messages.push_back(std::make_pair(id, value));
+            pthread_mutex_unlock(&mutex);
+        }
+
+        int process()
+        {
+            pthread_mutex_lock(&mutex);
+            int count = messages.size();
+            messages.clear();
+            spin_for_microseconds(simulatedTickMicroseconds);
+            pthread_mutex_unlock(&mutex);
+            return count;
+        }
+
+        pthread_mutex_t mutex;
+        std::list<std::pair<int, float>> messages;
+    };
+
+    struct QueueChannel
+    {
+        QueueChannel() : queue(1024) {}
+
+        void send(int id, float value)
+        {
+            CDspCommand *command;
+            while (!(command = queue.begin_write()))
+            {
+                std::this_thread::yield();
+            }
+
+            command->set_list_target("integra-broadcast-receive");
+            command->add_float(id);
+            command->add_symbol("delayTime");
+            command->add_float(value);
+            queue.end_write();
+        }
+
+        int process()
+        {
+            int count = 0;
+            while (queue.begin_read())
+            {
+                queue.end_read();
+                count++;
+            }
+
+            spin_for_microseconds(simulatedTickMicroseconds);
+            return count;
+        }
+
+        CDspCommandQueue queue;
+    };
+
+    template <class Channel> void run_channel_benchmark(const std::string &name)
+    {
+        Channel channel;
+        std::atomic<bool> finished(false);
+        std::atomic<int> processed(0);
+        BenchmarkStatistics callback_cost;
+        BenchmarkStatistics callback_lateness;
+
+        const double block_microseconds = 1000000.0 * k::benchmark::samplesPerBuffer / k::benchmark::sampleRate;
+
+        std::thread audio_thread([&]()
+        {
+            benchmark_clock::time_point next_block = benchmark_clock::now();
+            while (!finished)
+            {
+                next_block += std::chrono::microseconds((long) block_microseconds);
+                std::this_thread::sleep_until(next_block);
+
+                benchmark_clock::time_point start = benchmark_clock::now();
+                processed += channel.process();
+                benchmark_clock::time_point end = benchmark_clock::now();
+
+                callback_lateness.add(microseconds_between(next_block, start));
+                callback_cost.add(microseconds_between(start, end));
+            }
+        });
+
+        const int total_commands = k::benchmark::commandsPerSecond * k::benchmark::benchmarkSeconds;
+        const double command_interval = 1000000.0 / k::benchmark::commandsPerSecond;
+
+        benchmark_clock::time_point start = benchmark_clock::now();
+        for (int i = 0; i < total_commands; i++)
+        {
+            channel.send(i % 300, float(i));
+
+            while (microseconds_between(start, benchmark_clock::now()) < i * command_interval) {}
+        }
+
+        // let the audio thread drain what's left
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        finished = true;
+        audio_thread.join();
+
+        callback_cost.report(name + " callback cost", "us");
+        callback_lateness.report(name + " callback wakeup jitter", "us");
+
+        ASSERT_EQ(processed.load(), total_commands);
+    }
+}
+
+TEST(DspCommandChannelMicroBenchmark, MutexChannelCallbackJitter)
+{
+    run_channel_benchmark<MutexChannel>("simulated mutex channel (before)");
+}
+
+TEST(DspCommandChannelMicroBenchmark, LockFreeQueueCallbackJitter)
+{
+    run_channel_benchmark<QueueChannel>("simulated lock-free command queue (after)");
+}
+
+
+#pragma mark - Set command stress against a running patch
+
+class BenchmarkServerTest : public ::testing::Test
+{
+protected:
+
+    BenchmarkServerTest()
+    {
+        sinfo.system_module_directory       = k::benchmark::moduleDirectory;
+        sinfo.third_party_module_directory  = k::benchmark::thirdPartyModuleDirectory;
+        CTrace::set_categories_to_trace(false, false, false);
+
+        CError err = session.start_session(sinfo);
+        assert(err == CError::SUCCESS);
+    }
+
+    ~BenchmarkServerTest() override
+    {
+        CError err = session.end_session();
+        assert(err == CError::SUCCESS);
+    }
+
+    CServerLock server()
+    {
+        return session.get_server();
+    }
+
+    void create_tap_delay()
+    {
+        GUID guid;
+        CGuidHelper::string_to_guid(k::benchmark::tapDelayGUID, guid);
+
+        CError err = server()->process_command(INewCommand::create(guid, k::benchmark::tapDelayName, CPath()));
+        assert(err == CError::SUCCESS);
+    }
+
+    CServerStartupInfo sinfo;
+    CIntegraSession session;
+};
+
+/* pd's own flag, cleared whilst a graph edit has its dsp chain suspended */
+extern "C" int canvas_dspstate;
+
+namespace
+{
+    /*
+     Calls process_buffer at block rate on its own thread, as an audio driver does, timing each
+     call and how late it started.  process_buffer only try-locks libpd, so this is safe alongside
+     a running audio driver, although blocks the driver takes from it are skipped.  Blocks after
+     which pd's dsp chain is still suspended are counted, since everything after them is silent
+     */
+
+    class BlockDriver
+    {
+    public:
+
+        BlockDriver(CDspEngine &dsp_engine) : blocks(0), suspended_blocks(0), dsp_engine(dsp_engine), finished(false) {}
+
+        void start()
+        {
+            finished = false;
+            blocks = 0;
+            suspended_blocks = 0;
+            thread = std::thread([this]() { run(); });
+        }
+
+        void stop()
+        {
+            finished = true;
+            thread.join();
+        }
+
+        BenchmarkStatistics block_cost;
+        BenchmarkStatistics block_lateness;
+        int blocks;
+        int suspended_blocks;
+
+    private:
+
+        void run()
+        {
+            std::vector<float> input(CDspEngine::samples_per_buffer * 2, 0);
+            std::vector<float> output(CDspEngine::samples_per_buffer * 2, 0);
+
+            const double block_microseconds = 1000000.0 * CDspEngine::samples_per_buffer / k::benchmark::sampleRate;
+
+            benchmark_clock::time_point next_block = benchmark_clock::now();
+            while (!finished)
+            {
+                next_block += std::chrono::microseconds((long) block_microseconds);
+                std::this_thread::sleep_until(next_block);
+
+                benchmark_clock::time_point start = benchmark_clock::now();
+                dsp_engine.process_buffer(&input[0], &output[0], 2, 2, k::benchmark::sampleRate);
+                benchmark_clock::time_point end = benchmark_clock::now();
+
+                block_lateness.add(microseconds_between(next_block, start));
+                block_cost.add(microseconds_between(start, end));
+
+                blocks++;
+                if (!canvas_dspstate) suspended_blocks++;
+            }
+        }
+
+        CDspEngine &dsp_engine;
+        std::atomic<bool> finished;
+        std::thread thread;
+    };
+}
+
+/*
+ Fires k::benchmark::commandsPerSecond set commands at a running TapDelay whilst blocks are driven
+ through process_buffer, reporting the real callback cost and jitter with no commands, and under load
+ */
+
+TEST_F(BenchmarkServerTest, SetCommandStress)
+{
+    create_tap_delay();
+
+    CDspEngine &dsp_engine = dynamic_cast<CServer &>(*server()).get_dsp_engine();
+
+    BlockDriver idle_driver(dsp_engine);
+    idle_driver.start();
+    std::this_thread::sleep_for(std::chrono::seconds(k::benchmark::benchmarkSeconds));
+    idle_driver.stop();
+
+    const int total_commands = k::benchmark::commandsPerSecond * k::benchmark::benchmarkSeconds;
+    const double command_interval = 1000000.0 / k::benchmark::commandsPerSecond;
+
+    BenchmarkStatistics set_latency;
+    int failures = 0;
+
+    BlockDriver stress_driver(dsp_engine);
+    stress_driver.start();
+
+    benchmark_clock::time_point start = benchmark_clock::now();
+    for (int i = 0; i < total_commands; i++)
+    {
+        benchmark_clock::time_point command_start = benchmark_clock::now();
+
+        CError err = server()->process_command(ISetCommand::create(k::benchmark::tapDelayEndpoint, CFloatValue(float(i % 1000) * 0.001f)));
+        if (err != CError::SUCCESS) failures++;
+
+        set_latency.add(microseconds_between(command_start, benchmark_clock::now()));
+
+        while (microseconds_between(start, benchmark_clock::now()) < i * command_interval) {}
+    }
+
+    double elapsed_seconds = microseconds_between(start, benchmark_clock::now()) / 1000000.0;
+
+    stress_driver.stop();
+
+    idle_driver.block_cost.report("process_buffer cost with no set commands", "us");
+    idle_driver.block_lateness.report("process_buffer wakeup jitter with no set commands", "us");
+    stress_driver.block_cost.report("process_buffer cost under set command load", "us");
+    stress_driver.block_lateness.report("process_buffer wakeup jitter under set command load", "us");
+    set_latency.report("set command latency under load", "us");
+    std::cout << "[ BENCHMARK] achieved " << total_commands / elapsed_seconds << " set commands per second" << std::endl;
+
+    ASSERT_EQ(failures, 0);
+}
+
+
+#pragma mark - Audio ring buffer
+
+/*
+ Streams k::benchmark::ringBufferBlocks blocks of 64 stereo frames from a writer thread to a
+ reader thread, as the separate input and output portaudio callbacks do.  The previous
+ mutex-guarded ring is reproduced here as the baseline for the wait-free CRingBuffer.
+ */
+
+namespace
+{
+    class MutexRingBuffer
+    {
+    public:
+
+        MutexRingBuffer(int channels, int frames)
+        :   buffer(channels * frames, 0.f), channels(channels), frames(frames), write_position(0), read_position(0)
+        {
+            pthread_mutex_init(&mutex, NULL);
+        }
+
+        ~MutexRingBuffer() { pthread_mutex_destroy(&mutex); }
+
+        void write(const float *source, int sample_frames)
+        {
+            pthread_mutex_lock(&mutex);
+            for (int i = 0; i < sample_frames; i++)
+            {
+                std::copy(source + i * channels, source + (i + 1) * channels, &buffer[write_position * channels]);
+                write_position = (write_position + 1) % frames;
+            }
+            pthread_mutex_unlock(&mutex);
+        }
+
+        void read(float *destination, int sample_frames)
+        {
+            pthread_mutex_lock(&mutex);
+            for (int i = 0; i < sample_frames; i++)
+            {
+                std::copy(&buffer[read_position * channels], &buffer[(read_position + 1) * channels], destination + i * channels);
+                read_position = (read_position + 1) % frames;
+            }
+            pthread_mutex_unlock(&mutex);
+        }
+
+    private:
+
+        pthread_mutex_t mutex;
+        std::vector<float> buffer;
+        int channels;
+        int frames;
+        int write_position;
+        int read_position;
+    };
+
+    struct WaitFreeRingBuffer
+    {
+        WaitFreeRingBuffer(int channels, int frames)
+        {
+            ring.set_number_of_channels(channels);
+            ring.set_buffer_length(frames);
+        }
+
+        void write(const float *source, int sample_frames) { ring.write(source, sample_frames); }
+        void read(float *destination, int sample_frames) { ring.read(destination, sample_frames); }
+
+        CRingBuffer ring;
+    };
+
+    template <class Ring> void run_ring_buffer_benchmark(const std::string &name)
+    {
+        const int block_samples = k::benchmark::samplesPerBuffer * k::benchmark::ringBufferChannels;
+
+        Ring ring(k::benchmark::ringBufferChannels, k::benchmark::ringBufferFrames);
+        std::atomic<int> blocks_written(0);
+        std::atomic<int> blocks_read(0);
+        BenchmarkStatistics write_cost;
+        BenchmarkStatistics read_cost;
+
+        benchmark_clock::time_point start = benchmark_clock::now();
+
+        std::thread writer([&]()
+        {
+            std::vector<float> block(block_samples);
+            for (int i = 0; i < k::benchmark::ringBufferBlocks; i++)
+            {
+                // keep the writer no more than half a ring ahead, so that neither ring overruns
+                while ((i - blocks_read.load()) * k::benchmark::samplesPerBuffer > k::benchmark::ringBufferFrames / 2) {}
+
+                std::fill(block.begin(), block.end(), float(i));
+
+                benchmark_clock::time_point call_start = benchmark_clock::now();
+                ring.write(&block[0], k::benchmark::samplesPerBuffer);
+                write_cost.add(microseconds_between(call_start, benchmark_clock::now()));
+
+                blocks_written++;
+            }
+        });
+
+        std::vector<float> block(block_samples);
+        int mismatches = 0;
+        for (int i = 0; i < k::benchmark::ringBufferBlocks; i++)
+        {
+            while (blocks_written.load() <= i) {}
+
+            benchmark_clock::time_point call_start = benchmark_clock::now();
+            ring.read(&block[0], k::benchmark::samplesPerBuffer);
+            read_cost.add(microseconds_between(call_start, benchmark_clock::now()));
+
+            if (block.front() != float(i) || block.back() != float(i)) mismatches++;
+
+            blocks_read++;
+        }
+
+        writer.join();
+
+        double elapsed_seconds = microseconds_between(start, benchmark_clock::now()) / 1000000.0;
+
+        write_cost.report(name + " write cost", "us");
+        read_cost.report(name + " read cost", "us");
+        std::cout << "[ BENCHMARK] " << name << " throughput: " << k::benchmark::ringBufferBlocks * k::benchmark::samplesPerBuffer / elapsed_seconds << " frames per second" << std::endl;
+
+        ASSERT_EQ(mismatches, 0);
+    }
+}
+
+TEST(RingBufferBenchmark, MutexRingBuffer)
+{
+    run_ring_buffer_benchmark<MutexRingBuffer>("mutex ring buffer (before)");
+}
+
+TEST(RingBufferBenchmark, WaitFreeRingBuffer)
+{
+    run_ring_buffer_benchmark<WaitFreeRingBuffer>("wait-free ring buffer (after)");
+}
+
+TEST(RingBufferBenchmark, WaitFreeRingBufferCountsOverrunsAndUnderruns)
+{
+    CRingBuffer ring;
+    ring.set_number_of_channels(1);
+    ring.set_buffer_length(100);
+
+    std::vector<float> block(256, 1.f);
+
+    // length is rounded up to 128 frames, so the second write overruns by 64
+    ring.write(&block[0], 96);
+    ring.write(&block[0], 96);
+    ASSERT_EQ(ring.get_overrun_count(), 1u);
+    ASSERT_EQ(ring.get_dropped_frames(), 64u);
+
+    ring.read(&block[0], 192);
+    ASSERT_EQ(ring.get_underrun_count(), 1u);
+    ASSERT_EQ(ring.get_silent_frames(), 64u);
+    ASSERT_EQ(block[127], 1.f);
+    ASSERT_EQ(block[128], 0.f);
+}
+
+
+#pragma mark - Tracing
+
+/*
+ k::benchmark::tracingThreads threads trace concurrently, and the cost of each INTEGRA_TRACE_ERROR
+ statement is measured in the default (immediate) mode and in deferred mode.  stdout is replaced
+ by a stream which writes to /dev/null, so that the system calls made by immediate tracing are
+ still included without flooding the test output.
+ */
+
+namespace
+{
+    class DevNullBuffer : public std::streambuf
+    {
+    public:
+
+        DevNullBuffer() : file(open("/dev/null", O_WRONLY)) { setp(buffer, buffer + sizeof(buffer)); }
+        ~DevNullBuffer() override { sync(); close(file); }
+
+    protected:
+
+        int overflow(int character) override
+        {
+            sync();
+            if (character != traits_type::eof()) sputc(character);
+            return 0;
+        }
+
+        int sync() override
+        {
+            if (pptr() > pbase() && ::write(file, pbase(), pptr() - pbase()) < 0) return -1;
+            setp(buffer, buffer + sizeof(buffer));
+            return 0;
+        }
+
+    private:
+
+        int file;
+        char buffer[1024];
+    };
+
+    void run_trace_benchmark(const std::string &name, bool deferred)
+    {
+        DevNullBuffer dev_null;
+        std::streambuf *previous_buffer = std::cout.rdbuf(&dev_null);
+
+        CTrace::set_categories_to_trace(true, false, false);
+        CTrace::set_deferred_mode(deferred);
+
+        std::vector<BenchmarkStatistics> trace_cost(k::benchmark::tracingThreads);
+        std::vector<std::thread> threads;
+
+        for (int t = 0; t < k::benchmark::tracingThreads; t++)
+        {
+            threads.push_back(std::thread([&, t]()
+            {
+                benchmark_clock::time_point start = benchmark_clock::now();
+                for (int i = 0; i < k::benchmark::tracesPerThread; i++)
+                {
+                    benchmark_clock::time_point call_start = benchmark_clock::now();
+                    INTEGRA_TRACE_ERROR << "input underflow on thread " << t << " after " << i << " buffers, load " << 0.5f;
+                    trace_cost[t].add(microseconds_between(call_start, benchmark_clock::now()));
+
+                    while (microseconds_between(start, benchmark_clock::now()) < i * k::benchmark::traceIntervalMicroseconds) {}
+                }
+            }));
+        }
+
+        for (std::thread &thread : threads) thread.join();
+
+        CTrace::set_deferred_mode(false);
+        CTrace::set_categories_to_trace(false, false, false);
+
+        std::cout.rdbuf(previous_buffer);
+
+        BenchmarkStatistics all_threads;
+        for (const BenchmarkStatistics &statistics : trace_cost) all_threads.add_all(statistics);
+
+        all_threads.report(name + " per-call cost", "us");
+
+        ASSERT_EQ(all_threads.size(), k::benchmark::tracingThreads * k::benchmark::tracesPerThread);
+    }
+}
+
+TEST(TraceBenchmark, ImmediateTracingUnderContention)
+{
+    run_trace_benchmark("immediate tracing (before)", false);
+}
+
+TEST(TraceBenchmark, DeferredTracingUnderContention)
+{
+    run_trace_benchmark("deferred tracing (after)", true);
+}
+
+
+#pragma mark - Connection routing
+
+/*
+ Builds k::benchmark::routingContainers containers of Scalers, with connections between Scalers
+ inside each container and between containers at the top level, then sets Scaler inputs at
+ random.  Each set is routed through the Scaler's outValue to a connected Scaler.
+
+ The search which handle_connections used to do for each changed endpoint (walk up the
+ ancestors, scanning each one's siblings for Connections whose sourcePath matches) is
+ reproduced with the public api, for comparison with the cost of a whole routed set command.
+ */
+
+namespace
+{
+    const GUID &find_module_guid(IServer &server, const std::string &module_name)
+    {
+        const guid_set &module_ids = server.get_all_module_ids();
+        for (const GUID &module_id : module_ids)
+        {
+            const IInterfaceDefinition *interface_definition = server.find_interface(module_id);
+            if (interface_definition && interface_definition->get_interface_info().get_name() == module_name)
+            {
+                return interface_definition->get_module_guid();
+            }
+        }
+
+        return CGuidHelper::null_guid;
+    }
+
+    int count_connections_by_scan(IServer &server, const GUID &connection_guid, const INode &search_node, const INodeEndpoint &changed_endpoint)
+    {
+        int found = 0;
+
+        const INode *parent = search_node.get_parent();
+        if (parent)
+        {
+            found += count_connections_by_scan(server, connection_guid, *parent, changed_endpoint);
+        }
+
+        std::string relative_endpoint_path = changed_endpoint.get_path().get_string();
+        if (parent)
+        {
+            relative_endpoint_path = relative_endpoint_path.substr(parent->get_path().get_string().length() + 1);
+        }
+
+        const node_map &siblings = server.get_siblings(search_node);
+        for (node_map::const_iterator i = siblings.begin(); i != siblings.end(); i++)
+        {
+            const INode *sibling = i->second;
+            if (!CGuidHelper::guids_are_equal(sibling->get_interface_definition().get_module_guid(), connection_guid))
+            {
+                continue;
+            }
+
+            const std::string &source_path = *sibling->get_node_endpoint("sourcePath")->get_value();
+            if (source_path == relative_endpoint_path)
+            {
+                found++;
+            }
+        }
+
+        return found;
+    }
+
+    std::string scaler_path(int container, int scaler)
+    {
+        std::ostringstream path;
+        path << "Container" << container << ".Scaler" << scaler;
+        return path.str();
+    }
+}
+
+TEST_F(BenchmarkServerTest, ConnectionRoutingInLargeTree)
+{
+    GUID container_guid = find_module_guid(*server(), "Container");
+    GUID scaler_guid = find_module_guid(*server(), "Scaler");
+    GUID connection_guid = find_module_guid(*server(), "Connection");
+    ASSERT_FALSE(CGuidHelper::guids_are_equal(container_guid, CGuidHelper::null_guid));
+    ASSERT_FALSE(CGuidHelper::guids_are_equal(scaler_guid, CGuidHelper::null_guid));
+    ASSERT_FALSE(CGuidHelper::guids_are_equal(connection_guid, CGuidHelper::null_guid));
+
+    std::srand(1);
+
+    for (int c = 0; c < k::benchmark::routingContainers; c++)
+    {
+        std::ostringstream container_name;
+        container_name << "Container" << c;
+        CPath container_path(container_name.str());
+        ASSERT_EQ(server()->process_command(INewCommand::create(container_guid, container_name.str(), CPath())), CError::SUCCESS);
+
+        for (int s = 0; s < k::benchmark::routingScalersPerContainer; s++)
+        {
+            std::ostringstream scaler_name;
+            scaler_name << "Scaler" << s;
+            ASSERT_EQ(server()->process_command(INewCommand::create(scaler_guid, scaler_name.str(), container_path)), CError::SUCCESS);
+        }
+
+        // connect the upper half of the scalers to the lower half, which have no outgoing connections
+        for (int n = 0; n < k::benchmark::routingConnectionsPerContainer; n++)
+        {
+            std::ostringstream connection_name, source, target;
+            connection_name << "Connection" << n;
+            source << "Scaler" << n << ".outValue";
+            target << "Scaler" << (k::benchmark::routingScalersPerContainer / 2 + n) << ".inValue";
+
+            ASSERT_EQ(server()->process_command(INewCommand::create(connection_guid, connection_name.str(), container_path)), CError::SUCCESS);
+            std::string connection_path = container_name.str() + "." + connection_name.str();
+            ASSERT_EQ(server()->process_command(ISetCommand::create(connection_path + ".sourcePath", CStringValue(source.str()))), CError::SUCCESS);
+            ASSERT_EQ(server()->process_command(ISetCommand::create(connection_path + ".targetPath", CStringValue(target.str()))), CError::SUCCESS);
+        }
+    }
+
+    for (int n = 0; n < k::benchmark::routingTopLevelConnections; n++)
+    {
+        std::ostringstream connection_name;
+        connection_name << "TopLevelConnection" << n;
+
+        int source_container = n % k::benchmark::routingContainers;
+        int target_container = (n + 1) % k::benchmark::routingContainers;
+        int scaler = k::benchmark::routingConnectionsPerContainer + n / k::benchmark::routingContainers;
+
+        ASSERT_EQ(server()->process_command(INewCommand::create(connection_guid, connection_name.str(), CPath())), CError::SUCCESS);
+        ASSERT_EQ(server()->process_command(ISetCommand::create(connection_name.str() + ".sourcePath", CStringValue(scaler_path(source_container, scaler) + ".outValue"))), CError::SUCCESS);
+        ASSERT_EQ(server()->process_command(ISetCommand::create(connection_name.str() + ".targetPath", CStringValue(scaler_path(target_container, k::benchmark::routingScalersPerContainer / 2 + scaler) + ".inValue"))), CError::SUCCESS);
+    }
+
+    BenchmarkStatistics scan_cost;
+    BenchmarkStatistics set_cost;
+    int connections_found = 0;
+
+    benchmark_clock::time_point start = benchmark_clock::now();
+    for (int i = 0; i < k::benchmark::routingSetCommands; i++)
+    {
+        int container = std::rand() % k::benchmark::routingContainers;
+        int scaler = std::rand() % (k::benchmark::routingScalersPerContainer / 2);
+        std::string path = scaler_path(container, scaler);
+
+        // the previous search, for each endpoint that the set changes
+        benchmark_clock::time_point scan_start = benchmark_clock::now();
+        const INode *scaler_node = server()->find_node(path);
+        connections_found += count_connections_by_scan(*server(), connection_guid, *scaler_node, *scaler_node->get_node_endpoint("inValue"));
+        connections_found += count_connections_by_scan(*server(), connection_guid, *scaler_node, *scaler_node->get_node_endpoint("outValue"));
+        scan_cost.add(microseconds_between(scan_start, benchmark_clock::now()));
+
+        benchmark_clock::time_point set_start = benchmark_clock::now();
+        ASSERT_EQ(server()->process_command(ISetCommand::create(path + ".inValue", CFloatValue(float(i % 100) * 0.01f))), CError::SUCCESS);
+        set_cost.add(microseconds_between(set_start, benchmark_clock::now()));
+    }
+
+    double elapsed_seconds = microseconds_between(start, benchmark_clock::now()) / 1000000.0;
+
+    scan_cost.report("connection search by tree scan (before), per routed set", "us");
+    set_cost.report("whole routed set command with routing table (after)", "us");
+    std::cout << "[ BENCHMARK] achieved " << k::benchmark::routingSetCommands / elapsed_seconds << " routed set commands per second, including the scans" << std::endl;
+
+    ASSERT_GT(connections_found, 0);
+}
+
+
+#pragma mark - Script triggers
+
+/*
+ Triggers a Script which reads and writes a few Scaler endpoints, alongside
+ k::benchmark::scriptSiblingScalers other Scalers.  The cold case changes the script text
+ before every trigger, so the lua state is recreated and the script recompiled each time, as
+ used to happen on every trigger.  The warm case reuses the Script's cached state.
+ */
+
+namespace
+{
+    void run_script_benchmark(IServer &server, const std::string &name, bool change_script_each_trigger)
+    {
+        BenchmarkStatistics trigger_cost;
+        const std::string script = "Scaler0.inValue = Scaler1.outValue + mtof(Scaler2.inValue) * 0.001";
+
+        for (int i = 0; i < k::benchmark::scriptTriggers; i++)
+        {
+            std::string script_text = script;
+            if (change_script_each_trigger && i % 2) script_text += " ";
+
+            ASSERT_EQ(server.process_command(ISetCommand::create(CPath("Script1.text"), CStringValue(script_text))), CError::SUCCESS);
+
+            benchmark_clock::time_point start = benchmark_clock::now();
+            ASSERT_EQ(server.process_command(ISetCommand::create(CPath("Script1.trigger"))), CError::SUCCESS);
+            trigger_cost.add(microseconds_between(start, benchmark_clock::now()));
+        }
+
+        trigger_cost.report(name + " per-trigger latency", "us");
+
+        const std::string &info = *server.get_value(CPath("Script1.info"));
+        ASSERT_EQ(info.find("error"), std::string::npos);
+    }
+}
+
+TEST_F(BenchmarkServerTest, ScriptTriggerLatency)
+{
+    GUID scaler_guid = find_module_guid(*server(), "Scaler");
+    GUID script_guid = find_module_guid(*server(), "Script");
+
+    for (int s = 0; s < k::benchmark::scriptSiblingScalers; s++)
+    {
+        std::ostringstream scaler_name;
+        scaler_name << "Scaler" << s;
+        ASSERT_EQ(server()->process_command(INewCommand::create(scaler_guid, scaler_name.str(), CPath())), CError::SUCCESS);
+    }
+
+    ASSERT_EQ(server()->process_command(INewCommand::create(script_guid, "Script1", CPath())), CError::SUCCESS);
+
+    run_script_benchmark(*server(), "script state rebuilt each trigger (before)", true);
+    run_script_benchmark(*server(), "cached script state (after)", false);
+}
+
+
+#pragma mark - Server startup
+
+/*
+ Starts and ends a session k::benchmark::startupRepetitions times, reporting the
+ overall startup time and the module manager's per-phase load timings.  Phase times
+ are summed across the module loading worker threads.
+ */
+
+TEST(StartupBenchmark, ParallelModuleLoading)
+{
+    CServerStartupInfo sinfo;
+    sinfo.system_module_directory       = k::benchmark::moduleDirectory;
+    sinfo.third_party_module_directory  = k::benchmark::thirdPartyModuleDirectory;
+    CTrace::set_categories_to_trace(false, false, false);
+
+    BenchmarkStatistics startup, module_loading, unzip, parse, extraction, checksum;
+    int modules = 0;
+    int threads = 0;
+
+    for (int i = 0; i < k::benchmark::startupRepetitions; i++)
+    {
+        CIntegraSession session;
+
+        benchmark_clock::time_point start = benchmark_clock::now();
+        ASSERT_EQ(session.start_session(sinfo), CError::SUCCESS);
+        startup.add(microseconds_between(start, benchmark_clock::now()) / 1000);
+
+        {
+            CServerLock server = session.get_server();
+            const CModuleManager &module_manager = CModuleManager::downcast(server->get_module_manager());
+            const CModuleLoadTimings &timings = module_manager.get_load_timings();
+
+            module_loading.add(timings.total_seconds * 1000);
+            unzip.add(timings.unzip_seconds * 1000);
+            parse.add(timings.parse_seconds * 1000);
+            extraction.add(timings.extraction_seconds * 1000);
+            checksum.add(timings.checksum_seconds * 1000);
+
+            if (i > 0)
+            {
+                ASSERT_EQ(timings.number_of_modules, modules);
+            }
+            modules = timings.number_of_modules;
+            threads = timings.number_of_threads;
+
+            ASSERT_EQ(module_manager.get_all_module_ids().size(), (std::size_t) modules);
+        }
+
+        ASSERT_EQ(session.end_session(), CError::SUCCESS);
+    }
+
+    ASSERT_GT(modules, 0);
+
+    std::cout << "[ BENCHMARK] loaded " << modules << " modules using " << threads << " threads" << std::endl;
+    startup.report("session startup", "ms");
+    module_loading.report("module loading", "ms");
+    unzip.report("unzip (summed over threads)", "ms");
+    parse.report("iid parse (summed over threads)", "ms");
+    extraction.report("implementation extraction (summed over threads)", "ms");
+    checksum.report("checksum (summed over threads)", "ms");
+}
+
+
+/*
+ Compares a cold start, which populates a fresh module cache, against warm starts which
+ restore every module from it.  Both must produce the same modules with the same
+ implementation checksums.
+ */
+
+namespace
+{
+    typedef std::map<std::string, unsigned int> module_checksums;
+
+    void start_with_module_cache(BenchmarkStatistics &startup, module_checksums &checksums, int &cache_hits)
+    {
+        CServerStartupInfo sinfo;
+        sinfo.system_module_directory       = k::benchmark::moduleDirectory;
+        sinfo.third_party_module_directory  = k::benchmark::thirdPartyModuleDirectory;
+        sinfo.module_cache_directory        = k::benchmark::moduleCacheDirectory;
+
+        CIntegraSession session;
+
+        benchmark_clock::time_point start = benchmark_clock::now();
+        ASSERT_EQ(session.start_session(sinfo), CError::SUCCESS);
+        startup.add(microseconds_between(start, benchmark_clock::now()) / 1000);
+
+        {
+            CServerLock server = session.get_server();
+            const CModuleManager &module_manager = CModuleManager::downcast(server->get_module_manager());
+
+            checksums.clear();
+            const guid_set &module_ids = module_manager.get_all_module_ids();
+            for (guid_set::const_iterator i = module_ids.begin(); i != module_ids.end(); i++)
+            {
+                const IImplementationInfo *implementation = module_manager.get_interface_by_module_id(*i)->get_implementation_info();
+                checksums[CGuidHelper::guid_to_string(*i)] = implementation ? implementation->get_checksum() : 0;
+            }
+
+            cache_hits = module_manager.get_load_timings().number_of_cache_hits;
+        }
+
+        ASSERT_EQ(session.end_session(), CError::SUCCESS);
+    }
+}
+
+TEST(StartupBenchmark, ModuleCache)
+{
+    CTrace::set_categories_to_trace(false, false, false);
+
+    if (CFileHelper::is_directory(k::benchmark::moduleCacheDirectory))
+    {
+        CFileHelper::delete_directory(k::benchmark::moduleCacheDirectory);
+    }
+
+    BenchmarkStatistics cold_startup, warm_startup;
+    module_checksums cold_checksums, warm_checksums;
+    int cache_hits = 0;
+
+    start_with_module_cache(cold_startup, cold_checksums, cache_hits);
+    ASSERT_FALSE(cold_checksums.empty());
+    ASSERT_EQ(cache_hits, 0);
+
+    for (int i = 0; i < k::benchmark::startupRepetitions; i++)
+    {
+        start_with_module_cache(warm_startup, warm_checksums, cache_hits);
+        ASSERT_EQ(warm_checksums, cold_checksums);
+        ASSERT_EQ(cache_hits, (int) cold_checksums.size());
+    }
+
+    CFileHelper::delete_directory(k::benchmark::moduleCacheDirectory);
+
+    cold_startup.report("session startup populating module cache (before)", "ms");
+    warm_startup.report("session startup from module cache (after)", "ms");
+}
+
+
+/*
+ Compares startup with every module implementation extracted to the scratch directory against
+ startup with implementations served from memory.  Both must produce the same implementation
+ checksums, and a module created from memory must run.
+ */
+
+namespace
+{
+    void start_with_implementation_extraction(bool extract, BenchmarkStatistics &startup, module_checksums &checksums)
+    {
+        CServerStartupInfo sinfo;
+        sinfo.system_module_directory           = k::benchmark::moduleDirectory;
+        sinfo.third_party_module_directory      = k::benchmark::thirdPartyModuleDirectory;
+        sinfo.extract_module_implementations    = extract;
+
+        CIntegraSession session;
+
+        benchmark_clock::time_point start = benchmark_clock::now();
+        ASSERT_EQ(session.start_session(sinfo), CError::SUCCESS);
+        startup.add(microseconds_between(start, benchmark_clock::now()) / 1000);
+
+        {
+            CServerLock server = session.get_server();
+            const CModuleManager &module_manager = CModuleManager::downcast(server->get_module_manager());
+
+            checksums.clear();
+            const guid_set &module_ids = module_manager.get_all_module_ids();
+            for (guid_set::const_iterator i = module_ids.begin(); i != module_ids.end(); i++)
+            {
+                const IImplementationInfo *implementation = module_manager.get_interface_by_module_id(*i)->get_implementation_info();
+                checksums[CGuidHelper::guid_to_string(*i)] = implementation ? implementation->get_checksum() : 0;
+            }
+
+            GUID tap_delay_id;
+            CGuidHelper::string_to_guid(k::benchmark::tapDelayGUID, tap_delay_id);
+            ASSERT_EQ(server->process_command(INewCommand::create(tap_delay_id, k::benchmark::tapDelayName, CPath())), CError::SUCCESS);
+            ASSERT_EQ(server->process_command(ISetCommand::create(k::benchmark::tapDelayEndpoint, CFloatValue(0.5f))), CError::SUCCESS);
+        }
+
+        ASSERT_EQ(session.end_session(), CError::SUCCESS);
+    }
+}
+
+TEST(StartupBenchmark, ImplementationsInMemory)
+{
+    CTrace::set_categories_to_trace(false, false, false);
+
+    BenchmarkStatistics extracted_startup, in_memory_startup;
+    module_checksums extracted_checksums, in_memory_checksums;
+
+    for (int i = 0; i < k::benchmark::startupRepetitions; i++)
+    {
+        start_with_implementation_extraction(true, extracted_startup, extracted_checksums);
+        start_with_implementation_extraction(false, in_memory_startup, in_memory_checksums);
+
+        ASSERT_FALSE(extracted_checksums.empty());
+        ASSERT_EQ(in_memory_checksums, extracted_checksums);
+    }
+
+    extracted_startup.report("session startup extracting implementations (before)", "ms");
+    in_memory_startup.report("session startup with implementations in memory (after)", "ms");
+}
+
+
+#pragma mark - Collection loading
+
+/*
+ Loads a corpus of generated collections, each with k::benchmark::collectionContainers containers
+ of k::benchmark::collectionObjectsPerContainer objects.  The 'before' case mirrors the old load path:
+ compile the schema, build a DOM just to validate it, then parse the buffer again with a text reader.
+ The 'after' case validates with the shared compiled schema during the single reader pass.
+ */
+
+namespace
+{
+    std::string generate_collection(int seed)
+    {
+        std::ostringstream xml;
+        xml << "<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>\n";
+        xml << "<IntegraCollection xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-node\" integraVersion=\"1.7.11.3322\">\n";
+        xml << " <object moduleId=\"86c25f15-345a-f9ca-f6b8-a2430e2c0bd5\" originId=\"892b7437-a3dc-4a1f-863d-17b4ba973ef1\" name=\"Project" << seed << "\">\n";
+        xml << "  <attribute name=\"active\" typeCode=\"1\">1</attribute>\n";
+
+        for (int c = 0; c < k::benchmark::collectionContainers; c++)
+        {
+            xml << "  <object moduleId=\"86c25f15-345a-f9ca-f6b8-a2430e2c0bd5\" originId=\"892b7437-a3dc-4a1f-863d-17b4ba973ef1\" name=\"Container" << c << "\">\n";
+            xml << "   <attribute name=\"active\" typeCode=\"1\">1</attribute>\n";
+
+            for (int o = 0; o < k::benchmark::collectionObjectsPerContainer; o++)
+            {
+                xml << "   <object moduleId=\"2b1c6a51-6a2b-4be1-8bb5-3a2bd8bdbd11\" originId=\"4a8a2c83-7b1c-4b0d-8f4e-bc6e0f4d1c9e\" name=\"Scaler" << o << "\">\n";
+                xml << "    <attribute name=\"active\" typeCode=\"1\">1</attribute>\n";
+                xml << "    <attribute name=\"inRangeMin\" typeCode=\"2\">" << (o * 0.5) << "</attribute>\n";
+                xml << "    <attribute name=\"inRangeMax\" typeCode=\"2\">" << (o + seed) << "</attribute>\n";
+                xml << "    <attribute name=\"outRangeMin\" typeCode=\"2\">0.</attribute>\n";
+                xml << "    <attribute name=\"outRangeMax\" typeCode=\"2\">1.</attribute>\n";
+                xml << "    <attribute name=\"info\" typeCode=\"3\">Generated scaler " << c << "." << o << "</attribute>\n";
+                xml << "   </object>\n";
+            }
+
+            xml << "  </object>\n";
+        }
+
+        xml << " </object>\n";
+        xml << "</IntegraCollection>\n";
+        return xml.str();
+    }
+
+    /* walks the reader the way CFileIO::load_nodes does, returning the number of objects or -1 on error */
+    int read_collection(xmlTextReaderPtr reader, bool check_validity)
+    {
+        int objects = 0;
+        int rv;
+        while ((rv = xmlTextReaderRead(reader)) == 1)
+        {
+            if (check_validity && !CValidator::is_valid(reader)) return -1;
+            if (xmlTextReaderNodeType(reader) != XML_READER_TYPE_ELEMENT) continue;
+
+            std::string element((const char *) xmlTextReaderConstName(reader));
+            if (element == "object")
+            {
+                xmlChar *name = xmlTextReaderGetAttribute(reader, BAD_CAST "name");
+                xmlFree(name);
+                objects++;
+            }
+            else if (element == "attribute")
+            {
+                xmlChar *content = xmlNodeGetContent(xmlTextReaderExpand(reader));
+                xmlChar *name = xmlTextReaderGetAttribute(reader, BAD_CAST "name");
+                xmlChar *type_code = xmlTextReaderGetAttribute(reader, BAD_CAST "typeCode");
+                xmlFree(content);
+                xmlFree(name);
+                xmlFree(type_code);
+            }
+        }
+
+        if (rv < 0 || (check_validity && !CValidator::is_valid(reader))) return -1;
+        return objects;
+    }
+
+    int load_with_dom_validation(const std::string &collection)
+    {
+        xmlSchemaParserCtxtPtr parser_context = xmlSchemaNewParserCtxt(k::benchmark::collectionSchemaFile.c_str());
+        xmlSchemaPtr schema = xmlSchemaParse(parser_context);
+        xmlSchemaValidCtxtPtr validity_context = xmlSchemaNewValidCtxt(schema);
+
+        xmlDocPtr doc = xmlParseMemory(collection.c_str(), collection.length());
+        int validation_code = xmlSchemaValidateDoc(validity_context, doc);
+        xmlFreeDoc(doc);
+
+        xmlSchemaFreeValidCtxt(validity_context);
+        xmlSchemaFree(schema);
+        xmlSchemaFreeParserCtxt(parser_context);
+
+        if (validation_code != 0) return -1;
+
+        xmlTextReaderPtr reader = xmlReaderForMemory(collection.c_str(), collection.length(), NULL, NULL, 0);
+        int objects = read_collection(reader, false);
+        xmlFreeTextReader(reader);
+        return objects;
+    }
+
+    int load_with_streaming_validation(const std::string &collection)
+    {
+        xmlTextReaderPtr reader = xmlReaderForMemory(collection.c_str(), collection.length(), NULL, NULL, 0);
+        if (CValidator::get_shared_validator().validate_while_reading(reader) != CError::SUCCESS)
+        {
+            xmlFreeTextReader(reader);
+            return -1;
+        }
+
+        int objects = read_collection(reader, true);
+        xmlFreeTextReader(reader);
+        return objects;
+    }
+
+    void run_collection_load_benchmark(const std::string &name, int (*load)(const std::string &))
+    {
+        std::vector<std::string> corpus;
+        for (int i = 0; i < k::benchmark::collectionCorpusSize; i++)
+        {
+            corpus.push_back(generate_collection(i));
+        }
+
+        const int expected_objects = 1 + k::benchmark::collectionContainers * (1 + k::benchmark::collectionObjectsPerContainer);
+
+        BenchmarkStatistics load_time;
+        for (int r = 0; r < k::benchmark::collectionLoadRepetitions; r++)
+        {
+            for (const std::string &collection : corpus)
+            {
+                benchmark_clock::time_point start = benchmark_clock::now();
+                int objects = load(collection);
+                load_time.add(microseconds_between(start, benchmark_clock::now()) / 1000);
+
+                ASSERT_EQ(objects, expected_objects);
+            }
+        }
+
+        std::cout << "[ BENCHMARK] collection size " << corpus.front().length() / 1024 << "KB" << std::endl;
+        load_time.report(name + " per-collection load time", "ms");
+    }
+}
+
+TEST(CollectionLoadBenchmark, DomValidationThenReaderPass)
+{
+    xmlInitParser();
+    run_collection_load_benchmark("per-load schema and dom validation (before)", load_with_dom_validation);
+}
+
+TEST(CollectionLoadBenchmark, StreamingValidationInReaderPass)
+{
+    CTrace::set_categories_to_trace(false, false, false);
+    run_collection_load_benchmark("shared schema, streaming validation (after)", load_with_streaming_validation);
+
+    std::string invalid = generate_collection(0);
+    invalid.replace(invalid.rfind("<attribute "), 0, "<unexpected/>");
+    ASSERT_EQ(load_with_streaming_validation(invalid), -1);
+}
+
+
+#pragma mark - Command batches
+
+/*
+ Sets k::benchmark::batchSetCommands values spread across k::benchmark::batchTargetNodes
+ TapDelays, first as individual set commands (each taking the server lock, sending its own dsp
+ message and notification), then as a single ICommandBatch applied under one lock, with
+ validation up front, coalesced dsp messages and one notification per endpoint.
+ */
+
+namespace
+{
+    std::string tap_delay_endpoint(int node)
+    {
+        std::ostringstream path;
+        path << "TapDelay" << node << ".delayTime";
+        return path.str();
+    }
+
+    float batch_value(int command, int round)
+    {
+        return float((command + round) % 1000) * 0.001f;
+    }
+
+    void create_tap_delays(IServer &server)
+    {
+        GUID guid;
+        CGuidHelper::string_to_guid(k::benchmark::tapDelayGUID, guid);
+
+        for (int i = 0; i < k::benchmark::batchTargetNodes; i++)
+        {
+            std::ostringstream name;
+            name << "TapDelay" << i;
+            CError err = server.process_command(INewCommand::create(guid, name.str(), CPath()));
+            assert(err == CError::SUCCESS);
+        }
+    }
+
+    void assert_final_values(IServer &server, int round)
+    {
+        for (int i = k::benchmark::batchSetCommands - k::benchmark::batchTargetNodes; i < k::benchmark::batchSetCommands; i++)
+        {
+            const CValue *value = server.get_value(tap_delay_endpoint(i % k::benchmark::batchTargetNodes));
+            ASSERT_TRUE(value != NULL);
+            ASSERT_FLOAT_EQ(float(*value), batch_value(i, round));
+        }
+    }
+}
+
+TEST_F(BenchmarkServerTest, IndividualSetCommands)
+{
+    create_tap_delays(*server());
+
+    benchmark_clock::time_point start = benchmark_clock::now();
+    for (int i = 0; i < k::benchmark::batchSetCommands; i++)
+    {
+        CError err = server()->process_command(ISetCommand::create(tap_delay_endpoint(i % k::benchmark::batchTargetNodes), CFloatValue(batch_value(i, 0))));
+        ASSERT_EQ(err, CError::SUCCESS);
+    }
+    double elapsed = microseconds_between(start, benchmark_clock::now());
+
+    std::cout << "[ BENCHMARK] " << k::benchmark::batchSetCommands << " individual set commands (before): " << elapsed / 1000 << "ms" << std::endl;
+
+    assert_final_values(*server(), 0);
+}
+
+TEST_F(BenchmarkServerTest, BatchedSetCommands)
+{
+    create_tap_delays(*server());
+
+    benchmark_clock::time_point start = benchmark_clock::now();
+
+    ICommandBatch *batch = ICommandBatch::create();
+    for (int i = 0; i < k::benchmark::batchSetCommands; i++)
+    {
+        batch->add_command(ISetCommand::create(tap_delay_endpoint(i % k::benchmark::batchTargetNodes), CFloatValue(batch_value(i, 1))));
+    }
+    ASSERT_EQ(batch->get_number_of_commands(), k::benchmark::batchSetCommands);
+
+    CError err = server()->process_command(batch);
+    double elapsed = microseconds_between(start, benchmark_clock::now());
+    ASSERT_EQ(err, CError::SUCCESS);
+
+    std::cout << "[ BENCHMARK] " << k::benchmark::batchSetCommands << " set commands in one batch (after): " << elapsed / 1000 << "ms" << std::endl;
+
+    assert_final_values(*server(), 1);
+
+    /* a batch with one bad command is rejected before anything is applied */
+    batch = ICommandBatch::create();
+    batch->add_command(ISetCommand::create(tap_delay_endpoint(0), CFloatValue(0.5f)));
+    batch->add_command(ISetCommand::create(tap_delay_endpoint(1), CStringValue("not a float")));
+    ASSERT_EQ(server()->process_command(batch), CError::TYPE_ERROR);
+
+    assert_final_values(*server(), 1);
+}
+
+
+#pragma mark - Endpoint handles
+
+/*
+ Builds a chain of nested Containers k::benchmark::lookupMaximumDepth deep, with a Scaler at each
+ depth, then compares the cost of resolving the Scaler's inValue by path (which hashes the whole
+ dotted path) and by handle (an index and generation check), and of set commands addressed each way.
+ */
+
+namespace
+{
+    CPath nested_container_path(int depth)
+    {
+        CPath path;
+        for (int i = 0; i < depth; i++)
+        {
+            std::ostringstream name;
+            name << "Container" << i;
+            path.append_element(name.str());
+        }
+        return path;
+    }
+
+    CPath nested_scaler_endpoint_path(int depth)
+    {
+        CPath path = nested_container_path(depth);
+        path.append_element("Scaler");
+        path.append_element("inValue");
+        return path;
+    }
+}
+
+TEST_F(BenchmarkServerTest, EndpointLookupByPathDepth)
+{
+    GUID container_guid = find_module_guid(*server(), "Container");
+    GUID scaler_guid = find_module_guid(*server(), "Scaler");
+    ASSERT_FALSE(CGuidHelper::guids_are_equal(container_guid, CGuidHelper::null_guid));
+    ASSERT_FALSE(CGuidHelper::guids_are_equal(scaler_guid, CGuidHelper::null_guid));
+
+    for (int depth = 0; depth < k::benchmark::lookupMaximumDepth; depth++)
+    {
+        CPath parent = nested_container_path(depth);
+        ASSERT_EQ(server()->process_command(INewCommand::create(scaler_guid, "Scaler", parent)), CError::SUCCESS);
+
+        std::ostringstream container_name;
+        container_name << "Container" << depth;
+        ASSERT_EQ(server()->process_command(INewCommand::create(container_guid, container_name.str(), parent)), CError::SUCCESS);
+    }
+
+    CServerLock locked_server = server();
+
+    for (int depth = 0; depth < k::benchmark::lookupMaximumDepth; depth++)
+    {
+        CPath endpoint_path = nested_scaler_endpoint_path(depth);
+        const INodeEndpoint *endpoint = locked_server->find_node_endpoint(endpoint_path);
+        ASSERT_TRUE(endpoint != NULL);
+        CEndpointHandle handle = endpoint->get_handle();
+        ASSERT_FALSE(handle.is_null());
+
+        int found = 0;
+        benchmark_clock::time_point start = benchmark_clock::now();
+        for (int i = 0; i < k::benchmark::lookupsPerDepth; i++)
+        {
+            if (locked_server->get_value(endpoint_path)) found++;
+        }
+        double path_nanoseconds = microseconds_between(start, benchmark_clock::now()) * 1000 / k::benchmark::lookupsPerDepth;
+
+        start = benchmark_clock::now();
+        for (int i = 0; i < k::benchmark::lookupsPerDepth; i++)
+        {
+            if (locked_server->get_value(handle)) found++;
+        }
+        double handle_nanoseconds = microseconds_between(start, benchmark_clock::now()) * 1000 / k::benchmark::lookupsPerDepth;
+
+        ASSERT_EQ(found, k::benchmark::lookupsPerDepth * 2);
+
+        std::cout << "[ BENCHMARK] depth " << depth + 1 << " (" << endpoint_path.get_string().length() << " chars): by path " << path_nanoseconds << "ns, by handle " << handle_nanoseconds << "ns" << std::endl;
+    }
+}
+
+TEST_F(BenchmarkServerTest, SetCommandsByPathAndByHandle)
+{
+    GUID container_guid = find_module_guid(*server(), "Container");
+    GUID scaler_guid = find_module_guid(*server(), "Scaler");
+
+    CPath parent = nested_container_path(0);
+    for (int depth = 0; depth < k::benchmark::lookupMaximumDepth; depth++)
+    {
+        std::ostringstream container_name;
+        container_name << "Container" << depth;
+        ASSERT_EQ(server()->process_command(INewCommand::create(container_guid, container_name.str(), parent)), CError::SUCCESS);
+        parent.append_element(container_name.str());
+    }
+    ASSERT_EQ(server()->process_command(INewCommand::create(scaler_guid, "Scaler", parent)), CError::SUCCESS);
+
+    CServerLock locked_server = server();
+
+    CPath endpoint_path = nested_scaler_endpoint_path(k::benchmark::lookupMaximumDepth);
+    CEndpointHandle handle = locked_server->find_node_endpoint(endpoint_path)->get_handle();
+
+    benchmark_clock::time_point start = benchmark_clock::now();
+    for (int i = 0; i < k::benchmark::handleSetCommands; i++)
+    {
+        ASSERT_EQ(locked_server->process_command(ISetCommand::create(endpoint_path, CFloatValue(float(i % 100) * 0.01f))), CError::SUCCESS);
+    }
+    double path_microseconds = microseconds_between(start, benchmark_clock::now()) / k::benchmark::handleSetCommands;
+
+    start = benchmark_clock::now();
+    for (int i = 0; i < k::benchmark::handleSetCommands; i++)
+    {
+        ASSERT_EQ(locked_server->process_command(ISetCommand::create(handle, CFloatValue(float(i % 100) * 0.01f))), CError::SUCCESS);
+    }
+    double handle_microseconds = microseconds_between(start, benchmark_clock::now()) / k::benchmark::handleSetCommands;
+
+    std::cout << "[ BENCHMARK] set command at depth " << k::benchmark::lookupMaximumDepth + 1 << ": by path " << path_microseconds << "us, by handle " << handle_microseconds << "us" << std::endl;
+
+    /* handles survive renames and moves, and go stale when the node is deleted */
+    ASSERT_EQ(locked_server->process_command(IRenameCommand::create(CPath("Container0"), "Renamed")), CError::SUCCESS);
+    ASSERT_EQ(locked_server->process_command(IMoveCommand::create(CPath("Renamed.Container1"), CPath())), CError::SUCCESS);
+    ASSERT_TRUE(locked_server->find_node_endpoint(handle) != NULL);
+    ASSERT_EQ(locked_server->process_command(ISetCommand::create(handle, CFloatValue(0.5f))), CError::SUCCESS);
+    ASSERT_FLOAT_EQ(float(*locked_server->get_value(handle)), 0.5f);
+
+    ASSERT_EQ(locked_server->process_command(IDeleteCommand::create(CPath("Container1"))), CError::SUCCESS);
+    ASSERT_TRUE(locked_server->get_value(handle) == NULL);
+    ASSERT_EQ(locked_server->process_command(ISetCommand::create(handle, CFloatValue(0.5f))), CError::PATH_ERROR);
+}
+
+
+#pragma mark - DSP message dispatch
+
+/*
+ Measures the dsp-thread cost of each send_value as the number of module instances grows.
+
+ Values are queued with set commands, then a block is processed on the test thread (process_buffer
+ only try-locks libpd, so this is safe alongside a running audio driver).  The cost per send is the
+ difference between blocks with and without queued values, divided by the number of values.  When
+ every module listened on the shared broadcast receiver and filtered by id, this grew linearly with
+ the number of modules; with a receiver per module instance it should stay flat.
+ */
+
+TEST_F(BenchmarkServerTest, DspDispatchCostByModuleCount)
+{
+    GUID guid;
+    CGuidHelper::string_to_guid(k::benchmark::tapDelayGUID, guid);
+
+    std::vector<float> input(CDspEngine::samples_per_buffer * 2, 0);
+    std::vector<float> output(CDspEngine::samples_per_buffer * 2, 0);
+
+    int modules = 0;
+    for (int module_count : k::benchmark::dispatchModuleCounts)
+    {
+        for (; modules < module_count; modules++)
+        {
+            std::ostringstream name;
+            name << "TapDelay" << modules;
+            ASSERT_EQ(server()->process_command(INewCommand::create(guid, name.str(), CPath())), CError::SUCCESS);
+        }
+
+        CServerLock locked_server = server();
+        CServer &internal_server = dynamic_cast<CServer &>(*locked_server);
+        CDspEngine &dsp_engine = internal_server.get_dsp_engine();
+
+        /* make sure every module has been instantiated before timing */
+        internal_server.ping_all_dsp_modules();
+
+        BenchmarkStatistics idle_block;
+        BenchmarkStatistics busy_block;
+        double idle_total = 0;
+        double busy_total = 0;
+
+        for (int block = 0; block < k::benchmark::dispatchBlocks; block++)
+        {
+            benchmark_clock::time_point start = benchmark_clock::now();
+            dsp_engine.process_buffer(&input[0], &output[0], 2, 2, k::benchmark::sampleRate);
+            double idle = microseconds_between(start, benchmark_clock::now());
+            idle_block.add(idle);
+            idle_total += idle;
+
+            for (int i = 0; i < k::benchmark::dispatchSendsPerBlock; i++)
+            {
+                std::ostringstream path;
+                path << "TapDelay" << (i % modules) << ".delayTime";
+                ASSERT_EQ(locked_server->process_command(ISetCommand::create(CPath(path.str()), CFloatValue(float(i % 100) * 0.01f))), CError::SUCCESS);
+            }
+
+            start = benchmark_clock::now();
+            dsp_engine.process_buffer(&input[0], &output[0], 2, 2, k::benchmark::sampleRate);
+            double busy = microseconds_between(start, benchmark_clock::now());
+            busy_block.add(busy);
+            busy_total += busy;
+        }
+
+        std::ostringstream name;
+        name << module_count << " modules";
+        idle_block.report(name.str() + ", block with no queued values", "us");
+        busy_block.report(name.str() + ", block with " + std::to_string(k::benchmark::dispatchSendsPerBlock) + " queued values", "us");
+
+        double nanoseconds_per_send = (busy_total - idle_total) * 1000 / (k::benchmark::dispatchBlocks * k::benchmark::dispatchSendsPerBlock);
+        std::cout << "[ BENCHMARK] " << name.str() << ": dsp thread cost per send_value " << nanoseconds_per_send << "ns" << std::endl;
+    }
+}
+
+
+#pragma mark - Envelope control points
+
+/*
+ Envelopes with k::benchmark::envelopeControlPoints control points, looked up during forward
+ playback and at random positions.  The scan reproduces the old per-tick search over every control
+ point (without the endpoint lookups it also did for each one); CControlPointIndex keeps the control
+ points sorted and remembers where the previous lookup landed.
+ */
+
+namespace
+{
+    struct ScannedControlPoint
+    {
+        int tick;
+        float value;
+        float curvature;
+    };
+
+    float envelope_control_point_value(int index)
+    {
+        return float(index % 17) * 0.25f;
+    }
+
+    float envelope_control_point_curvature(int index)
+    {
+        return (index % 3 == 0) ? 1.5f : 0;
+    }
+
+    bool scan_control_points(const std::vector<ScannedControlPoint> &control_points, int tick, float &output)
+    {
+        bool found_previous = false, found_next = false;
+        const ScannedControlPoint *previous = NULL, *next = NULL;
+
+        for (const ScannedControlPoint &control_point : control_points)
+        {
+            if (control_point.tick <= tick && (!found_previous || control_point.tick > previous->tick))
+            {
+                previous = &control_point;
+                found_previous = true;
+            }
+            if (control_point.tick > tick && (!found_next || control_point.tick < next->tick))
+            {
+                next = &control_point;
+                found_next = true;
+            }
+        }
+
+        if (!found_previous && !found_next) return false;
+        if (!found_previous) { output = next->value; return true; }
+        if (!found_next) { output = previous->value; return true; }
+
+        float interpolation = float(tick - previous->tick) / (next->tick - previous->tick);
+        if (previous->curvature != 0)
+        {
+            interpolation = pow(interpolation, pow(2, -previous->curvature));
+        }
+        output = previous->value + interpolation * (next->value - previous->value);
+        return true;
+    }
+}
+
+TEST(EnvelopeBenchmark, ControlPointScanVersusIndex)
+{
+    std::vector<ScannedControlPoint> scanned;
+    CControlPointIndex index;
+
+    /* insert in shuffled order, as control points arrive from a loaded file */
+    std::vector<int> order(k::benchmark::envelopeControlPoints);
+    for (int i = 0; i < k::benchmark::envelopeControlPoints; i++) order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(1));
+
+    benchmark_clock::time_point start = benchmark_clock::now();
+    for (int i : order)
+    {
+        int tick = i * k::benchmark::envelopeTicksPerControlPoint;
+        index.set(i + 1, tick, envelope_control_point_value(i), envelope_control_point_curvature(i));
+        scanned.push_back({ tick, envelope_control_point_value(i), envelope_control_point_curvature(i) });
+    }
+    double insert_microseconds = microseconds_between(start, benchmark_clock::now());
+    ASSERT_EQ(index.get_number_of_control_points(), k::benchmark::envelopeControlPoints);
+
+    std::cout << "[ BENCHMARK] " << k::benchmark::envelopeControlPoints << " control points added to index: " << insert_microseconds / 1000 << "ms" << std::endl;
+
+    const int last_tick = k::benchmark::envelopeControlPoints * k::benchmark::envelopeTicksPerControlPoint;
+
+    std::vector<int> playback_ticks;
+    for (int tick = -k::benchmark::envelopeTicksPerControlPoint; tick <= last_tick; tick += k::benchmark::envelopePlaybackStep)
+    {
+        playback_ticks.push_back(tick);
+    }
+
+    std::vector<int> seek_ticks;
+    std::mt19937 random(2);
+    std::uniform_int_distribution<int> seek_distribution(0, last_tick);
+    for (int i = 0; i < k::benchmark::envelopeSeeks; i++)
+    {
+        seek_ticks.push_back(seek_distribution(random));
+    }
+
+    struct { const char *name; const std::vector<int> &ticks; } passes[] = { { "forward playback", playback_ticks }, { "random seeks", seek_ticks } };
+
+    for (const auto &pass : passes)
+    {
+        std::vector<float> scanned_values(pass.ticks.size());
+        std::vector<float> indexed_values(pass.ticks.size());
+
+        start = benchmark_clock::now();
+        for (std::size_t i = 0; i < pass.ticks.size(); i++)
+        {
+            ASSERT_TRUE(scan_control_points(scanned, pass.ticks[i], scanned_values[i]));
+        }
+        double scan_nanoseconds = microseconds_between(start, benchmark_clock::now()) * 1000 / pass.ticks.size();
+
+        start = benchmark_clock::now();
+        for (std::size_t i = 0; i < pass.ticks.size(); i++)
+        {
+            ASSERT_TRUE(index.get_value(pass.ticks[i], indexed_values[i]));
+        }
+        double index_nanoseconds = microseconds_between(start, benchmark_clock::now()) * 1000 / pass.ticks.size();
+
+        for (std::size_t i = 0; i < pass.ticks.size(); i++)
+        {
+            ASSERT_FLOAT_EQ(indexed_values[i], scanned_values[i]) << "at tick " << pass.ticks[i];
+        }
+
+        std::cout << "[ BENCHMARK] " << pass.name << " over " << k::benchmark::envelopeControlPoints << " control points: scan (before) " << scan_nanoseconds << "ns, index (after) " << index_nanoseconds << "ns per tick" << std::endl;
+    }
+
+    /* moving and removing control points keeps the index consistent */
+    index.set(1, last_tick + 100, 99.0f, 0);
+    index.remove(2);
+    scanned[std::find_if(scanned.begin(), scanned.end(), [](const ScannedControlPoint &p) { return p.tick == 0; }) - scanned.begin()] = { last_tick + 100, 99.0f, 0 };
+    scanned.erase(std::find_if(scanned.begin(), scanned.end(), [&](const ScannedControlPoint &p) { return p.tick == k::benchmark::envelopeTicksPerControlPoint; }));
+
+    for (int tick : { -5, 0, 5, 15, 25, last_tick - 5, last_tick + 50, last_tick + 200 })
+    {
+        float scanned_value = 0, indexed_value = 0;
+        ASSERT_TRUE(scan_control_points(scanned, tick, scanned_value));
+        ASSERT_TRUE(index.get_value(tick, indexed_value));
+        ASSERT_FLOAT_EQ(indexed_value, scanned_value) << "at tick " << tick;
+    }
+}
+
+TEST_F(BenchmarkServerTest, EnvelopePlaybackWithManyControlPoints)
+{
+    GUID envelope_guid = find_module_guid(*server(), "Envelope");
+    GUID control_point_guid = find_module_guid(*server(), "ControlPoint");
+    ASSERT_FALSE(CGuidHelper::guids_are_equal(envelope_guid, CGuidHelper::null_guid));
+    ASSERT_FALSE(CGuidHelper::guids_are_equal(control_point_guid, CGuidHelper::null_guid));
+
+    CServerLock locked_server = server();
+
+    ASSERT_EQ(locked_server->process_command(INewCommand::create(envelope_guid, "Envelope1", CPath())), CError::SUCCESS);
+
+    benchmark_clock::time_point start = benchmark_clock::now();
+    for (int i = 0; i < k::benchmark::envelopeControlPoints; i++)
+    {
+        std::ostringstream name;
+        name << "ControlPoint" << i;
+        CPath control_point_path("Envelope1." + name.str());
+
+        ASSERT_EQ(locked_server->process_command(INewCommand::create(control_point_guid, name.str(), CPath("Envelope1"))), CError::SUCCESS);
+        ASSERT_EQ(locked_server->process_command(ISetCommand::create(CPath(control_point_path.get_string() + ".tick"), CIntegerValue(i * k::benchmark::envelopeTicksPerControlPoint))), CError::SUCCESS);
+        ASSERT_EQ(locked_server->process_command(ISetCommand::create(CPath(control_point_path.get_string() + ".value"), CFloatValue(envelope_control_point_value(i)))), CError::SUCCESS);
+        ASSERT_EQ(locked_server->process_command(ISetCommand::create(CPath(control_point_path.get_string() + ".curvature"), CFloatValue(envelope_control_point_curvature(i)))), CError::SUCCESS);
+    }
+    double build_milliseconds = microseconds_between(start, benchmark_clock::now()) / 1000;
+
+    std::cout << "[ BENCHMARK] built envelope with " << k::benchmark::envelopeControlPoints << " control points: " << build_milliseconds << "ms" << std::endl;
+
+    CEndpointHandle current_tick = locked_server->find_node_endpoint(CPath("Envelope1.currentTick"))->get_handle();
+    CEndpointHandle current_value = locked_server->find_node_endpoint(CPath("Envelope1.currentValue"))->get_handle();
+
+    const int last_tick = k::benchmark::envelopeControlPoints * k::benchmark::envelopeTicksPerControlPoint;
+
+    BenchmarkStatistics tick_statistics;
+    for (int tick = 0; tick <= last_tick; tick += k::benchmark::envelopePlaybackStep)
+    {
+        benchmark_clock::time_point tick_start = benchmark_clock::now();
+        ASSERT_EQ(locked_server->process_command(ISetCommand::create(current_tick, CIntegerValue(tick))), CError::SUCCESS);
+        tick_statistics.add(microseconds_between(tick_start, benchmark_clock::now()));
+    }
+    tick_statistics.report("envelope tick with " + std::to_string(k::benchmark::envelopeControlPoints) + " control points", "us");
+
+    ASSERT_FLOAT_EQ(float(*locked_server->get_value(current_value)), envelope_control_point_value(k::benchmark::envelopeControlPoints - 1));
+}
+
+
+#pragma mark - MIDI input routing
+
+/*
+ Replays a recorded-style stream of k::benchmark::midiMessagesPerSecond control changes, spread over
+ every channel and controller and grouped into the messages which arrive during each audio block,
+ into growing numbers of MidiControlInput modules.
+
+ The scan reproduces the old dispatch, which offered every block's messages to every control and had
+ each one look up its mapping endpoints and decode every message; the routed dispatch only visits
+ controls whose mapping matches.
+ */
+
+namespace
+{
+    struct MidiControlMapping
+    {
+        bool any_device;
+        int channel;
+        int controller;
+    };
+
+    MidiControlMapping midi_control_mapping(int index)
+    {
+        return { index % 2 == 0, index % 16 + 1, (index / 16) % 128 };
+    }
+
+    std::vector<midi_message_list> make_midi_stream()
+    {
+        std::mt19937 random(3);
+        std::uniform_int_distribution<int> channel_distribution(0, 15);
+        std::uniform_int_distribution<int> controller_distribution(0, 127);
+        std::uniform_int_distribution<int> value_distribution(0, 127);
+
+        const int total_messages = k::benchmark::midiMessagesPerSecond * k::benchmark::midiStreamSeconds;
+        const int total_blocks = k::benchmark::sampleRate * k::benchmark::midiStreamSeconds / k::benchmark::samplesPerBuffer;
+
+        std::vector<midi_message_list> blocks(total_blocks);
+        for (int i = 0; i < total_messages; i++)
+        {
+            CMidiMessage message;
+            message.device = k::benchmark::midiDeviceName;
+            message.message = 0xB0 | channel_distribution(random) | (controller_distribution(random) << 8) | (value_distribution(random) << 16);
+
+            blocks[(long long) i * total_blocks / total_messages].push_back(message);
+        }
+
+        return blocks;
+    }
+
+    int scan_midi_controls(const std::vector<const INode *> &controls, const midi_message_list &messages)
+    {
+        int matches = 0;
+
+        for (const INode *control : controls)
+        {
+            if (int(*control->get_node_endpoint("active")->get_value()) == 0) continue;
+
+            const std::string &device = *control->get_node_endpoint("device")->get_value();
+            int channel = *control->get_node_endpoint("channel")->get_value();
+            const std::string &message_type = *control->get_node_endpoint("messageType")->get_value();
+            int controller = *control->get_node_endpoint("noteOrController")->get_value();
+            control->get_node_endpoint("value");
+            if (int(*control->get_node_endpoint("autoLearn")->get_value()) != 0) continue;
+
+            for (const CMidiMessage &message : messages)
+            {
+                unsigned int status = (message.message & 0xF0) >> 4;
+                int message_channel = (message.message & 0xF) + 1;
+                int value1 = (message.message & 0xFF00) >> 8;
+
+                if (status != 0xB || message_type != "cc") continue;
+                if (message.device != device && device != "Any Device") continue;
+                if (message_channel != channel && channel != 0) continue;
+                if (value1 != controller) continue;
+
+                matches++;
+            }
+        }
+
+        return matches;
+    }
+}
+
+TEST_F(BenchmarkServerTest, MidiInputRoutingToMappedControls)
+{
+    GUID midi_control_guid = find_module_guid(*server(), "MidiControlInput");
+    ASSERT_FALSE(CGuidHelper::guids_are_equal(midi_control_guid, CGuidHelper::null_guid));
+
+    std::vector<midi_message_list> stream = make_midi_stream();
+
+    std::vector<const INode *> controls;
+    for (int control_count : k::benchmark::midiMappedControlCounts)
+    {
+        CServerLock locked_server = server();
+        CServer &internal_server = dynamic_cast<CServer &>(*locked_server);
+
+        while (int(controls.size()) < control_count)
+        {
+            int index = controls.size();
+            std::string name = "MidiControlInput" + std::to_string(index);
+            MidiControlMapping mapping = midi_control_mapping(index);
+
+            ASSERT_EQ(locked_server->process_command(INewCommand::create(midi_control_guid, name, CPath())), CError::SUCCESS);
+            ASSERT_EQ(locked_server->process_command(ISetCommand::create(CPath(name + ".device"), CStringValue(mapping.any_device ? "Any Device" : k::benchmark::midiDeviceName))), CError::SUCCESS);
+            ASSERT_EQ(locked_server->process_command(ISetCommand::create(CPath(name + ".channel"), CIntegerValue(mapping.channel))), CError::SUCCESS);
+            ASSERT_EQ(locked_server->process_command(ISetCommand::create(CPath(name + ".noteOrController"), CIntegerValue(mapping.controller))), CError::SUCCESS);
+
+            controls.push_back(locked_server->find_node(CPath(name)));
+        }
+
+        int scanned_matches = 0;
+        benchmark_clock::time_point start = benchmark_clock::now();
+        for (const midi_message_list &block : stream)
+        {
+            scanned_matches += scan_midi_controls(controls, block);
+        }
+        double scan_microseconds = microseconds_between(start, benchmark_clock::now());
+
+        CMidiInputDispatcher &dispatcher = internal_server.get_midi_input_dispatcher();
+
+        BenchmarkStatistics block_statistics;
+        start = benchmark_clock::now();
+        for (const midi_message_list &block : stream)
+        {
+            benchmark_clock::time_point block_start = benchmark_clock::now();
+            dispatcher.route_midi_input(block);
+            block_statistics.add(microseconds_between(block_start, benchmark_clock::now()));
+        }
+        double route_microseconds = microseconds_between(start, benchmark_clock::now());
+
+        std::string name = std::to_string(control_count) + " mapped controls";
+        block_statistics.report(name + ", routed dispatch per block", "us");
+        std::cout << "[ BENCHMARK] " << name << ", " << k::benchmark::midiMessagesPerSecond << " messages per second: offered to every control (before) " << scan_microseconds / 1000 << "ms of matching, routed (after) " << route_microseconds / 1000 << "ms including " << scanned_matches << " value sets" << std::endl;
+
+        /* the last message for the first control's mapping decides its value */
+        MidiControlMapping mapping = midi_control_mapping(0);
+        int expected_value = -1;
+        for (const midi_message_list &block : stream)
+        {
+            for (const CMidiMessage &message : block)
+            {
+                if ((message.message & 0xF) + 1 == (unsigned int) mapping.channel && ((message.message & 0xFF00) >> 8) == (unsigned int) mapping.controller)
+                {
+                    expected_value = (message.message & 0xFF0000) >> 16;
+                }
+            }
+        }
+
+        if (expected_value >= 0)
+        {
+            ASSERT_EQ(int(*locked_server->get_value(CPath("MidiControlInput0.value"))), expected_value);
+        }
+    }
+}
+
+
+#pragma mark - Threaded queue push latency
+
+/*
+ A real-time thread pushes k::benchmark::queuePushesPerBlock items per 64-sample block while a control 
+ thread pushes k::benchmark::queueBackgroundPushesPerSecond more into the same queue, as the audio 
+ thread and midi input share CThreadedQueue.  The cost of each push from the real-time thread is 
+ measured for the previous design (a std::list behind a mutex, with a semaphore post per push and a 
+ new list per delivery) and the bounded lock-free CThreadedQueue.  The thread is given SCHED_FIFO 
+ priority where the system allows it.
+ */
+
+namespace
+{
+    struct QueueBenchmarkItem
+    {
+        int producer;
+        int index;
+    };
+
+    struct QueueBenchmarkSink : public IThreadedQueueOutputSink<QueueBenchmarkItem>
+    {
+        QueueBenchmarkSink() : delivered(0), deliveries(0) {}
+
+        void handle_queue_items(const std::list<QueueBenchmarkItem> &items)
+        {
+            delivered += items.size();
+            deliveries++;
+        }
+
+        std::atomic<int> delivered;
+        std::atomic<int> deliveries;
+    };
+
+    class LockedListQueue
+    {
+    public:
+
+        LockedListQueue(IThreadedQueueOutputSink<QueueBenchmarkItem> &output_sink)
+        :   output_sink(output_sink), content(new std::list<QueueBenchmarkItem>), finished(false)
+        {
+            pthread_mutex_init(&mutex, NULL);
+#ifdef __APPLE__
+            semaphore = dispatch_semaphore_create(0);
+#else
+            sem_init(&semaphore, 0, 0);
+#endif
+            output_thread = std::thread([this]() { run(); });
+        }
+
+        ~LockedListQueue()
+        {
+            finished = true;
+            signal();
+            output_thread.join();
+#ifdef __APPLE__
+            dispatch_release(semaphore);
+#else
+            sem_destroy(&semaphore);
+#endif
+            pthread_mutex_destroy(&mutex);
+            delete content;
+        }
+
+        bool push(const QueueBenchmarkItem &item)
+        {
+            pthread_mutex_lock(&mutex);
+            content->push_back(item);
+            pthread_mutex_unlock(&mutex);
+            signal();
+            return true;
+        }
+
+        unsigned long get_dropped_count() const { return 0; }
+
+    private:
+
+        void signal()
+        {
+#ifdef __APPLE__
+            dispatch_semaphore_signal(semaphore);
+#else
+            sem_post(&semaphore);
+#endif
+        }
+
+        void run()
+        {
+            bool done = false;
+            while (!done)
+            {
+#ifdef __APPLE__
+                dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+#else
+                sem_wait(&semaphore);
+#endif
+
+                pthread_mutex_lock(&mutex);
+                std::list<QueueBenchmarkItem> *content_to_deliver = NULL;
+                if (!content->empty())
+                {
+                    content_to_deliver = content;
+                    content = new std::list<QueueBenchmarkItem>;
+                }
+                done = finished;
+                pthread_mutex_unlock(&mutex);
+
+                if (content_to_deliver)
+                {
+                    output_sink.handle_queue_items(*content_to_deliver);
+                    delete content_to_deliver;
+                }
+            }
+        }
+
+        IThreadedQueueOutputSink<QueueBenchmarkItem> &output_sink;
+        std::list<QueueBenchmarkItem> *content;
+        pthread_mutex_t mutex;
+#ifdef __APPLE__
+        dispatch_semaphore_t semaphore;
+#else
+        sem_t semaphore;
+#endif
+        std::thread output_thread;
+        std::atomic<bool> finished;
+    };
+
+    struct LockFreeQueue
+    {
+        LockFreeQueue(IThreadedQueueOutputSink<QueueBenchmarkItem> &output_sink) : queue(output_sink) {}
+
+        bool push(const QueueBenchmarkItem &item) { return queue.push(item); }
+        unsigned long get_dropped_count() const { return queue.get_dropped_count(); }
+
+        CThreadedQueue<QueueBenchmarkItem> queue;
+    };
+
+    bool make_current_thread_real_time()
+    {
+        sched_param parameters;
+        parameters.sched_priority = sched_get_priority_max(SCHED_FIFO);
+        return (pthread_setschedparam(pthread_self(), SCHED_FIFO, &parameters) == 0);
+    }
+
+    template <class Queue> void run_threaded_queue_benchmark(const std::string &name)
+    {
+        QueueBenchmarkSink sink;
+        int pushed = 0;
+        unsigned long dropped = 0;
+        bool is_real_time = false;
+        BenchmarkStatistics push_cost;
+
+        {
+            Queue queue(sink);
+            std::atomic<bool> finished(false);
+            std::atomic<int> background_pushed(0);
+
+            const double block_microseconds = 1000000.0 * k::benchmark::samplesPerBuffer / k::benchmark::sampleRate;
+            const int blocks = k::benchmark::queueBenchmarkSeconds * k::benchmark::sampleRate / k::benchmark::samplesPerBuffer;
+
+            std::thread real_time_thread([&]()
+            {
+                is_real_time = make_current_thread_real_time();
+
+                benchmark_clock::time_point next_block = benchmark_clock::now();
+                for (int block = 0; block < blocks; block++)
+                {
+                    next_block += std::chrono::microseconds((long) block_microseconds);
+                    std::this_thread::sleep_until(next_block);
+
+                    for (int i = 0; i < k::benchmark::queuePushesPerBlock; i++)
+                    {
+                        QueueBenchmarkItem item = { 0, pushed };
+
+                        benchmark_clock::time_point start = benchmark_clock::now();
+                        bool was_pushed = queue.push(item);
+                        push_cost.add(microseconds_between(start, benchmark_clock::now()));
+
+                        if (was_pushed) pushed++;
+                    }
+                }
+
+                finished = true;
+            });
+
+            const double background_interval = 1000000.0 / k::benchmark::queueBackgroundPushesPerSecond;
+            benchmark_clock::time_point start = benchmark_clock::now();
+            for (int i = 0; !finished; i++)
+            {
+                QueueBenchmarkItem item = { 1, i };
+                if (queue.push(item)) background_pushed++;
+
+                while (!finished && microseconds_between(start, benchmark_clock::now()) < (i + 1) * background_interval)
+                {
+                    std::this_thread::yield();
+                }
+            }
+
+            real_time_thread.join();
+
+            pushed += background_pushed;
+            dropped = queue.get_dropped_count();
+        }
+
+        push_cost.report(name + " push cost from " + (is_real_time ? "SCHED_FIFO" : "normal priority") + " thread", "us");
+        std::cout << "[ BENCHMARK] " << name << ": " << sink.delivered << " items in " << sink.deliveries << " deliveries, " << dropped << " dropped" << std::endl;
+
+        /* the queues deliver everything they accepted before they're destroyed */
+        ASSERT_EQ(sink.delivered.load(), pushed);
+    }
+}
+
+TEST(ThreadedQueueBenchmark, LockedListQueuePushLatency)
+{
+    run_threaded_queue_benchmark<LockedListQueue>("locked list queue (before)");
+}
+
+TEST(ThreadedQueueBenchmark, LockFreeQueuePushLatency)
+{
+    run_threaded_queue_benchmark<LockFreeQueue>("lock-free threaded queue (after)");
+}
+
+
+#pragma mark - DSP load statistics
+
+/*
+ CDspLoadMonitor::record_block runs at the end of every audio callback, so its own cost is
+ measured here, along with the accuracy of the statistics derived from its histogram.
+ */
+
+TEST(DspLoadBenchmark, RecordBlockCost)
+{
+    CDspLoadMonitor monitor(k::benchmark::samplesPerBuffer);
+
+    std::mt19937 random(1);
+    std::uniform_int_distribution<uint64_t> block_nanoseconds(50000, 1500000);
+
+    std::vector<uint64_t> timings(k::benchmark::dspLoadRecordedBlocks);
+    for (uint64_t &timing : timings) timing = block_nanoseconds(random);
+
+    benchmark_clock::time_point start = benchmark_clock::now();
+    for (uint64_t timing : timings)
+    {
+        monitor.record_block(timing, k::benchmark::sampleRate);
+    }
+    double elapsed = microseconds_between(start, benchmark_clock::now());
+
+    std::cout << "[ BENCHMARK] dsp load monitor record_block cost: " << elapsed * 1000 / timings.size() << "ns per block" << std::endl;
+
+    CDspLoadSnapshot start_snapshot, end_snapshot;
+    monitor.take_snapshot(end_snapshot);
+
+    CAudioStatistics statistics;
+    end_snapshot.get_statistics(start_snapshot, statistics);
+    ASSERT_EQ(statistics.blocks_processed, k::benchmark::dspLoadRecordedBlocks);
+}
+
+TEST(DspLoadBenchmark, StatisticsMatchRecordedTimings)
+{
+    CDspLoadMonitor monitor(k::benchmark::samplesPerBuffer);
+
+    CDspLoadSnapshot first, second, third;
+    monitor.take_snapshot(first);
+
+    // 998 blocks of 100us, then a 500us block and a 2ms block which overruns the 1451us budget
+    for (int i = 0; i < 998; i++) monitor.record_block(100000, k::benchmark::sampleRate);
+    monitor.record_block(500000, k::benchmark::sampleRate);
+    monitor.record_block(2000000, k::benchmark::sampleRate);
+    monitor.record_skipped_block();
+
+    monitor.take_snapshot(second);
+
+    CAudioStatistics statistics;
+    second.get_statistics(first, statistics);
+
+    ASSERT_EQ(statistics.blocks_processed, 1000);
+    ASSERT_EQ(statistics.total_blocks_skipped, 1);
+    ASSERT_NEAR(statistics.budget_microseconds, 1451.25, 0.01);
+    ASSERT_DOUBLE_EQ(statistics.min_microseconds, 100);
+    ASSERT_DOUBLE_EQ(statistics.max_microseconds, 2000);
+    ASSERT_NEAR(statistics.mean_microseconds, 102.3, 0.001);
+    ASSERT_GE(statistics.p99_microseconds, 100);
+    ASSERT_LE(statistics.p99_microseconds, 100 + CDspLoadMonitor::bucket_microseconds);
+    ASSERT_GE(statistics.p999_microseconds, 500);
+    ASSERT_LE(statistics.p999_microseconds, 500 + CDspLoadMonitor::bucket_microseconds);
+    ASSERT_NEAR(statistics.max_budget_percent, 137.8, 0.1);
+
+    // the next period only sees its own blocks
+    for (int i = 0; i < 10; i++) monitor.record_block(300000, k::benchmark::sampleRate);
+    monitor.take_snapshot(third);
+    third.get_statistics(second, statistics);
+
+    ASSERT_EQ(statistics.blocks_processed, 10);
+    ASSERT_EQ(statistics.total_blocks_processed, 1010);
+    ASSERT_DOUBLE_EQ(statistics.min_microseconds, 300);
+    ASSERT_DOUBLE_EQ(statistics.max_microseconds, 300);
+    ASSERT_DOUBLE_EQ(statistics.p999_microseconds, 300);
+}
+
+
+#pragma mark - Deferred dsp graph rebuild
+
+/*
+ Builds a container of k::benchmark::graphModules TapDelays, each one's audio output connected to the
+ next one's input.  Every module add and connection is a canvas edit, after which pd resorts its whole
+ dsp chain unless the edit is made inside a graph edit scope.
+
+ The 'before' case creates the modules and connections with individual commands, which don't open a
+ scope.  The 'after' cases make the same edits in one command batch, and by loading the same container
+ from a file - both open a scope, so pd rebuilds its dsp chain once.  Each time includes a final block
+ processed on the test thread, which applies any edits still queued for libpd.  The slowest block seen
+ by the dsp load monitor during each build is reported too, since that is what the audience hears.
+ */
+
+namespace
+{
+    std::string find_stream_endpoint(IServer &server, const GUID &module_guid, IStreamInfo::stream_direction direction)
+    {
+        const IInterfaceDefinition *interface_definition = server.find_interface(module_guid);
+        assert(interface_definition);
+
+        const endpoint_definition_list &endpoints = interface_definition->get_endpoint_definitions();
+        for (endpoint_definition_list::const_iterator i = endpoints.begin(); i != endpoints.end(); i++)
+        {
+            const IEndpointDefinition *endpoint = *i;
+            if (endpoint->get_type() == IEndpointDefinition::STREAM && endpoint->get_stream_info()->get_direction() == direction)
+            {
+                return endpoint->get_name();
+            }
+        }
+
+        return "";
+    }
+
+    void add_graph_commands(std::vector<ICommand *> &commands, IServer &server, const std::string &container_name)
+    {
+        GUID container_guid = find_module_guid(server, "Container");
+        GUID connection_guid = find_module_guid(server, "Connection");
+        GUID tap_delay_guid;
+        CGuidHelper::string_to_guid(k::benchmark::tapDelayGUID, tap_delay_guid);
+
+        std::string output = find_stream_endpoint(server, tap_delay_guid, IStreamInfo::OUTPUT);
+        std::string input = find_stream_endpoint(server, tap_delay_guid, IStreamInfo::INPUT);
+        assert(!output.empty() && !input.empty());
+
+        CPath container_path(container_name);
+        commands.push_back(INewCommand::create(container_guid, container_name, CPath()));
+
+        for (int i = 0; i < k::benchmark::graphModules; i++)
+        {
+            std::ostringstream name;
+            name << "TapDelay" << i;
+            commands.push_back(INewCommand::create(tap_delay_guid, name.str(), container_path));
+        }
+
+        for (int i = 0; i + 1 < k::benchmark::graphModules; i++)
+        {
+            std::ostringstream name, source, target;
+            name << "Connection" << i;
+            source << "TapDelay" << i << "." << output;
+            target << "TapDelay" << (i + 1) << "." << input;
+
+            std::string connection_path = container_name + "." + name.str();
+            commands.push_back(INewCommand::create(connection_guid, name.str(), container_path));
+            commands.push_back(ISetCommand::create(connection_path + ".sourcePath", CStringValue(source.str())));
+            commands.push_back(ISetCommand::create(connection_path + ".targetPath", CStringValue(target.str())));
+        }
+    }
+}
+
+class DspGraphRebuildBenchmark : public BenchmarkServerTest
+{
+protected:
+
+    /* runs build with the server locked, then applies any edits still queued for libpd */
+    template <class Build> void time_graph_build(const std::string &name, const std::string &container_name, Build build)
+    {
+        BenchmarkStatistics build_time;
+        BenchmarkStatistics slowest_block;
+
+        std::vector<float> input(CDspEngine::samples_per_buffer * 2, 0);
+        std::vector<float> output(CDspEngine::samples_per_buffer * 2, 0);
+
+        for (int r = 0; r < k::benchmark::graphRepetitions; r++)
+        {
+            {
+                CServerLock locked_server = server();
+                CDspEngine &dsp_engine = dynamic_cast<CServer &>(*locked_server).get_dsp_engine();
+
+                CDspLoadSnapshot before, after;
+                dsp_engine.get_load_monitor().take_snapshot(before);
+
+                benchmark_clock::time_point start = benchmark_clock::now();
+                build(*locked_server);
+                dsp_engine.process_buffer(&input[0], &output[0], 2, 2, k::benchmark::sampleRate, true);
+                build_time.add(microseconds_between(start, benchmark_clock::now()) / 1000);
+
+                dsp_engine.get_load_monitor().take_snapshot(after);
+                CAudioStatistics statistics;
+                after.get_statistics(before, statistics);
+                slowest_block.add(statistics.max_microseconds / 1000);
+
+                ASSERT_TRUE(locked_server->find_node(CPath(container_name + ".TapDelay" + std::to_string(k::benchmark::graphModules - 1))));
+            }
+
+            ASSERT_EQ(server()->process_command(IDeleteCommand::create(CPath(container_name))), CError::SUCCESS);
+        }
+
+        build_time.report(name + ", " + std::to_string(k::benchmark::graphModules) + " connected modules", "ms");
+        slowest_block.report(name + ", slowest dsp block", "ms");
+    }
+};
+
+TEST_F(DspGraphRebuildBenchmark, IndividualCommandsRebuildPerEdit)
+{
+    time_graph_build("individual commands (before)", "Graph", [](IServer &locked_server)
+    {
+        std::vector<ICommand *> commands;
+        add_graph_commands(commands, locked_server, "Graph");
+
+        for (ICommand *command : commands)
+        {
+            ASSERT_EQ(locked_server.process_command(command), CError::SUCCESS);
+        }
+    });
+}
+
+TEST_F(DspGraphRebuildBenchmark, BatchedCommandsRebuildOnce)
+{
+    time_graph_build("one command batch (after)", "Graph", [](IServer &locked_server)
+    {
+        std::vector<ICommand *> commands;
+        add_graph_commands(commands, locked_server, "Graph");
+
+        ICommandBatch *batch = ICommandBatch::create();
+        for (ICommand *command : commands)
+        {
+            batch->add_command(command);
+        }
+
+        ASSERT_EQ(locked_server.process_command(batch), CError::SUCCESS);
+    });
+}
+
+TEST_F(DspGraphRebuildBenchmark, CollectionLoadRebuildsOnce)
+{
+    {
+        CServerLock locked_server = server();
+
+        std::vector<ICommand *> commands;
+        add_graph_commands(commands, *locked_server, "Graph");
+        for (ICommand *command : commands)
+        {
+            ASSERT_EQ(locked_server->process_command(command), CError::SUCCESS);
+        }
+
+        ASSERT_EQ(locked_server->process_command(ISaveCommand::create(k::benchmark::graphCollectionFile, CPath("Graph"))), CError::SUCCESS);
+        ASSERT_EQ(locked_server->process_command(IDeleteCommand::create(CPath("Graph"))), CError::SUCCESS);
+    }
+
+    /* a loaded collection's top level node is named after its file */
+    std::string container_name = k::benchmark::graphCollectionFile.substr(0, k::benchmark::graphCollectionFile.find('.'));
+
+    time_graph_build("collection load (after)", container_name, [](IServer &locked_server)
+    {
+        ASSERT_EQ(locked_server.process_command(ILoadCommand::create(k::benchmark::graphCollectionFile, CPath())), CError::SUCCESS);
+    });
+
+    std::remove(k::benchmark::graphCollectionFile.c_str());
+}
+
+/*
+ Makes the same one-batch build whilst blocks are driven through process_buffer.  Each TapDelay takes
+ several dsp commands, so the edit outgrows the dsp command queue and is delivered as several suspended
+ batches.  Each batch reaches libpd within a single block, so no block should end with pd's dsp chain
+ still suspended - previously the chain stayed suspended from the first overflow until the edit ended
+ */
+
+TEST_F(DspGraphRebuildBenchmark, OverflowingBatchWithAudioRunning)
+{
+    CDspEngine &dsp_engine = dynamic_cast<CServer &>(*server()).get_dsp_engine();
+
+    BlockDriver driver(dsp_engine);
+    driver.start();
+
+    /* let the driver initialise libpd's audio configuration */
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    BenchmarkStatistics build_time;
+    CError err;
+    {
+        CServerLock locked_server = server();
+
+        std::vector<ICommand *> commands;
+        add_graph_commands(commands, *locked_server, "Graph");
+
+        ICommandBatch *batch = ICommandBatch::create();
+        for (ICommand *command : commands)
+        {
+            batch->add_command(command);
+        }
+
+        benchmark_clock::time_point start = benchmark_clock::now();
+        err = locked_server->process_command(batch);
+        build_time.add(microseconds_between(start, benchmark_clock::now()) / 1000);
+    }
+
+    /* let the driver deliver the last batch */
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    driver.stop();
+
+    ASSERT_EQ(err, CError::SUCCESS);
+
+    build_time.report("one command batch with audio running, " + std::to_string(k::benchmark::graphModules) + " connected modules", "ms");
+    driver.block_cost.report("process_buffer cost during the build", "us");
+    std::cout << "[ BENCHMARK] " << driver.suspended_blocks << " of " << driver.blocks << " blocks ended with the dsp chain suspended" << std::endl;
+
+    ASSERT_TRUE(server()->find_node(CPath("Graph.TapDelay" + std::to_string(k::benchmark::graphModules - 1))));
+    ASSERT_EQ(driver.suspended_blocks, 0);
+}
+
+
+#pragma mark - Host canvas module removal
+
+/*
+ Measures the cost of deleting one module instance as the number of modules on the host canvas grows.
+
+ Each delete is applied to libpd by processing a block on the test thread, and the time includes that
+ block.  When modules were removed with find and cut, pd searched the text of every object on the canvas
+ and the engine renumbered every remaining module; with the module instances addressed directly this
+ should stay roughly flat.
+ */
+
+TEST_F(BenchmarkServerTest, ModuleRemovalCostByModuleCount)
+{
+    GUID guid;
+    CGuidHelper::string_to_guid(k::benchmark::tapDelayGUID, guid);
+
+    std::vector<float> input(CDspEngine::samples_per_buffer * 2, 0);
+    std::vector<float> output(CDspEngine::samples_per_buffer * 2, 0);
+
+    for (int module_count : k::benchmark::canvasModuleCounts)
+    {
+        for (int i = 0; i < module_count; i++)
+        {
+            std::ostringstream name;
+            name << "TapDelay" << i;
+            ASSERT_EQ(server()->process_command(INewCommand::create(guid, name.str(), CPath())), CError::SUCCESS);
+        }
+
+        CServerLock locked_server = server();
+        CServer &internal_server = dynamic_cast<CServer &>(*locked_server);
+        CDspEngine &dsp_engine = internal_server.get_dsp_engine();
+
+        internal_server.ping_all_dsp_modules();
+
+        BenchmarkStatistics removal;
+
+        /* remove modules spread across the canvas, rather than only the newest */
+        for (int r = 0; r < k::benchmark::canvasRemovals; r++)
+        {
+            std::ostringstream name;
+            name << "TapDelay" << (r * module_count / k::benchmark::canvasRemovals);
+
+            benchmark_clock::time_point start = benchmark_clock::now();
+            ASSERT_EQ(locked_server->process_command(IDeleteCommand::create(CPath(name.str()))), CError::SUCCESS);
+            dsp_engine.process_buffer(&input[0], &output[0], 2, 2, k::benchmark::sampleRate, true);
+            removal.add(microseconds_between(start, benchmark_clock::now()));
+        }
+
+        removal.report(std::to_string(module_count) + " modules, delete one module", "us");
+
+        for (int i = 0; i < module_count; i++)
+        {
+            std::ostringstream name;
+            name << "TapDelay" << i;
+            if (locked_server->find_node(CPath(name.str())))
+            {
+                ASSERT_EQ(locked_server->process_command(IDeleteCommand::create(CPath(name.str()))), CError::SUCCESS);
+            }
+        }
+    }
+}
+
+
+#pragma mark - Abstraction cache
+
+/*
+ Measures the time to instantiate each of k::benchmark::abstractionInstances TapDelays, including the
+ block processed on the test thread which creates the instance in libpd.
+
+ The 'before' case invalidates the TapDelay's implementation directory ahead of every instance, so
+ that pd reads and parses the module's abstraction and each of its handler abstractions from the
+ scratch directory every time.  The 'after' case leaves the parsed abstraction cache alone, so only
+ the first instance reads any files.
+ */
+
+TEST_F(BenchmarkServerTest, ModuleInstantiationWithAbstractionCache)
+{
+    GUID guid;
+    CGuidHelper::string_to_guid(k::benchmark::tapDelayGUID, guid);
+
+    std::vector<float> input(CDspEngine::samples_per_buffer * 2, 0);
+    std::vector<float> output(CDspEngine::samples_per_buffer * 2, 0);
+
+    CServerLock locked_server = server();
+    CServer &internal_server = dynamic_cast<CServer &>(*locked_server);
+    CDspEngine &dsp_engine = internal_server.get_dsp_engine();
+
+    const CInterfaceDefinition *interface_definition = dynamic_cast<const CInterfaceDefinition *>(locked_server->find_interface(guid));
+    ASSERT_TRUE(interface_definition);
+    std::string patch_path = CModuleManager::downcast(locked_server->get_module_manager()).get_patch_path(*interface_definition);
+    std::string implementation_directory = patch_path.substr(0, patch_path.find_last_of("/\\") + 1);
+
+    for (bool use_cache : { false, true })
+    {
+        BenchmarkStatistics instantiation;
+
+        for (int i = 0; i < k::benchmark::abstractionInstances; i++)
+        {
+            if (!use_cache)
+            {
+                dsp_engine.invalidate_abstractions(implementation_directory);
+                dsp_engine.process_buffer(&input[0], &output[0], 2, 2, k::benchmark::sampleRate, true);
+            }
+
+            std::ostringstream name;
+            name << "TapDelay" << i;
+
+            benchmark_clock::time_point start = benchmark_clock::now();
+            ASSERT_EQ(locked_server->process_command(INewCommand::create(guid, name.str(), CPath())), CError::SUCCESS);
+            dsp_engine.process_buffer(&input[0], &output[0], 2, 2, k::benchmark::sampleRate, true);
+            instantiation.add(microseconds_between(start, benchmark_clock::now()));
+        }
+
+        instantiation.report(use_cache ? "instantiate with abstraction cache (after)" : "instantiate, parsing every abstraction (before)", "us");
+
+        for (int i = 0; i < k::benchmark::abstractionInstances; i++)
+        {
+            std::ostringstream name;
+            name << "TapDelay" << i;
+            ASSERT_EQ(locked_server->process_command(IDeleteCommand::create(CPath(name.str()))), CError::SUCCESS);
+        }
+    }
+
+    int hits = 0, misses = 0;
+    integra_abstraction_cache_get_statistics(&hits, &misses);
+    std::cout << "[ BENCHMARK] abstraction cache: " << hits << " hits, " << misses << " misses" << std::endl;
+}
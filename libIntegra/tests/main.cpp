@@ -20,9 +20,14 @@
 #include "path.h"
 
 #include "../src/node.h"
+#include "../src/player_transport.h"
+#include "../src/dsp_command_queue.h"
 
 #include "gtest.h"
 
+#include <random>
+#include <set>
+
 
 
 using namespace testing;
@@ -37,6 +42,40 @@ namespace k
     const std::string tapDelayName              = "TapDelay1";
     const std::string tapDelayEndpoint          = tapDelayName + "." + "delayTime";
     const float testFloatValue                  = 1.5f;
+    const std::string scriptModuleName          = "Script";
+    const std::string soundfilerModuleName      = "Soundfiler";
+    const std::string soundfilerName            = "Soundfiler1";
+    const std::string scriptName                = "Script1";
+    
+    namespace transport
+    {
+        const int framesPerBlock                = 64;
+        const int sampleRate                    = 44100;
+        const int rate                          = 1000;
+        const int64_t startFrame                = 1000;
+        const int initialTick                   = 10;
+        const int endTick                       = 1010;
+        const int64_t lookaheadFrames           = 2205;
+        const int maxWakeGapBlocks              = 16;
+        const int64_t blocksToRender            = 1000;
+        const int commandQueueSlots             = 1024;
+        const int schedulerSlots                = 256;
+    }
+}
+
+const GUID &find_module_guid(IServer &server, const std::string &module_name)
+{
+    const guid_set &module_ids = server.get_all_module_ids();
+    for (const GUID &module_id : module_ids)
+    {
+        const IInterfaceDefinition *interface_definition = server.find_interface(module_id);
+        if (interface_definition && interface_definition->get_interface_info().get_name() == module_name)
+        {
+            return interface_definition->get_module_guid();
+        }
+    }
+    
+    return CGuidHelper::null_guid;
 }
 
 class SessionTest : public ::testing::Test
@@ -266,6 +305,202 @@ TEST_F(CommandTest, SetCommandSetsValue)
 }
 
 
+// a value which doesn't fit in a dsp command is refused, rather than sent to the module without its value
+TEST_F(CommandTest, SetCommandStringTooLongForDsp)
+{
+    CError err = server()->process_command(INewCommand::create(find_module_guid(*server(), k::soundfilerModuleName), k::soundfilerName, CPath()));
+    assert(err == CError::SUCCESS);
+    
+    std::string longPath(integra_internal::CDspCommand::string_storage_size, 'a');
+    err = server()->process_command(ISetCommand::create(CPath(k::soundfilerName + ".load"), CStringValue(longPath)));
+    ASSERT_EQ(err, CError::FAILED);
+    
+    // the abandoned command slot is reused
+    err = server()->process_command(ISetCommand::create(k::tapDelayEndpoint, CFloatValue(k::testFloatValue)));
+    ASSERT_EQ(err, CError::SUCCESS);
+}
+
+TEST(DspCommandTest, SymbolLongerThanStringStorageIsRejected)
+{
+    using namespace integra_internal;
+    
+    CDspCommand command;
+    command.clear();
+    command.set_node_target(1);
+    
+    ASSERT_TRUE(command.add_symbol("load"));
+    ASSERT_FALSE(command.add_symbol(std::string(CDspCommand::string_storage_size, 'a').c_str()));
+    ASSERT_EQ(command.get_number_of_atoms(), 1);
+}
+
+
+#pragma mark - Test scripts
+
+class ScriptTest : public ServerTest
+{
+protected:
+    void SetUp() override
+    {
+        CError err = server()->process_command(INewCommand::create(find_module_guid(*server(), k::scriptModuleName), k::scriptName, CPath()));
+        assert(err == CError::SUCCESS);
+    }
+    
+    CError run(const std::string &text)
+    {
+        CError err = server()->process_command(ISetCommand::create(CPath(k::scriptName + ".text"), CStringValue(text)));
+        if (err != CError::SUCCESS) return err;
+        
+        return server()->process_command(ISetCommand::create(CPath(k::scriptName + ".trigger")));
+    }
+    
+    std::string info()
+    {
+        return *server()->get_value(CPath(k::scriptName + ".info"));
+    }
+};
+
+// the nested run mustn't reset or replace the state which the outer run is still executing
+TEST_F(ScriptTest, ScriptCanTriggerItself)
+{
+    const std::string script = k::scriptName + ".trigger = 1 print(\"outer run finished\")";
+    
+    for (int i = 0; i < 2; i++)
+    {
+        ASSERT_EQ(run(script), CError::SUCCESS);
+        ASSERT_NE(info().find("outer run finished"), std::string::npos);
+        ASSERT_NE(info().find("_done_"), std::string::npos);
+    }
+    
+    // a new text still replaces the cached state once nothing is running
+    ASSERT_EQ(run("print(\"new text\")"), CError::SUCCESS);
+    ASSERT_NE(info().find("new text"), std::string::npos);
+}
+
+
+
+#pragma mark - Test player transport
+
+struct DispatchedTick
+{
+    int tick;
+    bool stop;
+    int64_t frame;
+    int64_t blockStart;
+    
+    bool operator==(const DispatchedTick &other) const
+    {
+        return tick == other.tick && stop == other.stop && frame == other.frame && blockStart == other.blockStart;
+    }
+};
+
+// Records ticks as the dsp side dispatches them, with the block which dispatched them
+class TickRecorder : public integra_internal::IDspCommandDispatcher
+{
+public:
+    
+    void dispatch_command(const integra_internal::CDspCommand &command) override
+    {
+        dispatched.push_back({ int(command.get_float(0)), command.get_float(1) != 0, command.get_frame(), blockStart });
+    }
+    
+    std::vector<DispatchedTick> dispatched;
+    int64_t blockStart = 0;
+};
+
+// Renders blocks offline, as the audio thread would, waking the player side after a random
+// number of blocks each time. The dsp side is CDspEngine's own dispatch loop.
+// Returns ticks in the order in which the dsp side dispatched them
+std::vector<DispatchedTick> renderPlayerOffline(unsigned int seed)
+{
+    using namespace integra_internal;
+    
+    CPlayerTransport transport(k::transport::framesPerBlock);
+    transport.start(k::transport::startFrame, k::transport::sampleRate, k::transport::initialTick, k::transport::rate, false, 0, k::transport::endTick);
+    
+    CDspCommandQueue queue(k::transport::commandQueueSlots);
+    CDspCommandScheduler scheduler(k::transport::schedulerSlots);
+    CPlayerTransport::event_list events;
+    TickRecorder recorder;
+    
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> wakeGap(0, k::transport::maxWakeGapBlocks);
+    int64_t nextWakeBlock = 0;
+    
+    for (int64_t block = 0; block < k::transport::blocksToRender; block++)
+    {
+        int64_t blockStart = block * k::transport::framesPerBlock;
+        int64_t blockEnd = blockStart + k::transport::framesPerBlock;
+        
+        // player side
+        if (block >= nextWakeBlock)
+        {
+            events.clear();
+            transport.schedule_until(blockStart + k::transport::lookaheadFrames, events);
+            
+            for (const auto &event : events)
+            {
+                CDspCommand *command = queue.begin_write();
+                command->set_frame(event.m_frame);
+                command->add_float(event.m_tick);
+                command->add_float(event.m_stop ? 1 : 0);
+                queue.end_write();
+            }
+            
+            nextWakeBlock = block + 1 + wakeGap(random);
+        }
+        
+        // dsp side
+        recorder.blockStart = blockStart;
+        scheduler.dispatch_commands(queue, blockEnd, recorder);
+    }
+    
+    return recorder.dispatched;
+}
+
+TEST(PlayerTransportTest, OfflineRenderIsSampleAccurate)
+{
+    auto dispatched = renderPlayerOffline(1);
+    ASSERT_FALSE(dispatched.empty());
+    
+    // one event for each block which contains at least one tick
+    std::set<int64_t> blocksWithTicks;
+    for (int64_t elapsed = 1; elapsed <= k::transport::endTick - k::transport::initialTick; elapsed++)
+    {
+        int64_t frame = k::transport::startFrame + (elapsed * k::transport::sampleRate + k::transport::rate - 1) / k::transport::rate;
+        blocksWithTicks.insert(frame / k::transport::framesPerBlock);
+    }
+    ASSERT_EQ(dispatched.size(), blocksWithTicks.size());
+    
+    int64_t previousFrame = -1;
+    for (const auto &tick : dispatched)
+    {
+        // each tick falls on the first frame at which its elapsed time has been reached
+        int64_t elapsed = tick.tick - k::transport::initialTick;
+        ASSERT_GE((tick.frame - k::transport::startFrame) * k::transport::rate, elapsed * k::transport::sampleRate);
+        ASSERT_LT((tick.frame - 1 - k::transport::startFrame) * k::transport::rate, elapsed * k::transport::sampleRate);
+        
+        // ...and is dispatched in the block which contains that frame
+        ASSERT_GE(tick.frame, tick.blockStart);
+        ASSERT_LT(tick.frame, tick.blockStart + k::transport::framesPerBlock);
+        
+        ASSERT_GT(tick.frame, previousFrame);
+        previousFrame = tick.frame;
+    }
+    
+    ASSERT_TRUE(dispatched.back().stop);
+    ASSERT_EQ(dispatched.back().tick, k::transport::endTick);
+}
+
+TEST(PlayerTransportTest, OfflineRenderIsIndependentOfWakeTimes)
+{
+    auto reference = renderPlayerOffline(1);
+    
+    for (unsigned int seed = 2; seed < 10; seed++)
+    {
+        ASSERT_EQ(renderPlayerOffline(seed), reference);
+    }
+}
+
 
 #pragma mark - Test module manager
 